@@ -8,6 +8,9 @@
 #ifdef _BLECENTRAL_ENABLE_
 
 #include <NimBLEDevice.h>
+#include <vector>
+#include <map>
+#include <algorithm>
 #include "module_utils.h"
 #include "module_blecentral.h"
 
@@ -51,6 +54,57 @@ static NimBLEConnInfo* g_pPendingConn = NULL;
 
 static std::string g_connect_address;
 static void task_connect(void *);
+
+#define SCAN_LIST_MAX             256
+#define SCAN_SEEN_MAX             256
+
+typedef struct{
+  std::string address;
+  std::vector<uint8_t> payload;
+  int rssi;
+  bool have_name;
+  std::string name;
+  bool have_service_uuid;
+  std::string service_uuid;
+  bool have_tx_power;
+  int tx_power;
+} BLECENT_SCAN_INFO;
+
+typedef struct{
+  bool enable_service_uuid;
+  NimBLEUUID service_uuid;
+  std::string name_prefix;
+  bool enable_rssi;
+  int rssi;
+  bool enable_manufacturer_id;
+  uint16_t manufacturer_id;
+  uint32_t duplicate_interval;
+  bool streaming;
+} BLECENT_SCAN_FILTER;
+
+static BLECENT_SCAN_FILTER g_scan_filter;
+static std::vector<BLECENT_SCAN_INFO> g_scan_list;
+static std::map<uint64_t, uint32_t> g_scan_seen;
+static uint32_t g_scan_dropped = 0;
+static SemaphoreHandle_t g_scan_mutex = NULL;
+
+// notification ring: [uint16_t length][uint16_t handle][data...] records, one producer (NimBLE host) and one consumer (loop)
+#define NOTIFY_RING_SIZE          8192 // power of 2
+#define NOTIFY_RECORD_HEADER      4
+#define NOTIFY_SUBSCRIBE_MAX      8
+
+typedef struct{
+  uint16_t handle;
+  std::string uuid;
+  bool batch;
+} BLECENT_NOTIFY_SUBSCRIBE;
+
+static uint8_t *g_notify_ring = NULL;
+static volatile uint32_t g_notify_head = 0;
+static volatile uint32_t g_notify_tail = 0;
+static volatile uint32_t g_notify_dropped = 0; // written by the producer only
+static uint32_t g_notify_dropped_base = 0; // g_notify_dropped at the last clear, consumer side
+static std::vector<BLECENT_NOTIFY_SUBSCRIBE> g_notify_subscribes;
 static void taskServer(void *);
 
 #define BLE_CAP_NONE              0x0000
@@ -74,6 +128,49 @@ static uint32_t toCapability(NimBLERemoteCharacteristic* pChar)
   return cap;
 }
 
+// call with g_scan_mutex held, makes room for one more address in g_scan_seen
+static void prune_scan_seen(uint32_t now)
+{
+  if( g_scan_seen.size() < SCAN_SEEN_MAX )
+    return;
+
+  // entries past the interval no longer suppress anything
+  if( g_scan_filter.duplicate_interval > 0 ){
+    for( auto it = g_scan_seen.begin() ; it != g_scan_seen.end() ; ){
+      if( (now - it->second) >= g_scan_filter.duplicate_interval )
+        it = g_scan_seen.erase(it);
+      else
+        ++it;
+    }
+    if( g_scan_seen.size() < SCAN_SEEN_MAX )
+      return;
+  }
+
+  // still full, forget the address seen longest ago; it may be reported once more
+  auto oldest = g_scan_seen.begin();
+  for( auto it = g_scan_seen.begin() ; it != g_scan_seen.end() ; ++it ){
+    if( (now - it->second) > (now - oldest->second) )
+      oldest = it;
+  }
+  g_scan_seen.erase(oldest);
+}
+
+static void clear_scan_list(void)
+{
+  xSemaphoreTake(g_scan_mutex, portMAX_DELAY);
+  g_scan_list.clear();
+  g_scan_seen.clear();
+  g_scan_dropped = 0;
+  xSemaphoreGive(g_scan_mutex);
+}
+
+static void clear_notify_ring(void)
+{
+  g_notify_tail = g_notify_head;
+  g_notify_dropped_base = g_notify_dropped;
+  g_notify_subscribes.clear();
+}
+
 static void disconnect()
 {
   g_pClient->cancelConnect();
@@ -101,21 +198,43 @@ static void disconnect()
   }
 }
 
+static void notify_ring_write(uint32_t pos, const uint8_t *p_data, uint32_t length)
+{
+  pos &= (NOTIFY_RING_SIZE - 1);
+  uint32_t first = std::min(length, (uint32_t)NOTIFY_RING_SIZE - pos);
+  memmove(&g_notify_ring[pos], p_data, first);
+  memmove(&g_notify_ring[0], &p_data[first], length - first);
+}
+
+static void notify_ring_read(uint32_t pos, uint8_t *p_data, uint32_t length)
+{
+  pos &= (NOTIFY_RING_SIZE - 1);
+  uint32_t first = std::min(length, (uint32_t)NOTIFY_RING_SIZE - pos);
+  memmove(p_data, &g_notify_ring[pos], first);
+  memmove(&p_data[first], &g_notify_ring[0], length - first);
+}
+
 void myNotifyHandler(NimBLERemoteCharacteristic* pChar, uint8_t* data, size_t length, bool isNotify) {
 //  Serial.print("Notify received: ");
-  if( g_callback_func == JS_UNDEFINED )
+  if( g_callback_func == JS_UNDEFINED || g_notify_ring == NULL )
     return;
-  
-  BLECENT_EVENT_INFO info;  
-  info.type = BLEEVENT_TYPE_NOTIFY;
-  info.str = pChar->getUUID().toString();
-  info.p_data = (uint8_t*)malloc(length);
-  if( info.p_data == NULL )
+
+  uint32_t record_length = NOTIFY_RECORD_HEADER + length;
+  if( length > 0xffff || record_length > NOTIFY_RING_SIZE - (g_notify_head - g_notify_tail) ){
+    g_notify_dropped++;
     return;
-  memmove(info.p_data, data, length);
-  info.length = length;
+  }
 
-  g_event_list.push_back(info);
+  uint8_t header[NOTIFY_RECORD_HEADER];
+  uint16_t handle = pChar->getHandle();
+  header[0] = length & 0xff;
+  header[1] = (length >> 8) & 0xff;
+  header[2] = handle & 0xff;
+  header[3] = (handle >> 8) & 0xff;
+  notify_ring_write(g_notify_head, header, NOTIFY_RECORD_HEADER);
+  notify_ring_write(g_notify_head + NOTIFY_RECORD_HEADER, data, length);
+  __sync_synchronize();
+  g_notify_head += record_length;
 }
 
 class MyClientCallbacks : public NimBLEClientCallbacks {
@@ -167,6 +286,68 @@ class MyScanCallbacks: public NimBLEScanCallbacks
 {
   // void onResult(const NimBLEAdvertisedDevice* advertisedDevice) override {
   // }
+  void onResult(const NimBLEAdvertisedDevice* advertisedDevice) override {
+    if( g_scan_filter.enable_rssi && advertisedDevice->getRSSI() < g_scan_filter.rssi )
+      return;
+    if( g_scan_filter.enable_service_uuid && !advertisedDevice->isAdvertisingService(g_scan_filter.service_uuid) )
+      return;
+    if( g_scan_filter.name_prefix.length() > 0 ){
+      if( !advertisedDevice->haveName() || advertisedDevice->getName().compare(0, g_scan_filter.name_prefix.length(), g_scan_filter.name_prefix) != 0 )
+        return;
+    }
+    if( g_scan_filter.enable_manufacturer_id ){
+      if( !advertisedDevice->haveManufacturerData() )
+        return;
+      std::string data = advertisedDevice->getManufacturerData();
+      if( data.length() < 2 || (uint16_t)((uint8_t)data[0] | ((uint8_t)data[1] << 8)) != g_scan_filter.manufacturer_id )
+        return;
+    }
+
+    std::string address = advertisedDevice->getAddress().toString();
+    uint64_t key = (uint64_t)advertisedDevice->getAddress();
+    uint32_t now = millis();
+
+    xSemaphoreTake(g_scan_mutex, portMAX_DELAY);
+    auto it = g_scan_seen.find(key);
+    bool duplicated = (it != g_scan_seen.end()) && (g_scan_filter.duplicate_interval == 0 || (now - it->second) < g_scan_filter.duplicate_interval);
+    if( duplicated ){
+      // coalesce into the pending entry, if not delivered yet
+      for( auto &info : g_scan_list ){
+        if( info.address == address ){
+          info.rssi = advertisedDevice->getRSSI();
+          info.payload = advertisedDevice->getPayload();
+          break;
+        }
+      }
+      xSemaphoreGive(g_scan_mutex);
+      return;
+    }
+    if( g_scan_list.size() >= SCAN_LIST_MAX ){
+      g_scan_dropped++;
+      xSemaphoreGive(g_scan_mutex);
+      return;
+    }
+    if( it == g_scan_seen.end() )
+      prune_scan_seen(now);
+    g_scan_seen[key] = now;
+
+    BLECENT_SCAN_INFO info;
+    info.address = address;
+    info.payload = advertisedDevice->getPayload();
+    info.rssi = advertisedDevice->getRSSI();
+    info.have_name = advertisedDevice->haveName();
+    if( info.have_name )
+      info.name = advertisedDevice->getName();
+    info.have_service_uuid = advertisedDevice->haveServiceUUID();
+    if( info.have_service_uuid )
+      info.service_uuid = advertisedDevice->getServiceUUID().toString();
+    info.have_tx_power = advertisedDevice->haveTXPower();
+    if( info.have_tx_power )
+      info.tx_power = advertisedDevice->getTXPower();
+    g_scan_list.push_back(info);
+    xSemaphoreGive(g_scan_mutex);
+  }
+
   void onScanEnd(const NimBLEScanResults& scanResults, int reason) override{
     g_scanCompleted = true;
   }
@@ -411,11 +592,31 @@ static JSValue blecentral_subscribe(JSContext *ctx, JSValueConst jsThis, int arg
   JS_FreeCString(ctx, serviceUuid);
   JS_FreeCString(ctx, characteristicUuid);
 
+  bool batch = false;
+  if( magic == 0 && argc >= 3 )
+    batch = JS_ToBool(ctx, argv[2]);
+
+  uint16_t handle = pChar->getHandle();
+  for( auto it = g_notify_subscribes.begin() ; it != g_notify_subscribes.end() ; it++ ){
+    if( it->handle == handle ){
+      g_notify_subscribes.erase(it);
+      break;
+    }
+  }
+
   bool result;
-  if( magic == 0 )
+  if( magic == 0 ){
+    if( g_notify_subscribes.size() >= NOTIFY_SUBSCRIBE_MAX )
+      return JS_EXCEPTION;
+    BLECENT_NOTIFY_SUBSCRIBE subscribe;
+    subscribe.handle = handle;
+    subscribe.uuid = pChar->getUUID().toString();
+    subscribe.batch = batch;
+    g_notify_subscribes.push_back(subscribe);
     result = pChar->subscribe(true, myNotifyHandler, false);
-  else
+  }else{
     result = pChar->unsubscribe(false);
+  }
 
   return JS_NewBool(ctx, result);
 }
@@ -460,11 +661,77 @@ static JSValue blecentral_startScan(JSContext *ctx, JSValueConst jsThis, int arg
     g_pScan->setWindow(window);
   }
 
+  g_scan_filter.enable_service_uuid = false;
+  g_scan_filter.name_prefix = "";
+  g_scan_filter.enable_rssi = false;
+  g_scan_filter.enable_manufacturer_id = false;
+  g_scan_filter.duplicate_interval = 0;
+  g_scan_filter.streaming = false;
+
+  value = JS_GetPropertyStr(ctx, argv[1], "serviceUuid");
+  if( value != JS_UNDEFINED ){
+    const char *uuid = JS_ToCString(ctx, value);
+    JS_FreeValue(ctx, value);
+    if( uuid == NULL )
+      return JS_EXCEPTION;
+    g_scan_filter.service_uuid = NimBLEUUID(uuid);
+    g_scan_filter.enable_service_uuid = true;
+    JS_FreeCString(ctx, uuid);
+  }
+
+  value = JS_GetPropertyStr(ctx, argv[1], "namePrefix");
+  if( value != JS_UNDEFINED ){
+    const char *prefix = JS_ToCString(ctx, value);
+    JS_FreeValue(ctx, value);
+    if( prefix == NULL )
+      return JS_EXCEPTION;
+    g_scan_filter.name_prefix = prefix;
+    JS_FreeCString(ctx, prefix);
+  }
+
+  value = JS_GetPropertyStr(ctx, argv[1], "rssi");
+  if( value != JS_UNDEFINED ){
+    int32_t rssi;
+    JS_ToInt32(ctx, &rssi, value);
+    JS_FreeValue(ctx, value);
+    g_scan_filter.rssi = rssi;
+    g_scan_filter.enable_rssi = true;
+  }
+
+  value = JS_GetPropertyStr(ctx, argv[1], "manufacturerId");
+  if( value != JS_UNDEFINED ){
+    uint32_t id;
+    JS_ToUint32(ctx, &id, value);
+    JS_FreeValue(ctx, value);
+    g_scan_filter.manufacturer_id = (uint16_t)id;
+    g_scan_filter.enable_manufacturer_id = true;
+  }
+
+  value = JS_GetPropertyStr(ctx, argv[1], "duplicateInterval");
+  if( value != JS_UNDEFINED ){
+    uint32_t interval;
+    JS_ToUint32(ctx, &interval, value);
+    JS_FreeValue(ctx, value);
+    g_scan_filter.duplicate_interval = interval;
+  }
+
+  value = JS_GetPropertyStr(ctx, argv[1], "streaming");
+  if( value != JS_UNDEFINED ){
+    g_scan_filter.streaming = JS_ToBool(ctx, value);
+    JS_FreeValue(ctx, value);
+  }
+
+  // duplicates are coalesced here, so only let the controller drop them when no interval is requested
+  g_pScan->setDuplicateFilter(g_scan_filter.duplicate_interval == 0);
+  // results are kept in g_scan_list
+  g_pScan->setMaxResults(0);
+
   g_ctx = ctx;
   g_callback_scan_func = JS_DupValue(g_ctx, argv[2]);
 
   g_scanCompleted = false;
   g_pScan->clearResults();
+  clear_scan_list();
 
   bool ret = g_pScan->start(duration);
   isRunning = BLECENTRAL_RUNNING_SCAN;
@@ -506,6 +773,7 @@ static void blecentral_stopScan(void){
   if( isRunning == BLECENTRAL_RUNNING_SCAN ){
     g_pScan->stop();
     g_pScan->clearResults();
+    clear_scan_list();
     g_scanCompleted = false;
     isRunning = BLECENTRAL_RUNNING_NONE;
   }
@@ -583,7 +851,7 @@ static const JSCFunctionListEntry blecentral_funcs[] = {
         }},
     JSCFunctionListEntry{
         "subscribe", 0, JS_DEF_CFUNC, 0, {
-          func : {2, JS_CFUNC_generic_magic, {generic_magic : blecentral_subscribe}}
+          func : {3, JS_CFUNC_generic_magic, {generic_magic : blecentral_subscribe}}
         }},
     JSCFunctionListEntry{
         "isConnected", 0, JS_DEF_CFUNC, 1, {
@@ -732,6 +1000,7 @@ void endModule_blecentral(void)
       g_event_list.erase(g_event_list.begin());
     }
   }
+  clear_notify_ring();
 
   // default
   NimBLEDevice::setMTU(255);
@@ -739,7 +1008,88 @@ void endModule_blecentral(void)
   NimBLEDevice::setSecurityIOCap(BLE_HS_IO_NO_INPUT_OUTPUT);
 }
 
+static const BLECENT_NOTIFY_SUBSCRIBE *find_notify_subscribe(uint16_t handle)
+{
+  for( auto &subscribe : g_notify_subscribes ){
+    if( subscribe.handle == handle )
+      return &subscribe;
+  }
+  return NULL;
+}
+
+typedef struct{
+  std::string uuid;
+  bool batch;
+  uint32_t count;
+  JSValue data;
+} BLECENT_NOTIFY_DELIVERY;
+
+static void deliver_notify(void)
+{
+  // records queued after this point are left for the next loop
+  uint32_t head = g_notify_head;
+  __sync_synchronize();
+  if( g_notify_tail == head )
+    return;
+
+  // batched subscriptions are collected into one array per characteristic
+  std::vector<BLECENT_NOTIFY_DELIVERY> deliveries;
+  while( g_notify_tail != head ){
+    uint8_t header[NOTIFY_RECORD_HEADER];
+    notify_ring_read(g_notify_tail, header, NOTIFY_RECORD_HEADER);
+    uint16_t length = header[0] | (header[1] << 8);
+    uint16_t handle = header[2] | (header[3] << 8);
+
+    const BLECENT_NOTIFY_SUBSCRIBE *p_subscribe = find_notify_subscribe(handle);
+    uint8_t *p_data = (uint8_t*)malloc(length > 0 ? length : 1);
+    if( p_subscribe != NULL && p_data != NULL ){
+      notify_ring_read(g_notify_tail + NOTIFY_RECORD_HEADER, p_data, length);
+      JSValue data = create_Uint8Array(g_ctx, p_data, length);
+
+      BLECENT_NOTIFY_DELIVERY *p_delivery = NULL;
+      if( p_subscribe->batch ){
+        for( auto &delivery : deliveries ){
+          if( delivery.batch && delivery.uuid == p_subscribe->uuid ){
+            p_delivery = &delivery;
+            break;
+          }
+        }
+        if( p_delivery == NULL ){
+          deliveries.push_back({ p_subscribe->uuid, true, 0, JS_NewArray(g_ctx) });
+          p_delivery = &deliveries.back();
+        }
+        JS_SetPropertyUint32(g_ctx, p_delivery->data, p_delivery->count++, data);
+      }else{
+        deliveries.push_back({ p_subscribe->uuid, false, 1, data });
+      }
+    }
+    if( p_data != NULL )
+      free(p_data);
+    __sync_synchronize();
+    g_notify_tail += NOTIFY_RECORD_HEADER + length;
+  }
+
+  for( auto &delivery : deliveries ){
+    JSValue objs[2];
+    objs[0] = JS_NewString(g_ctx, delivery.batch ? "notify_batch" : "notify");
+    objs[1] = JS_NewObject(g_ctx);
+    JS_SetPropertyStr(g_ctx, objs[1], "characteristic", JS_NewString(g_ctx, delivery.uuid.c_str()));
+    JS_SetPropertyStr(g_ctx, objs[1], delivery.batch ? "list" : "data", delivery.data);
+    if( delivery.batch )
+      JS_SetPropertyStr(g_ctx, objs[1], "dropped", JS_NewUint32(g_ctx, g_notify_dropped - g_notify_dropped_base));
+
+    ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(g_ctx);
+    JSValue ret = qjs->callJsFunc_with_arg(g_ctx, g_callback_func, g_callback_func, 2, objs);
+    JS_FreeValue(g_ctx, objs[0]);
+    JS_FreeValue(g_ctx, objs[1]);
+    JS_FreeValue(g_ctx, ret);
+  }
+}
+
 void loopModule_blecentral(void){
+  if( g_callback_func != JS_UNDEFINED )
+    deliver_notify();
+
   if( g_callback_func != JS_UNDEFINED ){
     while(g_event_list.size() > 0){
       BLECENT_EVENT_INFO info = (BLECENT_EVENT_INFO)g_event_list.front();
@@ -768,6 +1118,7 @@ void loopModule_blecentral(void){
           break;
         }
         case BLEEVENT_TYPE_DISCONNECT: {
+          clear_notify_ring();
           objs[0] = JS_NewString(g_ctx, "disconnect");
           objs[1] = JS_UNDEFINED;
 
@@ -777,20 +1128,6 @@ void loopModule_blecentral(void){
           JS_FreeValue(g_ctx, ret);
           break;
         }
-        case BLEEVENT_TYPE_NOTIFY: {
-          objs[0] = JS_NewString(g_ctx, "notify");
-          objs[1] = JS_NewObject(g_ctx);
-          JS_SetPropertyStr(g_ctx, objs[1], "characteristic", JS_NewString(g_ctx, info.str.c_str()));
-          JS_SetPropertyStr(g_ctx, objs[1], "data", create_Uint8Array(g_ctx, info.p_data, info.length));
-          free(info.p_data);
-
-          ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(g_ctx);
-          JSValue ret = qjs->callJsFunc_with_arg(g_ctx, g_callback_func, g_callback_func, 2, objs);
-          JS_FreeValue(g_ctx, objs[0]);
-          JS_FreeValue(g_ctx, objs[1]);
-          JS_FreeValue(g_ctx, ret);
-          break;
-        }
         case BLEEVENT_TYPE_PASSKEY_ENTRY: {
           objs[0] = JS_NewString(g_ctx, "passkey_entry");
           objs[1] = JS_UNDEFINED;
@@ -823,42 +1160,49 @@ void loopModule_blecentral(void){
     }
   }
 
-  if( g_scanCompleted && g_callback_scan_func != JS_UNDEFINED ){
-    NimBLEScanResults results = g_pScan->getResults();
-    JSValue array = JS_NewArray(g_ctx);
-    for( int i = 0 ; i < results.getCount(); i++ ){
-      const BLEAdvertisedDevice* p_device = results.getDevice(i);
-      JSValue item = JS_NewObject(g_ctx);
-
-      JS_SetPropertyStr(g_ctx, item, "address", JS_NewString(g_ctx, p_device->getAddress().toString().c_str()));
-      const std::vector<uint8_t>& payload = p_device->getPayload();
-      uint8_t* raw = (uint8_t*)malloc(payload.size());
-      if( raw != NULL ){
-        std::copy(payload.begin(), payload.end(), raw);
-        JS_SetPropertyStr(g_ctx, item, "advertisement", JS_NewArrayBufferCopy(g_ctx, raw, payload.size()));
-        free(raw);
+  if( g_callback_scan_func != JS_UNDEFINED && (g_scanCompleted || g_scan_filter.streaming) ){
+    bool completed = g_scanCompleted;
+    std::vector<BLECENT_SCAN_INFO> list;
+    xSemaphoreTake(g_scan_mutex, portMAX_DELAY);
+    list.swap(g_scan_list);
+    uint32_t dropped = g_scan_dropped;
+    xSemaphoreGive(g_scan_mutex);
+
+    if( list.size() > 0 || completed ){
+      JSValue array = JS_NewArray(g_ctx);
+      for( int i = 0 ; i < list.size(); i++ ){
+        BLECENT_SCAN_INFO *p_info = &list[i];
+        JSValue item = JS_NewObject(g_ctx);
+
+        JS_SetPropertyStr(g_ctx, item, "address", JS_NewString(g_ctx, p_info->address.c_str()));
+        JS_SetPropertyStr(g_ctx, item, "advertisement", JS_NewArrayBufferCopy(g_ctx, p_info->payload.data(), p_info->payload.size()));
+        JS_SetPropertyStr(g_ctx, item, "rssi", JS_NewInt32(g_ctx, p_info->rssi));
+        if( p_info->have_name )
+          JS_SetPropertyStr(g_ctx, item, "name", JS_NewString(g_ctx, p_info->name.c_str()));
+        if( p_info->have_service_uuid )
+          JS_SetPropertyStr(g_ctx, item, "serviceUuid", JS_NewString(g_ctx, p_info->service_uuid.c_str()));
+        if( p_info->have_tx_power )
+          JS_SetPropertyStr(g_ctx, item, "txPower", JS_NewInt32(g_ctx, p_info->tx_power));
+
+        JS_SetPropertyUint32(g_ctx, array, i, item);
       }
-      JS_SetPropertyStr(g_ctx, item, "rssi", JS_NewInt32(g_ctx, p_device->getRSSI()));
-      if( p_device->haveName() )
-        JS_SetPropertyStr(g_ctx, item, "name", JS_NewString(g_ctx, p_device->getName().c_str()));
-      if( p_device->haveServiceUUID() )
-        JS_SetPropertyStr(g_ctx, item, "serviceUuid", JS_NewString(g_ctx, p_device->getServiceUUID().toString().c_str()));
-      if( p_device->haveTXPower() )
-        JS_SetPropertyStr(g_ctx, item, "txPower", JS_NewInt32(g_ctx, p_device->getTXPower()));
-
-      JS_SetPropertyUint32(g_ctx, array, i, item);
-    }
-    g_pScan->clearResults();
 
-    ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(g_ctx);
-    JSValue ret = qjs->callJsFunc_with_arg(g_ctx, g_callback_scan_func, g_callback_scan_func, 1, &array);
-    JS_FreeValue(g_ctx, array);
-    JS_FreeValue(g_ctx, ret);
+      // dropped counts the results lost to a full list since the scan started, like notify_batch
+      JSValue objs[3] = { array, JS_NewBool(g_ctx, completed), JS_NewUint32(g_ctx, dropped) };
+      ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(g_ctx);
+      JSValue ret = qjs->callJsFunc_with_arg(g_ctx, g_callback_scan_func, g_callback_scan_func, 3, objs);
+      JS_FreeValue(g_ctx, array);
+      JS_FreeValue(g_ctx, ret);
+    }
 
-    JS_FreeValue(g_ctx, g_callback_scan_func);
-    g_callback_scan_func = JS_UNDEFINED;
-    g_scanCompleted = false;
-    isRunning = BLECENTRAL_RUNNING_NONE;
+    if( completed ){
+      g_pScan->clearResults();
+      clear_scan_list();
+      JS_FreeValue(g_ctx, g_callback_scan_func);
+      g_callback_scan_func = JS_UNDEFINED;
+      g_scanCompleted = false;
+      isRunning = BLECENTRAL_RUNNING_NONE;
+    }
   }
 }
 
@@ -874,6 +1218,9 @@ static void taskServer(void *)
   BLEDevice::init("");
   g_pScan = NimBLEDevice::getScan();
 
+  g_scan_mutex = xSemaphoreCreateMutex();
+  g_notify_ring = (uint8_t*)malloc(NOTIFY_RING_SIZE);
+
   g_pcallback = new MyScanCallbacks();
   g_pScan->setScanCallbacks(g_pcallback);
 
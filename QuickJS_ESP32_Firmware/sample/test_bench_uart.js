@@ -0,0 +1,39 @@
+import * as uart from "Uart";
+
+// 256-byte round trip through Uart.write(Uint8Array) and Uart.read(n)
+// jumper TX to RX; the line time is subtracted, what is left is the call and conversion cost
+const PIN_RX = 13;
+const PIN_TX = 14;
+const BAUD = 2000000;
+const SIZE = 256;
+const COUNT = 200;
+
+function roundtrip(data) {
+    uart.write(data);
+    var received = 0;
+    var start = millis();
+    while (received < SIZE && millis() - start < 100) {
+        var list = uart.read(SIZE - received);
+        received += list.length;
+    }
+    return received;
+}
+
+function setup() {
+    uart.begin(BAUD, PIN_RX, PIN_TX);
+    var data = new Uint8Array(SIZE);
+    for (var i = 0; i < SIZE; i++)
+        data[i] = i;
+
+    roundtrip(data);
+    var start = millis();
+    for (var i = 0; i < COUNT; i++) {
+        if (roundtrip(data) != SIZE) {
+            console.log("loopback failed, check the TX-RX jumper");
+            return;
+        }
+    }
+    var elapsed = (millis() - start) * 1000 / COUNT;
+    var line = SIZE * 10 * 1000000 / BAUD;
+    console.log("roundtrip: " + elapsed.toFixed(1) + "us, line: " + line.toFixed(1) + "us, overhead: " + (elapsed - line).toFixed(1) + "us");
+}
@@ -15,6 +15,8 @@
  *----------------------------------------------------------------------*/
 
 #include "MyButton.h"
+#include <hal/gpio_ll.h>
+#include <soc/gpio_struct.h>
 
 /*----------------------------------------------------------------------*
  * Button(pin, puEnable, invert, dbTime) instantiates a button object.  *
@@ -43,6 +45,36 @@ MyButton::MyButton(uint8_t pin, uint8_t invert, uint32_t dbTime) {
     _lastTime   = _time;
     _lastChange = _time;
     _pressTime  = _time;
+    _mux         = portMUX_INITIALIZER_UNLOCKED;
+    _isrState    = _state;
+    _isrChange   = _time;
+    _isrPresses  = 0;
+    _readPresses = 0;
+    attachInterruptArg(_pin, onChange, this, CHANGE);
+}
+
+MyButton::~MyButton() {
+    detachInterrupt(_pin);
+}
+
+/*----------------------------------------------------------------------*
+ * onChange() runs on every pin edge. The first edge after dbTime is    *
+ * taken at once and the bounces that follow it are ignored, so a press *
+ * shorter than one pass of the main loop is still seen by read().      *
+ *----------------------------------------------------------------------*/
+void IRAM_ATTR MyButton::onChange(void *arg) {
+    MyButton *btn = (MyButton *)arg;
+    uint32_t ms = millis();
+    uint8_t val = gpio_ll_get_level(&GPIO, (gpio_num_t)btn->_pin);
+    if (btn->_invert != 0) val = !val;
+
+    portENTER_CRITICAL_ISR(&btn->_mux);
+    if (val != btn->_isrState && ms - btn->_isrChange >= btn->_dbTime) {
+        btn->_isrState  = val;
+        btn->_isrChange = ms;
+        if (val) btn->_isrPresses++;
+    }
+    portEXIT_CRITICAL_ISR(&btn->_mux);
 }
 
 /*----------------------------------------------------------------------*
@@ -53,9 +85,22 @@ uint8_t MyButton::read(void) {
     static uint32_t ms;
     static uint8_t pinVal;
 
-    ms     = millis();
-    pinVal = digitalRead(_pin);
-    if (_invert != 0) pinVal = !pinVal;
+    ms = millis();
+    portENTER_CRITICAL(&_mux);
+    // an edge that settled inside the debounce time raises no further interrupt
+    if (ms - _isrChange >= _dbTime) {
+        pinVal = gpio_ll_get_level(&GPIO, (gpio_num_t)_pin);
+        if (_invert != 0) pinVal = !pinVal;
+        if (pinVal != _isrState) {
+            _isrState  = pinVal;
+            _isrChange = ms;
+            if (pinVal) _isrPresses++;
+        }
+    }
+    pinVal = _isrState;
+    // a whole press happened since the last read
+    if (!pinVal && !_state && _isrPresses != _readPresses) pinVal = 1;
+    portEXIT_CRITICAL(&_mux);
     if (ms - _lastChange < _dbTime) {
         _lastTime = _time;
         _time     = ms;
@@ -70,7 +115,8 @@ uint8_t MyButton::read(void) {
             _lastChange = ms;
             _changed    = 1;
             if (_state) {
-                _pressTime = _time;
+                _pressTime   = _time;
+                _readPresses = _isrPresses;
             }
         } else {
             _changed = 0;
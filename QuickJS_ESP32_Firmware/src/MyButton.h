@@ -18,6 +18,7 @@
 class MyButton {
    public:
     MyButton(uint8_t pin, uint8_t invert, uint32_t dbTime);
+    ~MyButton();
     uint8_t read();
     uint8_t isPressed();
     uint8_t isReleased();
@@ -42,5 +43,13 @@ class MyButton {
     uint32_t _dbTime;      // debounce time
     uint32_t _pressTime;   // press time
     uint32_t _hold_time;   // hold time call wasreleasefor
+    // edges latched by the pin interrupt between two reads
+    portMUX_TYPE _mux;
+    volatile uint8_t _isrState;    // debounced state seen by the interrupt
+    volatile uint32_t _isrChange;  // time of the last accepted edge
+    volatile uint8_t _isrPresses;  // presses accepted by the interrupt
+    uint8_t _readPresses;          // presses already reported by read()
+
+    static void IRAM_ATTR onChange(void *arg);
 };
 #endif
\ No newline at end of file
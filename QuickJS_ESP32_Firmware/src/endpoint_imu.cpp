@@ -5,11 +5,14 @@
 
 #include "endpoint_types.h"
 #include "endpoint_imu.h"
+#include "module_esp32.h"
 
 long endp_imu_getAccel(JsonObject& request, JsonObject& response, int magic)
 {
   float ax, ay, az;
+  esp32_internal_bus_lock();
   M5.Imu.getAccel(&ax, &ay, &az);
+  esp32_internal_bus_unlock();
 
   response["result"]["x"] = ax;
   response["result"]["y"] = ay;
@@ -21,7 +24,9 @@ long endp_imu_getAccel(JsonObject& request, JsonObject& response, int magic)
 long endp_imu_getGyro(JsonObject& request, JsonObject& response, int magic)
 {
   float gx, gy, gz;
+  esp32_internal_bus_lock();
   M5.Imu.getGyro(&gx, &gy, &gz);
+  esp32_internal_bus_unlock();
 
   response["result"]["x"] = gx;
   response["result"]["y"] = gy;
@@ -33,7 +38,9 @@ long endp_imu_getGyro(JsonObject& request, JsonObject& response, int magic)
 long endp_imu_getTemp(JsonObject& request, JsonObject& response, int magic)
 {
   float t;
+  esp32_internal_bus_lock();
   M5.Imu.getTemp(&t);
+  esp32_internal_bus_unlock();
 
   response["result"] = t;
 
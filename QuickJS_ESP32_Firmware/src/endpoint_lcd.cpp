@@ -10,6 +10,7 @@
 #include "endpoint_types.h"
 #include "endpoint_lcd.h"
 #include "module_lcd.h"
+#include "lib_lcdcapture.h"
 
 long endp_lcd_setRotation(JsonObject& request, JsonObject& response, int magic)
 {
@@ -259,6 +260,33 @@ long endp_lcd_getMetric(JsonObject& request, JsonObject& response, int magic)
   return 0;
 }
 
+long endp_lcd_setStreamFps(JsonObject& request, JsonObject& response, int magic)
+{
+  uint8_t fps = request["fps"];
+
+  return lcdcapture_setFps(fps);
+}
+
+long endp_lcd_getStreamStats(JsonObject& request, JsonObject& response, int magic)
+{
+  LCDCAPTURE_STATS stats;
+  lcdcapture_getStats(&stats);
+  response["result"]["fps"] = stats.fps;
+  response["result"]["clients"] = stats.clients;
+  response["result"]["scans"] = stats.scans;
+  response["result"]["frames"] = stats.frames;
+  response["result"]["skipped"] = stats.skipped;
+  response["result"]["captures"] = stats.captures;
+  response["result"]["lastBytes"] = stats.last_bytes;
+  response["result"]["lastTiles"] = stats.last_tiles;
+  response["result"]["lastEncode"] = stats.last_encode;
+  response["result"]["maxEncode"] = stats.max_encode;
+  response["result"]["totalBytes"] = (double)stats.total_bytes;
+  response["result"]["totalEncode"] = (double)stats.total_encode;
+
+  return 0;
+}
+
 EndpointEntry lcd_table[] = {
   EndpointEntry{ endp_lcd_setRotation, "/lcd-setRotation", -1 },
   EndpointEntry{ endp_lcd_setBrightness, "/lcd-setBrightness", -1 },
@@ -287,6 +315,8 @@ EndpointEntry lcd_table[] = {
   EndpointEntry{ endp_lcd_getMetric, "/lcd-height", ENDPOINT_TYPE_HEIGHT },
   EndpointEntry{ endp_lcd_getMetric, "/lcd-getColorDepth", ENDPOINT_TYPE_DEPTH },
   EndpointEntry{ endp_lcd_getMetric, "/lcd-fontHeight", ENDPOINT_TYPE_FONTHEIGHT },
+  EndpointEntry{ endp_lcd_setStreamFps, "/lcd-setStreamFps", -1 },
+  EndpointEntry{ endp_lcd_getStreamStats, "/lcd-getStreamStats", -1 },
 };
 
 const int num_of_lcd_entry = sizeof(lcd_table) / sizeof(EndpointEntry);
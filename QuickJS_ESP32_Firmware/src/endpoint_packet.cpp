@@ -11,6 +11,7 @@
 #include "endpoint_packet.h"
 #include "wifi_utils.h"
 #include "lib_snmp.h"
+#include "lib_metrics.h"
 
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
@@ -35,6 +36,7 @@
 #endif
 #ifdef _LCD_ENABLE_
 #include "endpoint_lcd.h"
+#include "lib_lcdcapture.h"
 #endif
 #ifdef _WEBSOCKET_ENABLE_
 #include "module_websocket.h"
@@ -229,6 +231,21 @@ long packet_initialize(void)
     request->send(response);
   });
 
+  server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+    String text = metrics_format_prometheus();
+    if( text.length() == 0 ){
+      request->send(503, "text/plain", "No metrics available");
+      return;
+    }
+    request->send(200, "text/plain; version=0.0.4", text);
+  });
+
+#ifdef _LCD_ENABLE_
+  server.on("/lcd-capture", HTTP_GET, [](AsyncWebServerRequest *request) {
+    lcdcapture_request(request);
+  });
+#endif
+
   DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
   DefaultHeaders::Instance().addHeader("Access-Control-Allow-Headers", "*");
 #ifdef ENABLE_STATIC_WEB_PAGE
@@ -240,6 +257,9 @@ long packet_initialize(void)
   ws.onEvent(onWebsocketEvent);
   server.addHandler(&ws);
 #endif
+#ifdef _LCD_ENABLE_
+  server.addHandler(lcdcapture_getStream());
+#endif
 
   return 0;
 }
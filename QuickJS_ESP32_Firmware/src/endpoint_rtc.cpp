@@ -5,6 +5,7 @@
 
 #include "endpoint_types.h"
 #include "endpoint_rtc.h"
+#include "module_esp32.h"
 
 long endp_rtc_setTime(JsonObject& request, JsonObject& response, int magic)
 {
@@ -16,7 +17,9 @@ long endp_rtc_setTime(JsonObject& request, JsonObject& response, int magic)
   def.hours = hours;
   def.minutes = minutes;
   def.seconds = seconds;
+  esp32_internal_bus_lock();
   M5.Rtc.setTime(&def);
+  esp32_internal_bus_unlock();
 
   return 0;
 }
@@ -33,7 +36,9 @@ long endp_rtc_setDate(JsonObject& request, JsonObject& response, int magic)
   def.month = month;
   def.date = date;
   def.weekDay = weekday;
+  esp32_internal_bus_lock();
   M5.Rtc.setDate(&def);
+  esp32_internal_bus_unlock();
 
   return 0;
 }
@@ -41,7 +46,9 @@ long endp_rtc_setDate(JsonObject& request, JsonObject& response, int magic)
 long endp_rtc_getTime(JsonObject& request, JsonObject& response, int magic)
 {
   m5::rtc_time_t def;
+  esp32_internal_bus_lock();
   M5.Rtc.getTime(&def);
+  esp32_internal_bus_unlock();
 
   response["result"]["Hours"] = def.hours;
   response["result"]["Minutes"] = def.minutes;
@@ -53,7 +60,9 @@ long endp_rtc_getTime(JsonObject& request, JsonObject& response, int magic)
 long endp_rtc_getDate(JsonObject& request, JsonObject& response, int magic)
 {
   m5::rtc_date_t def;
+  esp32_internal_bus_lock();
   M5.Rtc.getDate(&def);
+  esp32_internal_bus_unlock();
 
   response["result"]["Year"] = def.year;
   response["result"]["Month"] = def.month;
@@ -3,6 +3,7 @@
 
 #include "endpoint_types.h"
 #include "endpoint_wire.h"
+#include "module_wire.h"
 
 long endp_wire_begin(JsonObject& request, JsonObject& response, int magic)
 {
@@ -18,7 +19,9 @@ long endp_wire_begin(JsonObject& request, JsonObject& response, int magic)
   int scl = request["scl"] | -1;
   uint32_t freq = request["freq"] | 0;
 
+  wire_bus_lock(wire);
   bool ret = wire->begin(sda, scl, freq);
+  wire_bus_unlock(wire);
 
   response["result"] = ret;
 
@@ -39,7 +42,9 @@ long endp_wire_requestFrom(JsonObject& request, JsonObject& response, int magic)
   uint8_t count = request["count"];
   bool stop = request["stop"] | true;
 
+  wire_bus_lock(wire);
   uint8_t ret = wire->requestFrom(address, count, (uint8_t)stop);
+  wire_bus_unlock(wire);
   response["result"] = ret;
 
   return 0;
@@ -57,7 +62,9 @@ long endp_wire_beginTransmission(JsonObject& request, JsonObject& response, int
 
   uint8_t address = request["address"];
 
+  wire_bus_lock(wire);
   wire->beginTransmission(address);
+  wire_bus_unlock(wire);
 
   return 0;
 }
@@ -74,7 +81,9 @@ long endp_wire_endTransmission(JsonObject& request, JsonObject& response, int ma
 
   bool stop = request["stop"] | true;
 
+  wire_bus_lock(wire);
   uint8_t ret = wire->endTransmission(stop);
+  wire_bus_unlock(wire);
   response["result"] = ret;
 
   return 0;
@@ -90,13 +99,16 @@ long endp_wire_write(JsonObject& request, JsonObject& response, int magic)
   else
     return -1;
 
+  wire_bus_lock(wire);
   if( request["value"].is<JsonArray>() ){
     JsonArray arry = request["value"];
     int size = arry.size();
     for( int i = 0 ; i < size ; i++ ){
       uint8_t value = arry[i];
-      if( wire->write(value) != 1 )
+      if( wire->write(value) != 1 ){
+        wire_bus_unlock(wire);
         return -1;
+      }
     }
 
     response["result"] = size;
@@ -105,6 +117,7 @@ long endp_wire_write(JsonObject& request, JsonObject& response, int magic)
     int ret = wire->write(value);
     response["result"] = ret;
   }
+  wire_bus_unlock(wire);
 
   return 0;
 }
@@ -136,6 +149,7 @@ long endp_wire_read(JsonObject& request, JsonObject& response, int magic)
   else
     return -1;
 
+  wire_bus_lock(wire);
 //  if( request.containsKey("count") ){
   if( request["count"].is<int>() ){
     int count = request["count"];
@@ -146,6 +160,7 @@ long endp_wire_read(JsonObject& request, JsonObject& response, int magic)
   }else{
     response["result"] = wire->read();
   }
+  wire_bus_unlock(wire);
 
   return 0;
 }
@@ -0,0 +1,164 @@
+#include <math.h>
+#include <string.h>
+#include "lib_dsp.h"
+
+// esp-dsp is not in lib_deps, so the radix-2 fallback below is what the firmware builds today
+#if defined(ESP_PLATFORM) && __has_include("esp_dsp.h")
+#include "esp_dsp.h"
+#define DSP_USE_ESP_DSP
+#endif
+
+void dsp_decimator_init(DSP_DECIMATOR *p_dec, uint32_t factor)
+{
+  p_dec->factor = (factor == 0) ? 1 : factor;
+  p_dec->count = 0;
+  p_dec->sum = 0.0f;
+}
+
+bool dsp_decimator_push(DSP_DECIMATOR *p_dec, float in, float *p_out)
+{
+  p_dec->sum += in;
+  if( ++p_dec->count < p_dec->factor )
+    return false;
+
+  *p_out = p_dec->sum / p_dec->factor;
+  p_dec->count = 0;
+  p_dec->sum = 0.0f;
+  return true;
+}
+
+void dsp_stats(const float *p_in, uint32_t num, DSP_STATS *p_stats)
+{
+  if( num == 0 ){
+    memset(p_stats, 0, sizeof(DSP_STATS));
+    return;
+  }
+
+  float min = p_in[0], max = p_in[0];
+  double sum = 0.0, sum_sq = 0.0;
+  for( uint32_t i = 0 ; i < num ; i++ ){
+    float v = p_in[i];
+    if( v < min ) min = v;
+    if( v > max ) max = v;
+    sum += v;
+    sum_sq += (double)v * v;
+  }
+  p_stats->mean = sum / num;
+  p_stats->min = min;
+  p_stats->max = max;
+  p_stats->rms = sqrt(sum_sq / num);
+}
+
+void dsp_moving_rms_init(DSP_MOVING_RMS *p_rms, float *p_squares, uint32_t length)
+{
+  p_rms->p_squares = p_squares;
+  p_rms->length = (length == 0) ? 1 : length;
+  p_rms->index = 0;
+  p_rms->count = 0;
+  p_rms->sum = 0.0;
+}
+
+float dsp_moving_rms_push(DSP_MOVING_RMS *p_rms, float in)
+{
+  float sq = in * in;
+  if( p_rms->count < p_rms->length )
+    p_rms->count++;
+  else
+    p_rms->sum -= p_rms->p_squares[p_rms->index];
+  p_rms->p_squares[p_rms->index] = sq;
+  p_rms->sum += sq;
+
+  if( ++p_rms->index >= p_rms->length ){
+    p_rms->index = 0;
+    // the running sum drifts with every subtraction, rebuild it once per lap
+    double sum = 0.0;
+    for( uint32_t i = 0 ; i < p_rms->count ; i++ )
+      sum += p_rms->p_squares[i];
+    p_rms->sum = sum;
+  }
+
+  return sqrt((p_rms->sum > 0.0 ? p_rms->sum : 0.0) / p_rms->count);
+}
+
+#ifndef DSP_USE_ESP_DSP
+// in-place radix-2 complex FFT on interleaved re/im
+static void fft_radix2(float *p_data, uint32_t num)
+{
+  for( uint32_t i = 1, j = 0 ; i < num ; i++ ){
+    uint32_t bit = num >> 1;
+    for( ; j & bit ; bit >>= 1 )
+      j ^= bit;
+    j ^= bit;
+    if( i < j ){
+      float tr = p_data[i * 2], ti = p_data[i * 2 + 1];
+      p_data[i * 2] = p_data[j * 2];
+      p_data[i * 2 + 1] = p_data[j * 2 + 1];
+      p_data[j * 2] = tr;
+      p_data[j * 2 + 1] = ti;
+    }
+  }
+
+  for( uint32_t len = 2 ; len <= num ; len <<= 1 ){
+    float angle = -2.0f * (float)M_PI / len;
+    float wr = cosf(angle), wi = sinf(angle);
+    for( uint32_t i = 0 ; i < num ; i += len ){
+      float cr = 1.0f, ci = 0.0f;
+      for( uint32_t k = 0 ; k < len / 2 ; k++ ){
+        uint32_t a = (i + k) * 2, b = (i + k + len / 2) * 2;
+        float xr = p_data[b] * cr - p_data[b + 1] * ci;
+        float xi = p_data[b] * ci + p_data[b + 1] * cr;
+        p_data[b] = p_data[a] - xr;
+        p_data[b + 1] = p_data[a + 1] - xi;
+        p_data[a] += xr;
+        p_data[a + 1] += xi;
+        float t = cr * wr - ci * wi;
+        ci = cr * wi + ci * wr;
+        cr = t;
+      }
+    }
+  }
+}
+#endif
+
+long dsp_fft_magnitude(const float *p_in, uint32_t num, float *p_work, float *p_out)
+{
+  if( num < 2 || (num & (num - 1)) != 0 )
+    return -1;
+
+  float mean = 0.0f;
+  for( uint32_t i = 0 ; i < num ; i++ )
+    mean += p_in[i];
+  mean /= num;
+
+  for( uint32_t i = 0 ; i < num ; i++ ){
+    float hann = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (num - 1));
+    p_work[i * 2] = (p_in[i] - mean) * hann;
+    p_work[i * 2 + 1] = 0.0f;
+  }
+
+#ifdef DSP_USE_ESP_DSP
+  static uint32_t s_table_size = 0;
+  if( s_table_size < num ){
+    if( s_table_size != 0 )
+      dsps_fft2r_deinit_fc32();
+    if( dsps_fft2r_init_fc32(NULL, num) != ESP_OK ){
+      s_table_size = 0;
+      return -1;
+    }
+    s_table_size = num;
+  }
+  dsps_fft2r_fc32(p_work, num);
+  dsps_bit_rev_fc32(p_work, num);
+#else
+  fft_radix2(p_work, num);
+#endif
+
+  // amplitude of the Hann-windowed input: x2 for one side, x2 for the window gain
+  float scale = 4.0f / num;
+  for( uint32_t i = 0 ; i < num / 2 ; i++ ){
+    float re = p_work[i * 2], im = p_work[i * 2 + 1];
+    p_out[i] = sqrtf(re * re + im * im) * scale;
+  }
+
+  return 0;
+}
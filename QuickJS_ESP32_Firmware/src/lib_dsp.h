@@ -0,0 +1,42 @@
+#ifndef _LIB_DSP_H_
+#define _LIB_DSP_H_
+
+#include <stdint.h>
+
+typedef struct {
+  float mean;
+  float min;
+  float max;
+  float rms;
+} DSP_STATS;
+
+// block-average decimator, keeps its partial sum between calls
+typedef struct {
+  uint32_t factor;
+  uint32_t count;
+  float sum;
+} DSP_DECIMATOR;
+
+// sliding RMS over the last length samples, carried across calls
+typedef struct {
+  float *p_squares; // length floats, owned by the caller
+  uint32_t length;
+  uint32_t index;
+  uint32_t count;
+  double sum;
+} DSP_MOVING_RMS;
+
+void dsp_decimator_init(DSP_DECIMATOR *p_dec, uint32_t factor);
+// returns true when *p_out holds a new output sample
+bool dsp_decimator_push(DSP_DECIMATOR *p_dec, float in, float *p_out);
+
+void dsp_stats(const float *p_in, uint32_t num, DSP_STATS *p_stats);
+
+void dsp_moving_rms_init(DSP_MOVING_RMS *p_rms, float *p_squares, uint32_t length);
+// returns the RMS of the last min(pushed, length) samples
+float dsp_moving_rms_push(DSP_MOVING_RMS *p_rms, float in);
+
+// num: power of 2, p_work: 2 * num floats, p_out: num / 2 magnitudes (Hann windowed, DC removed)
+long dsp_fft_magnitude(const float *p_in, uint32_t num, float *p_work, float *p_out);
+
+#endif
@@ -0,0 +1,154 @@
+#include <string.h>
+#include "lib_ircodec.h"
+
+typedef struct {
+  uint8_t *p_out;
+  uint32_t out_size;
+  uint32_t nibbles;
+} NIBBLE_WRITER;
+
+static bool nibble_put(NIBBLE_WRITER *p_writer, uint8_t value)
+{
+  uint32_t pos = p_writer->nibbles / 2;
+  if( pos >= p_writer->out_size )
+    return false;
+  if( (p_writer->nibbles & 1) == 0 )
+    p_writer->p_out[pos] = (value & 0x0f) << 4;
+  else
+    p_writer->p_out[pos] |= value & 0x0f;
+  p_writer->nibbles++;
+  return true;
+}
+
+static uint8_t nibble_get(const uint8_t *p_in, uint32_t index)
+{
+  uint8_t value = p_in[index / 2];
+  return (index & 1) ? (value & 0x0f) : (value >> 4);
+}
+
+static bool within_tolerance(uint32_t value, uint32_t center)
+{
+  uint32_t tolerance = center / IRCODEC_TOLERANCE;
+  if( tolerance < IRCODEC_TOLERANCE_MIN )
+    tolerance = IRCODEC_TOLERANCE_MIN;
+  return (value > center ? value - center : center - value) <= tolerance;
+}
+
+uint32_t ircodec_encode_bound(uint32_t num)
+{
+  return IRCODEC_HEADER_SIZE + IRCODEC_TABLE_MAX * 2 + (num * 5 + 1) / 2;
+}
+
+uint32_t ircodec_encode(const uint16_t *p_durations, uint32_t num, uint8_t freq_khz, uint8_t *p_out, uint32_t out_size)
+{
+  if( num > 0xffff || out_size < IRCODEC_HEADER_SIZE )
+    return 0;
+
+  // cluster the durations, each table entry ends up as the mean of its members
+  uint32_t sums[IRCODEC_TABLE_MAX];
+  uint32_t counts[IRCODEC_TABLE_MAX];
+  uint16_t table[IRCODEC_TABLE_MAX];
+  uint8_t table_num = 0;
+  for( uint32_t i = 0 ; i < num ; i++ ){
+    uint8_t j;
+    for( j = 0 ; j < table_num ; j++ ){
+      if( within_tolerance(p_durations[i], table[j]) )
+        break;
+    }
+    if( j < table_num ){
+      sums[j] += p_durations[i];
+      counts[j]++;
+      table[j] = (sums[j] + counts[j] / 2) / counts[j];
+    }else if( table_num < IRCODEC_TABLE_MAX ){
+      sums[table_num] = p_durations[i];
+      counts[table_num] = 1;
+      table[table_num] = p_durations[i];
+      table_num++;
+    }
+  }
+
+  uint32_t header_size = IRCODEC_HEADER_SIZE + table_num * 2;
+  if( out_size < header_size )
+    return 0;
+  p_out[0] = 'I';
+  p_out[1] = 'R';
+  p_out[2] = IRCODEC_VERSION;
+  p_out[3] = freq_khz;
+  p_out[4] = num & 0xff;
+  p_out[5] = (num >> 8) & 0xff;
+  p_out[6] = table_num;
+  for( uint8_t j = 0 ; j < table_num ; j++ ){
+    p_out[IRCODEC_HEADER_SIZE + j * 2] = table[j] & 0xff;
+    p_out[IRCODEC_HEADER_SIZE + j * 2 + 1] = (table[j] >> 8) & 0xff;
+  }
+
+  NIBBLE_WRITER writer = { p_out + header_size, out_size - header_size, 0 };
+  for( uint32_t i = 0 ; i < num ; i++ ){
+    // nearest entry, the means may have drifted since clustering
+    uint8_t best = IRCODEC_TABLE_MAX;
+    uint32_t best_diff = 0xffffffff;
+    for( uint8_t j = 0 ; j < table_num ; j++ ){
+      uint32_t diff = p_durations[i] > table[j] ? p_durations[i] - table[j] : table[j] - p_durations[i];
+      if( diff < best_diff && within_tolerance(p_durations[i], table[j]) ){
+        best = j;
+        best_diff = diff;
+      }
+    }
+    if( best < IRCODEC_TABLE_MAX ){
+      if( !nibble_put(&writer, best) )
+        return 0;
+    }else{
+      uint16_t value = p_durations[i];
+      if( !nibble_put(&writer, 0x0f) ||
+          !nibble_put(&writer, value >> 12) || !nibble_put(&writer, value >> 8) ||
+          !nibble_put(&writer, value >> 4) || !nibble_put(&writer, value) )
+        return 0;
+    }
+  }
+
+  return header_size + (writer.nibbles + 1) / 2;
+}
+
+uint32_t ircodec_decoded_length(const uint8_t *p_in, uint32_t in_size)
+{
+  if( in_size < IRCODEC_HEADER_SIZE || p_in[0] != 'I' || p_in[1] != 'R' || p_in[2] != IRCODEC_VERSION )
+    return 0;
+  return p_in[4] | ((uint32_t)p_in[5] << 8);
+}
+
+long ircodec_decode(const uint8_t *p_in, uint32_t in_size, uint16_t *p_durations, uint32_t max_num, uint32_t *p_num, uint8_t *p_freq_khz)
+{
+  uint32_t num = ircodec_decoded_length(p_in, in_size);
+  if( num == 0 || num > max_num )
+    return -1;
+  uint8_t table_num = p_in[6];
+  uint32_t header_size = IRCODEC_HEADER_SIZE + table_num * 2;
+  if( table_num > IRCODEC_TABLE_MAX || in_size < header_size )
+    return -1;
+
+  const uint8_t *p_nibbles = p_in + header_size;
+  uint32_t nibbles_max = (in_size - header_size) * 2;
+  uint32_t pos = 0;
+  for( uint32_t i = 0 ; i < num ; i++ ){
+    if( pos >= nibbles_max )
+      return -1;
+    uint8_t index = nibble_get(p_nibbles, pos++);
+    if( index < table_num ){
+      p_durations[i] = p_in[IRCODEC_HEADER_SIZE + index * 2] | ((uint16_t)p_in[IRCODEC_HEADER_SIZE + index * 2 + 1] << 8);
+    }else if( index == 0x0f ){
+      if( pos + 4 > nibbles_max )
+        return -1;
+      uint16_t value = 0;
+      for( int j = 0 ; j < 4 ; j++ )
+        value = (value << 4) | nibble_get(p_nibbles, pos++);
+      p_durations[i] = value;
+    }else{
+      return -1;
+    }
+  }
+
+  *p_num = num;
+  if( p_freq_khz != NULL )
+    *p_freq_khz = p_in[3];
+  return 0;
+}
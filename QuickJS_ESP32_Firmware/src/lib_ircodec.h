@@ -0,0 +1,27 @@
+#ifndef _LIB_IRCODEC_H_
+#define _LIB_IRCODEC_H_
+
+#include <stdint.h>
+
+// Compact format for raw IR timings (us, mark/space alternating):
+//   "IR" ver freq_khz num(u16 le) table_num table(u16 le * table_num)
+//   then one nibble per duration, high nibble first:
+//   0..14 index into the table, 15 escape followed by 4 nibbles of the literal duration.
+// Durations within IRCODEC_TOLERANCE of a table entry share it, so a typical
+// NEC/AEHA frame packs into one nibble per duration.
+#define IRCODEC_VERSION       1
+#define IRCODEC_HEADER_SIZE   7
+#define IRCODEC_TABLE_MAX     15
+#define IRCODEC_TOLERANCE     5 // 1/5 = 20%
+#define IRCODEC_TOLERANCE_MIN 50 // us
+
+// returns the encoded size, 0 when p_out is too small
+uint32_t ircodec_encode(const uint16_t *p_durations, uint32_t num, uint8_t freq_khz, uint8_t *p_out, uint32_t out_size);
+// worst case output size for num durations
+uint32_t ircodec_encode_bound(uint32_t num);
+// returns 0 on success, *p_num: number of durations written
+long ircodec_decode(const uint8_t *p_in, uint32_t in_size, uint16_t *p_durations, uint32_t max_num, uint32_t *p_num, uint8_t *p_freq_khz);
+// returns the number of durations in an encoded buffer, 0 when not valid
+uint32_t ircodec_decoded_length(const uint8_t *p_in, uint32_t in_size);
+
+#endif
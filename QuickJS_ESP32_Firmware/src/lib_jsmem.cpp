@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <string.h>
+#include "lib_jsmem.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#include "mem_utils.h"
+#define JS_MEM_CHUNK_ALLOC(size)          heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define JS_MEM_CHUNK_FREE(ptr)            heap_caps_free(ptr)
+#define JS_MEM_LARGE_ALLOC(size)          utils_mem_alloc(size)
+#define JS_MEM_LARGE_REALLOC(ptr, size)   utils_mem_realloc(ptr, size)
+#define JS_MEM_LARGE_FREE(ptr)            utils_mem_free(ptr)
+#else
+#define JS_MEM_CHUNK_ALLOC(size)          malloc(size)
+#define JS_MEM_CHUNK_FREE(ptr)            free(ptr)
+#define JS_MEM_LARGE_ALLOC(size)          malloc(size)
+#define JS_MEM_LARGE_REALLOC(ptr, size)   realloc(ptr, size)
+#define JS_MEM_LARGE_FREE(ptr)            free(ptr)
+#endif
+
+/*
+ * Every block starts with a JS_MEM_ALIGN byte header, the tag is its last word.
+ *   slab:  JS_MEM_HEADER_SLAB | class index
+ *   large: requested size
+ * so free/realloc/usable_size never have to ask the heap for the block size.
+ */
+#define JS_MEM_HEADER_SIZE    JS_MEM_ALIGN
+#define JS_MEM_HEADER_SLAB    0x80000000
+#define JS_MEM_TAG(buffer)    (((uint32_t*)(buffer))[-1])
+
+// multiples of JS_MEM_ALIGN, so every slot stays aligned
+static const uint16_t g_slab_sizes[] = { 16, 24, 32, 48, 64 };
+#define NUM_OF_SLAB_CLASS     ((int)(sizeof(g_slab_sizes) / sizeof(g_slab_sizes[0])))
+
+typedef struct JS_MEM_SLOT {
+  struct JS_MEM_SLOT *p_next;
+} JS_MEM_SLOT;
+
+typedef struct JS_MEM_CHUNK {
+  struct JS_MEM_CHUNK *p_next;
+} JS_MEM_CHUNK;
+
+static JS_MEM_SLOT *g_slab_free[NUM_OF_SLAB_CLASS];
+static JS_MEM_CHUNK *g_slab_chunks = NULL;
+static JS_MEM_INFO g_js_mem_info;
+
+static inline int slab_class(size_t size)
+{
+  for( int i = 0 ; i < NUM_OF_SLAB_CLASS ; i++ ){
+    if( size <= g_slab_sizes[i] )
+      return i;
+  }
+  return -1;
+}
+
+// a chunk belongs to one class for good: it is not rebalanced to another class
+// and not given back to the heap before js_mem_release()
+static bool slab_grow(int index)
+{
+  if( (g_js_mem_info.slab_chunks + 1) * JS_MEM_SLAB_CHUNK_SIZE > JS_MEM_SLAB_MAX_BYTES )
+    return false;
+  JS_MEM_CHUNK *p_chunk = (JS_MEM_CHUNK*)JS_MEM_CHUNK_ALLOC(JS_MEM_SLAB_CHUNK_SIZE);
+  if( p_chunk == NULL )
+    return false;
+  p_chunk->p_next = g_slab_chunks;
+  g_slab_chunks = p_chunk;
+  g_js_mem_info.slab_chunks++;
+
+  // the heap may hand out 4 byte aligned chunks, the first slot is moved up to the alignment
+  uint32_t slot_size = JS_MEM_HEADER_SIZE + g_slab_sizes[index];
+  uintptr_t start = (uintptr_t)p_chunk + sizeof(JS_MEM_CHUNK);
+  start = (start + JS_MEM_ALIGN - 1) & ~(uintptr_t)(JS_MEM_ALIGN - 1);
+  uint8_t *p = (uint8_t*)start;
+  uint8_t *p_end = (uint8_t*)p_chunk + JS_MEM_SLAB_CHUNK_SIZE;
+  for( ; p + slot_size <= p_end ; p += slot_size ){
+    JS_MEM_SLOT *p_slot = (JS_MEM_SLOT*)(p + JS_MEM_HEADER_SIZE);
+    p_slot->p_next = g_slab_free[index];
+    g_slab_free[index] = p_slot;
+  }
+  return true;
+}
+
+static void* large_alloc(size_t size)
+{
+  uint8_t *p_block = (uint8_t*)JS_MEM_LARGE_ALLOC(JS_MEM_HEADER_SIZE + size);
+  if( p_block == NULL )
+    return NULL;
+  JS_MEM_TAG(p_block + JS_MEM_HEADER_SIZE) = size;
+  g_js_mem_info.large_count++;
+  return p_block + JS_MEM_HEADER_SIZE;
+}
+
+void* js_mem_alloc(size_t size)
+{
+  if( size == 0 || size >= JS_MEM_HEADER_SLAB )
+    return NULL;
+
+  int index = slab_class(size);
+  if( index >= 0 ){
+    if( g_slab_free[index] != NULL || slab_grow(index) ){
+      JS_MEM_SLOT *p_slot = g_slab_free[index];
+      g_slab_free[index] = p_slot->p_next;
+      JS_MEM_TAG(p_slot) = JS_MEM_HEADER_SLAB | index;
+      g_js_mem_info.slab_used++;
+      return p_slot;
+    }
+    g_js_mem_info.slab_fallback++;
+  }
+
+  return large_alloc(size);
+}
+
+void js_mem_free(void* buffer)
+{
+  if( buffer == NULL )
+    return;
+
+  uint32_t tag = JS_MEM_TAG(buffer);
+  if( tag & JS_MEM_HEADER_SLAB ){
+    int index = tag & ~JS_MEM_HEADER_SLAB;
+    JS_MEM_SLOT *p_slot = (JS_MEM_SLOT*)buffer;
+    p_slot->p_next = g_slab_free[index];
+    g_slab_free[index] = p_slot;
+    g_js_mem_info.slab_used--;
+  }else{
+    g_js_mem_info.large_count--;
+    JS_MEM_LARGE_FREE((uint8_t*)buffer - JS_MEM_HEADER_SIZE);
+  }
+}
+
+void* js_mem_realloc(void* buffer, size_t size)
+{
+  if( buffer == NULL )
+    return js_mem_alloc(size);
+  if( size == 0 ){
+    js_mem_free(buffer);
+    return NULL;
+  }
+  if( size >= JS_MEM_HEADER_SLAB )
+    return NULL;
+
+  uint32_t tag = JS_MEM_TAG(buffer);
+  if( tag & JS_MEM_HEADER_SLAB ){
+    size_t old_size = g_slab_sizes[tag & ~JS_MEM_HEADER_SLAB];
+    if( size <= old_size )
+      return buffer;
+    void *p_new = js_mem_alloc(size);
+    if( p_new == NULL )
+      return NULL;
+    memmove(p_new, buffer, old_size);
+    js_mem_free(buffer);
+    return p_new;
+  }
+
+  uint8_t *p_new = (uint8_t*)JS_MEM_LARGE_REALLOC((uint8_t*)buffer - JS_MEM_HEADER_SIZE, JS_MEM_HEADER_SIZE + size);
+  if( p_new == NULL )
+    return NULL;
+  JS_MEM_TAG(p_new + JS_MEM_HEADER_SIZE) = size;
+  return p_new + JS_MEM_HEADER_SIZE;
+}
+
+size_t js_mem_usable_size(const void* buffer)
+{
+  if( buffer == NULL )
+    return 0;
+
+  uint32_t tag = ((const uint32_t*)buffer)[-1];
+  if( tag & JS_MEM_HEADER_SLAB )
+    return g_slab_sizes[tag & ~JS_MEM_HEADER_SLAB];
+  else
+    return tag;
+}
+
+// only after JS_FreeRuntime(), when no slab block is alive
+void js_mem_release(void)
+{
+  while( g_slab_chunks != NULL ){
+    JS_MEM_CHUNK *p_next = g_slab_chunks->p_next;
+    JS_MEM_CHUNK_FREE(g_slab_chunks);
+    g_slab_chunks = p_next;
+  }
+  for( int i = 0 ; i < NUM_OF_SLAB_CLASS ; i++ )
+    g_slab_free[i] = NULL;
+  g_js_mem_info.slab_chunks = 0;
+  g_js_mem_info.slab_used = 0;
+  g_js_mem_info.slab_fallback = 0;
+}
+
+void js_mem_get_info(JS_MEM_INFO *p_info)
+{
+  *p_info = g_js_mem_info;
+}
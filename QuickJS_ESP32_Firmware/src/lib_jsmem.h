@@ -0,0 +1,27 @@
+#ifndef _LIB_JSMEM_H_
+#define _LIB_JSMEM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// QuickJS runtime allocator: small objects from internal RAM slab pools, others from PSRAM if present
+#define JS_MEM_SLAB_MAX_SIZE      64
+#define JS_MEM_SLAB_CHUNK_SIZE    4096
+#define JS_MEM_SLAB_MAX_BYTES     (96 * 1024)
+#define JS_MEM_ALIGN              8 // doubles and 64bit JSValues
+
+typedef struct {
+  uint32_t slab_chunks;
+  uint32_t slab_used; // slots in use
+  uint32_t slab_fallback; // small allocations that did not fit into the pools
+  uint32_t large_count;
+} JS_MEM_INFO;
+
+void* js_mem_alloc(size_t size);
+void* js_mem_realloc(void* buffer, size_t size);
+void js_mem_free(void* buffer);
+size_t js_mem_usable_size(const void* buffer);
+void js_mem_release(void);
+void js_mem_get_info(JS_MEM_INFO *p_info);
+
+#endif
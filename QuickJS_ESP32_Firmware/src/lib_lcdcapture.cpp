@@ -0,0 +1,454 @@
+#include <Arduino.h>
+#include "main_config.h"
+
+#ifdef _LCD_ENABLE_
+
+#include <vector>
+#include "lib_lcdcapture.h"
+#include "module_lcd.h"
+#include "mem_utils.h"
+
+#define LCDCAPTURE_FORMAT_RLE   0
+#define LCDCAPTURE_FORMAT_PNG   1
+
+#define FNV_OFFSET_BASIS  2166136261UL
+#define FNV_PRIME         16777619UL
+
+typedef struct {
+  uint8_t format;
+  uint8_t display;
+  AsyncWebServerRequestPtr requestPtr;
+} LCDCAPTURE_REQUEST;
+
+static SemaphoreHandle_t g_capture_mutex = NULL;
+static std::vector<LCDCAPTURE_REQUEST> g_request_list;
+
+static AsyncWebSocket g_stream_ws("/lcd-stream");
+static volatile bool g_stream_keyframe = true;
+static uint32_t g_stream_last = 0;
+static uint32_t g_stream_sequence = 0;
+static LCDCAPTURE_STATS g_stats;
+
+static uint16_t *g_band = NULL;
+static uint32_t g_band_size = 0;
+static uint8_t *g_frame = NULL;
+static uint32_t g_frame_size = 0;
+static uint32_t *g_hashes = NULL;
+static int32_t g_hash_cols = 0;
+static int32_t g_hash_rows = 0;
+
+static void put_u16(uint8_t *p, uint16_t value)
+{
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+}
+
+static void put_u32(uint8_t *p, uint32_t value)
+{
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+  p[2] = (value >> 16) & 0xff;
+  p[3] = (value >> 24) & 0xff;
+}
+
+static bool lcdcapture_reserve(int32_t width, int32_t height)
+{
+  uint32_t band_size = width * LCDCAPTURE_TILE_SIZE * sizeof(uint16_t);
+  if( band_size > g_band_size ){
+    uint16_t *band = (uint16_t*)utils_mem_realloc(g_band, band_size);
+    if( band == NULL )
+      return false;
+    g_band = band;
+    g_band_size = band_size;
+  }
+
+  // PackBits never grows a row by more than one header byte per 64 pixels plus one
+  int32_t cols = (width + LCDCAPTURE_TILE_SIZE - 1) / LCDCAPTURE_TILE_SIZE;
+  int32_t rows = (height + LCDCAPTURE_TILE_SIZE - 1) / LCDCAPTURE_TILE_SIZE;
+  uint32_t pixels = width * height;
+  uint32_t frame_size = LCDCAPTURE_FRAME_HEADER + cols * rows * LCDCAPTURE_RECT_HEADER
+                      + pixels * 2 + pixels / 64 + height * cols + 16;
+  if( frame_size > g_frame_size ){
+    uint8_t *frame = (uint8_t*)utils_mem_realloc(g_frame, frame_size);
+    if( frame == NULL )
+      return false;
+    g_frame = frame;
+    g_frame_size = frame_size;
+  }
+
+  return true;
+}
+
+static void lcdcapture_release(void)
+{
+  if( g_band != NULL ){
+    utils_mem_free(g_band);
+    g_band = NULL;
+    g_band_size = 0;
+  }
+  if( g_frame != NULL ){
+    utils_mem_free(g_frame);
+    g_frame = NULL;
+    g_frame_size = 0;
+  }
+  if( g_hashes != NULL ){
+    utils_mem_free(g_hashes);
+    g_hashes = NULL;
+    g_hash_cols = 0;
+    g_hash_rows = 0;
+  }
+}
+
+// header < 128: literal of header + 1 pixels, otherwise a run of header - 126 pixels
+static uint8_t* lcdcapture_pack_row(uint8_t *p, const uint16_t *pixels, int32_t count)
+{
+  int32_t i = 0;
+  while( i < count ){
+    int32_t run = 1;
+    while( i + run < count && run < 129 && pixels[i + run] == pixels[i] )
+      run++;
+    if( run >= 2 ){
+      *p++ = (uint8_t)(run + 126);
+      memmove(p, &pixels[i], 2);
+      p += 2;
+      i += run;
+      continue;
+    }
+
+    int32_t literal = 1;
+    while( i + literal < count && literal < 128 ){
+      if( i + literal + 1 < count && pixels[i + literal] == pixels[i + literal + 1] )
+        break;
+      literal++;
+    }
+    *p++ = (uint8_t)(literal - 1);
+    memmove(p, &pixels[i], literal * 2);
+    p += literal * 2;
+    i += literal;
+  }
+
+  return p;
+}
+
+static uint8_t* lcdcapture_pack_rect(uint8_t *p, int32_t stride, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+  uint8_t *p_header = p;
+  put_u16(&p[0], x);
+  put_u16(&p[2], y);
+  put_u16(&p[4], w);
+  put_u16(&p[6], h);
+  p += LCDCAPTURE_RECT_HEADER;
+
+  uint8_t *p_body = p;
+  for( int32_t row = 0 ; row < h ; row++ )
+    p = lcdcapture_pack_row(p, &g_band[row * stride + x], w);
+  put_u32(&p_header[8], p - p_body);
+
+  return p;
+}
+
+static void lcdcapture_frame_header(int32_t width, int32_t height, uint16_t num_of_rects, uint16_t flags, uint32_t sequence, uint32_t elapsed)
+{
+  memmove(&g_frame[0], "R565", 4);
+  put_u16(&g_frame[4], width);
+  put_u16(&g_frame[6], height);
+  put_u16(&g_frame[8], num_of_rects);
+  put_u16(&g_frame[10], flags);
+  put_u32(&g_frame[12], sequence);
+  put_u32(&g_frame[16], elapsed);
+}
+
+static long lcdcapture_encode_full(LovyanGFX *gfx, uint32_t *p_len)
+{
+  uint32_t start = micros();
+  int32_t width = gfx->width();
+  int32_t height = gfx->height();
+  if( !lcdcapture_reserve(width, height) )
+    return -1;
+
+  uint8_t *p = &g_frame[LCDCAPTURE_FRAME_HEADER];
+  uint8_t *p_header = p;
+  put_u16(&p[0], 0);
+  put_u16(&p[2], 0);
+  put_u16(&p[4], width);
+  put_u16(&p[6], height);
+  p += LCDCAPTURE_RECT_HEADER;
+
+  uint8_t *p_body = p;
+  for( int32_t y = 0 ; y < height ; y += LCDCAPTURE_TILE_SIZE ){
+    int32_t h = std::min((int32_t)LCDCAPTURE_TILE_SIZE, height - y);
+    gfx->readRect(0, y, width, h, (lgfx::swap565_t*)g_band);
+    for( int32_t row = 0 ; row < h ; row++ )
+      p = lcdcapture_pack_row(p, &g_band[row * width], width);
+  }
+  put_u32(&p_header[8], p - p_body);
+
+  lcdcapture_frame_header(width, height, 1, LCDCAPTURE_FLAG_KEYFRAME, 0, micros() - start);
+  *p_len = p - g_frame;
+
+  return 0;
+}
+
+static long lcdcapture_encode_delta(LovyanGFX *gfx, bool keyframe, uint32_t *p_len, uint32_t *p_tiles)
+{
+  uint32_t start = micros();
+  int32_t width = gfx->width();
+  int32_t height = gfx->height();
+  if( !lcdcapture_reserve(width, height) )
+    return -1;
+
+  int32_t cols = (width + LCDCAPTURE_TILE_SIZE - 1) / LCDCAPTURE_TILE_SIZE;
+  int32_t rows = (height + LCDCAPTURE_TILE_SIZE - 1) / LCDCAPTURE_TILE_SIZE;
+  if( cols != g_hash_cols || rows != g_hash_rows ){
+    uint32_t *hashes = (uint32_t*)utils_mem_realloc(g_hashes, cols * rows * sizeof(uint32_t));
+    if( hashes == NULL )
+      return -1;
+    g_hashes = hashes;
+    g_hash_cols = cols;
+    g_hash_rows = rows;
+    keyframe = true;
+  }
+
+  uint8_t *p = &g_frame[LCDCAPTURE_FRAME_HEADER];
+  uint16_t num_of_rects = 0;
+  uint32_t num_of_tiles = 0;
+  for( int32_t row = 0 ; row < rows ; row++ ){
+    int32_t y = row * LCDCAPTURE_TILE_SIZE;
+    int32_t h = std::min((int32_t)LCDCAPTURE_TILE_SIZE, height - y);
+    gfx->readRect(0, y, width, h, (lgfx::swap565_t*)g_band);
+
+    // horizontally adjacent changed tiles are sent as one rect
+    int32_t first = -1;
+    for( int32_t col = 0 ; col <= cols ; col++ ){
+      bool changed = false;
+      if( col < cols ){
+        int32_t x = col * LCDCAPTURE_TILE_SIZE;
+        int32_t w = std::min((int32_t)LCDCAPTURE_TILE_SIZE, width - x);
+        uint32_t hash = FNV_OFFSET_BASIS;
+        for( int32_t i = 0 ; i < h ; i++ ){
+          const uint16_t *pixels = &g_band[i * width + x];
+          for( int32_t j = 0 ; j < w ; j++ )
+            hash = (hash ^ pixels[j]) * FNV_PRIME;
+        }
+        uint32_t *p_hash = &g_hashes[row * cols + col];
+        changed = keyframe || *p_hash != hash;
+        *p_hash = hash;
+      }
+
+      if( changed ){
+        num_of_tiles++;
+        if( first < 0 )
+          first = col;
+      }else if( first >= 0 ){
+        int32_t x = first * LCDCAPTURE_TILE_SIZE;
+        int32_t w = std::min((int32_t)(col * LCDCAPTURE_TILE_SIZE), width) - x;
+        p = lcdcapture_pack_rect(p, width, x, y, w, h);
+        num_of_rects++;
+        first = -1;
+      }
+    }
+  }
+
+  lcdcapture_frame_header(width, height, num_of_rects, keyframe ? LCDCAPTURE_FLAG_KEYFRAME : 0, g_stream_sequence, micros() - start);
+  *p_len = p - g_frame;
+  *p_tiles = num_of_tiles;
+
+  return 0;
+}
+
+static void lcdcapture_respond(LCDCAPTURE_REQUEST &req)
+{
+  auto request = req.requestPtr.lock();
+  if( !request )
+    return;
+
+  LovyanGFX *gfx = module_lcd_getSurface(req.display);
+  if( gfx == NULL ){
+    request->send(404, "text/plain", "No display");
+    return;
+  }
+
+  uint32_t start = micros();
+  if( req.format == LCDCAPTURE_FORMAT_PNG ){
+    size_t len = 0;
+    void *png = gfx->createPng(&len, 0, 0, gfx->width(), gfx->height());
+    if( png == NULL ){
+      request->send(503, "text/plain", "Not enough memory");
+      return;
+    }
+    AsyncResponseStream *response = request->beginResponseStream("image/png");
+    response->addHeader("X-Encode-Time", String(micros() - start));
+    response->write((const uint8_t*)png, len);
+    free(png);
+    request->send(response);
+  }else{
+    uint32_t len;
+    if( lcdcapture_encode_full(gfx, &len) != 0 ){
+      request->send(503, "text/plain", "Not enough memory");
+      return;
+    }
+    AsyncResponseStream *response = request->beginResponseStream("application/octet-stream");
+    response->addHeader("X-Encode-Time", String(micros() - start));
+    response->write(g_frame, len);
+    request->send(response);
+  }
+
+  xSemaphoreTake(g_capture_mutex, portMAX_DELAY);
+  g_stats.captures++;
+  xSemaphoreGive(g_capture_mutex);
+}
+
+static void lcdcapture_stream(void)
+{
+  if( g_stream_ws.count() == 0 ){
+    if( g_hashes != NULL || g_frame != NULL )
+      lcdcapture_release();
+    return;
+  }
+
+  uint32_t now = millis();
+  if( now - g_stream_last < 1000 / g_stats.fps )
+    return;
+  g_stream_last = now;
+
+  // changes keep accumulating in the hashes until every client can take a frame
+  if( !g_stream_ws.availableForWriteAll() ){
+    xSemaphoreTake(g_capture_mutex, portMAX_DELAY);
+    g_stats.skipped++;
+    xSemaphoreGive(g_capture_mutex);
+    return;
+  }
+
+  LovyanGFX *gfx = module_lcd_getSurface(0);
+  if( gfx == NULL )
+    return;
+
+  uint32_t start = micros();
+  bool keyframe = g_stream_keyframe;
+  g_stream_keyframe = false;
+  uint32_t len, tiles;
+  if( lcdcapture_encode_delta(gfx, keyframe, &len, &tiles) != 0 ){
+    g_stream_keyframe = true;
+    return;
+  }
+  if( tiles > 0 ){
+    g_stream_ws.binaryAll(g_frame, len);
+    g_stream_sequence++;
+  }
+  uint32_t elapsed = micros() - start;
+
+  xSemaphoreTake(g_capture_mutex, portMAX_DELAY);
+  g_stats.scans++;
+  g_stats.last_encode = elapsed;
+  if( elapsed > g_stats.max_encode )
+    g_stats.max_encode = elapsed;
+  g_stats.total_encode += elapsed;
+  g_stats.last_tiles = tiles;
+  if( tiles > 0 ){
+    g_stats.frames++;
+    g_stats.last_bytes = len;
+    g_stats.total_bytes += len;
+  }
+  xSemaphoreGive(g_capture_mutex);
+}
+
+static void onStreamEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+{
+  // a new viewer has no picture yet, so everybody gets a keyframe
+  if( type == WS_EVT_CONNECT )
+    g_stream_keyframe = true;
+}
+
+long lcdcapture_request(AsyncWebServerRequest *request)
+{
+  LCDCAPTURE_REQUEST req;
+  req.format = LCDCAPTURE_FORMAT_RLE;
+  req.display = 0;
+  const AsyncWebParameter *p_format = request->getParam("format");
+  if( p_format != NULL ){
+    if( p_format->value() == "png" ){
+      req.format = LCDCAPTURE_FORMAT_PNG;
+    }else if( p_format->value() != "rle" ){
+      request->send(400, "text/plain", "Unknown format");
+      return -1;
+    }
+  }
+  const AsyncWebParameter *p_display = request->getParam("display");
+  if( p_display != NULL )
+    req.display = (p_display->value().toInt() == 1) ? 1 : 0;
+
+  xSemaphoreTake(g_capture_mutex, portMAX_DELAY);
+  if( g_request_list.size() >= LCDCAPTURE_MAX_REQUESTS ){
+    xSemaphoreGive(g_capture_mutex);
+    request->send(503, "text/plain", "Too many requests");
+    return -1;
+  }
+  // the panel is read on the main loop, where the scripts draw
+  req.requestPtr = request->pause();
+  g_request_list.push_back(req);
+  xSemaphoreGive(g_capture_mutex);
+
+  return 0;
+}
+
+AsyncWebSocket* lcdcapture_getStream(void)
+{
+  return &g_stream_ws;
+}
+
+long lcdcapture_setFps(uint8_t fps)
+{
+  if( fps < 1 || fps > LCDCAPTURE_MAX_FPS )
+    return -1;
+
+  g_stats.fps = fps;
+
+  return 0;
+}
+
+long lcdcapture_getStats(LCDCAPTURE_STATS *p_stats)
+{
+  xSemaphoreTake(g_capture_mutex, portMAX_DELAY);
+  memmove(p_stats, &g_stats, sizeof(LCDCAPTURE_STATS));
+  xSemaphoreGive(g_capture_mutex);
+  p_stats->clients = g_stream_ws.count();
+
+  return 0;
+}
+
+long lcdcapture_initialize(void)
+{
+  g_capture_mutex = xSemaphoreCreateMutex();
+  if( g_capture_mutex == NULL )
+    return -1;
+
+  memset(&g_stats, 0, sizeof(g_stats));
+  g_stats.fps = LCDCAPTURE_DEFAULT_FPS;
+  g_stream_ws.onEvent(onStreamEvent);
+
+  return 0;
+}
+
+void lcdcapture_loop(void)
+{
+  if( g_capture_mutex == NULL )
+    return;
+
+  while( true ){
+    xSemaphoreTake(g_capture_mutex, portMAX_DELAY);
+    if( g_request_list.size() <= 0 ){
+      xSemaphoreGive(g_capture_mutex);
+      break;
+    }
+    LCDCAPTURE_REQUEST req = g_request_list.front();
+    g_request_list.erase(g_request_list.begin());
+    xSemaphoreGive(g_capture_mutex);
+
+    lcdcapture_respond(req);
+  }
+
+  lcdcapture_stream();
+  g_stream_ws.cleanupClients();
+}
+
+#endif
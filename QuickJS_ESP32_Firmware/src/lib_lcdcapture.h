@@ -0,0 +1,46 @@
+#ifndef _LIB_LCDCAPTURE_H_
+#define _LIB_LCDCAPTURE_H_
+
+#include <Arduino.h>
+#include "main_config.h"
+
+#ifdef _LCD_ENABLE_
+
+#include <ESPAsyncWebServer.h>
+
+#define LCDCAPTURE_TILE_SIZE      16
+#define LCDCAPTURE_DEFAULT_FPS    5
+#define LCDCAPTURE_MAX_FPS        30
+#define LCDCAPTURE_MAX_REQUESTS   2
+
+// frame: "R565", u16 width, u16 height, u16 num_of_rects, u16 flags, u32 sequence, u32 encode time(us)
+#define LCDCAPTURE_FRAME_HEADER   20
+// rect: u16 x, u16 y, u16 w, u16 h, u32 length, PackBits over big-endian RGB565 rows
+#define LCDCAPTURE_RECT_HEADER    12
+#define LCDCAPTURE_FLAG_KEYFRAME  0x0001
+
+typedef struct {
+  uint8_t fps;
+  uint8_t clients;
+  uint32_t scans;
+  uint32_t frames;
+  uint32_t skipped; // client queue was full
+  uint32_t last_bytes;
+  uint32_t last_tiles;
+  uint32_t last_encode; // us
+  uint32_t max_encode; // us
+  uint64_t total_bytes;
+  uint64_t total_encode; // us
+  uint32_t captures;
+} LCDCAPTURE_STATS;
+
+long lcdcapture_initialize(void);
+void lcdcapture_loop(void);
+long lcdcapture_request(AsyncWebServerRequest *request);
+AsyncWebSocket* lcdcapture_getStream(void);
+long lcdcapture_setFps(uint8_t fps);
+long lcdcapture_getStats(LCDCAPTURE_STATS *p_stats);
+
+#endif
+
+#endif
@@ -0,0 +1,350 @@
+#include <Arduino.h>
+#include <algorithm>
+#include <esp_heap_caps.h>
+#include <esp_idf_version.h>
+#include "main_config.h"
+#include "lib_metrics.h"
+
+#include "quickjs_esp32.h"
+
+#if defined(CONFIG_FREERTOS_USE_TRACE_FACILITY) && defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)
+#define METRICS_RUNTIME_STATS
+#endif
+
+#ifndef configRUN_TIME_COUNTER_TYPE
+#define configRUN_TIME_COUNTER_TYPE uint32_t
+#endif
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+#define METRICS_IDLE_TASK_HANDLE(core) xTaskGetIdleTaskHandleForCore(core)
+#else
+#define METRICS_IDLE_TASK_HANDLE(core) xTaskGetIdleTaskHandleForCPU(core)
+#endif
+
+// fallback when run-time stats are not compiled in: lateness of the main loop
+#define IDEAL_LOOP_PERIOD 8000
+
+extern ESP32QuickJS qjs;
+
+static SemaphoreHandle_t g_metrics_mutex = NULL;
+static METRICS_INFO g_metrics;
+static uint32_t g_last_sample = 0;
+
+static uint32_t g_timer_lag[METRICS_NUM_OF_SAMPLES];
+static uint16_t g_timer_lag_count = 0;
+static uint16_t g_timer_lag_index = 0;
+static uint32_t g_loop_time[METRICS_NUM_OF_SAMPLES];
+static uint16_t g_loop_time_count = 0;
+static uint16_t g_loop_time_index = 0;
+
+static uint32_t g_gc_count = 0;
+static uint32_t g_gc_time_total = 0;
+static uint32_t g_gc_time_last = 0;
+
+static uint32_t lastLoopMicros = 0;
+
+// 多重平均
+static float avgFast = 0;
+static float avgMid  = 0;
+static float avgSlow = 0;
+
+#ifdef METRICS_RUNTIME_STATS
+typedef struct {
+  UBaseType_t number;
+  configRUN_TIME_COUNTER_TYPE counter;
+} METRICS_TASK_COUNTER;
+static METRICS_TASK_COUNTER g_prev_counter[METRICS_MAX_TASKS];
+static uint8_t g_prev_num = 0;
+static configRUN_TIME_COUNTER_TYPE g_prev_total = 0;
+#endif
+
+static void record_sample(uint32_t *p_samples, uint16_t *p_count, uint16_t *p_index, uint32_t value)
+{
+  p_samples[*p_index] = value;
+  *p_index = (*p_index + 1) % METRICS_NUM_OF_SAMPLES;
+  if( *p_count < METRICS_NUM_OF_SAMPLES )
+    (*p_count)++;
+}
+
+static void calc_percentile(const uint32_t *p_samples, uint16_t count, METRICS_PERCENTILE *p_result)
+{
+  if( count == 0 ){
+    memset(p_result, 0, sizeof(METRICS_PERCENTILE));
+    return;
+  }
+
+  uint32_t sorted[METRICS_NUM_OF_SAMPLES];
+  memmove(sorted, p_samples, sizeof(uint32_t) * count);
+  std::sort(sorted, sorted + count);
+  p_result->p50 = sorted[(count - 1) * 50 / 100];
+  p_result->p90 = sorted[(count - 1) * 90 / 100];
+  p_result->p99 = sorted[(count - 1) * 99 / 100];
+  p_result->max = sorted[count - 1];
+}
+
+void metrics_record_timer_lag(uint32_t lag)
+{
+  record_sample(g_timer_lag, &g_timer_lag_count, &g_timer_lag_index, lag);
+}
+
+void metrics_record_loop_time(uint32_t elapsed)
+{
+  record_sample(g_loop_time, &g_loop_time_count, &g_loop_time_index, elapsed);
+}
+
+void metrics_record_gc(uint32_t elapsed)
+{
+  g_gc_count++;
+  g_gc_time_total += elapsed;
+  g_gc_time_last = elapsed;
+}
+
+static uint8_t calc_fragmentation(uint32_t free_size, uint32_t largest)
+{
+  if( free_size == 0 )
+    return 0;
+  return 100 - (uint8_t)((uint64_t)largest * 100 / free_size);
+}
+
+#ifdef METRICS_RUNTIME_STATS
+static void sample_tasks(METRICS_INFO *p_info)
+{
+  UBaseType_t num = uxTaskGetNumberOfTasks() + 4;
+  TaskStatus_t *p_status = (TaskStatus_t*)malloc(sizeof(TaskStatus_t) * num);
+  if( p_status == NULL )
+    return;
+  configRUN_TIME_COUNTER_TYPE total;
+  num = uxTaskGetSystemState(p_status, num, &total);
+
+  configRUN_TIME_COUNTER_TYPE total_delta = total - g_prev_total;
+  TaskHandle_t idle[METRICS_MAX_CORES];
+  for( int core = 0 ; core < METRICS_MAX_CORES ; core++ )
+    idle[core] = (core < portNUM_PROCESSORS) ? METRICS_IDLE_TASK_HANDLE(core) : NULL;
+
+  METRICS_TASK_COUNTER counter[METRICS_MAX_TASKS];
+  uint8_t num_counter = 0;
+  p_info->num_tasks = 0;
+  for( UBaseType_t i = 0 ; i < num && num_counter < METRICS_MAX_TASKS ; i++ ){
+    TaskStatus_t *p_task = &p_status[i];
+    configRUN_TIME_COUNTER_TYPE delta = p_task->ulRunTimeCounter;
+    for( int j = 0 ; j < g_prev_num ; j++ ){
+      if( g_prev_counter[j].number == p_task->xTaskNumber ){
+        delta = p_task->ulRunTimeCounter - g_prev_counter[j].counter;
+        break;
+      }
+    }
+    counter[num_counter].number = p_task->xTaskNumber;
+    counter[num_counter].counter = p_task->ulRunTimeCounter;
+    num_counter++;
+
+    uint8_t load = (total_delta > 0 && g_prev_total != 0) ? (uint8_t)std::min((uint64_t)100, (uint64_t)delta * 100 / total_delta) : 0;
+    for( int core = 0 ; core < METRICS_MAX_CORES ; core++ ){
+      if( idle[core] != NULL && p_task->xHandle == idle[core] )
+        p_info->core_load[core] = 100 - load;
+    }
+
+    METRICS_TASK_INFO *p_item = &p_info->tasks[p_info->num_tasks++];
+    strncpy(p_item->name, p_task->pcTaskName, sizeof(p_item->name) - 1);
+    p_item->name[sizeof(p_item->name) - 1] = '\0';
+#if portNUM_PROCESSORS > 1
+    BaseType_t affinity = xTaskGetAffinity(p_task->xHandle);
+    p_item->core = (affinity == tskNO_AFFINITY) ? 0xff : (uint8_t)affinity;
+#else
+    p_item->core = 0;
+#endif
+    p_item->load = load;
+    p_item->stack_free = p_task->usStackHighWaterMark;
+  }
+  free(p_status);
+
+  memmove(g_prev_counter, counter, sizeof(METRICS_TASK_COUNTER) * num_counter);
+  g_prev_num = num_counter;
+  g_prev_total = total;
+}
+#endif
+
+static void sample_all(void)
+{
+  METRICS_INFO info;
+  xSemaphoreTake(g_metrics_mutex, portMAX_DELAY);
+  memmove(&info, &g_metrics, sizeof(info));
+  xSemaphoreGive(g_metrics_mutex);
+
+  info.timestamp = millis();
+  info.num_cores = std::min(portNUM_PROCESSORS, METRICS_MAX_CORES);
+#ifdef METRICS_RUNTIME_STATS
+  info.runtime_stats = true;
+  sample_tasks(&info);
+#else
+  info.runtime_stats = false;
+  info.num_tasks = 0;
+  for( int core = 0 ; core < METRICS_MAX_CORES ; core++ )
+    info.core_load[core] = (uint8_t)(avgSlow + 0.5);
+#endif
+
+  calc_percentile(g_timer_lag, g_timer_lag_count, &info.timer_lag);
+  calc_percentile(g_loop_time, g_loop_time_count, &info.loop_time);
+  info.gc_count = g_gc_count;
+  info.gc_time_total = g_gc_time_total;
+  info.gc_time_last = g_gc_time_last;
+
+  info.heap_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  info.heap_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  info.heap_frag = calc_fragmentation(info.heap_free, info.heap_largest);
+  info.psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  info.psram_largest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+  info.psram_frag = calc_fragmentation(info.psram_free, info.psram_largest);
+
+  // JS_ComputeMemoryUsage must run on the JS thread, so cache it here
+  if( qjs.rt != NULL ){
+    JSMemoryUsage usage;
+    qjs.getMemoryUsage(&usage);
+    info.js_malloc_size = usage.malloc_size;
+    info.js_memory_used = usage.memory_used_size;
+  }else{
+    info.js_malloc_size = 0;
+    info.js_memory_used = 0;
+  }
+
+  xSemaphoreTake(g_metrics_mutex, portMAX_DELAY);
+  memmove(&g_metrics, &info, sizeof(info));
+  xSemaphoreGive(g_metrics_mutex);
+}
+
+long metrics_initialize(void)
+{
+  g_metrics_mutex = xSemaphoreCreateMutex();
+  if( g_metrics_mutex == NULL )
+    return -1;
+
+  memset(&g_metrics, 0, sizeof(g_metrics));
+  lastLoopMicros = micros();
+  g_last_sample = millis();
+
+  return 0;
+}
+
+void metrics_loop(void)
+{
+  uint32_t now = micros();
+  uint32_t diff = now - lastLoopMicros;
+  lastLoopMicros = now;
+
+  int cpuLoadRaw;
+  const uint32_t ideal = IDEAL_LOOP_PERIOD;
+  if (diff <= ideal) {
+    cpuLoadRaw = 0;
+  } else {
+    uint32_t over = diff - ideal;
+    cpuLoadRaw = over * 100 / ideal;
+    if (cpuLoadRaw > 100) cpuLoadRaw = 100;
+  }
+
+  avgFast = avgFast * 0.7 + cpuLoadRaw * 0.3;
+  avgMid  = avgMid  * 0.85 + avgFast * 0.15;
+  avgSlow = avgSlow * 0.95 + avgMid  * 0.05;
+
+  if( g_metrics_mutex == NULL )
+    return;
+  if( millis() - g_last_sample < METRICS_SAMPLE_INTERVAL )
+    return;
+  g_last_sample = millis();
+
+  sample_all();
+}
+
+long metrics_get(METRICS_INFO *p_info)
+{
+  if( g_metrics_mutex == NULL )
+    return -1;
+
+  xSemaphoreTake(g_metrics_mutex, portMAX_DELAY);
+  memmove(p_info, &g_metrics, sizeof(METRICS_INFO));
+  xSemaphoreGive(g_metrics_mutex);
+
+  return 0;
+}
+
+uint8_t metrics_get_core_load(uint8_t core)
+{
+  if( g_metrics_mutex == NULL || core >= METRICS_MAX_CORES )
+    return 0;
+
+  xSemaphoreTake(g_metrics_mutex, portMAX_DELAY);
+  uint8_t load = g_metrics.core_load[core];
+  xSemaphoreGive(g_metrics_mutex);
+
+  return load;
+}
+
+static void append_percentile(String &text, const char *name, const char *help, const METRICS_PERCENTILE *p_value)
+{
+  text += String("# HELP ") + name + " " + help + "\n";
+  text += String("# TYPE ") + name + " summary\n";
+  text += String(name) + "{quantile=\"0.5\"} " + p_value->p50 + "\n";
+  text += String(name) + "{quantile=\"0.9\"} " + p_value->p90 + "\n";
+  text += String(name) + "{quantile=\"0.99\"} " + p_value->p99 + "\n";
+  text += String(name) + "{quantile=\"1\"} " + p_value->max + "\n";
+}
+
+String metrics_format_prometheus(void)
+{
+  METRICS_INFO *p_info = (METRICS_INFO*)malloc(sizeof(METRICS_INFO));
+  if( p_info == NULL || metrics_get(p_info) != 0 ){
+    free(p_info);
+    return String("");
+  }
+
+  String text;
+  text.reserve(2048);
+
+  text += "# HELP esp32_cpu_load_percent CPU load per core\n";
+  text += "# TYPE esp32_cpu_load_percent gauge\n";
+  for( int core = 0 ; core < p_info->num_cores ; core++ )
+    text += String("esp32_cpu_load_percent{core=\"") + core + "\"} " + p_info->core_load[core] + "\n";
+
+  if( p_info->runtime_stats ){
+    text += "# HELP esp32_task_cpu_load_percent CPU load per task, relative to one core\n";
+    text += "# TYPE esp32_task_cpu_load_percent gauge\n";
+    for( int i = 0 ; i < p_info->num_tasks ; i++ ){
+      METRICS_TASK_INFO *p_task = &p_info->tasks[i];
+      String core = (p_task->core == 0xff) ? String("any") : String(p_task->core);
+      text += String("esp32_task_cpu_load_percent{task=\"") + p_task->name + "\",core=\"" + core + "\"} " + p_task->load + "\n";
+    }
+    text += "# HELP esp32_task_stack_free_bytes Minimum free stack per task\n";
+    text += "# TYPE esp32_task_stack_free_bytes gauge\n";
+    for( int i = 0 ; i < p_info->num_tasks ; i++ ){
+      METRICS_TASK_INFO *p_task = &p_info->tasks[i];
+      text += String("esp32_task_stack_free_bytes{task=\"") + p_task->name + "\"} " + p_task->stack_free + "\n";
+    }
+  }
+
+  append_percentile(text, "esp32_js_timer_lag_ms", "Delay of JS timers behind their schedule", &p_info->timer_lag);
+  append_percentile(text, "esp32_js_loop_time_us", "Duration of one JS event loop iteration", &p_info->loop_time);
+
+  text += "# TYPE esp32_js_gc_count counter\n";
+  text += String("esp32_js_gc_count ") + p_info->gc_count + "\n";
+  text += "# TYPE esp32_js_gc_time_us counter\n";
+  text += String("esp32_js_gc_time_us ") + p_info->gc_time_total + "\n";
+  text += "# TYPE esp32_js_malloc_bytes gauge\n";
+  text += String("esp32_js_malloc_bytes ") + p_info->js_malloc_size + "\n";
+  text += "# TYPE esp32_js_memory_used_bytes gauge\n";
+  text += String("esp32_js_memory_used_bytes ") + p_info->js_memory_used + "\n";
+
+  text += "# TYPE esp32_heap_free_bytes gauge\n";
+  text += String("esp32_heap_free_bytes{region=\"internal\"} ") + p_info->heap_free + "\n";
+  text += String("esp32_heap_free_bytes{region=\"psram\"} ") + p_info->psram_free + "\n";
+  text += "# TYPE esp32_heap_largest_free_block_bytes gauge\n";
+  text += String("esp32_heap_largest_free_block_bytes{region=\"internal\"} ") + p_info->heap_largest + "\n";
+  text += String("esp32_heap_largest_free_block_bytes{region=\"psram\"} ") + p_info->psram_largest + "\n";
+  text += "# TYPE esp32_heap_fragmentation_percent gauge\n";
+  text += String("esp32_heap_fragmentation_percent{region=\"internal\"} ") + p_info->heap_frag + "\n";
+  text += String("esp32_heap_fragmentation_percent{region=\"psram\"} ") + p_info->psram_frag + "\n";
+
+  text += "# TYPE esp32_uptime_seconds counter\n";
+  text += String("esp32_uptime_seconds ") + (millis() / 1000) + "\n";
+
+  free(p_info);
+
+  return text;
+}
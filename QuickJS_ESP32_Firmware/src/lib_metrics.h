@@ -0,0 +1,60 @@
+#ifndef _LIB_METRICS_H_
+#define _LIB_METRICS_H_
+
+#include <Arduino.h>
+
+#define METRICS_SAMPLE_INTERVAL   1000
+#define METRICS_MAX_TASKS         32
+#define METRICS_MAX_CORES         2
+#define METRICS_NUM_OF_SAMPLES    128
+#define METRICS_TASK_NAME_LEN     16
+
+typedef struct {
+  char name[METRICS_TASK_NAME_LEN];
+  uint8_t core; // 0xff: no affinity
+  uint8_t load; // % of one core
+  uint32_t stack_free;
+} METRICS_TASK_INFO;
+
+typedef struct {
+  uint32_t p50;
+  uint32_t p90;
+  uint32_t p99;
+  uint32_t max;
+} METRICS_PERCENTILE;
+
+typedef struct {
+  uint32_t timestamp;
+  bool runtime_stats;
+  uint8_t num_cores;
+  uint8_t core_load[METRICS_MAX_CORES];
+  uint8_t num_tasks;
+  METRICS_TASK_INFO tasks[METRICS_MAX_TASKS];
+
+  METRICS_PERCENTILE timer_lag; // ms
+  METRICS_PERCENTILE loop_time; // us
+  uint32_t gc_count;
+  uint32_t gc_time_total; // us
+  uint32_t gc_time_last; // us
+
+  uint32_t heap_free;
+  uint32_t heap_largest;
+  uint8_t heap_frag; // %
+  uint32_t psram_free;
+  uint32_t psram_largest;
+  uint8_t psram_frag; // %
+
+  uint32_t js_malloc_size;
+  uint32_t js_memory_used;
+} METRICS_INFO;
+
+long metrics_initialize(void);
+void metrics_loop(void);
+void metrics_record_timer_lag(uint32_t lag);
+void metrics_record_loop_time(uint32_t elapsed);
+void metrics_record_gc(uint32_t elapsed);
+long metrics_get(METRICS_INFO *p_info);
+uint8_t metrics_get_core_load(uint8_t core);
+String metrics_format_prometheus(void);
+
+#endif
@@ -7,17 +7,19 @@
 #include <WiFiUdp.h>
 #include <LittleFFS.h>
 #include <SNMP_Agent.h>
+#include <algorithm>
 #include "wifi_utils.h"
 #include "storage_info.h"
 #include "lib_snmp.h"
+#include "lib_metrics.h"
 
 #include "quickjs_esp32.h"
 
-#define IDEAL_LOOP_PERIOD 8000
-
 static WiFiUDP udp;
 static SNMPAgent snmp("public");
 
+#define SNMP_TABLE_MAX_RESPONSE 1400 // one Ethernet MTU
+
 extern ESP32QuickJS qjs;
 
 #define hrStorageOther        ".1.3.6.1.2.1.25.2.1.1"
@@ -26,18 +28,112 @@ extern ESP32QuickJS qjs;
 #define hrStorageFixedDisk    ".1.3.6.1.2.1.25.2.1.4"
 #define hrStorageFlashMemory  ".1.3.6.1.2.1.25.2.1.9"
 
-static uint32_t lastLoopMicros = 0;
-static int cpuLoadRaw = 0;
-
-// 多重平均
-static float avgFast = 0;
-static float avgMid  = 0;
-static float avgSlow = 0;
-
 static int private_number[NUM_OF_PRIV_NUMBER] = { NUMBER_DEFAULT, NUMBER_DEFAULT, NUMBER_DEFAULT };
 static std::string private_string[NUM_OF_PRIV_STRING] = { "", "", "" };
 static uint32_t private_timestamp[NUM_OF_PRIV_TIMESTAMP] = { 0, 0, 0 };
 
+// JSから登録されたテーブル(値はスナップショットから応答し、varbindごとにJSを呼ばない)
+static SNMP_TABLE snmp_tables[NUM_OF_SNMP_TABLE];
+
+static bool snmp_tables_in_use(void)
+{
+  for( int i = 0 ; i < NUM_OF_SNMP_TABLE ; i++ ){
+    if( snmp_tables[i].used && snmp_tables[i].num_rows > 0 )
+      return true;
+  }
+  return false;
+}
+
+// Sits between the agent and the socket. SNMP_Agent only matches exact OIDs, so instead of one
+// handler per cell, a request that involves a table reaches the agent with the cells' GETs
+// replaced (lib_snmptable) and the agent's response gets the cells merged in before it is sent.
+class SnmpTableUDP : public UDP {
+  public:
+    SnmpTableUDP(UDP *p_udp) : _p_udp(p_udp), _read_pos(0), _involved(false), _port(0) {}
+
+    uint8_t begin(uint16_t port) override { return _p_udp->begin(port); }
+    void stop() override { _p_udp->stop(); }
+
+    int parsePacket() override {
+      _request.clear();
+      _read_pos = 0;
+      _involved = false;
+      int size = _p_udp->parsePacket();
+      if( size <= 0 )
+        return size;
+      _request.resize(size);
+      int num = _p_udp->read(_request.data(), size);
+      _request.resize(num > 0 ? num : 0);
+
+      if( snmp_tables_in_use() && snmp_message_decode(_request.data(), _request.size(), &_original) ){
+        SNMP_MESSAGE rewritten = _original;
+        if( snmp_tables_rewrite_request(snmp_tables, NUM_OF_SNMP_TABLE, &rewritten) ){
+          snmp_message_encode(&rewritten, _request);
+          _involved = true;
+        }
+      }
+      return _request.size();
+    }
+    int available() override { return _request.size() - _read_pos; }
+    int read() override { return (_read_pos < _request.size()) ? _request[_read_pos++] : -1; }
+    int read(unsigned char *p_buffer, size_t len) override {
+      size_t num = std::min(len, _request.size() - _read_pos);
+      memmove(p_buffer, _request.data() + _read_pos, num);
+      _read_pos += num;
+      return num;
+    }
+    int read(char *p_buffer, size_t len) override { return read((unsigned char*)p_buffer, len); }
+    int peek() override { return (_read_pos < _request.size()) ? _request[_read_pos] : -1; }
+    void flush() override { _read_pos = _request.size(); }
+    IPAddress remoteIP() override { return _p_udp->remoteIP(); }
+    uint16_t remotePort() override { return _p_udp->remotePort(); }
+
+    int beginPacket(IPAddress ip, uint16_t port) override {
+      _ip = ip;
+      _port = port;
+      _response.clear();
+      return 1;
+    }
+    int beginPacket(const char *host, uint16_t port) override {
+      _involved = false;
+      _response.clear();
+      return _p_udp->beginPacket(host, port);
+    }
+    size_t write(uint8_t value) override {
+      _response.push_back(value);
+      return 1;
+    }
+    size_t write(const uint8_t *p_buffer, size_t size) override {
+      _response.insert(_response.end(), p_buffer, p_buffer + size);
+      return size;
+    }
+    int endPacket() override {
+      if( _involved ){
+        SNMP_MESSAGE response;
+        if( snmp_message_decode(_response.data(), _response.size(), &response) &&
+            snmp_tables_merge_response(snmp_tables, NUM_OF_SNMP_TABLE, &_original, &response, SNMP_TABLE_MAX_RESPONSE) )
+          snmp_message_encode(&response, _response);
+      }
+      if( _port != 0 )
+        _p_udp->beginPacket(_ip, _port);
+      _p_udp->write(_response.data(), _response.size());
+      _response.clear();
+      _port = 0;
+      return _p_udp->endPacket();
+    }
+
+  private:
+    UDP *_p_udp;
+    std::vector<uint8_t> _request;
+    size_t _read_pos;
+    SNMP_MESSAGE _original;
+    bool _involved;
+    std::vector<uint8_t> _response;
+    IPAddress _ip;
+    uint16_t _port;
+};
+static SnmpTableUDP table_udp(&udp);
+
 long snmp_set_number(unsigned char index, int value)
 {
   if( index >= NUM_OF_PRIV_NUMBER )
@@ -83,16 +179,98 @@ long snmp_clear_value(void)
   return 0;
 }
 
+static unsigned int snmp_table_total_cells(unsigned char except)
+{
+  unsigned int total = 0;
+  for( int i = 0 ; i < NUM_OF_SNMP_TABLE ; i++ ){
+    if( i != except && snmp_tables[i].used )
+      total += snmp_tables[i].num_columns * snmp_tables[i].num_rows;
+  }
+  return total;
+}
+
+long snmp_table_register(const char *p_oid_base, const unsigned char *p_types, unsigned char num_columns)
+{
+  if( p_oid_base == NULL || num_columns == 0 || num_columns > SNMP_TABLE_MAX_COLUMNS )
+    return -1;
+  for( int i = 0 ; i < num_columns ; i++ ){
+    if( p_types[i] > SNMP_COLUMN_TIMESTAMP )
+      return -1;
+  }
+  std::vector<uint32_t> oid_base;
+  if( !snmp_oid_parse(p_oid_base, oid_base) )
+    return -1;
+
+  for( int i = 0 ; i < NUM_OF_SNMP_TABLE ; i++ ){
+    SNMP_TABLE *p_table = &snmp_tables[i];
+    if( p_table->used )
+      continue;
+
+    p_table->used = true;
+    p_table->oid_base.swap(oid_base);
+    p_table->num_columns = num_columns;
+    memmove(p_table->types, p_types, num_columns);
+    p_table->num_rows = 0;
+    p_table->cells.clear();
+
+    return i;
+  }
+
+  return -1;
+}
+
+long snmp_table_set_rows(unsigned char index, std::vector<SNMP_TABLE_CELL> &cells, unsigned int num_rows)
+{
+  if( index >= NUM_OF_SNMP_TABLE || !snmp_tables[index].used )
+    return -1;
+  SNMP_TABLE *p_table = &snmp_tables[index];
+  if( cells.size() != num_rows * p_table->num_columns )
+    return -1;
+  if( snmp_table_total_cells(index) + cells.size() > SNMP_TABLE_MAX_CELLS )
+    return -1;
+
+  p_table->cells.swap(cells);
+  p_table->num_rows = num_rows;
+
+  return 0;
+}
+
+long snmp_table_get_info(unsigned char index, unsigned char *p_num_columns, unsigned int *p_num_rows)
+{
+  if( index >= NUM_OF_SNMP_TABLE || !snmp_tables[index].used )
+    return -1;
+
+  if( p_num_columns != NULL )
+    *p_num_columns = snmp_tables[index].num_columns;
+  if( p_num_rows != NULL )
+    *p_num_rows = snmp_tables[index].num_rows;
+
+  return 0;
+}
+
+long snmp_table_clear(void)
+{
+  for( int i = 0 ; i < NUM_OF_SNMP_TABLE ; i++ ){
+    SNMP_TABLE *p_table = &snmp_tables[i];
+    if( !p_table->used )
+      continue;
+    p_table->cells.clear();
+    p_table->cells.shrink_to_fit();
+    p_table->num_rows = 0;
+    p_table->used = false;
+  }
+
+  return 0;
+}
+
 long snmp_initialize(void)
 {
   if( !wifi_is_connected() )
     return -1;
 
-  snmp.setUDP(&udp);
+  snmp.setUDP(&table_udp);
   snmp.begin();
 
-  lastLoopMicros = micros();
-
   // system.sysDescr
   snmp.addReadOnlyStaticStringHandler(".1.3.6.1.2.1.1.1.0",
     std::string("ESP32 SNMP Agent")
@@ -229,12 +407,19 @@ long snmp_initialize(void)
     }
   );
 
-  // hrProcessorLoad
+  // hrProcessorLoad (1:core0, 2:core1)
   snmp.addDynamicIntegerHandler(".1.3.6.1.2.1.25.3.3.1.2.1",
     []() -> int {
-      return (int)(avgSlow + 0.5);
+      return metrics_get_core_load(0);
     }
   );
+#if portNUM_PROCESSORS > 1
+  snmp.addDynamicIntegerHandler(".1.3.6.1.2.1.25.3.3.1.2.2",
+    []() -> int {
+      return metrics_get_core_load(1);
+    }
+  );
+#endif
 
   snmp.addDynamicIntegerHandler(PRIVETE_OID_BASE ".1.0",
     []() -> int {
@@ -287,28 +472,8 @@ long snmp_initialize(void)
   return 0;
 }
 
-static void snmp_perform(void) {
-  uint32_t now = micros();
-  uint32_t diff = now - lastLoopMicros;
-  lastLoopMicros = now;
-
-  const uint32_t ideal = IDEAL_LOOP_PERIOD;
-  if (diff <= ideal) {
-    cpuLoadRaw = 0;
-  } else {
-    uint32_t over = diff - ideal;
-    cpuLoadRaw = over * 100 / ideal;
-    if (cpuLoadRaw > 100) cpuLoadRaw = 100;
-  }
-
-  avgFast = avgFast * 0.7 + cpuLoadRaw * 0.3;
-  avgMid  = avgMid  * 0.85 + avgFast * 0.15;
-  avgSlow = avgSlow * 0.95 + avgMid  * 0.05;
-}
-
 long snmp_loop(void)
 {
-  snmp_perform();
   snmp.loop();
 
   return 0;
@@ -8,6 +8,14 @@
 #define NUMBER_DEFAULT  0 // INT_MIN
 #define PRIVETE_OID_BASE  ".1.3.6.1.4.1.8072.9999"
 
+#define NUM_OF_SNMP_TABLE       4
+// cells are only snapshot memory now (about 28 bytes each plus long strings), the agent has no handler per cell
+#define SNMP_TABLE_MAX_CELLS    2048
+
+#include <string>
+#include <vector>
+#include "lib_snmptable.h"
+
 long snmp_initialize(void);
 long snmp_loop(void);
 long snmp_set_number(unsigned char index, int value);
@@ -15,4 +23,9 @@ long snmp_set_string(unsigned char index, const char *p_str);
 long snmp_set_timestamp(unsigned char index, unsigned long value);
 long snmp_clear_value(void);
 
+long snmp_table_register(const char *p_oid_base, const unsigned char *p_types, unsigned char num_columns);
+long snmp_table_set_rows(unsigned char index, std::vector<SNMP_TABLE_CELL> &cells, unsigned int num_rows);
+long snmp_table_get_info(unsigned char index, unsigned char *p_num_columns, unsigned int *p_num_rows);
+long snmp_table_clear(void);
+
 #endif
\ No newline at end of file
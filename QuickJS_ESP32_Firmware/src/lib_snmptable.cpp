@@ -0,0 +1,509 @@
+#include <string.h>
+#include <stdlib.h>
+#include "lib_snmptable.h"
+
+#define BER_INTEGER         0x02
+#define BER_OCTET_STRING    0x04
+#define BER_NULL            0x05
+#define BER_OID             0x06
+#define BER_SEQUENCE        0x30
+#define BER_TIMETICKS       0x43
+#define BER_END_OF_MIB_VIEW 0x82
+
+#define SNMP_VERSION_1          0
+#define SNMP_ERROR_NO_SUCH_NAME 2
+
+typedef struct {
+  const uint8_t *p;
+  const uint8_t *end;
+} BER_READER;
+
+// content of the next TLV, advances the reader past it
+static bool ber_read(BER_READER *p_reader, uint8_t *p_tag, BER_READER *p_content)
+{
+  const uint8_t *p = p_reader->p;
+  if( p_reader->end - p < 2 )
+    return false;
+  uint8_t tag = *p++;
+  size_t length = *p++;
+  if( length & 0x80 ){
+    size_t num = length & 0x7f;
+    if( num == 0 || num > 4 || (size_t)(p_reader->end - p) < num )
+      return false;
+    length = 0;
+    for( size_t i = 0 ; i < num ; i++ )
+      length = (length << 8) | *p++;
+  }
+  if( (size_t)(p_reader->end - p) < length )
+    return false;
+
+  *p_tag = tag;
+  p_content->p = p;
+  p_content->end = p + length;
+  p_reader->p = p + length;
+  return true;
+}
+
+static bool ber_read_integer(BER_READER *p_reader, int32_t *p_value)
+{
+  uint8_t tag;
+  BER_READER content;
+  if( !ber_read(p_reader, &tag, &content) || tag != BER_INTEGER )
+    return false;
+  size_t length = content.end - content.p;
+  if( length == 0 || length > 4 )
+    return false;
+  int32_t value = (content.p[0] & 0x80) ? -1 : 0;
+  for( size_t i = 0 ; i < length ; i++ )
+    value = (int32_t)(((uint32_t)value << 8) | content.p[i]);
+  *p_value = value;
+  return true;
+}
+
+static bool ber_read_oid(BER_READER *p_reader, std::vector<uint32_t> &oid)
+{
+  uint8_t tag;
+  BER_READER content;
+  if( !ber_read(p_reader, &tag, &content) || tag != BER_OID || content.p == content.end )
+    return false;
+
+  oid.clear();
+  uint32_t value = 0;
+  for( const uint8_t *p = content.p ; p < content.end ; p++ ){
+    if( value > (0xffffffff >> 7) )
+      return false;
+    value = (value << 7) | (*p & 0x7f);
+    if( *p & 0x80 )
+      continue;
+    if( oid.empty() ){
+      uint32_t first = (value < 40) ? 0 : (value < 80) ? 1 : 2;
+      oid.push_back(first);
+      oid.push_back(value - first * 40);
+    }else{
+      oid.push_back(value);
+    }
+    value = 0;
+  }
+  return (content.end[-1] & 0x80) == 0;
+}
+
+static void ber_put_header(std::vector<uint8_t> &out, uint8_t tag, size_t length)
+{
+  out.push_back(tag);
+  if( length < 0x80 ){
+    out.push_back((uint8_t)length);
+  }else if( length < 0x100 ){
+    out.push_back(0x81);
+    out.push_back((uint8_t)length);
+  }else{
+    out.push_back(0x82);
+    out.push_back((uint8_t)(length >> 8));
+    out.push_back((uint8_t)length);
+  }
+}
+
+static void ber_put(std::vector<uint8_t> &out, uint8_t tag, const std::vector<uint8_t> &content)
+{
+  ber_put_header(out, tag, content.size());
+  out.insert(out.end(), content.begin(), content.end());
+}
+
+static void ber_put_integer(std::vector<uint8_t> &out, uint8_t tag, int32_t value)
+{
+  // shortest two's complement
+  uint8_t bytes[4] = { (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value };
+  int start = 0;
+  while( start < 3 && ((bytes[start] == 0x00 && !(bytes[start + 1] & 0x80)) || (bytes[start] == 0xff && (bytes[start + 1] & 0x80))) )
+    start++;
+  ber_put_header(out, tag, 4 - start);
+  out.insert(out.end(), bytes + start, bytes + 4);
+}
+
+static void ber_put_unsigned(std::vector<uint8_t> &out, uint8_t tag, uint32_t value)
+{
+  uint8_t bytes[5] = { 0x00, (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value };
+  int start = 0;
+  while( start < 4 && bytes[start] == 0x00 && !(bytes[start + 1] & 0x80) )
+    start++;
+  ber_put_header(out, tag, 5 - start);
+  out.insert(out.end(), bytes + start, bytes + 5);
+}
+
+static void ber_put_oid(std::vector<uint8_t> &out, const std::vector<uint32_t> &oid)
+{
+  std::vector<uint8_t> content;
+  for( size_t i = (oid.size() >= 2) ? 1 : 0 ; i < oid.size() ; i++ ){
+    uint32_t value = oid[i];
+    if( i == 1 )
+      value += oid[0] * 40;
+    uint8_t septets[5];
+    int num = 0;
+    do{
+      septets[num++] = value & 0x7f;
+      value >>= 7;
+    }while( value != 0 );
+    while( num > 1 )
+      content.push_back(septets[--num] | 0x80);
+    content.push_back(septets[0]);
+  }
+  ber_put(out, BER_OID, content);
+}
+
+bool snmp_oid_parse(const char *p_str, std::vector<uint32_t> &oid)
+{
+  oid.clear();
+  if( p_str == NULL )
+    return false;
+  if( *p_str == '.' )
+    p_str++;
+  while( *p_str != '\0' ){
+    if( *p_str < '0' || *p_str > '9' )
+      return false;
+    char *p_end;
+    unsigned long value = strtoul(p_str, &p_end, 10);
+    if( value > 0xffffffff )
+      return false;
+    oid.push_back((uint32_t)value);
+    p_str = p_end;
+    if( *p_str == '.' ){
+      p_str++;
+      if( *p_str == '\0' )
+        return false;
+    }else if( *p_str != '\0' ){
+      return false;
+    }
+  }
+  return oid.size() >= 2 && oid[0] <= 2;
+}
+
+int snmp_oid_compare(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b)
+{
+  size_t num = (a.size() < b.size()) ? a.size() : b.size();
+  for( size_t i = 0 ; i < num ; i++ ){
+    if( a[i] != b[i] )
+      return (a[i] < b[i]) ? -1 : 1;
+  }
+  if( a.size() == b.size() )
+    return 0;
+  return (a.size() < b.size()) ? -1 : 1;
+}
+
+bool snmp_message_decode(const uint8_t *p_data, size_t length, SNMP_MESSAGE *p_message)
+{
+  BER_READER reader = { p_data, p_data + length };
+  BER_READER message, pdu, list;
+  uint8_t tag;
+  if( !ber_read(&reader, &tag, &message) || tag != BER_SEQUENCE )
+    return false;
+  if( !ber_read_integer(&message, &p_message->version) )
+    return false;
+  BER_READER community;
+  if( !ber_read(&message, &tag, &community) || tag != BER_OCTET_STRING )
+    return false;
+  p_message->community.assign((const char*)community.p, community.end - community.p);
+  if( !ber_read(&message, &p_message->pdu_type, &pdu) || (p_message->pdu_type & 0xe0) != 0xa0 )
+    return false;
+  if( !ber_read_integer(&pdu, &p_message->request_id) ||
+      !ber_read_integer(&pdu, &p_message->error_status) ||
+      !ber_read_integer(&pdu, &p_message->error_index) )
+    return false;
+  if( !ber_read(&pdu, &tag, &list) || tag != BER_SEQUENCE )
+    return false;
+
+  p_message->varbinds.clear();
+  while( list.p < list.end ){
+    BER_READER item, value;
+    SNMP_VARBIND varbind;
+    if( !ber_read(&list, &tag, &item) || tag != BER_SEQUENCE )
+      return false;
+    if( !ber_read_oid(&item, varbind.oid) )
+      return false;
+    const uint8_t *p_value = item.p;
+    if( !ber_read(&item, &tag, &value) )
+      return false;
+    varbind.value.assign(p_value, value.end);
+    p_message->varbinds.push_back(varbind);
+  }
+  return true;
+}
+
+void snmp_message_encode(const SNMP_MESSAGE *p_message, std::vector<uint8_t> &out)
+{
+  std::vector<uint8_t> list;
+  for( const auto &varbind : p_message->varbinds ){
+    std::vector<uint8_t> item;
+    ber_put_oid(item, varbind.oid);
+    item.insert(item.end(), varbind.value.begin(), varbind.value.end());
+    ber_put(list, BER_SEQUENCE, item);
+  }
+
+  std::vector<uint8_t> pdu;
+  ber_put_integer(pdu, BER_INTEGER, p_message->request_id);
+  ber_put_integer(pdu, BER_INTEGER, p_message->error_status);
+  ber_put_integer(pdu, BER_INTEGER, p_message->error_index);
+  ber_put(pdu, BER_SEQUENCE, list);
+
+  std::vector<uint8_t> message;
+  ber_put_integer(message, BER_INTEGER, p_message->version);
+  ber_put_header(message, BER_OCTET_STRING, p_message->community.size());
+  message.insert(message.end(), p_message->community.begin(), p_message->community.end());
+  ber_put(message, p_message->pdu_type, pdu);
+
+  out.clear();
+  ber_put(out, BER_SEQUENCE, message);
+}
+
+bool snmp_table_find(const SNMP_TABLE *p_table, const std::vector<uint32_t> &oid, unsigned int *p_column, unsigned int *p_row)
+{
+  size_t n = p_table->oid_base.size();
+  if( !p_table->used || oid.size() != n + 3 || oid[n] != 1 )
+    return false;
+  if( memcmp(oid.data(), p_table->oid_base.data(), n * sizeof(uint32_t)) != 0 )
+    return false;
+  if( oid[n + 1] < 1 || oid[n + 1] > p_table->num_columns || oid[n + 2] < 1 || oid[n + 2] > p_table->num_rows )
+    return false;
+
+  *p_column = oid[n + 1];
+  *p_row = oid[n + 2];
+  return true;
+}
+
+bool snmp_table_next(const SNMP_TABLE *p_table, const std::vector<uint32_t> &oid, unsigned int *p_column, unsigned int *p_row)
+{
+  if( !p_table->used || p_table->num_rows == 0 )
+    return false;
+
+  // against tableEntry = base.1
+  size_t n = p_table->oid_base.size();
+  for( size_t i = 0 ; i <= n ; i++ ){
+    uint32_t entry = (i < n) ? p_table->oid_base[i] : 1;
+    if( i >= oid.size() || oid[i] < entry ){
+      *p_column = 1;
+      *p_row = 1;
+      return true;
+    }
+    if( oid[i] > entry )
+      return false;
+  }
+
+  unsigned int column = (oid.size() > n + 1) ? oid[n + 1] : 0;
+  if( column == 0 ){
+    *p_column = 1;
+    *p_row = 1;
+    return true;
+  }
+  if( column > p_table->num_columns )
+    return false;
+  unsigned int row = (oid.size() > n + 2) ? oid[n + 2] : 0;
+  if( row >= p_table->num_rows ){
+    if( column >= p_table->num_columns )
+      return false;
+    *p_column = column + 1;
+    *p_row = 1;
+    return true;
+  }
+  *p_column = column;
+  *p_row = row + 1;
+  return true;
+}
+
+static void snmp_table_cell_varbind(const SNMP_TABLE *p_table, unsigned int column, unsigned int row, SNMP_VARBIND *p_varbind)
+{
+  p_varbind->oid = p_table->oid_base;
+  p_varbind->oid.push_back(1);
+  p_varbind->oid.push_back(column);
+  p_varbind->oid.push_back(row);
+
+  const SNMP_TABLE_CELL *p_cell = &p_table->cells[(row - 1) * p_table->num_columns + (column - 1)];
+  p_varbind->value.clear();
+  if( p_table->types[column - 1] == SNMP_COLUMN_STRING ){
+    ber_put_header(p_varbind->value, BER_OCTET_STRING, p_cell->str.size());
+    p_varbind->value.insert(p_varbind->value.end(), p_cell->str.begin(), p_cell->str.end());
+  }else if( p_table->types[column - 1] == SNMP_COLUMN_TIMESTAMP ){
+    ber_put_unsigned(p_varbind->value, BER_TIMETICKS, (uint32_t)p_cell->number / 10);
+  }else{
+    ber_put_integer(p_varbind->value, BER_INTEGER, p_cell->number);
+  }
+}
+
+static bool snmp_tables_find(const SNMP_TABLE *p_tables, unsigned int num, const std::vector<uint32_t> &oid, SNMP_VARBIND *p_varbind)
+{
+  unsigned int column, row;
+  for( unsigned int i = 0 ; i < num ; i++ ){
+    if( snmp_table_find(&p_tables[i], oid, &column, &row) ){
+      if( p_varbind != NULL )
+        snmp_table_cell_varbind(&p_tables[i], column, row, p_varbind);
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool snmp_tables_next(const SNMP_TABLE *p_tables, unsigned int num, const std::vector<uint32_t> &oid, SNMP_VARBIND *p_varbind)
+{
+  bool found = false;
+  unsigned int column, row;
+  SNMP_VARBIND candidate;
+  for( unsigned int i = 0 ; i < num ; i++ ){
+    if( !snmp_table_next(&p_tables[i], oid, &column, &row) )
+      continue;
+    snmp_table_cell_varbind(&p_tables[i], column, row, &candidate);
+    if( !found || snmp_oid_compare(candidate.oid, p_varbind->oid) < 0 ){
+      *p_varbind = candidate;
+      found = true;
+    }
+  }
+  return found;
+}
+
+static bool snmp_varbind_exhausted(const SNMP_VARBIND *p_varbind)
+{
+  return p_varbind->value.empty() || p_varbind->value[0] == BER_END_OF_MIB_VIEW;
+}
+
+bool snmp_tables_rewrite_request(const SNMP_TABLE *p_tables, unsigned int num, SNMP_MESSAGE *p_request)
+{
+  bool involved = false;
+  SNMP_VARBIND varbind;
+  for( auto &item : p_request->varbinds ){
+    if( p_request->pdu_type == SNMP_PDU_GET ){
+      if( snmp_tables_find(p_tables, num, item.oid, NULL) ){
+        snmp_oid_parse(SNMP_TABLE_PLACEHOLDER_OID, item.oid);
+        involved = true;
+      }
+    }else if( p_request->pdu_type == SNMP_PDU_GETNEXT || p_request->pdu_type == SNMP_PDU_GETBULK ){
+      if( snmp_tables_next(p_tables, num, item.oid, &varbind) )
+        involved = true;
+    }
+  }
+  return involved;
+}
+
+// next of oid in the union of the agent's chain (consumed from *p_agent) and the tables
+static void snmp_tables_merge_next(const SNMP_TABLE *p_tables, unsigned int num, const std::vector<uint32_t> &oid,
+                                   const SNMP_VARBIND *p_agent, bool *p_agent_used, SNMP_VARBIND *p_out)
+{
+  SNMP_VARBIND table;
+  bool has_table = snmp_tables_next(p_tables, num, oid, &table);
+  bool has_agent = p_agent != NULL && !snmp_varbind_exhausted(p_agent);
+  *p_agent_used = false;
+  if( has_table && (!has_agent || snmp_oid_compare(table.oid, p_agent->oid) < 0) ){
+    *p_out = table;
+  }else if( has_agent ){
+    *p_out = *p_agent;
+    *p_agent_used = true;
+  }else{
+    // both exhausted, the walk stays where it is
+    p_out->oid = oid;
+    p_out->value.assign({ BER_END_OF_MIB_VIEW, 0x00 });
+  }
+}
+
+bool snmp_tables_merge_response(const SNMP_TABLE *p_tables, unsigned int num, const SNMP_MESSAGE *p_request, SNMP_MESSAGE *p_response, size_t max_size)
+{
+  const auto &request = p_request->varbinds;
+  auto &response = p_response->varbinds;
+  bool agent_used;
+
+  if( p_request->pdu_type == SNMP_PDU_GET ){
+    if( response.size() != request.size() )
+      return false;
+    bool changed = false;
+    for( size_t i = 0 ; i < request.size() ; i++ ){
+      SNMP_VARBIND cell;
+      if( !snmp_tables_find(p_tables, num, request[i].oid, &cell) )
+        continue;
+      // an error elsewhere echoes the request, which still has to show the original OID
+      if( p_response->error_status == 0 )
+        response[i] = cell;
+      else
+        response[i].oid = request[i].oid;
+      changed = true;
+    }
+    return changed;
+  }
+
+  if( p_request->pdu_type == SNMP_PDU_GETNEXT ){
+    if( response.size() != request.size() )
+      return false;
+    if( p_response->error_status != 0 ){
+      // SNMPv1 reports the end of the agent's MIB as noSuchName, only a lone varbind can be answered instead
+      SNMP_VARBIND next;
+      if( p_response->version != SNMP_VERSION_1 || p_response->error_status != SNMP_ERROR_NO_SUCH_NAME ||
+          request.size() != 1 || !snmp_tables_next(p_tables, num, request[0].oid, &next) )
+        return false;
+      p_response->error_status = 0;
+      p_response->error_index = 0;
+      response[0] = next;
+      return true;
+    }
+    bool changed = false;
+    for( size_t i = 0 ; i < request.size() ; i++ ){
+      SNMP_VARBIND next;
+      snmp_tables_merge_next(p_tables, num, request[i].oid, &response[i], &agent_used, &next);
+      if( !agent_used ){
+        response[i] = next;
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  if( p_request->pdu_type == SNMP_PDU_GETBULK ){
+    if( p_response->error_status != 0 )
+      return false;
+    size_t non_repeaters = (p_request->error_status < 0) ? 0 : (size_t)p_request->error_status;
+    if( non_repeaters > request.size() )
+      non_repeaters = request.size();
+    size_t repeaters = request.size() - non_repeaters;
+    size_t max_repetitions = (p_request->error_index < 0) ? 0 : (size_t)p_request->error_index;
+    if( response.size() < non_repeaters )
+      return false;
+    // the agent may already have cut the repetitions short, never answer more than it did
+    size_t repetitions = (repeaters > 0) ? (response.size() - non_repeaters) / repeaters : 0;
+    if( repeaters > 0 && repetitions == 0 && max_repetitions > 0 )
+      repetitions = 1;
+
+    std::vector<SNMP_VARBIND> agent(response);
+    std::vector<SNMP_VARBIND> merged;
+    for( size_t i = 0 ; i < non_repeaters ; i++ ){
+      SNMP_VARBIND next;
+      snmp_tables_merge_next(p_tables, num, request[i].oid, &agent[i], &agent_used, &next);
+      merged.push_back(next);
+    }
+    std::vector<std::vector<SNMP_VARBIND>> columns(repeaters);
+    for( size_t j = 0 ; j < repeaters ; j++ ){
+      std::vector<uint32_t> oid = request[non_repeaters + j].oid;
+      size_t k = 0; // next unused element of the agent's chain
+      for( size_t r = 0 ; r < repetitions ; r++ ){
+        size_t index = non_repeaters + k * repeaters + j;
+        const SNMP_VARBIND *p_agent = (index < agent.size()) ? &agent[index] : NULL;
+        SNMP_VARBIND next;
+        snmp_tables_merge_next(p_tables, num, oid, p_agent, &agent_used, &next);
+        if( agent_used )
+          k++;
+        oid = next.oid;
+        columns[j].push_back(next);
+      }
+    }
+
+    // fewer repetitions than asked for is allowed when the message would get too big
+    while( true ){
+      response.assign(merged.begin(), merged.end());
+      for( size_t r = 0 ; r < repetitions ; r++ ){
+        for( size_t j = 0 ; j < repeaters ; j++ )
+          response.push_back(columns[j][r]);
+      }
+      if( repetitions <= 1 || max_size == 0 )
+        break;
+      std::vector<uint8_t> encoded;
+      snmp_message_encode(p_response, encoded);
+      if( encoded.size() <= max_size )
+        break;
+      repetitions--;
+    }
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,73 @@
+#ifndef _LIB_SNMPTABLE_H_
+#define _LIB_SNMPTABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Tables registered from JS are not agent handlers. The agent answers the request first and
+// its response is then merged with the cells: a cell is addressed by arithmetic on
+// tableEntry(.1).column.row, and GETNEXT/GETBULK take whichever of the agent's and the tables'
+// next OIDs is smaller, so a walk sees one lexicographically ordered MIB.
+#define SNMP_TABLE_MAX_COLUMNS  16
+
+#define SNMP_COLUMN_NUMBER      0
+#define SNMP_COLUMN_STRING      1
+#define SNMP_COLUMN_TIMESTAMP   2
+
+#define SNMP_PDU_GET            0xa0
+#define SNMP_PDU_GETNEXT        0xa1
+#define SNMP_PDU_RESPONSE       0xa2
+#define SNMP_PDU_GETBULK        0xa5
+
+// a GET of a cell reaches the agent as sysUpTime.0, which always exists
+#define SNMP_TABLE_PLACEHOLDER_OID  ".1.3.6.1.2.1.1.3.0"
+
+typedef struct {
+  int number;
+  std::string str;
+} SNMP_TABLE_CELL;
+
+typedef struct {
+  bool used;
+  std::vector<uint32_t> oid_base;
+  unsigned char num_columns;
+  unsigned char types[SNMP_TABLE_MAX_COLUMNS];
+  unsigned int num_rows;
+  std::vector<SNMP_TABLE_CELL> cells; // row-major
+} SNMP_TABLE;
+
+typedef struct {
+  std::vector<uint32_t> oid;
+  std::vector<uint8_t> value; // whole TLV
+} SNMP_VARBIND;
+
+typedef struct {
+  int32_t version;
+  std::string community;
+  uint8_t pdu_type;
+  int32_t request_id;
+  int32_t error_status; // non-repeaters for GETBULK
+  int32_t error_index;  // max-repetitions for GETBULK
+  std::vector<SNMP_VARBIND> varbinds;
+} SNMP_MESSAGE;
+
+// ".1.3.6.1..." (the leading dot is optional)
+bool snmp_oid_parse(const char *p_str, std::vector<uint32_t> &oid);
+int snmp_oid_compare(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b);
+
+bool snmp_message_decode(const uint8_t *p_data, size_t length, SNMP_MESSAGE *p_message);
+void snmp_message_encode(const SNMP_MESSAGE *p_message, std::vector<uint8_t> &out);
+
+// exact cell, column and row are 1 based
+bool snmp_table_find(const SNMP_TABLE *p_table, const std::vector<uint32_t> &oid, unsigned int *p_column, unsigned int *p_row);
+// first cell after oid in walk order (column by column)
+bool snmp_table_next(const SNMP_TABLE *p_table, const std::vector<uint32_t> &oid, unsigned int *p_column, unsigned int *p_row);
+
+// replaces GETs of cells with the placeholder, false when the request does not involve a table
+bool snmp_tables_rewrite_request(const SNMP_TABLE *p_tables, unsigned int num, SNMP_MESSAGE *p_request);
+// merges the cells into the agent's response to the original request, false when it is left as is
+bool snmp_tables_merge_response(const SNMP_TABLE *p_tables, unsigned int num, const SNMP_MESSAGE *p_request, SNMP_MESSAGE *p_response, size_t max_size);
+
+#endif
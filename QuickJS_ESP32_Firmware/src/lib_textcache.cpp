@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include "lib_textcache.h"
+
+std::string textcache_run_key(const void *font, float size_x, float size_y, uint32_t fore_rgb888, uint32_t back_rgb888, bool transparent, const char *text)
+{
+  // a transparent run does not depend on the background color
+  char prefix[64];
+  snprintf(prefix, sizeof(prefix), "%p|%g|%g|%06x|%07x|", font, size_x, size_y,
+    (unsigned int)fore_rgb888, transparent ? 0x1000000U : (unsigned int)back_rgb888);
+  std::string key(prefix);
+  key += text;
+  return key;
+}
+
+uint64_t textcache_glyph_key(const void *font, uint32_t code)
+{
+  return ((uint64_t)(uintptr_t)font << 32) | code;
+}
+
+int textcache_utf8_next(const char *p, uint32_t *p_code)
+{
+  uint8_t c = (uint8_t)p[0];
+  int len;
+  if( c < 0x80 ){ *p_code = c; return 1; }
+  else if( (c & 0xe0) == 0xc0 ){ *p_code = c & 0x1f; len = 2; }
+  else if( (c & 0xf0) == 0xe0 ){ *p_code = c & 0x0f; len = 3; }
+  else if( (c & 0xf8) == 0xf0 ){ *p_code = c & 0x07; len = 4; }
+  else return 0;
+  for( int i = 1 ; i < len ; i++ ){
+    if( ((uint8_t)p[i] & 0xc0) != 0x80 )
+      return 0;
+    *p_code = (*p_code << 6) | ((uint8_t)p[i] & 0x3f);
+  }
+  return len;
+}
+
+bool textcache_cacheable(const char *text, size_t max_len)
+{
+  size_t len = 0;
+  for( const char *p = text ; *p != '\0' ; p++, len++ ){
+    if( (uint8_t)*p < 0x20 || len >= max_len )
+      return false;
+  }
+  return len > 0;
+}
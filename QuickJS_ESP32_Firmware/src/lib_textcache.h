@@ -0,0 +1,101 @@
+#ifndef _LIB_TEXTCACHE_H_
+#define _LIB_TEXTCACHE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// key of a whole rendered string: font, text size, colors and the UTF-8 text
+std::string textcache_run_key(const void *font, float size_x, float size_y, uint32_t fore_rgb888, uint32_t back_rgb888, bool transparent, const char *text);
+// key of a glyph mask: font and codepoint
+uint64_t textcache_glyph_key(const void *font, uint32_t code);
+// bytes of the UTF-8 sequence at p, 0 when malformed
+int textcache_utf8_next(const char *p, uint32_t *p_code);
+// printable and at most max_len bytes
+bool textcache_cacheable(const char *text, size_t max_len);
+
+// byte budgeted LRU of heap objects, release() frees an evicted value
+template <typename KEY>
+class TextCache {
+  public:
+    TextCache(void (*release)(void *p_value))
+      : _release(release), _budget(0), _used(0), _hits(0), _misses(0), _evictions(0) {}
+    ~TextCache() { clear(); }
+
+    // counts a hit or a miss, a hit becomes the most recently used
+    void *find(const KEY &key) {
+      auto it = _map.find(key);
+      if( it == _map.end() ){
+        _misses++;
+        return NULL;
+      }
+      _hits++;
+      _lru.splice(_lru.begin(), _lru, it->second);
+      return it->second->p_value;
+    }
+
+    // false when the value alone is over the budget, the caller keeps it then
+    bool insert(const KEY &key, void *p_value, uint32_t size) {
+      if( _budget == 0 || size > _budget || _map.find(key) != _map.end() )
+        return false;
+      trim(_budget - size);
+      _lru.push_front(ENTRY{ key, p_value, size });
+      _map[key] = _lru.begin();
+      _used += size;
+      return true;
+    }
+
+    void setBudget(uint32_t budget) {
+      _budget = budget;
+      trim(budget);
+    }
+
+    void clear(void) {
+      trim(0);
+    }
+
+    void resetStats(void) {
+      _hits = 0;
+      _misses = 0;
+      _evictions = 0;
+    }
+
+    uint32_t budget(void) const { return _budget; }
+    uint32_t used(void) const { return _used; }
+    uint32_t count(void) const { return _map.size(); }
+    uint32_t hits(void) const { return _hits; }
+    uint32_t misses(void) const { return _misses; }
+    uint32_t evictions(void) const { return _evictions; }
+
+  private:
+    typedef struct {
+      KEY key;
+      void *p_value;
+      uint32_t size;
+    } ENTRY;
+
+    void trim(uint32_t budget) {
+      // a zero budget also drops the zero sized entries
+      while( !_lru.empty() && (_used > budget || budget == 0) ){
+        ENTRY &oldest = _lru.back();
+        _release(oldest.p_value);
+        _used -= oldest.size;
+        _map.erase(oldest.key);
+        _lru.pop_back();
+        _evictions++;
+      }
+    }
+
+    void (*_release)(void *p_value);
+    std::list<ENTRY> _lru; // most recently used first
+    std::unordered_map<KEY, typename std::list<ENTRY>::iterator> _map;
+    uint32_t _budget;
+    uint32_t _used;
+    uint32_t _hits;
+    uint32_t _misses;
+    uint32_t _evictions;
+};
+
+#endif
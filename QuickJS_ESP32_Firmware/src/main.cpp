@@ -8,6 +8,10 @@
 #include "config_utils.h"
 #include "wifi_utils.h"
 #include "lib_snmp.h"
+#include "lib_metrics.h"
+#ifdef _LCD_ENABLE_
+#include "lib_lcdcapture.h"
+#endif
 
 #include "endpoint_types.h"
 #include "endpoint_packet.h"
@@ -76,6 +80,16 @@ void setup()
   binSem = xSemaphoreCreateBinary();
   xSemaphoreGive(binSem);
 
+  ret = metrics_initialize();
+  if( ret != 0 )
+    Serial.println("metrics_initialize error");
+
+#ifdef _LCD_ENABLE_
+  ret = lcdcapture_initialize();
+  if( ret != 0 )
+    Serial.println("lcdcapture_initialize error");
+#endif
+
   ret = packet_open();
   if( ret != 0 )
     Serial.println("packet_open error");
@@ -101,6 +115,11 @@ void setup()
 
 void loop()
 {
+  metrics_loop();
+#ifdef _LCD_ENABLE_
+  lcdcapture_loop();
+#endif
+
   if( g_fileloading == FILE_LOADING_PAUSE || g_fileloading == FILE_LOADING_STOP ){
     delay(100);
     return;
@@ -1,9 +1,19 @@
 #include <Arduino.h>
 #include <esp_heap_caps.h>
+#include "mem_utils.h"
+
+static int8_t g_psram_found = -1;
+
+static bool has_psram(void)
+{
+  if( g_psram_found < 0 )
+    g_psram_found = psramInit() ? 1 : 0;
+  return g_psram_found != 0;
+}
 
 void* utils_mem_alloc(size_t size)
 {
-  if( psramInit() ){
+  if( has_psram() ){
     return heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
   }else{
     return malloc(size);
@@ -12,7 +22,7 @@ void* utils_mem_alloc(size_t size)
 
 void* utils_mem_realloc(void* buffer, size_t size)
 {
-  if( psramInit() ){
+  if( has_psram() ){
     return heap_caps_realloc(buffer, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
   }else{
     return realloc(buffer, size);
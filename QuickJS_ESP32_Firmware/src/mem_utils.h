@@ -2,9 +2,10 @@
 #define _MEM_UTILS_H_
 
 #include <Arduino.h>
+#include "lib_jsmem.h"
 
 void* utils_mem_alloc(size_t size);
 void* utils_mem_realloc(void* buffer, size_t size);
 void utils_mem_free(void* buffer);
 
-#endif
\ No newline at end of file
+#endif
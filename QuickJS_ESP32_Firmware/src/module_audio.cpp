@@ -4,18 +4,41 @@
 #ifdef _AUDIO_ENABLE_
 
 #include "quickjs.h"
+#include "quickjs_esp32.h"
 #include "module_type.h"
 #include "module_utils.h"
+#include "mem_utils.h"
 
 #include "module_audio.h"
 #include <AudioOutput.h>
 #include <AudioFileSourceHTTPStream.h>
 #include <AudioFileSourceBuffer.h>
 #include <AudioGeneratorMP3.h>
+#include <AudioGeneratorWAV.h>
+#include <AudioGeneratorAAC.h>
 #include <AudioFileSourceSD.h>
+#include <vector>
 
 #define DEFAULT_AUDIO_VOLUME  64
-#define AUDIO_URL_BUFFER_SIZE 1024
+#define AUDIO_URL_BUFFER_SIZE (64 * 1024) // prefetch ring, PSRAM when available
+#define AUDIO_URL_BUFFER_MIN  1024
+
+#define AUDIO_TASK_STACK      10240
+#define AUDIO_TASK_PRIORITY   3
+#define AUDIO_TASK_CORE       0
+#define AUDIO_QUEUE_LENGTH    8
+#define AUDIO_IDLE_WAIT       20
+#define AUDIO_ACK_TIMEOUT     3000
+// play/next wait for the next source to open: HTTPClient allows 5 s to connect and 5 s for the
+// response header, and the generator's first read may wait on the stream once more
+#define AUDIO_OPEN_TIMEOUT    16000
+#define AUDIO_ACK_LENGTH      4
+#define AUDIO_MAX_EVENTS      16
+
+#define AUDIO_FORMAT_AUTO     0
+#define AUDIO_FORMAT_MP3      1
+#define AUDIO_FORMAT_WAV      2
+#define AUDIO_FORMAT_AAC      3
 
 #define AUDIO_OUTPUT_AUTO           0x00
 #define AUDIO_OUTPUT_INTERNAL_DAC   0x01
@@ -76,19 +99,43 @@ class AudioOutputM5Speaker : public AudioOutput
     {
       if (_tri_buffer_index)
       {
+        // the speaker ran dry before this chunk arrived
+        if( _primed && _m5sound->isPlaying(_virtual_ch) == 0 )
+          underruns++;
+        _primed = true;
         _m5sound->playRaw(_tri_buffer[_tri_index], _tri_buffer_index, hertz, true, 1, _virtual_ch);
         _tri_index = _tri_index < 2 ? _tri_index + 1 : 0;
         _tri_buffer_index = 0;
       }
     }
 
+    // generators call stop() at the end of every track, keep the speaker
+    // running so that the next track in the playlist follows without a gap
     virtual bool stop(void) override
     {
       flush();
-      _m5sound->stop(_virtual_ch);
+      _primed = false;
       return true;
     }
 
+    void end(void)
+    {
+      flush();
+      _primed = false;
+      _m5sound->stop(_virtual_ch);
+    }
+
+    // drops the pending chunk and whatever the speaker still has queued
+    void discard(void)
+    {
+      _tri_buffer_index = 0;
+      _primed = false;
+      _m5sound->stop(_virtual_ch);
+    }
+
+    int getRate(void) const { return hertz; }
+    uint32_t underruns = 0;
+
     const int16_t* getBuffer(void) const { return _tri_buffer[(_tri_index + 2) % 3]; }
 
     virtual bool SetRate(int hz) override
@@ -105,19 +152,102 @@ class AudioOutputM5Speaker : public AudioOutput
     int16_t *_tri_buffer[3] = { NULL, NULL, NULL };
     size_t _tri_buffer_index = 0;
     size_t _tri_index = 0;
+    bool _primed = false;
 };
 
+typedef enum {
+  AUDIO_CMD_PLAY, // replaces the playlist
+  AUDIO_CMD_ENQUEUE,
+  AUDIO_CMD_NEXT,
+  AUDIO_CMD_STOP,
+  AUDIO_CMD_PAUSE,
+  AUDIO_CMD_RESUME,
+  AUDIO_CMD_QUIT,
+} AUDIO_CMD_TYPE;
+
+typedef struct {
+  char *p_location; // http(s):// URL or SD path, owned by the command
+  uint8_t format;
+  uint32_t prefetch;
+} AUDIO_TRACK;
+
+typedef struct {
+  AUDIO_CMD_TYPE type;
+  AUDIO_TRACK track;
+  bool ack;
+  uint32_t seq; // echoed back in the ack
+} AUDIO_COMMAND;
+
+typedef enum {
+  AUDIO_EVENT_STARTED,
+  AUDIO_EVENT_FAILED,
+  AUDIO_EVENT_FINISHED,
+} AUDIO_EVENT_TYPE;
+
+typedef struct {
+  AUDIO_EVENT_TYPE type;
+  uint32_t index;
+} AUDIO_EVENT_INFO;
+
 static AudioOutputM5Speaker *out = NULL;
-static AudioGeneratorMP3 *mp3 = NULL;
+static bool audio_paused = false;
+static uint8_t audio_volume = DEFAULT_AUDIO_VOLUME;
+
+// owned by the audio task, JS only posts commands
+static AudioGenerator *generator = NULL;
 static AudioFileSourceSD *file_sd = NULL;
 static AudioFileSourceHTTPStream *file_http = NULL;
 static AudioFileSourceBuffer *buff = NULL;
-static bool audio_paused = false;
-static uint8_t audio_volume = DEFAULT_AUDIO_VOLUME;
+static uint8_t *buff_memory = NULL;
+static uint32_t buff_size = 0;
+static std::vector<AUDIO_TRACK> g_playlist;
+
+static TaskHandle_t g_audio_task = NULL;
+static QueueHandle_t g_audio_queue = NULL;
+static QueueHandle_t g_audio_ack = NULL; // seq of completed acked commands
+static uint32_t g_audio_seq = 0;
+static SemaphoreHandle_t g_event_mutex = NULL;
+static std::vector<AUDIO_EVENT_INFO> g_event_list;
+
+static volatile bool g_playing = false;
+static volatile uint32_t g_track_index = 0;
+static volatile uint32_t g_playlist_length = 0;
+static volatile uint32_t g_buffer_level = 0;
+static volatile uint32_t g_starved = 0;
+
+static JSContext *g_ctx = NULL;
+static JSValue g_callback_func = JS_UNDEFINED;
+
+static void audio_push_event(AUDIO_EVENT_TYPE type, uint32_t index)
+{
+  AUDIO_EVENT_INFO info = { type, index };
+  xSemaphoreTake(g_event_mutex, portMAX_DELAY);
+  if( g_event_list.size() >= AUDIO_MAX_EVENTS )
+    g_event_list.erase(g_event_list.begin());
+  g_event_list.push_back(info);
+  xSemaphoreGive(g_event_mutex);
+}
+
+static void audio_track_free(AUDIO_TRACK *p_track)
+{
+  if( p_track->p_location != NULL ){
+    free(p_track->p_location);
+    p_track->p_location = NULL;
+  }
+}
+
+static void audio_playlist_clear(void)
+{
+  for( auto &track : g_playlist )
+    audio_track_free(&track);
+  g_playlist.clear();
+  g_playlist_length = 0;
+  g_track_index = 0;
+}
 
 static void audio_source_dispose(void){
-  if( mp3 != NULL )
-    mp3->stop();
+  if( generator != NULL && generator->isRunning() )
+    generator->stop();
   if( buff != NULL )
     buff->close();
   if( file_sd != NULL )
@@ -125,15 +255,20 @@ static void audio_source_dispose(void){
   if( file_http != NULL )
     file_http->close();
 
-  if( mp3 != NULL ){
-    delete mp3;
-    mp3 = NULL;
+  if( generator != NULL ){
+    delete generator;
+    generator = NULL;
   }
 
   if( buff != NULL ){
     delete buff;
     buff = NULL;
   }
+  if( buff_memory != NULL ){
+    utils_mem_free(buff_memory);
+    buff_memory = NULL;
+  }
+  buff_size = 0;
   if( file_sd != NULL ){
     delete file_sd;
     file_sd = NULL;
@@ -143,14 +278,284 @@ static void audio_source_dispose(void){
     file_http = NULL;
   }
 
-  audio_paused = false;
+  g_buffer_level = 0;
 }
 
-static JSValue audio_begin(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+static uint8_t audio_detect_format(const char *p_location)
+{
+  const char *p_ext = strrchr(p_location, '.');
+  if( p_ext != NULL ){
+    if( strncasecmp(p_ext, ".wav", 4) == 0 )
+      return AUDIO_FORMAT_WAV;
+    if( strncasecmp(p_ext, ".aac", 4) == 0 )
+      return AUDIO_FORMAT_AAC;
+  }
+  return AUDIO_FORMAT_MP3;
+}
+
+// runs on the audio task
+static bool audio_source_open(const AUDIO_TRACK *p_track)
 {
   audio_source_dispose();
+
+  AudioFileSource *source;
+  if( strncmp(p_track->p_location, "http://", 7) == 0 || strncmp(p_track->p_location, "https://", 8) == 0 ){
+    file_http = new AudioFileSourceHTTPStream(p_track->p_location);
+    // prefetch ring, falls back to smaller sizes when memory is short
+    uint32_t size = p_track->prefetch;
+    while( size >= AUDIO_URL_BUFFER_MIN ){
+      buff_memory = (uint8_t*)utils_mem_alloc(size);
+      if( buff_memory != NULL )
+        break;
+      size /= 2;
+    }
+    if( buff_memory == NULL ){
+      audio_source_dispose();
+      return false;
+    }
+    buff_size = size;
+    buff = new AudioFileSourceBuffer(file_http, buff_memory, buff_size);
+    source = buff;
+  }else{
+    file_sd = new AudioFileSourceSD(p_track->p_location);
+    if( !file_sd->isOpen() ){
+      audio_source_dispose();
+      return false;
+    }
+    source = file_sd;
+  }
+
+  uint8_t format = (p_track->format == AUDIO_FORMAT_AUTO) ? audio_detect_format(p_track->p_location) : p_track->format;
+  if( format == AUDIO_FORMAT_WAV )
+    generator = new AudioGeneratorWAV();
+  else if( format == AUDIO_FORMAT_AAC )
+    generator = new AudioGeneratorAAC();
+  else
+    generator = new AudioGeneratorMP3();
+  if( !generator->begin(source, out) ){
+    audio_source_dispose();
+    return false;
+  }
+
+  return true;
+}
+
+// runs on the audio task, opens the next playable entry from g_track_index
+static void audio_start_track(void)
+{
+  while( g_track_index < g_playlist.size() ){
+    if( audio_source_open(&g_playlist[g_track_index]) ){
+      g_playing = true;
+      audio_push_event(AUDIO_EVENT_STARTED, g_track_index);
+      return;
+    }
+    audio_push_event(AUDIO_EVENT_FAILED, g_track_index);
+    g_track_index++;
+  }
+
+  g_playing = false;
+  out->end();
+  if( g_playlist.size() > 0 )
+    audio_push_event(AUDIO_EVENT_FINISHED, g_track_index);
+}
+
+static void audio_handle_command(AUDIO_COMMAND *p_cmd)
+{
+  switch( p_cmd->type ){
+    case AUDIO_CMD_PLAY:
+      // the old track's chunks must not play ahead of the new one
+      audio_source_dispose();
+      out->discard();
+      audio_playlist_clear();
+      g_playlist.push_back(p_cmd->track);
+      g_playlist_length = g_playlist.size();
+      p_cmd->track.p_location = NULL;
+      audio_paused = false;
+      audio_start_track();
+      break;
+    case AUDIO_CMD_ENQUEUE: {
+      g_playlist.push_back(p_cmd->track);
+      g_playlist_length = g_playlist.size();
+      p_cmd->track.p_location = NULL;
+      // the playlist had already run out
+      if( !g_playing && generator == NULL ){
+        g_track_index = g_playlist.size() - 1;
+        audio_start_track();
+      }
+      break;
+    }
+    case AUDIO_CMD_NEXT:
+      if( g_playing ){
+        audio_source_dispose();
+        g_track_index++;
+        audio_start_track();
+      }
+      break;
+    case AUDIO_CMD_STOP:
+      audio_source_dispose();
+      audio_playlist_clear();
+      if( g_playing ){
+        g_playing = false;
+        out->end();
+      }
+      audio_paused = false;
+      break;
+    case AUDIO_CMD_PAUSE:
+      if( g_playing && !audio_paused ){
+        M5.Speaker.setVolume(0);
+        out->flush();
+        audio_paused = true;
+      }
+      break;
+    case AUDIO_CMD_RESUME:
+      if( audio_paused ){
+        M5.Speaker.setVolume(audio_volume);
+        audio_paused = false;
+      }
+      break;
+    default:
+      break;
+  }
+  audio_track_free(&p_cmd->track);
+}
+
+static void audio_task(void *arg)
+{
+  bool running = true;
+  bool empty = false;
+
+  while( running ){
+    AUDIO_COMMAND cmd;
+    TickType_t wait = (g_playing && !audio_paused) ? 0 : pdMS_TO_TICKS(AUDIO_IDLE_WAIT);
+    while( xQueueReceive(g_audio_queue, &cmd, wait) == pdTRUE ){
+      wait = 0;
+      if( cmd.type == AUDIO_CMD_QUIT ){
+        running = false;
+      }else{
+        audio_handle_command(&cmd);
+      }
+      // dropped when full, those can only be acks nobody is waiting for anymore
+      if( cmd.ack )
+        xQueueSend(g_audio_ack, &cmd.seq, 0);
+      if( !running )
+        break;
+    }
+    if( !running || !g_playing || audio_paused )
+      continue;
+
+    if( buff != NULL ){
+      g_buffer_level = buff->getFillLevel();
+      if( g_buffer_level == 0 && !empty )
+        g_starved++;
+      empty = (g_buffer_level == 0);
+    }
+
+    // the speaker queue paces this loop: playRaw waits while both slots are busy
+    if( !generator->isRunning() || !generator->loop() ){
+      audio_source_dispose();
+      g_track_index++;
+      audio_start_track();
+    }
+  }
+
+  audio_source_dispose();
+  audio_playlist_clear();
+  g_playing = false;
+  g_audio_task = NULL;
+  vTaskDelete(NULL);
+}
+
+static bool audio_post(AUDIO_COMMAND *p_cmd)
+{
+  if( g_audio_task == NULL ){
+    audio_track_free(&p_cmd->track);
+    return false;
+  }
+  if( p_cmd->ack ){
+    // acks of earlier commands that timed out arrive late, they must not complete this one
+    xQueueReset(g_audio_ack);
+    p_cmd->seq = ++g_audio_seq;
+  }
+  if( xQueueSend(g_audio_queue, p_cmd, pdMS_TO_TICKS(AUDIO_ACK_TIMEOUT)) != pdTRUE ){
+    audio_track_free(&p_cmd->track);
+    return false;
+  }
+  if( !p_cmd->ack )
+    return true;
+
+  TickType_t start = xTaskGetTickCount();
+  bool opens = (p_cmd->type == AUDIO_CMD_PLAY || p_cmd->type == AUDIO_CMD_NEXT);
+  TickType_t timeout = pdMS_TO_TICKS(opens ? AUDIO_OPEN_TIMEOUT : AUDIO_ACK_TIMEOUT);
+  for( ;; ){
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if( elapsed >= timeout )
+      return false;
+    uint32_t seq;
+    if( xQueueReceive(g_audio_ack, &seq, timeout - elapsed) != pdTRUE )
+      return false;
+    if( seq == p_cmd->seq )
+      return true;
+  }
+}
+
+static bool audio_post_simple(AUDIO_CMD_TYPE type, bool ack)
+{
+  AUDIO_COMMAND cmd;
+  memset(&cmd, 0, sizeof(cmd));
+  cmd.type = type;
+  cmd.ack = ack;
+  return audio_post(&cmd);
+}
+
+static void audio_stop_task(void)
+{
+  if( g_audio_task == NULL )
+    return;
+
+  audio_post_simple(AUDIO_CMD_QUIT, true);
+  while( g_audio_task != NULL )
+    delay(1);
+}
+
+static long audio_get_track(JSContext *ctx, int argc, JSValueConst *argv, AUDIO_TRACK *p_track)
+{
+  const char *p_location = JS_ToCString(ctx, argv[0]);
+  if( p_location == NULL )
+    return -1;
+  p_track->p_location = strdup(p_location);
+  JS_FreeCString(ctx, p_location);
+  if( p_track->p_location == NULL )
+    return -1;
+  p_track->format = AUDIO_FORMAT_AUTO;
+  p_track->prefetch = AUDIO_URL_BUFFER_SIZE;
+
+  if( argc >= 2 ){
+    if( JS_IsNumber(argv[1]) ){
+      // playUrl(url, bufsize)
+      JS_ToUint32(ctx, &p_track->prefetch, argv[1]);
+    }else{
+      uint32_t value;
+      JSValue v2 = JS_GetPropertyStr(ctx, argv[1], "format");
+      if( v2 != JS_UNDEFINED ){
+        JS_ToUint32(ctx, &value, v2);
+        p_track->format = value;
+      }
+      v2 = JS_GetPropertyStr(ctx, argv[1], "prefetch");
+      if( v2 != JS_UNDEFINED )
+        JS_ToUint32(ctx, &p_track->prefetch, v2);
+    }
+  }
+  if( p_track->prefetch < AUDIO_URL_BUFFER_MIN )
+    p_track->prefetch = AUDIO_URL_BUFFER_MIN;
+
+  return 0;
+}
+
+static JSValue audio_begin(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  audio_stop_task();
   if( out != NULL ){
-    out->stop();
+    out->end();
     delete out;
     out = NULL;
   }
@@ -223,93 +628,60 @@ static JSValue audio_begin(JSContext *ctx, JSValueConst jsThis, int argc, JSValu
   if( !out->setBufferSize(buf_size) )
     return JS_EXCEPTION;
 
+  BaseType_t result = xTaskCreatePinnedToCore(audio_task, "audio_task", AUDIO_TASK_STACK, NULL, AUDIO_TASK_PRIORITY, &g_audio_task, AUDIO_TASK_CORE);
+  if( result != pdPASS ){
+    g_audio_task = NULL;
+    return JS_EXCEPTION;
+  }
+
   return JS_NewBool(ctx, ret);
 }
 
 static JSValue audio_update(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  if( mp3 != NULL ){
-    if (mp3->isRunning()) {
-      if( !audio_paused ){
-        if (!mp3->loop()){
-//          Serial.println("mp3 loop stop");
-          mp3->stop();
-        }
-      }
-    }
-  }
-
+  // decoding runs on the audio task, kept for existing scripts
   return JS_UNDEFINED;
 }
 
 static JSValue audio_pause(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
 {
-  if( mp3 != NULL ){
-    if (mp3->isRunning()) {
-      if( magic == 0 ){
-        M5.Speaker.setVolume(audio_volume);
-        audio_paused = false;
-      }else{
-        M5.Speaker.setVolume(0);
-        out->flush();
-        audio_paused = true;
-      }
-    }
-  }
+  if( out == NULL )
+    return JS_UNDEFINED;
+
+  audio_post_simple(magic == 0 ? AUDIO_CMD_RESUME : AUDIO_CMD_PAUSE, false);
 
   return JS_UNDEFINED;
 }
 
-static JSValue audio_playUrl(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+static JSValue audio_play(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
 {
   if( out == NULL )
     return JS_EXCEPTION;
 
-  audio_source_dispose();
-
-  const char *url = JS_ToCString(ctx, argv[0]);
-  if( url == NULL )
+  AUDIO_COMMAND cmd;
+  memset(&cmd, 0, sizeof(cmd));
+  cmd.type = (magic == 0) ? AUDIO_CMD_PLAY : AUDIO_CMD_ENQUEUE;
+  if( audio_get_track(ctx, argc, argv, &cmd.track) != 0 )
     return JS_EXCEPTION;
 
-  uint32_t bufsize = AUDIO_URL_BUFFER_SIZE;
-  if( argc >= 2 )
-    JS_ToUint32(ctx, &bufsize, argv[1]);
+  // play waits for the source to open so that the result is known
+  cmd.ack = (magic == 0);
+  if( !audio_post(&cmd) )
+    return JS_EXCEPTION;
 
-  file_http = new AudioFileSourceHTTPStream(url);
-  JS_FreeCString(ctx, url);
-  buff = new AudioFileSourceBuffer(file_http, bufsize);
-  mp3 = new AudioGeneratorMP3();
-  bool ret = mp3->begin(buff, out);
-  if( !ret )
-    audio_source_dispose();
-  
-  return JS_NewBool(ctx, ret);
+  if( magic == 0 )
+    return JS_NewBool(ctx, g_playing);
+  return JS_NewUint32(ctx, g_playlist_length);
 }
 
-static JSValue audio_playSd(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+static JSValue audio_next(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
   if( out == NULL )
     return JS_EXCEPTION;
 
-  audio_source_dispose();
-    
-  const char *path = JS_ToCString(ctx, argv[0]);
-  if( path == NULL )
-    return JS_EXCEPTION;
+  audio_post_simple(AUDIO_CMD_NEXT, true);
 
-  file_sd = new AudioFileSourceSD(path);
-  JS_FreeCString(ctx, path);
-  if( !file_sd->isOpen() ){
-    delete file_sd;
-    file_sd = NULL;
-    return JS_EXCEPTION;
-  }
-  mp3 = new AudioGeneratorMP3();
-  bool ret = mp3->begin(file_sd, out);
-  if( !ret )
-    audio_source_dispose();
-
-  return JS_NewBool(ctx, ret);
+  return JS_UNDEFINED;
 }
 
 static JSValue audio_tone(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
@@ -317,7 +689,7 @@ static JSValue audio_tone(JSContext *ctx, JSValueConst jsThis, int argc, JSValue
   if( out == NULL )
     return JS_EXCEPTION;
 
-  audio_source_dispose();
+  audio_post_simple(AUDIO_CMD_STOP, true);
 
   double frequency;
   JS_ToFloat64(ctx, &frequency, argv[0]);
@@ -356,17 +728,44 @@ static JSValue audio_getVolume(JSContext *ctx, JSValueConst jsThis, int argc, JS
 
 static JSValue audio_isRunning(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  if( out == NULL || mp3 == NULL )
+  if( out == NULL )
     return JS_NewBool(ctx, false);
 
-  bool is_running = mp3->isRunning();
+  return JS_NewBool(ctx, g_playing);
+}
 
-  return JS_NewBool(ctx, is_running);
+static JSValue audio_getStatus(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "running", JS_NewBool(ctx, g_playing));
+  JS_SetPropertyStr(ctx, obj, "paused", JS_NewBool(ctx, audio_paused));
+  JS_SetPropertyStr(ctx, obj, "index", JS_NewUint32(ctx, g_track_index));
+  JS_SetPropertyStr(ctx, obj, "length", JS_NewUint32(ctx, g_playlist_length));
+  JS_SetPropertyStr(ctx, obj, "bufferLevel", JS_NewUint32(ctx, g_buffer_level));
+  JS_SetPropertyStr(ctx, obj, "bufferSize", JS_NewUint32(ctx, buff_size));
+  JS_SetPropertyStr(ctx, obj, "starved", JS_NewUint32(ctx, g_starved));
+  JS_SetPropertyStr(ctx, obj, "underruns", JS_NewUint32(ctx, out != NULL ? out->underruns : 0));
+  JS_SetPropertyStr(ctx, obj, "sampleRate", JS_NewUint32(ctx, out != NULL ? out->getRate() : 0));
+  return obj;
+}
+
+static JSValue audio_setCallback(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  if( g_callback_func != JS_UNDEFINED )
+    JS_FreeValue(g_ctx, g_callback_func);
+  g_callback_func = JS_UNDEFINED;
+
+  if( argc >= 1 && JS_IsFunction(ctx, argv[0]) ){
+    g_ctx = ctx;
+    g_callback_func = JS_DupValue(ctx, argv[0]);
+  }
+
+  return JS_UNDEFINED;
 }
 
 static JSValue audio_stop(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  audio_source_dispose();
+  audio_post_simple(AUDIO_CMD_STOP, true);
 
   return JS_UNDEFINED;
 }
@@ -386,11 +785,20 @@ static const JSCFunctionListEntry audio_funcs[] = {
         "pause", 0, JS_DEF_CFUNC, 1, {
           func : {0, JS_CFUNC_generic_magic, {generic_magic : audio_pause}}
         }},
-    JSCFunctionListEntry{"playUrl", 0, JS_DEF_CFUNC, 0, {
-                           func : {2, JS_CFUNC_generic, audio_playUrl}
-                         }},
-    JSCFunctionListEntry{"playSd", 0, JS_DEF_CFUNC, 0, {
-                           func : {1, JS_CFUNC_generic, audio_playSd}
+    JSCFunctionListEntry{
+        "playUrl", 0, JS_DEF_CFUNC, 0, {
+          func : {2, JS_CFUNC_generic_magic, {generic_magic : audio_play}}
+        }},
+    JSCFunctionListEntry{
+        "playSd", 0, JS_DEF_CFUNC, 0, {
+          func : {2, JS_CFUNC_generic_magic, {generic_magic : audio_play}}
+        }},
+    JSCFunctionListEntry{
+        "enqueue", 0, JS_DEF_CFUNC, 1, {
+          func : {2, JS_CFUNC_generic_magic, {generic_magic : audio_play}}
+        }},
+    JSCFunctionListEntry{"next", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, audio_next}
                          }},
     JSCFunctionListEntry{"setVolume", 0, JS_DEF_CFUNC, 0, {
                            func : {1, JS_CFUNC_generic, audio_setVolume}
@@ -404,6 +812,12 @@ static const JSCFunctionListEntry audio_funcs[] = {
     JSCFunctionListEntry{"isRunning", 0, JS_DEF_CFUNC, 0, {
                            func : {0, JS_CFUNC_generic, audio_isRunning}
                          }},
+    JSCFunctionListEntry{"getStatus", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, audio_getStatus}
+                         }},
+    JSCFunctionListEntry{"setCallback", 0, JS_DEF_CFUNC, 0, {
+                           func : {1, JS_CFUNC_generic, audio_setCallback}
+                         }},
     JSCFunctionListEntry{"stop", 0, JS_DEF_CFUNC, 0, {
                            func : {0, JS_CFUNC_generic, audio_stop}
                          }},
@@ -419,6 +833,22 @@ static const JSCFunctionListEntry audio_funcs[] = {
         "OUTPUT_EXTERNAL_I2S", 0, JS_DEF_PROP_INT32, 0, {
           i32 : AUDIO_OUTPUT_EXTERNAL_I2S
         }},
+    JSCFunctionListEntry{
+        "FORMAT_AUTO", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : AUDIO_FORMAT_AUTO
+        }},
+    JSCFunctionListEntry{
+        "FORMAT_MP3", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : AUDIO_FORMAT_MP3
+        }},
+    JSCFunctionListEntry{
+        "FORMAT_WAV", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : AUDIO_FORMAT_WAV
+        }},
+    JSCFunctionListEntry{
+        "FORMAT_AAC", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : AUDIO_FORMAT_AAC
+        }},
 };
 
 JSModuleDef *addModule_audio(JSContext *ctx, JSValue global)
@@ -440,26 +870,76 @@ JSModuleDef *addModule_audio(JSContext *ctx, JSValue global)
 
 long initialize_audio(void)
 {
+  g_audio_queue = xQueueCreate(AUDIO_QUEUE_LENGTH, sizeof(AUDIO_COMMAND));
+  g_audio_ack = xQueueCreate(AUDIO_ACK_LENGTH, sizeof(uint32_t));
+  g_event_mutex = xSemaphoreCreateMutex();
+  if( g_audio_queue == NULL || g_audio_ack == NULL || g_event_mutex == NULL )
+    return -1;
+
   return 0;
 }
 
+void loopModule_audio(void)
+{
+  if( g_ctx == NULL || g_callback_func == JS_UNDEFINED )
+    return;
+
+  while(true){
+    AUDIO_EVENT_INFO info;
+    xSemaphoreTake(g_event_mutex, portMAX_DELAY);
+    if( g_event_list.size() == 0 ){
+      xSemaphoreGive(g_event_mutex);
+      break;
+    }
+    info = g_event_list.front();
+    g_event_list.erase(g_event_list.begin());
+    xSemaphoreGive(g_event_mutex);
+
+    JSValue objs[2];
+    if( info.type == AUDIO_EVENT_STARTED )
+      objs[0] = JS_NewString(g_ctx, "started");
+    else if( info.type == AUDIO_EVENT_FAILED )
+      objs[0] = JS_NewString(g_ctx, "failed");
+    else
+      objs[0] = JS_NewString(g_ctx, "finished");
+    objs[1] = JS_NewUint32(g_ctx, info.index);
+
+    ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(g_ctx);
+    JSValue ret = qjs->callJsFunc_with_arg(g_ctx, g_callback_func, g_callback_func, 2, objs);
+    JS_FreeValue(g_ctx, objs[0]);
+    JS_FreeValue(g_ctx, objs[1]);
+    JS_FreeValue(g_ctx, ret);
+  }
+}
+
 void endModule_audio(void)
 {
-  audio_source_dispose();
+  audio_stop_task();
   if( out != NULL ){
-    out->stop();
+    out->end();
     delete out;
     out = NULL;
   }
   audio_volume = DEFAULT_AUDIO_VOLUME;
+  audio_paused = false;
+  g_starved = 0;
+
+  xSemaphoreTake(g_event_mutex, portMAX_DELAY);
+  g_event_list.clear();
+  xSemaphoreGive(g_event_mutex);
+  if( g_callback_func != JS_UNDEFINED ){
+    JS_FreeValue(g_ctx, g_callback_func);
+    g_callback_func = JS_UNDEFINED;
+  }
+  g_ctx = NULL;
 }
 
 JsModuleEntry audio_module = {
   "Audio",
   initialize_audio,
   addModule_audio,
-  NULL,
+  loopModule_audio,
   endModule_audio
 };
 
-#endif
\ No newline at end of file
+#endif
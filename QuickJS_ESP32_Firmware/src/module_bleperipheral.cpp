@@ -9,6 +9,8 @@
 
 #include <NimBLEDevice.h>
 #include <NimBLEBeacon.h>
+#include <vector>
+#include <algorithm>
 #include "module_utils.h"
 #include "module_bleperipheral.h"
 
@@ -17,6 +19,66 @@ static NimBLEAdvertising *g_pAdvertising = NULL;
 #define DEFAULT_ADVERTISE_INTERVAL 0x0080
 static uint16_t g_advertise_interval = DEFAULT_ADVERTISE_INTERVAL;
 
+#define NUM_OF_CHARACTERISTIC       8
+#define NOTIFY_QUEUE_SIZE           4096 // power of 2
+#define NOTIFY_TASK_STACK           4096
+#define NOTIFY_TASK_IDLE_WAIT       20
+#define ATT_HEADER_SIZE             3
+
+#define PROPERTY_READ     0x01
+#define PROPERTY_WRITE    0x02
+#define PROPERTY_NOTIFY   0x04
+#define PROPERTY_WRITE_NR 0x08
+
+typedef struct {
+  NimBLEService *p_service;
+  NimBLECharacteristic *p_characteristic;
+  uint8_t properties;
+  uint16_t record_size;
+  volatile bool subscribed;
+  // single producer (JS) / single consumer (notify task) ring; head and tail only grow
+  uint8_t *p_ring;
+  volatile uint32_t head;
+  volatile uint32_t tail;
+  uint32_t dropped;
+} BLEPERIPHERAL_CHAR_INFO;
+static BLEPERIPHERAL_CHAR_INFO g_characteristics[NUM_OF_CHARACTERISTIC];
+static uint8_t g_num_of_characteristic = 0;
+
+typedef enum {
+  BLEPCB_CONNECTED,
+  BLEPCB_DISCONNECTED,
+  BLEPCB_WRITE,
+  BLEPCB_SUBSCRIBE,
+} BLEPCB_TYPE;
+
+typedef struct {
+  BLEPCB_TYPE type;
+  int32_t index;
+  uint8_t *p_payload;
+  uint32_t length;
+} BLEPERIPHERAL_EVENT_INFO;
+static std::vector<BLEPERIPHERAL_EVENT_INFO> g_event_list;
+static SemaphoreHandle_t g_event_mutex = NULL;
+
+static JSContext *g_ctx = NULL;
+static JSValue g_callback_func = JS_UNDEFINED;
+
+static NimBLEServer *g_pServer = NULL;
+static volatile uint16_t g_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+static volatile uint16_t g_mtu = BLE_ATT_MTU_DFLT;
+static uint16_t g_conn_interval_min = 0;
+static uint16_t g_conn_interval_max = 0;
+static uint16_t g_conn_latency = 0;
+static uint16_t g_conn_timeout = 400;
+static bool g_phy_2m = false;
+
+static TaskHandle_t g_notify_task = NULL;
+static volatile bool g_notify_running = false;
+static volatile uint32_t g_notified_bytes = 0;
+static volatile uint32_t g_notified_packets = 0;
+static volatile uint32_t g_throughput = 0;
+
 static JSValue bleperipheral_startAdvertise(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
   g_pAdvertising->stop();
@@ -217,6 +279,440 @@ static JSValue bleperipheral_getAdvertiseInterval(JSContext *ctx, JSValueConst j
   return JS_NewInt32(ctx, g_advertise_interval);
 }
 
+static void push_event(BLEPCB_TYPE type, int32_t index, const uint8_t *p_data, uint32_t length)
+{
+  BLEPERIPHERAL_EVENT_INFO info = { type, index, NULL, 0 };
+  if( p_data != NULL && length > 0 ){
+    info.p_payload = (uint8_t*)malloc(length);
+    if( info.p_payload == NULL )
+      return;
+    memmove(info.p_payload, p_data, length);
+    info.length = length;
+  }
+
+  xSemaphoreTake(g_event_mutex, portMAX_DELAY);
+  g_event_list.push_back(info);
+  xSemaphoreGive(g_event_mutex);
+}
+
+static void clear_event_list(void)
+{
+  xSemaphoreTake(g_event_mutex, portMAX_DELAY);
+  for( auto &info : g_event_list ){
+    if( info.p_payload != NULL )
+      free(info.p_payload);
+  }
+  g_event_list.clear();
+  xSemaphoreGive(g_event_mutex);
+}
+
+static int32_t find_characteristic(const NimBLECharacteristic *p_characteristic)
+{
+  for( int i = 0 ; i < g_num_of_characteristic ; i++ ){
+    if( g_characteristics[i].p_characteristic == p_characteristic )
+      return i;
+  }
+  return -1;
+}
+
+class BlePeripheralServerCallbacks : public NimBLEServerCallbacks {
+  void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) override {
+    g_conn_handle = connInfo.getConnHandle();
+    g_mtu = connInfo.getMTU();
+    if( g_conn_interval_min != 0 && g_conn_interval_max != 0 )
+      pServer->updateConnParams(g_conn_handle, g_conn_interval_min, g_conn_interval_max, g_conn_latency, g_conn_timeout);
+    pServer->setDataLen(g_conn_handle, BLE_HCI_SET_DATALEN_TX_OCTETS_MAX);
+#if !defined(CONFIG_IDF_TARGET_ESP32)
+    if( g_phy_2m )
+      pServer->updatePhy(g_conn_handle, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK, 0);
+#endif
+    push_event(BLEPCB_CONNECTED, -1, NULL, 0);
+  }
+
+  void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) override {
+    g_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+    g_mtu = BLE_ATT_MTU_DFLT;
+    for( int i = 0 ; i < g_num_of_characteristic ; i++ )
+      g_characteristics[i].subscribed = false;
+    push_event(BLEPCB_DISCONNECTED, -1, NULL, 0);
+  }
+
+  void onMTUChange(uint16_t MTU, NimBLEConnInfo& connInfo) override {
+    g_mtu = MTU;
+  }
+};
+static BlePeripheralServerCallbacks g_server_callbacks;
+
+class BlePeripheralCharacteristicCallbacks : public NimBLECharacteristicCallbacks {
+  void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+    int32_t index = find_characteristic(pCharacteristic);
+    if( index < 0 )
+      return;
+    NimBLEAttValue value = pCharacteristic->getValue();
+    push_event(BLEPCB_WRITE, index, value.data(), value.length());
+  }
+
+  void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) override {
+    int32_t index = find_characteristic(pCharacteristic);
+    if( index < 0 )
+      return;
+    g_characteristics[index].subscribed = (subValue & 0x0001) != 0;
+    uint8_t value = (uint8_t)subValue;
+    push_event(BLEPCB_SUBSCRIBE, index, &value, 1);
+  }
+};
+static BlePeripheralCharacteristicCallbacks g_characteristic_callbacks;
+
+static uint32_t notify_queue_write(BLEPERIPHERAL_CHAR_INFO *p_info, const uint8_t *p_data, uint32_t length)
+{
+  uint32_t space = NOTIFY_QUEUE_SIZE - (p_info->head - p_info->tail);
+  if( length > space )
+    return 0;
+
+  uint32_t pos = p_info->head & (NOTIFY_QUEUE_SIZE - 1);
+  uint32_t first = std::min(length, (uint32_t)NOTIFY_QUEUE_SIZE - pos);
+  memmove(&p_info->p_ring[pos], p_data, first);
+  memmove(&p_info->p_ring[0], &p_data[first], length - first);
+  __sync_synchronize();
+  p_info->head += length;
+
+  return length;
+}
+
+static uint32_t notify_queue_peek(BLEPERIPHERAL_CHAR_INFO *p_info, uint8_t *p_data, uint32_t length)
+{
+  uint32_t available = p_info->head - p_info->tail;
+  if( length > available )
+    length = available;
+
+  uint32_t pos = p_info->tail & (NOTIFY_QUEUE_SIZE - 1);
+  uint32_t first = std::min(length, (uint32_t)NOTIFY_QUEUE_SIZE - pos);
+  memmove(p_data, &p_info->p_ring[pos], first);
+  memmove(&p_data[first], &p_info->p_ring[0], length - first);
+
+  return length;
+}
+
+static void notify_task(void *arg)
+{
+  uint8_t packet[BLE_ATT_MTU_MAX];
+  uint32_t window_start = millis();
+  uint32_t window_bytes = g_notified_bytes;
+
+  while( g_notify_running ){
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(NOTIFY_TASK_IDLE_WAIT));
+
+    bool sent = true;
+    while( sent && g_notify_running && g_conn_handle != BLE_HS_CONN_HANDLE_NONE ){
+      sent = false;
+      for( int i = 0 ; i < g_num_of_characteristic ; i++ ){
+        BLEPERIPHERAL_CHAR_INFO *p_info = &g_characteristics[i];
+        if( p_info->p_ring == NULL || !p_info->subscribed )
+          continue;
+
+        // fill up to the negotiated MTU, keeping records whole when a record size is set
+        uint32_t payload = std::min((uint32_t)g_mtu, (uint32_t)BLE_ATT_MTU_MAX) - ATT_HEADER_SIZE;
+        if( p_info->record_size > 0 && p_info->record_size <= payload )
+          payload -= payload % p_info->record_size;
+        uint32_t length = notify_queue_peek(p_info, packet, payload);
+        if( length == 0 )
+          continue;
+
+        if( p_info->p_characteristic->notify(packet, length) ){
+          __sync_synchronize();
+          p_info->tail += length;
+          g_notified_bytes += length;
+          g_notified_packets++;
+          sent = true;
+        }else{
+          // out of mbufs; let the stack drain
+          vTaskDelay(1);
+        }
+      }
+    }
+
+    uint32_t now = millis();
+    if( now - window_start >= 1000 ){
+      g_throughput = (uint64_t)(g_notified_bytes - window_bytes) * 1000 / (now - window_start);
+      window_start = now;
+      window_bytes = g_notified_bytes;
+    }
+  }
+
+  g_notify_task = NULL;
+  vTaskDelete(NULL);
+}
+
+static void stop_server(void)
+{
+  if( g_notify_task != NULL ){
+    g_notify_running = false;
+    xTaskNotifyGive(g_notify_task);
+    while( g_notify_task != NULL )
+      delay(1);
+  }
+
+  if( g_pServer != NULL ){
+    g_pAdvertising->stop();
+    if( g_conn_handle != BLE_HS_CONN_HANDLE_NONE )
+      g_pServer->disconnect(g_conn_handle);
+    for( int i = 0 ; i < g_num_of_characteristic ; i++ ){
+      NimBLEService *p_service = g_characteristics[i].p_service;
+      if( p_service == NULL )
+        continue;
+      for( int j = i ; j < g_num_of_characteristic ; j++ ){
+        if( g_characteristics[j].p_service == p_service )
+          g_characteristics[j].p_service = NULL;
+      }
+      g_pServer->removeService(p_service, true);
+    }
+  }
+
+  for( int i = 0 ; i < g_num_of_characteristic ; i++ ){
+    if( g_characteristics[i].p_ring != NULL )
+      free(g_characteristics[i].p_ring);
+  }
+  memset(g_characteristics, 0, sizeof(g_characteristics));
+  g_num_of_characteristic = 0;
+  g_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+  g_notified_bytes = 0;
+  g_notified_packets = 0;
+  g_throughput = 0;
+}
+
+static JSValue bleperipheral_createCharacteristic(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  if( g_num_of_characteristic >= NUM_OF_CHARACTERISTIC )
+    return JS_EXCEPTION;
+
+  const char *serviceUuid = JS_ToCString(ctx, argv[0]);
+  if( serviceUuid == NULL )
+    return JS_EXCEPTION;
+  NimBLEUUID service_uuid = NimBLEUUID(serviceUuid);
+  JS_FreeCString(ctx, serviceUuid);
+  const char *charUuid = JS_ToCString(ctx, argv[1]);
+  if( charUuid == NULL )
+    return JS_EXCEPTION;
+  NimBLEUUID char_uuid = NimBLEUUID(charUuid);
+  JS_FreeCString(ctx, charUuid);
+  if( service_uuid.bitSize() == 0 || char_uuid.bitSize() == 0 )
+    return JS_EXCEPTION;
+
+  uint32_t properties;
+  JS_ToUint32(ctx, &properties, argv[2]);
+  uint32_t record_size = 0;
+  if( argc >= 4 )
+    JS_ToUint32(ctx, &record_size, argv[3]);
+
+  if( g_pServer == NULL ){
+    g_pServer = NimBLEDevice::createServer();
+    g_pServer->setCallbacks(&g_server_callbacks, false);
+  }
+
+  NimBLEService *p_service = g_pServer->getServiceByUUID(service_uuid);
+  if( p_service == NULL )
+    p_service = g_pServer->createService(service_uuid);
+
+  uint32_t nimble_properties = 0;
+  if( properties & PROPERTY_READ ) nimble_properties |= NIMBLE_PROPERTY::READ;
+  if( properties & PROPERTY_WRITE ) nimble_properties |= NIMBLE_PROPERTY::WRITE;
+  if( properties & PROPERTY_WRITE_NR ) nimble_properties |= NIMBLE_PROPERTY::WRITE_NR;
+  if( properties & PROPERTY_NOTIFY ) nimble_properties |= NIMBLE_PROPERTY::NOTIFY;
+
+  BLEPERIPHERAL_CHAR_INFO *p_info = &g_characteristics[g_num_of_characteristic];
+  memset(p_info, 0, sizeof(BLEPERIPHERAL_CHAR_INFO));
+  if( properties & PROPERTY_NOTIFY ){
+    p_info->p_ring = (uint8_t*)malloc(NOTIFY_QUEUE_SIZE);
+    if( p_info->p_ring == NULL )
+      return JS_EXCEPTION;
+  }
+  p_info->p_service = p_service;
+  p_info->p_characteristic = p_service->createCharacteristic(char_uuid, nimble_properties);
+  p_info->p_characteristic->setCallbacks(&g_characteristic_callbacks);
+  p_info->properties = properties;
+  p_info->record_size = record_size;
+
+  return JS_NewInt32(ctx, g_num_of_characteristic++);
+}
+
+static JSValue bleperipheral_startServer(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  if( g_pServer == NULL || g_num_of_characteristic == 0 )
+    return JS_EXCEPTION;
+
+  g_pAdvertising->stop();
+  g_pAdvertising->reset();
+  g_pAdvertising->setConnectableMode(BLE_GAP_CONN_MODE_UND);
+  g_pAdvertising->enableScanResponse(true);
+
+  NimBLEAdvertisementData scanResponse = NimBLEAdvertisementData();
+  if( argc >= 1 ){
+    JSValue value;
+
+    value = JS_GetPropertyStr(ctx, argv[0], "name");
+    if( value != JS_UNDEFINED ){
+      const char *name = JS_ToCString(ctx, value);
+      scanResponse.setName(name);
+      JS_FreeCString(ctx, name);
+      JS_FreeValue(ctx, value);
+    }
+
+    value = JS_GetPropertyStr(ctx, argv[0], "phy2m");
+    if( value != JS_UNDEFINED ){
+      g_phy_2m = JS_ToBool(ctx, value);
+      JS_FreeValue(ctx, value);
+    }
+  }
+  g_pAdvertising->setScanResponseData(scanResponse);
+
+  for( int i = 0 ; i < g_num_of_characteristic ; i++ ){
+    NimBLEService *p_service = g_characteristics[i].p_service;
+    p_service->start();
+    g_pAdvertising->addServiceUUID(p_service->getUUID());
+  }
+  NimBLEDevice::setMTU(BLE_ATT_MTU_MAX);
+  g_pServer->start();
+
+  if( g_notify_task == NULL ){
+    g_notify_running = true;
+    BaseType_t ret = xTaskCreate(notify_task, "ble_notify", NOTIFY_TASK_STACK, NULL, 2, &g_notify_task);
+    if( ret != pdPASS ){
+      g_notify_running = false;
+      g_notify_task = NULL;
+      return JS_EXCEPTION;
+    }
+  }
+
+  bool ret = g_pAdvertising->start();
+
+  return JS_NewBool(ctx, ret);
+}
+
+static JSValue bleperipheral_stopServer(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  stop_server();
+  clear_event_list();
+
+  return JS_UNDEFINED;
+}
+
+static JSValue bleperipheral_setConnParams(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  // interval: 1.25ms unit, timeout: 10ms unit
+  uint32_t min, max, latency = 0, timeout = 400;
+  JS_ToUint32(ctx, &min, argv[0]);
+  JS_ToUint32(ctx, &max, argv[1]);
+  if( argc >= 3 )
+    JS_ToUint32(ctx, &latency, argv[2]);
+  if( argc >= 4 )
+    JS_ToUint32(ctx, &timeout, argv[3]);
+  if( min < 6 || max < min || max > 3200 )
+    return JS_EXCEPTION;
+
+  g_conn_interval_min = min;
+  g_conn_interval_max = max;
+  g_conn_latency = latency;
+  g_conn_timeout = timeout;
+  if( g_pServer != NULL && g_conn_handle != BLE_HS_CONN_HANDLE_NONE )
+    g_pServer->updateConnParams(g_conn_handle, min, max, latency, timeout);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue bleperipheral_setValue(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t index;
+  JS_ToUint32(ctx, &index, argv[0]);
+  if( index >= g_num_of_characteristic )
+    return JS_EXCEPTION;
+
+  NimBLECharacteristic *p_characteristic = g_characteristics[index].p_characteristic;
+  if( JS_IsString(argv[1]) ){
+    size_t len;
+    const char *str = JS_ToCStringLen(ctx, &len, argv[1]);
+    if( str == NULL )
+      return JS_EXCEPTION;
+    p_characteristic->setValue((const uint8_t*)str, len);
+    JS_FreeCString(ctx, str);
+  }else{
+    uint32_t unit_num;
+    uint8_t *p_buffer;
+    JSValue vbuffer = from_Uint8Array(ctx, argv[1], &p_buffer, &unit_num);
+    if( JS_IsException(vbuffer) )
+      return JS_EXCEPTION;
+    p_characteristic->setValue(p_buffer, unit_num);
+    JS_FreeValue(ctx, vbuffer);
+  }
+
+  return JS_UNDEFINED;
+}
+
+static JSValue bleperipheral_notify(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t index;
+  JS_ToUint32(ctx, &index, argv[0]);
+  if( index >= g_num_of_characteristic )
+    return JS_EXCEPTION;
+  BLEPERIPHERAL_CHAR_INFO *p_info = &g_characteristics[index];
+  if( p_info->p_ring == NULL )
+    return JS_EXCEPTION;
+
+  uint32_t written;
+  if( JS_IsString(argv[1]) ){
+    size_t len;
+    const char *str = JS_ToCStringLen(ctx, &len, argv[1]);
+    if( str == NULL )
+      return JS_EXCEPTION;
+    written = notify_queue_write(p_info, (const uint8_t*)str, len);
+    JS_FreeCString(ctx, str);
+  }else{
+    uint32_t unit_num;
+    uint8_t *p_buffer;
+    JSValue vbuffer = from_Uint8Array(ctx, argv[1], &p_buffer, &unit_num);
+    if( JS_IsException(vbuffer) )
+      return JS_EXCEPTION;
+    written = notify_queue_write(p_info, p_buffer, unit_num);
+    JS_FreeValue(ctx, vbuffer);
+  }
+
+  if( written == 0 )
+    p_info->dropped++;
+  else if( g_notify_task != NULL )
+    xTaskNotifyGive(g_notify_task);
+
+  return JS_NewBool(ctx, written != 0);
+}
+
+static JSValue bleperipheral_setCallback(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  if( g_callback_func != JS_UNDEFINED )
+    JS_FreeValue(g_ctx, g_callback_func);
+
+  g_ctx = ctx;
+  g_callback_func = JS_DupValue(ctx, argv[0]);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue bleperipheral_getStatus(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t queued = 0, dropped = 0;
+  for( int i = 0 ; i < g_num_of_characteristic ; i++ ){
+    queued += g_characteristics[i].head - g_characteristics[i].tail;
+    dropped += g_characteristics[i].dropped;
+  }
+
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "connected", JS_NewBool(ctx, g_conn_handle != BLE_HS_CONN_HANDLE_NONE));
+  JS_SetPropertyStr(ctx, obj, "mtu", JS_NewUint32(ctx, g_mtu));
+  JS_SetPropertyStr(ctx, obj, "queued", JS_NewUint32(ctx, queued));
+  JS_SetPropertyStr(ctx, obj, "dropped", JS_NewUint32(ctx, dropped));
+  JS_SetPropertyStr(ctx, obj, "notified", JS_NewUint32(ctx, g_notified_bytes));
+  JS_SetPropertyStr(ctx, obj, "packets", JS_NewUint32(ctx, g_notified_packets));
+  JS_SetPropertyStr(ctx, obj, "throughput", JS_NewUint32(ctx, g_throughput));
+  return obj;
+}
+
 static const JSCFunctionListEntry bleperipheral_funcs[] = {
     JSCFunctionListEntry{
         "startAdvertise", 0, JS_DEF_CFUNC, 0, {
@@ -254,6 +750,54 @@ static const JSCFunctionListEntry bleperipheral_funcs[] = {
         "getAdvertiseInterval", 0, JS_DEF_CFUNC, 0, {
           func : {0, JS_CFUNC_generic, bleperipheral_getAdvertiseInterval}
         }},
+    JSCFunctionListEntry{
+        "createCharacteristic", 0, JS_DEF_CFUNC, 0, {
+          func : {4, JS_CFUNC_generic, bleperipheral_createCharacteristic}
+        }},
+    JSCFunctionListEntry{
+        "startServer", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic, bleperipheral_startServer}
+        }},
+    JSCFunctionListEntry{
+        "stopServer", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, bleperipheral_stopServer}
+        }},
+    JSCFunctionListEntry{
+        "setConnParams", 0, JS_DEF_CFUNC, 0, {
+          func : {4, JS_CFUNC_generic, bleperipheral_setConnParams}
+        }},
+    JSCFunctionListEntry{
+        "setValue", 0, JS_DEF_CFUNC, 0, {
+          func : {2, JS_CFUNC_generic, bleperipheral_setValue}
+        }},
+    JSCFunctionListEntry{
+        "notify", 0, JS_DEF_CFUNC, 0, {
+          func : {2, JS_CFUNC_generic, bleperipheral_notify}
+        }},
+    JSCFunctionListEntry{
+        "setCallback", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic, bleperipheral_setCallback}
+        }},
+    JSCFunctionListEntry{
+        "getStatus", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, bleperipheral_getStatus}
+        }},
+    JSCFunctionListEntry{
+        "PROPERTY_READ", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : PROPERTY_READ
+        }},
+    JSCFunctionListEntry{
+        "PROPERTY_WRITE", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : PROPERTY_WRITE
+        }},
+    JSCFunctionListEntry{
+        "PROPERTY_NOTIFY", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : PROPERTY_NOTIFY
+        }},
+    JSCFunctionListEntry{
+        "PROPERTY_WRITE_NR", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : PROPERTY_WRITE_NR
+        }},
 };
 
 JSModuleDef *addModule_bleperipheral(JSContext *ctx, JSValue global)
@@ -273,8 +817,63 @@ JSModuleDef *addModule_bleperipheral(JSContext *ctx, JSValue global)
   return mod;
 }
 
+void loopModule_bleperipheral(void)
+{
+  if( g_ctx == NULL || g_callback_func == JS_UNDEFINED )
+    return;
+
+  while(true){
+    BLEPERIPHERAL_EVENT_INFO info;
+    xSemaphoreTake(g_event_mutex, portMAX_DELAY);
+    if( g_event_list.size() == 0 ){
+      xSemaphoreGive(g_event_mutex);
+      break;
+    }
+    info = g_event_list.front();
+    g_event_list.erase(g_event_list.begin());
+    xSemaphoreGive(g_event_mutex);
+
+    JSValue objs[3] = { JS_UNDEFINED, JS_UNDEFINED, JS_UNDEFINED };
+    if( info.type == BLEPCB_CONNECTED ){
+      objs[0] = JS_NewString(g_ctx, "connected");
+    }else if( info.type == BLEPCB_DISCONNECTED ){
+      objs[0] = JS_NewString(g_ctx, "disconnected");
+    }else if( info.type == BLEPCB_WRITE ){
+      objs[0] = JS_NewString(g_ctx, "write");
+      objs[1] = JS_NewInt32(g_ctx, info.index);
+      objs[2] = create_Uint8Array_nocopy(g_ctx, info.p_payload, info.length, my_mem_free, NULL);
+      info.p_payload = NULL;
+    }else if( info.type == BLEPCB_SUBSCRIBE ){
+      objs[0] = JS_NewString(g_ctx, "subscribe");
+      objs[1] = JS_NewInt32(g_ctx, info.index);
+      objs[2] = JS_NewInt32(g_ctx, info.p_payload[0]);
+    }
+    if( info.p_payload != NULL )
+      free(info.p_payload);
+
+    ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(g_ctx);
+    JSValue ret = qjs->callJsFunc_with_arg(g_ctx, g_callback_func, g_callback_func, 3, objs);
+    JS_FreeValue(g_ctx, objs[0]);
+    JS_FreeValue(g_ctx, objs[1]);
+    JS_FreeValue(g_ctx, objs[2]);
+    JS_FreeValue(g_ctx, ret);
+  }
+}
+
 void endModule_bleperipheral(void)
 {
+  stop_server();
+  clear_event_list();
+
+  if( g_callback_func != JS_UNDEFINED ){
+    JS_FreeValue(g_ctx, g_callback_func);
+    g_callback_func = JS_UNDEFINED;
+  }
+  g_ctx = NULL;
+  g_conn_interval_min = 0;
+  g_conn_interval_max = 0;
+  g_phy_2m = false;
+
   g_pAdvertising->stop();
 
   // default
@@ -289,6 +888,10 @@ void endModule_bleperipheral(void)
 
 long initializeModule_bleperipheral(void)
 {
+  g_event_mutex = xSemaphoreCreateMutex();
+  if( g_event_mutex == NULL )
+    return -1;
+
   NimBLEDevice::init("");
   g_pAdvertising = NimBLEDevice::getAdvertising();
 
@@ -303,7 +906,7 @@ JsModuleEntry bleperipheral_module = {
   "BlePeripheral",
   initializeModule_bleperipheral,
   addModule_bleperipheral,
-  NULL,
+  loopModule_bleperipheral,
   endModule_bleperipheral
 };
 
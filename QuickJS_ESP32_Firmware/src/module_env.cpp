@@ -5,6 +5,8 @@
 
 #include "quickjs.h"
 #include "module_env.h"
+#include "module_sensor.h"
+#include "module_wire.h"
 
 #ifdef ENV_MODULE_SHT30
 #include "SHT3X.h"
@@ -25,34 +27,111 @@ static Adafruit_SHT4x sht40;
 static Adafruit_BMP280 bmp(&Wire);
 #endif
 
+#ifdef ENV_MODULE_SHT30
+static const char * const sht30_value_names[] = { "cTemp", "fTemp", "humidity" };
+
+static bool env_sht30_measure(float *p_values)
+{
+  wire_bus_lock(&Wire);
+  bool ret = sht30.get() == 0;
+  p_values[0] = sht30.cTemp;
+  p_values[1] = sht30.fTemp;
+  p_values[2] = sht30.humidity;
+  wire_bus_unlock(&Wire);
+  return ret;
+}
+
+static const SENSOR_PROVIDER sht30_provider = { "sht30", 3, sht30_value_names, env_sht30_measure };
+#endif
+
+#ifdef ENV_MODULE_DHT12
+static const char * const dht12_value_names[] = { "temperature", "humidity" };
+
+static bool env_dht12_measure(float *p_values)
+{
+  wire_bus_lock(&Wire);
+  p_values[0] = dht12.readTemperature();
+  p_values[1] = dht12.readHumidity();
+  wire_bus_unlock(&Wire);
+  return !isnan(p_values[0]) && !isnan(p_values[1]);
+}
+
+static const SENSOR_PROVIDER dht12_provider = { "dht12", 2, dht12_value_names, env_dht12_measure };
+#endif
+
+#ifdef ENV_MODULE_SHT40
+static const char * const sht40_value_names[] = { "temperature", "humidity" };
+
+static bool env_sht40_measure(float *p_values)
+{
+  sensors_event_t humidity, temp;
+  wire_bus_lock(&Wire);
+  bool ret = sht40.getEvent(&humidity, &temp);
+  wire_bus_unlock(&Wire);
+  if( !ret )
+    return false;
+
+  p_values[0] = temp.temperature;
+  p_values[1] = humidity.relative_humidity;
+  return true;
+}
+
+static const SENSOR_PROVIDER sht40_provider = { "sht40", 2, sht40_value_names, env_sht40_measure };
+#endif
+
 #ifdef ENV_MODULE_BMP280
+static const char * const bmp280_value_names[] = { "temperature", "pressure", "altitude" };
+
+static bool env_bmp280_measure(float *p_values)
+{
+  wire_bus_lock(&Wire);
+  p_values[0] = bmp.readTemperature();
+  p_values[1] = bmp.readPressure();
+  p_values[2] = bmp.readAltitude(1013.25);
+  wire_bus_unlock(&Wire);
+  return !isnan(p_values[0]);
+}
+
+static const SENSOR_PROVIDER bmp280_provider = { "bmp280", 3, bmp280_value_names, env_bmp280_measure };
+
 static JSValue env_bmp280_begin(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+    sensor_unregister(bmp280_provider.name);
+    wire_bus_lock(&Wire);
     bool status = bmp.begin(BMP280_SENSOR_ADDR);
+    wire_bus_unlock(&Wire);
     if (!status) {
         return JS_EXCEPTION;
     }
 
+    sensor_register(&bmp280_provider);
+
     return JS_UNDEFINED;
 }
 
 static JSValue env_bmp280_readTemperature(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+    wire_bus_lock(&Wire);
     float temp = bmp.readTemperature();
+    wire_bus_unlock(&Wire);
 
     return JS_NewFloat64(ctx, temp);
 }
 
 static JSValue env_bmp280_readPressure(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+    wire_bus_lock(&Wire);
     float press = bmp.readPressure();
+    wire_bus_unlock(&Wire);
 
     return JS_NewFloat64(ctx, press);
 }
 
 static JSValue env_bmp280_readAltitude(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+    wire_bus_lock(&Wire);
     float alt = bmp.readAltitude(1013.25);
+    wire_bus_unlock(&Wire);
 
     return JS_NewFloat64(ctx, alt);
 }
@@ -61,13 +140,17 @@ static JSValue env_bmp280_readAltitude(JSContext *ctx, JSValueConst jsThis, int
 #ifdef ENV_MODULE_DHT12
 static JSValue env_dht12_readTemperature(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   float tmp = dht12.readTemperature();
+  wire_bus_unlock(&Wire);
   return JS_NewFloat64(ctx, tmp);
 }
 
 static JSValue env_dht12_readHumidity(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   float hum = dht12.readHumidity();
+  wire_bus_unlock(&Wire);
   return JS_NewFloat64(ctx, hum);
 }
 #endif
@@ -75,13 +158,14 @@ static JSValue env_dht12_readHumidity(JSContext *ctx, JSValueConst jsThis, int a
 #ifdef ENV_MODULE_SHT30
 static JSValue env_sht30_get(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  if(sht30.get() != 0)
+  float values[3];
+  if( !env_sht30_measure(values) )
     return JS_EXCEPTION;
   
   JSValue obj = JS_NewObject(ctx);
-  JS_SetPropertyStr(ctx, obj, "cTemp", JS_NewFloat64(ctx, sht30.cTemp));
-  JS_SetPropertyStr(ctx, obj, "fTemp", JS_NewFloat64(ctx, sht30.fTemp));
-  JS_SetPropertyStr(ctx, obj, "humidity", JS_NewFloat64(ctx, sht30.humidity));
+  JS_SetPropertyStr(ctx, obj, "cTemp", JS_NewFloat64(ctx, values[0]));
+  JS_SetPropertyStr(ctx, obj, "fTemp", JS_NewFloat64(ctx, values[1]));
+  JS_SetPropertyStr(ctx, obj, "humidity", JS_NewFloat64(ctx, values[2]));
   return obj;
 }
 #endif
@@ -89,11 +173,18 @@ static JSValue env_sht30_get(JSContext *ctx, JSValueConst jsThis, int argc, JSVa
 #ifdef ENV_MODULE_SHT40
 static JSValue env_sht40_begin(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  if( !sht40.begin() )
+  sensor_unregister(sht40_provider.name);
+  wire_bus_lock(&Wire);
+  bool ret = sht40.begin();
+  if( ret ){
+    sht40.setPrecision(SHT4X_HIGH_PRECISION);
+    sht40.setHeater(SHT4X_NO_HEATER);
+  }
+  wire_bus_unlock(&Wire);
+  if( !ret )
     return JS_EXCEPTION;
 
-  sht40.setPrecision(SHT4X_HIGH_PRECISION);
-  sht40.setHeater(SHT4X_NO_HEATER);
+  sensor_register(&sht40_provider);
 
   return JS_UNDEFINED;
 }
@@ -104,21 +195,23 @@ static JSValue env_sht40_setConfig(JSContext *ctx, JSValueConst jsThis, int argc
   JS_ToInt32(ctx, &precision, argv[0]);
   JS_ToInt32(ctx, &heater, argv[1]);
 
+  wire_bus_lock(&Wire);
   sht40.setPrecision((sht4x_precision_t)precision);
   sht40.setHeater((sht4x_heater_t)heater);
+  wire_bus_unlock(&Wire);
 
   return JS_UNDEFINED;
 }
 
 static JSValue env_sht40_get(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  sensors_event_t humidity, temp;
-  if(!sht40.getEvent(&humidity, &temp))
+  float values[2];
+  if( !env_sht40_measure(values) )
     return JS_EXCEPTION;
   
   JSValue obj = JS_NewObject(ctx);
-  JS_SetPropertyStr(ctx, obj, "temperature", JS_NewFloat64(ctx, temp.temperature));
-  JS_SetPropertyStr(ctx, obj, "humidity", JS_NewFloat64(ctx, humidity.relative_humidity));
+  JS_SetPropertyStr(ctx, obj, "temperature", JS_NewFloat64(ctx, values[0]));
+  JS_SetPropertyStr(ctx, obj, "humidity", JS_NewFloat64(ctx, values[1]));
   return obj;
 }
 #endif
@@ -217,6 +310,15 @@ static const JSCFunctionListEntry env_funcs[] = {
 JSModuleDef *addModule_env(JSContext *ctx, JSValue global)
 {
   JSModuleDef *mod;
+
+  // no begin() for these, subscribable as soon as the module is loaded
+#ifdef ENV_MODULE_SHT30
+  sensor_register(&sht30_provider);
+#endif
+#ifdef ENV_MODULE_DHT12
+  sensor_register(&dht12_provider);
+#endif
+
   mod = JS_NewCModule(ctx, "Env", [](JSContext *ctx, JSModuleDef *m)
                       { return JS_SetModuleExportList(
                             ctx, m, env_funcs,
@@ -34,6 +34,7 @@
 #include "endpoint_packet.h"
 #include "storage_info.h"
 #include "lib_snmp.h"
+#include "lib_metrics.h"
 
 #define GLOBAL_ESP32
 #define GLOBAL_CONSOLE
@@ -390,6 +391,72 @@ static JSValue esp32_getMemoryUsage(JSContext *ctx, JSValueConst jsThis, int arg
   return obj;
 }
 
+static JSValue esp32_getMetrics(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  METRICS_INFO *p_info = (METRICS_INFO*)malloc(sizeof(METRICS_INFO));
+  if( p_info == NULL )
+    return JS_EXCEPTION;
+  if( metrics_get(p_info) != 0 ){
+    free(p_info);
+    return JS_EXCEPTION;
+  }
+
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "timestamp", JS_NewUint32(ctx, p_info->timestamp));
+  JS_SetPropertyStr(ctx, obj, "runtime_stats", JS_NewBool(ctx, p_info->runtime_stats));
+
+  JSValue cores = JS_NewArray(ctx);
+  for( int i = 0 ; i < p_info->num_cores ; i++ )
+    JS_SetPropertyUint32(ctx, cores, i, JS_NewUint32(ctx, p_info->core_load[i]));
+  JS_SetPropertyStr(ctx, obj, "core_load", cores);
+
+  JSValue tasks = JS_NewArray(ctx);
+  for( int i = 0 ; i < p_info->num_tasks ; i++ ){
+    METRICS_TASK_INFO *p_task = &p_info->tasks[i];
+    JSValue task = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, task, "name", JS_NewString(ctx, p_task->name));
+    JS_SetPropertyStr(ctx, task, "core", (p_task->core == 0xff) ? JS_NewInt32(ctx, -1) : JS_NewInt32(ctx, p_task->core));
+    JS_SetPropertyStr(ctx, task, "load", JS_NewUint32(ctx, p_task->load));
+    JS_SetPropertyStr(ctx, task, "stack_free", JS_NewUint32(ctx, p_task->stack_free));
+    JS_SetPropertyUint32(ctx, tasks, i, task);
+  }
+  JS_SetPropertyStr(ctx, obj, "tasks", tasks);
+
+  const METRICS_PERCENTILE *percentiles[2] = { &p_info->timer_lag, &p_info->loop_time };
+  const char *names[2] = { "timer_lag", "loop_time" };
+  for( int i = 0 ; i < 2 ; i++ ){
+    JSValue value = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, value, "p50", JS_NewUint32(ctx, percentiles[i]->p50));
+    JS_SetPropertyStr(ctx, value, "p90", JS_NewUint32(ctx, percentiles[i]->p90));
+    JS_SetPropertyStr(ctx, value, "p99", JS_NewUint32(ctx, percentiles[i]->p99));
+    JS_SetPropertyStr(ctx, value, "max", JS_NewUint32(ctx, percentiles[i]->max));
+    JS_SetPropertyStr(ctx, obj, names[i], value);
+  }
+
+  JS_SetPropertyStr(ctx, obj, "gc_count", JS_NewUint32(ctx, p_info->gc_count));
+  JS_SetPropertyStr(ctx, obj, "gc_time_total", JS_NewUint32(ctx, p_info->gc_time_total));
+  JS_SetPropertyStr(ctx, obj, "gc_time_last", JS_NewUint32(ctx, p_info->gc_time_last));
+  JS_SetPropertyStr(ctx, obj, "heap_free", JS_NewUint32(ctx, p_info->heap_free));
+  JS_SetPropertyStr(ctx, obj, "heap_largest", JS_NewUint32(ctx, p_info->heap_largest));
+  JS_SetPropertyStr(ctx, obj, "heap_frag", JS_NewUint32(ctx, p_info->heap_frag));
+  JS_SetPropertyStr(ctx, obj, "psram_free", JS_NewUint32(ctx, p_info->psram_free));
+  JS_SetPropertyStr(ctx, obj, "psram_largest", JS_NewUint32(ctx, p_info->psram_largest));
+  JS_SetPropertyStr(ctx, obj, "psram_frag", JS_NewUint32(ctx, p_info->psram_frag));
+  JS_SetPropertyStr(ctx, obj, "js_malloc_size", JS_NewUint32(ctx, p_info->js_malloc_size));
+  JS_SetPropertyStr(ctx, obj, "js_memory_used", JS_NewUint32(ctx, p_info->js_memory_used));
+  free(p_info);
+
+  return obj;
+}
+
+static JSValue esp32_runGC(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(ctx);
+  uint32_t elapsed = qjs->runGC();
+
+  return JS_NewUint32(ctx, elapsed);
+}
+
 static JSValue esp32_getStorageInfo(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
   JSValue obj = JS_NewObject(ctx);
@@ -589,6 +656,145 @@ static JSValue esp32_setSnmpTimestamp(JSContext *ctx, JSValueConst jsThis, int a
     return JS_EXCEPTION;
   return JS_UNDEFINED;
 }
+
+typedef struct {
+  JSValue provider;
+  uint32_t interval;
+  uint32_t next;
+} SNMP_TABLE_PROVIDER;
+static SNMP_TABLE_PROVIDER g_snmp_table_providers[NUM_OF_SNMP_TABLE];
+static JSContext *g_snmp_ctx = NULL;
+
+static long snmp_table_update_from_rows(JSContext *ctx, unsigned char index, JSValue rows)
+{
+  unsigned char num_columns;
+  if( snmp_table_get_info(index, &num_columns, NULL) != 0 )
+    return -1;
+  if( !JS_IsArray(ctx, rows) )
+    return -1;
+
+  JSValue jv = JS_GetPropertyStr(ctx, rows, "length");
+  uint32_t num_rows;
+  JS_ToUint32(ctx, &num_rows, jv);
+  JS_FreeValue(ctx, jv);
+  if( num_rows * num_columns > SNMP_TABLE_MAX_CELLS )
+    return -1;
+
+  std::vector<SNMP_TABLE_CELL> cells(num_rows * num_columns);
+  for( uint32_t row = 0 ; row < num_rows ; row++ ){
+    JSValue vrow = JS_GetPropertyUint32(ctx, rows, row);
+    for( uint32_t col = 0 ; col < num_columns ; col++ ){
+      SNMP_TABLE_CELL *p_cell = &cells[row * num_columns + col];
+      JSValue value = JS_GetPropertyUint32(ctx, vrow, col);
+      if( JS_IsString(value) ){
+        const char *str = JS_ToCString(ctx, value);
+        if( str != NULL ){
+          p_cell->str = std::string(str);
+          JS_FreeCString(ctx, str);
+        }
+        p_cell->number = NUMBER_DEFAULT;
+      }else if( JS_IsUndefined(value) ){
+        p_cell->number = NUMBER_DEFAULT;
+      }else{
+        int32_t number;
+        JS_ToInt32(ctx, &number, value);
+        p_cell->number = number;
+      }
+      JS_FreeValue(ctx, value);
+    }
+    JS_FreeValue(ctx, vrow);
+  }
+
+  return snmp_table_set_rows(index, cells, num_rows);
+}
+
+static long snmp_table_refresh(unsigned char index)
+{
+  SNMP_TABLE_PROVIDER *p_provider = &g_snmp_table_providers[index];
+  ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(g_snmp_ctx);
+  JSValue rows = qjs->callJsFunc(g_snmp_ctx, p_provider->provider, p_provider->provider);
+  long ret = snmp_table_update_from_rows(g_snmp_ctx, index, rows);
+  JS_FreeValue(g_snmp_ctx, rows);
+  p_provider->next = millis() + p_provider->interval;
+
+  return ret;
+}
+
+static JSValue esp32_registerSnmpTable(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  const char *oid_base = JS_ToCString(ctx, argv[0]);
+  if( oid_base == NULL )
+    return JS_EXCEPTION;
+
+  unsigned char types[SNMP_TABLE_MAX_COLUMNS];
+  JSValue jv = JS_GetPropertyStr(ctx, argv[1], "length");
+  uint32_t num_columns;
+  JS_ToUint32(ctx, &num_columns, jv);
+  JS_FreeValue(ctx, jv);
+  if( num_columns == 0 || num_columns > SNMP_TABLE_MAX_COLUMNS ){
+    JS_FreeCString(ctx, oid_base);
+    return JS_EXCEPTION;
+  }
+  for( uint32_t i = 0 ; i < num_columns ; i++ ){
+    JSValue value = JS_GetPropertyUint32(ctx, argv[1], i);
+    const char *type = JS_ToCString(ctx, value);
+    JS_FreeValue(ctx, value);
+    if( type == NULL ){
+      JS_FreeCString(ctx, oid_base);
+      return JS_EXCEPTION;
+    }
+    long column_type;
+    if( strcmp(type, "number") == 0 )
+      column_type = SNMP_COLUMN_NUMBER;
+    else if( strcmp(type, "string") == 0 )
+      column_type = SNMP_COLUMN_STRING;
+    else if( strcmp(type, "timestamp") == 0 )
+      column_type = SNMP_COLUMN_TIMESTAMP;
+    else
+      column_type = -1;
+    JS_FreeCString(ctx, type);
+    if( column_type < 0 ){
+      JS_FreeCString(ctx, oid_base);
+      return JS_EXCEPTION;
+    }
+    types[i] = (unsigned char)column_type;
+  }
+
+  long index = snmp_table_register(oid_base, types, num_columns);
+  JS_FreeCString(ctx, oid_base);
+  if( index < 0 )
+    return JS_EXCEPTION;
+
+  SNMP_TABLE_PROVIDER *p_provider = &g_snmp_table_providers[index];
+  p_provider->provider = JS_UNDEFINED;
+  p_provider->interval = 0;
+  if( argc >= 3 && JS_IsFunction(ctx, argv[2]) ){
+    uint32_t interval = 10000;
+    if( argc >= 4 )
+      JS_ToUint32(ctx, &interval, argv[3]);
+    if( interval < 100 )
+      interval = 100;
+    g_snmp_ctx = ctx;
+    p_provider->provider = JS_DupValue(ctx, argv[2]);
+    p_provider->interval = interval;
+    snmp_table_refresh(index);
+  }
+
+  return JS_NewInt32(ctx, index);
+}
+
+static JSValue esp32_setSnmpTableRows(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t index;
+  JS_ToUint32(ctx, &index, argv[0]);
+  if( index >= NUM_OF_SNMP_TABLE )
+    return JS_EXCEPTION;
+
+  long ret = snmp_table_update_from_rows(ctx, index, argv[1]);
+  if( ret != 0 )
+    return JS_EXCEPTION;
+  return JS_UNDEFINED;
+}
 #endif
 
 static JSValue esp32_download_jscode(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
@@ -813,6 +1019,12 @@ static const JSCFunctionListEntry esp32_funcs[] = {
     JSCFunctionListEntry{"getMemoryUsage", 0, JS_DEF_CFUNC, 0, {
                            func : {0, JS_CFUNC_generic, esp32_getMemoryUsage}
                          }},
+    JSCFunctionListEntry{"getMetrics", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_getMetrics}
+                         }},
+    JSCFunctionListEntry{"runGC", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_runGC}
+                         }},
     JSCFunctionListEntry{"getStorageInfo", 0, JS_DEF_CFUNC, 0, {
                            func : {0, JS_CFUNC_generic, esp32_getStorageInfo}
                          }},
@@ -829,6 +1041,12 @@ static const JSCFunctionListEntry esp32_funcs[] = {
     JSCFunctionListEntry{"setSnmpTimestamp", 0, JS_DEF_CFUNC, 0, {
                            func : {2, JS_CFUNC_generic, esp32_setSnmpTimestamp}
                          }},
+    JSCFunctionListEntry{"registerSnmpTable", 0, JS_DEF_CFUNC, 0, {
+                           func : {4, JS_CFUNC_generic, esp32_registerSnmpTable}
+                         }},
+    JSCFunctionListEntry{"setSnmpTableRows", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic, esp32_setSnmpTableRows}
+                         }},
 #endif
     JSCFunctionListEntry{"time", 0, JS_DEF_CFUNC, 0, {
                            func : {0, JS_CFUNC_generic, esp32_time}
@@ -1119,12 +1337,39 @@ long initialize_esp32(void)
     syslog_changeServer(host.c_str(), port.toInt());
   }
 
+#ifdef _SNMP_AGENT_ENABLE_
+  for( int i = 0 ; i < NUM_OF_SNMP_TABLE ; i++ )
+    g_snmp_table_providers[i].provider = JS_UNDEFINED;
+#endif
+
   return 0;
 }
 
+void loopModule_esp32(void){
+#ifdef _SNMP_AGENT_ENABLE_
+  for( int i = 0 ; i < NUM_OF_SNMP_TABLE ; i++ ){
+    SNMP_TABLE_PROVIDER *p_provider = &g_snmp_table_providers[i];
+    if( p_provider->provider == JS_UNDEFINED )
+      continue;
+    if( (int32_t)(millis() - p_provider->next) >= 0 )
+      snmp_table_refresh(i);
+  }
+#endif
+}
+
 void endModule_esp32(void){
 #ifdef _SNMP_AGENT_ENABLE_
   snmp_clear_value();
+
+  for( int i = 0 ; i < NUM_OF_SNMP_TABLE ; i++ ){
+    SNMP_TABLE_PROVIDER *p_provider = &g_snmp_table_providers[i];
+    if( p_provider->provider != JS_UNDEFINED ){
+      JS_FreeValue(g_snmp_ctx, p_provider->provider);
+      p_provider->provider = JS_UNDEFINED;
+    }
+  }
+  snmp_table_clear();
+  g_snmp_ctx = NULL;
 #endif
 }
 
@@ -1132,7 +1377,7 @@ JsModuleEntry esp32_module = {
   "Esp32",
   initialize_esp32,
   addModule_esp32,
-  NULL,
+  loopModule_esp32,
   endModule_esp32
 };
 
@@ -1144,8 +1389,22 @@ JsModuleEntry console_module = {
   NULL
 };
 
+static SemaphoreHandle_t g_internal_bus_lock = NULL;
+
+void esp32_internal_bus_lock(void)
+{
+  xSemaphoreTakeRecursive(g_internal_bus_lock, portMAX_DELAY);
+}
+
+void esp32_internal_bus_unlock(void)
+{
+  xSemaphoreGiveRecursive(g_internal_bus_lock);
+}
+
 long esp32_initialize(void)
 {
+  g_internal_bus_lock = xSemaphoreCreateRecursiveMutex();
+
   Serial.begin(115200);
 
   auto cfg = M5.config();
@@ -1210,5 +1469,7 @@ long esp32_initialize(void)
 
 void esp32_update(void)
 {
+  esp32_internal_bus_lock();
   M5.update();
+  esp32_internal_bus_unlock();
 }
\ No newline at end of file
@@ -11,6 +11,9 @@ extern int g_external_display_type;
 
 long esp32_initialize(void);
 void esp32_update(void);
+// the internal I2C bus (touch, PMIC, IMU, RTC) is shared by the main task, the IMU sampling task and the web server
+void esp32_internal_bus_lock(void);
+void esp32_internal_bus_unlock(void);
 uint32_t esp32_getDeviceModel(void);
 
 long syslog_send(uint16_t pri, const char *p_message);
@@ -1,6 +1,103 @@
 #include <Arduino.h>
 #include "quickjs.h"
 #include "module_type.h"
+#include "module_utils.h"
+#include "mem_utils.h"
+#include "lib_dsp.h"
+#include "quickjs_esp32.h"
+#include <driver/adc.h>
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+#include <soc/gpio_struct.h>
+
+#define ADC_CONT_MAX_CHANNELS     4
+#define ADC_CONT_MAX_WINDOW       1024
+#define ADC_CONT_NUM_OF_SLOTS     4
+#define ADC_CONT_FRAME_SIZE       (256 * SOC_ADC_DIGI_RESULT_BYTES)
+#define ADC_CONT_TASK_STACK       4096
+#define ADC_CONT_TASK_PRIORITY    4
+#define ADC_CONT_STATS_NUM        4 // mean, min, max, rms of the window
+#define ADC_CONT_MAX_RMS_LENGTH   ADC_CONT_MAX_WINDOW
+
+#define GPIO_CHANGE_MAX_PINS      8
+#define GPIO_CHANGE_QUEUE_SIZE    64
+#define GPIO_CHANGE_DEFAULT_DEBOUNCE      20 // ms
+#define GPIO_CHANGE_DEFAULT_LONG_PRESS    800 // ms
+#define GPIO_CHANGE_DEFAULT_DOUBLE_CLICK  300 // ms
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_CONT_OUTPUT_FORMAT    ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_CONT_GET_CHANNEL(p)   ((p)->type1.channel)
+#define ADC_CONT_GET_DATA(p)      ((p)->type1.data)
+#else
+#define ADC_CONT_OUTPUT_FORMAT    ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_CONT_GET_CHANNEL(p)   ((p)->type2.channel)
+#define ADC_CONT_GET_DATA(p)      ((p)->type2.data)
+#endif
+
+// one completed window for all channels
+typedef struct {
+  uint32_t timestamp;
+  float *p_samples; // [channel][window]
+  float *p_stats; // [channel][ADC_CONT_STATS_NUM]
+  float *p_fft; // [channel][window / 2]
+  float *p_rms; // [channel][window], moving RMS at each sample
+} ADC_CONT_SLOT;
+
+static uint8_t g_adc_num_channels = 0;
+static uint8_t g_adc_channels[ADC_CONT_MAX_CHANNELS];
+static uint32_t g_adc_window = 0;
+static bool g_adc_fft = false;
+static DSP_DECIMATOR g_adc_decimators[ADC_CONT_MAX_CHANNELS];
+static uint32_t g_adc_fill[ADC_CONT_MAX_CHANNELS];
+static float *g_adc_work = NULL;
+static uint32_t g_adc_rms_length = 0; // 0: no moving RMS
+static DSP_MOVING_RMS g_adc_rms[ADC_CONT_MAX_CHANNELS];
+static float *g_adc_rms_squares = NULL; // [channel][rms_length]
+
+static ADC_CONT_SLOT g_adc_slots[ADC_CONT_NUM_OF_SLOTS];
+static volatile uint32_t g_adc_head = 0;
+static volatile uint32_t g_adc_tail = 0;
+static volatile uint32_t g_adc_dropped = 0;
+static volatile uint32_t g_adc_overflow = 0;
+static volatile uint32_t g_adc_rate = 0; // achieved conversions per second
+
+static TaskHandle_t g_adc_task = NULL;
+static volatile bool g_adc_running = false;
+
+typedef struct {
+  bool used;
+  uint8_t pin;
+  uint8_t edge; // RISING and/or FALLING reported to the script
+  bool classify;
+  bool active_low;
+  uint32_t debounce_us;
+  uint32_t long_press;
+  uint32_t double_click;
+  volatile uint8_t isr_level; // last accepted level
+  volatile uint32_t isr_time; // us of the last accepted edge
+  bool pressed;
+  uint32_t press_time;
+  bool long_fired;
+  bool click_valid;
+  uint32_t click_time;
+  JSValue callback;
+} GPIO_CHANGE_SLOT;
+
+typedef struct {
+  uint8_t slot;
+  uint8_t level;
+  uint32_t time; // ms
+} GPIO_CHANGE_EDGE;
+
+static GPIO_CHANGE_SLOT g_change_slots[GPIO_CHANGE_MAX_PINS];
+static GPIO_CHANGE_EDGE g_change_queue[GPIO_CHANGE_QUEUE_SIZE];
+static volatile uint32_t g_change_head = 0;
+static volatile uint32_t g_change_tail = 0;
+static volatile uint32_t g_change_dropped = 0;
+static uint32_t g_change_edges = 0;
+static portMUX_TYPE g_change_mux = portMUX_INITIALIZER_UNLOCKED;
+static JSContext *g_change_ctx = NULL;
 
 static JSValue esp32_gpio_mode(JSContext *ctx, JSValueConst jsThis, int argc,
                                JSValueConst *argv)
@@ -38,6 +135,594 @@ static JSValue esp32_gpio_digital_write(JSContext *ctx, JSValueConst jsThis,
   return JS_UNDEFINED;
 }
 
+// the slot at g_adc_head is only filled while the ring has room for it, see adc_task
+static void adc_complete_window(void)
+{
+  ADC_CONT_SLOT *p_slot = &g_adc_slots[g_adc_head % ADC_CONT_NUM_OF_SLOTS];
+  p_slot->timestamp = millis();
+  for( int ch = 0 ; ch < g_adc_num_channels ; ch++ ){
+    const float *p_samples = &p_slot->p_samples[ch * g_adc_window];
+    DSP_STATS stats;
+    dsp_stats(p_samples, g_adc_window, &stats);
+    float *p_stats = &p_slot->p_stats[ch * ADC_CONT_STATS_NUM];
+    p_stats[0] = stats.mean;
+    p_stats[1] = stats.min;
+    p_stats[2] = stats.max;
+    p_stats[3] = stats.rms;
+    if( g_adc_fft )
+      dsp_fft_magnitude(p_samples, g_adc_window, g_adc_work, &p_slot->p_fft[ch * g_adc_window / 2]);
+  }
+  __sync_synchronize();
+  g_adc_head++;
+}
+
+static void adc_task(void *arg)
+{
+  uint8_t *p_frame = (uint8_t*)malloc(ADC_CONT_FRAME_SIZE);
+  uint32_t window_start = millis();
+  uint32_t window_count = 0;
+  // decided when a window starts: with all slots queued, the slot at g_adc_head is the one
+  // adcContinuousRead may be copying, so that window is only counted and not stored
+  ADC_CONT_SLOT *p_slot = &g_adc_slots[g_adc_head % ADC_CONT_NUM_OF_SLOTS];
+  bool discard = false;
+
+  while( g_adc_running && p_frame != NULL ){
+    uint32_t length = 0;
+    esp_err_t ret = adc_digi_read_bytes(p_frame, ADC_CONT_FRAME_SIZE, &length, 100);
+    if( ret == ESP_ERR_INVALID_STATE ){
+      // the driver buffer overflowed; the data read is still valid
+      g_adc_overflow++;
+    }else if( ret != ESP_OK ){
+      continue;
+    }
+
+    for( uint32_t i = 0 ; i + SOC_ADC_DIGI_RESULT_BYTES <= length ; i += SOC_ADC_DIGI_RESULT_BYTES ){
+      adc_digi_output_data_t *p_data = (adc_digi_output_data_t*)&p_frame[i];
+      uint32_t channel = ADC_CONT_GET_CHANNEL(p_data);
+      int ch;
+      for( ch = 0 ; ch < g_adc_num_channels ; ch++ ){
+        if( g_adc_channels[ch] == channel )
+          break;
+      }
+      if( ch >= g_adc_num_channels )
+        continue;
+      window_count++;
+
+      float value;
+      if( !dsp_decimator_push(&g_adc_decimators[ch], ADC_CONT_GET_DATA(p_data), &value) )
+        continue;
+      // a channel that is ahead waits for the others at the window boundary
+      if( g_adc_fill[ch] >= g_adc_window )
+        continue;
+      // the moving RMS runs over every sample, also in dropped windows
+      float rms = (g_adc_rms_length > 0) ? dsp_moving_rms_push(&g_adc_rms[ch], value) : 0.0f;
+      if( !discard ){
+        p_slot->p_samples[ch * g_adc_window + g_adc_fill[ch]] = value;
+        if( g_adc_rms_length > 0 )
+          p_slot->p_rms[ch * g_adc_window + g_adc_fill[ch]] = rms;
+      }
+      g_adc_fill[ch]++;
+
+      bool completed = true;
+      for( int j = 0 ; j < g_adc_num_channels ; j++ ){
+        if( g_adc_fill[j] < g_adc_window ){
+          completed = false;
+          break;
+        }
+      }
+      if( completed ){
+        if( discard )
+          g_adc_dropped++;
+        else
+          adc_complete_window();
+        for( int j = 0 ; j < g_adc_num_channels ; j++ )
+          g_adc_fill[j] = 0;
+        p_slot = &g_adc_slots[g_adc_head % ADC_CONT_NUM_OF_SLOTS];
+        discard = (g_adc_head - g_adc_tail >= ADC_CONT_NUM_OF_SLOTS);
+      }
+    }
+
+    uint32_t now = millis();
+    if( now - window_start >= 1000 ){
+      g_adc_rate = (uint64_t)window_count * 1000 / (now - window_start);
+      window_start = now;
+      window_count = 0;
+    }
+  }
+
+  if( p_frame != NULL )
+    free(p_frame);
+  g_adc_task = NULL;
+  vTaskDelete(NULL);
+}
+
+static void adc_continuous_stop(void)
+{
+  if( g_adc_task != NULL ){
+    g_adc_running = false;
+    while( g_adc_task != NULL )
+      delay(1);
+    adc_digi_stop();
+    adc_digi_deinitialize();
+  }
+
+  for( int i = 0 ; i < ADC_CONT_NUM_OF_SLOTS ; i++ ){
+    if( g_adc_slots[i].p_samples != NULL )
+      utils_mem_free(g_adc_slots[i].p_samples);
+    g_adc_slots[i].p_samples = NULL;
+    g_adc_slots[i].p_stats = NULL;
+    g_adc_slots[i].p_fft = NULL;
+    g_adc_slots[i].p_rms = NULL;
+  }
+  if( g_adc_work != NULL ){
+    utils_mem_free(g_adc_work);
+    g_adc_work = NULL;
+  }
+  if( g_adc_rms_squares != NULL ){
+    utils_mem_free(g_adc_rms_squares);
+    g_adc_rms_squares = NULL;
+  }
+  g_adc_rms_length = 0;
+  g_adc_num_channels = 0;
+  g_adc_head = 0;
+  g_adc_tail = 0;
+  g_adc_dropped = 0;
+  g_adc_overflow = 0;
+  g_adc_rate = 0;
+}
+
+static JSValue esp32_gpio_adc_continuous_start(JSContext *ctx, JSValueConst jsThis,
+                                      int argc, JSValueConst *argv)
+{
+  int32_t *p_pins;
+  uint32_t num_pins;
+  if( getNumberArray(ctx, argv[0], &p_pins, &num_pins) != 0 )
+    return JS_EXCEPTION;
+  if( num_pins == 0 || num_pins > ADC_CONT_MAX_CHANNELS ){
+    free(p_pins);
+    return JS_EXCEPTION;
+  }
+
+  uint32_t rate = 20000;
+  uint32_t decimation = 1;
+  uint32_t window = 256;
+  uint32_t atten = ADC_ATTEN_DB_11;
+  uint32_t rms_length = 0;
+  bool fft = false;
+  if( argc >= 2 ){
+    JSValue value;
+    value = JS_GetPropertyStr(ctx, argv[1], "rate");
+    if( value != JS_UNDEFINED ){
+      JS_ToUint32(ctx, &rate, value);
+      JS_FreeValue(ctx, value);
+    }
+    value = JS_GetPropertyStr(ctx, argv[1], "decimation");
+    if( value != JS_UNDEFINED ){
+      JS_ToUint32(ctx, &decimation, value);
+      JS_FreeValue(ctx, value);
+    }
+    value = JS_GetPropertyStr(ctx, argv[1], "window");
+    if( value != JS_UNDEFINED ){
+      JS_ToUint32(ctx, &window, value);
+      JS_FreeValue(ctx, value);
+    }
+    value = JS_GetPropertyStr(ctx, argv[1], "atten");
+    if( value != JS_UNDEFINED ){
+      JS_ToUint32(ctx, &atten, value);
+      JS_FreeValue(ctx, value);
+    }
+    value = JS_GetPropertyStr(ctx, argv[1], "fft");
+    if( value != JS_UNDEFINED ){
+      fft = JS_ToBool(ctx, value);
+      JS_FreeValue(ctx, value);
+    }
+    value = JS_GetPropertyStr(ctx, argv[1], "rms");
+    if( value != JS_UNDEFINED ){
+      JS_ToUint32(ctx, &rms_length, value);
+      JS_FreeValue(ctx, value);
+    }
+  }
+  if( rate < SOC_ADC_SAMPLE_FREQ_THRES_LOW || rate > SOC_ADC_SAMPLE_FREQ_THRES_HIGH ||
+      window < 2 || window > ADC_CONT_MAX_WINDOW || (fft && (window & (window - 1)) != 0) ||
+      decimation == 0 || atten > ADC_ATTEN_DB_11 || rms_length > ADC_CONT_MAX_RMS_LENGTH ){
+    free(p_pins);
+    return JS_EXCEPTION;
+  }
+
+  adc_continuous_stop();
+
+  // only ADC1 can be driven by the digital controller alongside WiFi
+  uint32_t chan_mask = 0;
+  for( uint32_t i = 0 ; i < num_pins ; i++ ){
+    int8_t channel = digitalPinToAnalogChannel(p_pins[i]);
+    if( channel < 0 || channel >= SOC_ADC_MAX_CHANNEL_NUM ){
+      free(p_pins);
+      return JS_EXCEPTION;
+    }
+    g_adc_channels[i] = channel;
+    chan_mask |= 1 << channel;
+  }
+  free(p_pins);
+  g_adc_num_channels = num_pins;
+  g_adc_window = window;
+  g_adc_fft = fft;
+  for( int ch = 0 ; ch < g_adc_num_channels ; ch++ ){
+    dsp_decimator_init(&g_adc_decimators[ch], decimation);
+    g_adc_fill[ch] = 0;
+  }
+
+  uint32_t samples_size = g_adc_num_channels * window;
+  uint32_t stats_size = g_adc_num_channels * ADC_CONT_STATS_NUM;
+  uint32_t fft_size = fft ? g_adc_num_channels * window / 2 : 0;
+  uint32_t rms_size = (rms_length > 0) ? g_adc_num_channels * window : 0;
+  for( int i = 0 ; i < ADC_CONT_NUM_OF_SLOTS ; i++ ){
+    float *p_buffer = (float*)utils_mem_alloc(sizeof(float) * (samples_size + stats_size + fft_size + rms_size));
+    if( p_buffer == NULL ){
+      adc_continuous_stop();
+      return JS_EXCEPTION;
+    }
+    g_adc_slots[i].p_samples = p_buffer;
+    g_adc_slots[i].p_stats = p_buffer + samples_size;
+    g_adc_slots[i].p_fft = fft ? p_buffer + samples_size + stats_size : NULL;
+    g_adc_slots[i].p_rms = (rms_length > 0) ? p_buffer + samples_size + stats_size + fft_size : NULL;
+  }
+  if( rms_length > 0 ){
+    g_adc_rms_squares = (float*)utils_mem_alloc(sizeof(float) * g_adc_num_channels * rms_length);
+    if( g_adc_rms_squares == NULL ){
+      adc_continuous_stop();
+      return JS_EXCEPTION;
+    }
+    for( int ch = 0 ; ch < g_adc_num_channels ; ch++ )
+      dsp_moving_rms_init(&g_adc_rms[ch], &g_adc_rms_squares[ch * rms_length], rms_length);
+    g_adc_rms_length = rms_length;
+  }
+  if( fft ){
+    g_adc_work = (float*)utils_mem_alloc(sizeof(float) * window * 2);
+    if( g_adc_work == NULL ){
+      adc_continuous_stop();
+      return JS_EXCEPTION;
+    }
+  }
+
+  adc_digi_init_config_t init_config = {};
+  init_config.max_store_buf_size = ADC_CONT_FRAME_SIZE * 4;
+  init_config.conv_num_each_intr = ADC_CONT_FRAME_SIZE;
+  init_config.adc1_chan_mask = chan_mask;
+  init_config.adc2_chan_mask = 0;
+  if( adc_digi_initialize(&init_config) != ESP_OK ){
+    adc_continuous_stop();
+    return JS_EXCEPTION;
+  }
+
+  adc_digi_pattern_config_t patterns[SOC_ADC_PATT_LEN_MAX] = {};
+  for( int ch = 0 ; ch < g_adc_num_channels ; ch++ ){
+    patterns[ch].atten = atten;
+    patterns[ch].channel = g_adc_channels[ch];
+    patterns[ch].unit = 0; // ADC1
+    patterns[ch].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
+  adc_digi_configuration_t dig_config = {};
+  dig_config.conv_limit_en = ADC_CONV_LIMIT_EN;
+  dig_config.conv_limit_num = 250;
+  dig_config.pattern_num = g_adc_num_channels;
+  dig_config.adc_pattern = patterns;
+  dig_config.sample_freq_hz = rate;
+  dig_config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  dig_config.format = ADC_CONT_OUTPUT_FORMAT;
+  if( adc_digi_controller_configure(&dig_config) != ESP_OK || adc_digi_start() != ESP_OK ){
+    adc_digi_deinitialize();
+    adc_continuous_stop();
+    return JS_EXCEPTION;
+  }
+
+  g_adc_running = true;
+  BaseType_t ret = xTaskCreate(adc_task, "adc_continuous", ADC_CONT_TASK_STACK, NULL, ADC_CONT_TASK_PRIORITY, &g_adc_task);
+  if( ret != pdPASS ){
+    g_adc_running = false;
+    g_adc_task = NULL;
+    adc_digi_stop();
+    adc_digi_deinitialize();
+    adc_continuous_stop();
+    return JS_EXCEPTION;
+  }
+
+  return JS_NewBool(ctx, true);
+}
+
+static JSValue esp32_gpio_adc_continuous_stop(JSContext *ctx, JSValueConst jsThis,
+                                      int argc, JSValueConst *argv)
+{
+  adc_continuous_stop();
+
+  return JS_UNDEFINED;
+}
+
+static JSValue create_Float32Array_copy(JSContext *ctx, const float *p_buffer, uint32_t num)
+{
+  JSValue buffer = JS_NewArrayBufferCopy(ctx, (const uint8_t*)p_buffer, sizeof(float) * num);
+  if( JS_IsException(buffer) )
+    return JS_EXCEPTION;
+  JSValue array = create_TypedArray(ctx, BINDING_CTOR_FLOAT32ARRAY, buffer);
+  JS_FreeValue(ctx, buffer);
+  return array;
+}
+
+static JSValue esp32_gpio_adc_continuous_read(JSContext *ctx, JSValueConst jsThis,
+                                      int argc, JSValueConst *argv)
+{
+  if( g_adc_task == NULL )
+    return JS_EXCEPTION;
+  if( g_adc_head == g_adc_tail )
+    return JS_NULL;
+
+  // oldest completed window
+  const ADC_CONT_SLOT *p_slot = &g_adc_slots[g_adc_tail % ADC_CONT_NUM_OF_SLOTS];
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "timestamp", JS_NewUint32(ctx, p_slot->timestamp));
+  JS_SetPropertyStr(ctx, obj, "samples", create_Float32Array_copy(ctx, p_slot->p_samples, g_adc_num_channels * g_adc_window));
+  JS_SetPropertyStr(ctx, obj, "stats", create_Float32Array_copy(ctx, p_slot->p_stats, g_adc_num_channels * ADC_CONT_STATS_NUM));
+  if( g_adc_fft )
+    JS_SetPropertyStr(ctx, obj, "fft", create_Float32Array_copy(ctx, p_slot->p_fft, g_adc_num_channels * g_adc_window / 2));
+  if( g_adc_rms_length > 0 )
+    JS_SetPropertyStr(ctx, obj, "rms", create_Float32Array_copy(ctx, p_slot->p_rms, g_adc_num_channels * g_adc_window));
+  __sync_synchronize();
+  g_adc_tail++;
+
+  return obj;
+}
+
+static JSValue esp32_gpio_adc_continuous_status(JSContext *ctx, JSValueConst jsThis,
+                                      int argc, JSValueConst *argv)
+{
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "running", JS_NewBool(ctx, g_adc_task != NULL));
+  JS_SetPropertyStr(ctx, obj, "rate", JS_NewUint32(ctx, g_adc_rate));
+  JS_SetPropertyStr(ctx, obj, "queued", JS_NewUint32(ctx, g_adc_head - g_adc_tail));
+  JS_SetPropertyStr(ctx, obj, "dropped", JS_NewUint32(ctx, g_adc_dropped));
+  JS_SetPropertyStr(ctx, obj, "overflow", JS_NewUint32(ctx, g_adc_overflow));
+  return obj;
+}
+
+static void IRAM_ATTR gpio_change_isr(void *arg)
+{
+  GPIO_CHANGE_SLOT *p_slot = (GPIO_CHANGE_SLOT*)arg;
+  uint32_t now = micros();
+  uint8_t level = gpio_ll_get_level(&GPIO, (gpio_num_t)p_slot->pin);
+
+  // leading edge debounce: the first edge is taken at once and the bounces after it are ignored
+  portENTER_CRITICAL_ISR(&g_change_mux);
+  if( level != p_slot->isr_level && now - p_slot->isr_time >= p_slot->debounce_us ){
+    p_slot->isr_level = level;
+    p_slot->isr_time = now;
+    if( g_change_head - g_change_tail >= GPIO_CHANGE_QUEUE_SIZE ){
+      g_change_dropped++;
+    }else{
+      GPIO_CHANGE_EDGE *p_edge = &g_change_queue[g_change_head % GPIO_CHANGE_QUEUE_SIZE];
+      p_edge->slot = p_slot - g_change_slots;
+      p_edge->level = level;
+      p_edge->time = millis();
+      g_change_head++;
+    }
+  }
+  portEXIT_CRITICAL_ISR(&g_change_mux);
+}
+
+static void gpio_change_detach(GPIO_CHANGE_SLOT *p_slot)
+{
+  if( !p_slot->used )
+    return;
+  detachInterrupt(p_slot->pin);
+  p_slot->used = false;
+  if( p_slot->callback != JS_UNDEFINED ){
+    JS_FreeValue(g_change_ctx, p_slot->callback);
+    p_slot->callback = JS_UNDEFINED;
+  }
+}
+
+static void gpio_change_notify(GPIO_CHANGE_SLOT *p_slot, uint8_t type, uint8_t level, uint32_t time, uint32_t duration)
+{
+  JSValue obj = JS_NewObject(g_change_ctx);
+  JS_SetPropertyStr(g_change_ctx, obj, "pin", JS_NewUint32(g_change_ctx, p_slot->pin));
+  JS_SetPropertyStr(g_change_ctx, obj, "type", JS_NewUint32(g_change_ctx, type));
+  JS_SetPropertyStr(g_change_ctx, obj, "level", JS_NewUint32(g_change_ctx, level));
+  JS_SetPropertyStr(g_change_ctx, obj, "time", JS_NewUint32(g_change_ctx, time));
+  if( type == GPIO_EVENT_CLICK || type == GPIO_EVENT_LONG_PRESS )
+    JS_SetPropertyStr(g_change_ctx, obj, "duration", JS_NewUint32(g_change_ctx, duration));
+
+  // the callback may detach its own pin
+  JSValue func = JS_DupValue(g_change_ctx, p_slot->callback);
+  ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(g_change_ctx);
+  JSValue ret = qjs->callJsFunc_with_arg(g_change_ctx, func, func, 1, &obj);
+  JS_FreeValue(g_change_ctx, ret);
+  JS_FreeValue(g_change_ctx, func);
+  JS_FreeValue(g_change_ctx, obj);
+}
+
+static void gpio_change_process(GPIO_CHANGE_SLOT *p_slot, uint8_t level, uint32_t time)
+{
+  uint8_t edge = level ? RISING : FALLING;
+  if( p_slot->edge & edge )
+    gpio_change_notify(p_slot, level ? GPIO_EVENT_RISING : GPIO_EVENT_FALLING, level, time, 0);
+  if( !p_slot->used || !p_slot->classify )
+    return;
+
+  bool pressed = p_slot->active_low ? !level : level;
+  if( pressed ){
+    p_slot->pressed = true;
+    p_slot->press_time = time;
+    p_slot->long_fired = false;
+    return;
+  }
+  if( !p_slot->pressed )
+    return;
+  p_slot->pressed = false;
+  if( p_slot->long_fired )
+    return;
+
+  gpio_change_notify(p_slot, GPIO_EVENT_CLICK, level, time, time - p_slot->press_time);
+  if( !p_slot->used )
+    return;
+  if( p_slot->click_valid && time - p_slot->click_time <= p_slot->double_click ){
+    p_slot->click_valid = false;
+    gpio_change_notify(p_slot, GPIO_EVENT_DOUBLE_CLICK, level, time, 0);
+  }else{
+    p_slot->click_valid = true;
+    p_slot->click_time = time;
+  }
+}
+
+void loopModule_gpio(void)
+{
+  if( g_change_ctx == NULL )
+    return;
+
+  uint32_t now_us = micros();
+  for( int i = 0 ; i < GPIO_CHANGE_MAX_PINS ; i++ ){
+    GPIO_CHANGE_SLOT *p_slot = &g_change_slots[i];
+    if( !p_slot->used )
+      continue;
+    // an edge that settled inside the debounce window never raises another interrupt
+    portENTER_CRITICAL(&g_change_mux);
+    if( now_us - p_slot->isr_time >= p_slot->debounce_us ){
+      uint8_t level = gpio_ll_get_level(&GPIO, (gpio_num_t)p_slot->pin);
+      if( level != p_slot->isr_level && g_change_head - g_change_tail < GPIO_CHANGE_QUEUE_SIZE ){
+        p_slot->isr_level = level;
+        p_slot->isr_time = now_us;
+        GPIO_CHANGE_EDGE *p_edge = &g_change_queue[g_change_head % GPIO_CHANGE_QUEUE_SIZE];
+        p_edge->slot = i;
+        p_edge->level = level;
+        p_edge->time = millis();
+        g_change_head++;
+      }
+    }
+    portEXIT_CRITICAL(&g_change_mux);
+  }
+
+  while( g_change_head != g_change_tail ){
+    GPIO_CHANGE_EDGE edge = g_change_queue[g_change_tail % GPIO_CHANGE_QUEUE_SIZE];
+    __sync_synchronize();
+    g_change_tail++;
+    g_change_edges++;
+    GPIO_CHANGE_SLOT *p_slot = &g_change_slots[edge.slot];
+    if( p_slot->used )
+      gpio_change_process(p_slot, edge.level, edge.time);
+  }
+
+  uint32_t now = millis();
+  for( int i = 0 ; i < GPIO_CHANGE_MAX_PINS ; i++ ){
+    GPIO_CHANGE_SLOT *p_slot = &g_change_slots[i];
+    if( p_slot->used && p_slot->classify && p_slot->pressed && !p_slot->long_fired && now - p_slot->press_time >= p_slot->long_press ){
+      p_slot->long_fired = true;
+      p_slot->click_valid = false;
+      gpio_change_notify(p_slot, GPIO_EVENT_LONG_PRESS, p_slot->isr_level, now, now - p_slot->press_time);
+    }
+  }
+}
+
+// onChange(pin, edge, func[, { debounce, classify, activeLow, longPress, doubleClick }]), func=null detaches
+static JSValue esp32_gpio_on_change(JSContext *ctx, JSValueConst jsThis,
+                                      int argc, JSValueConst *argv)
+{
+  uint32_t pin, edge;
+  JS_ToUint32(ctx, &pin, argv[0]);
+  JS_ToUint32(ctx, &edge, argv[1]);
+  if( !GPIO_IS_VALID_GPIO(pin) )
+    return JS_EXCEPTION;
+
+  GPIO_CHANGE_SLOT *p_slot = NULL;
+  for( int i = 0 ; i < GPIO_CHANGE_MAX_PINS ; i++ ){
+    if( g_change_slots[i].used && g_change_slots[i].pin == pin ){
+      p_slot = &g_change_slots[i];
+      break;
+    }
+  }
+  if( p_slot != NULL )
+    gpio_change_detach(p_slot);
+  if( !JS_IsFunction(ctx, argv[2]) )
+    return JS_UNDEFINED;
+
+  if( p_slot == NULL ){
+    for( int i = 0 ; i < GPIO_CHANGE_MAX_PINS ; i++ ){
+      if( !g_change_slots[i].used ){
+        p_slot = &g_change_slots[i];
+        break;
+      }
+    }
+    if( p_slot == NULL )
+      return JS_EXCEPTION;
+  }
+
+  uint32_t debounce = GPIO_CHANGE_DEFAULT_DEBOUNCE;
+  uint32_t long_press = GPIO_CHANGE_DEFAULT_LONG_PRESS;
+  uint32_t double_click = GPIO_CHANGE_DEFAULT_DOUBLE_CLICK;
+  bool classify = false;
+  bool active_low = true;
+  if( argc >= 4 ){
+    JSValue value;
+    value = JS_GetPropertyStr(ctx, argv[3], "debounce");
+    if( value != JS_UNDEFINED ){
+      JS_ToUint32(ctx, &debounce, value);
+      JS_FreeValue(ctx, value);
+    }
+    value = JS_GetPropertyStr(ctx, argv[3], "longPress");
+    if( value != JS_UNDEFINED ){
+      JS_ToUint32(ctx, &long_press, value);
+      JS_FreeValue(ctx, value);
+    }
+    value = JS_GetPropertyStr(ctx, argv[3], "doubleClick");
+    if( value != JS_UNDEFINED ){
+      JS_ToUint32(ctx, &double_click, value);
+      JS_FreeValue(ctx, value);
+    }
+    value = JS_GetPropertyStr(ctx, argv[3], "classify");
+    if( value != JS_UNDEFINED ){
+      classify = JS_ToBool(ctx, value);
+      JS_FreeValue(ctx, value);
+    }
+    value = JS_GetPropertyStr(ctx, argv[3], "activeLow");
+    if( value != JS_UNDEFINED ){
+      active_low = JS_ToBool(ctx, value);
+      JS_FreeValue(ctx, value);
+    }
+  }
+
+  g_change_ctx = ctx;
+  p_slot->pin = pin;
+  p_slot->edge = edge & CHANGE;
+  p_slot->classify = classify;
+  p_slot->active_low = active_low;
+  p_slot->debounce_us = debounce * 1000;
+  p_slot->long_press = long_press;
+  p_slot->double_click = double_click;
+  p_slot->isr_level = gpio_ll_get_level(&GPIO, (gpio_num_t)pin);
+  p_slot->isr_time = micros() - p_slot->debounce_us;
+  p_slot->pressed = active_low ? !p_slot->isr_level : p_slot->isr_level;
+  p_slot->press_time = millis();
+  p_slot->long_fired = p_slot->pressed; // held at attach time is not a long press
+  p_slot->click_valid = false;
+  p_slot->callback = JS_DupValue(ctx, argv[2]);
+  p_slot->used = true;
+  attachInterruptArg(pin, gpio_change_isr, p_slot, CHANGE);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_gpio_change_status(JSContext *ctx, JSValueConst jsThis,
+                                      int argc, JSValueConst *argv)
+{
+  uint32_t pins = 0;
+  for( int i = 0 ; i < GPIO_CHANGE_MAX_PINS ; i++ ){
+    if( g_change_slots[i].used )
+      pins++;
+  }
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "pins", JS_NewUint32(ctx, pins));
+  JS_SetPropertyStr(ctx, obj, "edges", JS_NewUint32(ctx, g_change_edges));
+  JS_SetPropertyStr(ctx, obj, "queued", JS_NewUint32(ctx, g_change_head - g_change_tail));
+  JS_SetPropertyStr(ctx, obj, "dropped", JS_NewUint32(ctx, g_change_dropped));
+  return obj;
+}
+
 static const JSCFunctionListEntry gpio_funcs[] = {
     JSCFunctionListEntry{"pinMode", 0, JS_DEF_CFUNC, 0, {
                            func : {2, JS_CFUNC_generic, esp32_gpio_mode}
@@ -46,6 +731,30 @@ static const JSCFunctionListEntry gpio_funcs[] = {
         "analogRead", 0, JS_DEF_CFUNC, 0, {
           func : {1, JS_CFUNC_generic, esp32_gpio_analog_read}
         }},
+    JSCFunctionListEntry{
+        "adcContinuousStart", 0, JS_DEF_CFUNC, 0, {
+          func : {2, JS_CFUNC_generic, esp32_gpio_adc_continuous_start}
+        }},
+    JSCFunctionListEntry{
+        "adcContinuousStop", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, esp32_gpio_adc_continuous_stop}
+        }},
+    JSCFunctionListEntry{
+        "adcContinuousRead", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, esp32_gpio_adc_continuous_read}
+        }},
+    JSCFunctionListEntry{
+        "adcContinuousStatus", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, esp32_gpio_adc_continuous_status}
+        }},
+    JSCFunctionListEntry{
+        "onChange", 0, JS_DEF_CFUNC, 0, {
+          func : {4, JS_CFUNC_generic, esp32_gpio_on_change}
+        }},
+    JSCFunctionListEntry{
+        "changeStatus", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, esp32_gpio_change_status}
+        }},
     JSCFunctionListEntry{
         "digitalRead", 0, JS_DEF_CFUNC, 0, {
           func : {1, JS_CFUNC_generic, esp32_gpio_digital_read}
@@ -62,6 +771,30 @@ static const JSCFunctionListEntry gpio_funcs[] = {
         "HIGH", 0, JS_DEF_PROP_INT32, 0, {
           i32 : HIGH
         }},
+    JSCFunctionListEntry{
+        "RISING", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : RISING
+        }},
+    JSCFunctionListEntry{
+        "FALLING", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : FALLING
+        }},
+    JSCFunctionListEntry{
+        "CHANGE", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : CHANGE
+        }},
+    JSCFunctionListEntry{
+        "CLICK", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : GPIO_EVENT_CLICK
+        }},
+    JSCFunctionListEntry{
+        "DOUBLE_CLICK", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : GPIO_EVENT_DOUBLE_CLICK
+        }},
+    JSCFunctionListEntry{
+        "LONG_PRESS", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : GPIO_EVENT_LONG_PRESS
+        }},
     JSCFunctionListEntry{
         "INPUT", 0, JS_DEF_PROP_INT32, 0, {
           i32 : INPUT
@@ -113,10 +846,23 @@ JSModuleDef *addModule_gpio(JSContext *ctx, JSValue global)
   return mod;
 }
 
+void endModule_gpio(void)
+{
+  adc_continuous_stop();
+
+  for( int i = 0 ; i < GPIO_CHANGE_MAX_PINS ; i++ )
+    gpio_change_detach(&g_change_slots[i]);
+  g_change_head = 0;
+  g_change_tail = 0;
+  g_change_dropped = 0;
+  g_change_edges = 0;
+  g_change_ctx = NULL;
+}
+
 JsModuleEntry gpio_module = {
   "Gpio",
   NULL,
   addModule_gpio,
-  NULL,
-  NULL
+  loopModule_gpio,
+  endModule_gpio
 };
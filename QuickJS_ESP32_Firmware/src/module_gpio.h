@@ -3,6 +3,13 @@
 
 #include "module_type.h"
 
+// RISING(1) and FALLING(2) are reported with their Arduino values
+#define GPIO_EVENT_RISING         1
+#define GPIO_EVENT_FALLING        2
+#define GPIO_EVENT_CLICK          4
+#define GPIO_EVENT_DOUBLE_CLICK   5
+#define GPIO_EVENT_LONG_PRESS     6
+
 extern JsModuleEntry gpio_module;
 
 #endif
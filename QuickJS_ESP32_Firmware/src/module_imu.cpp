@@ -5,39 +5,314 @@
 
 #include "quickjs.h"
 #include "module_imu.h"
+#include "module_utils.h"
+#include "module_esp32.h"
+#include "mem_utils.h"
+#include "MadgwickAHRS.h"
+#include <esp_timer.h>
+
+#define IMU_SAMPLING_DEFAULT_RATE     200
+#define IMU_SAMPLING_MAX_RATE         1000
+#define IMU_SAMPLING_DEFAULT_CAPACITY 512 // power of 2
+#define IMU_SAMPLING_TASK_STACK       4096
+#define IMU_SAMPLING_TASK_PRIORITY    3
+#define IMU_SAMPLING_TASK_CORE        0
+
+#define IMU_RECORD_RAW_NUM            6 // ax, ay, az[G], gx, gy, gz[deg/s]
+#define IMU_RECORD_QUAT_NUM           4 // w, x, y, z
+
+typedef struct {
+  uint32_t timestamp; // micros
+  float raw[IMU_RECORD_RAW_NUM];
+  float quat[IMU_RECORD_QUAT_NUM];
+} IMU_RECORD;
+
+static Madgwick g_filter;
+static bool g_fusion = true;
+
+static IMU_RECORD *g_ring = NULL;
+static uint32_t g_ring_capacity = 0;
+static volatile uint32_t g_ring_head = 0;
+static volatile uint32_t g_ring_tail = 0;
+static volatile uint32_t g_dropped = 0;
+static volatile uint32_t g_sample_rate = 0; // achieved, per second
+static volatile float g_quat[IMU_RECORD_QUAT_NUM] = { 1.0f, 0.0f, 0.0f, 0.0f };
+
+static TaskHandle_t g_sampling_task = NULL;
+static esp_timer_handle_t g_sampling_timer = NULL;
+static volatile bool g_sampling_running = false;
+
+static void sampling_timer_callback(void *arg)
+{
+  TaskHandle_t task = g_sampling_task;
+  if( task != NULL )
+    xTaskNotifyGive(task);
+}
+
+static void euler_to_quaternion(float roll, float pitch, float yaw, float *p_quat)
+{
+  float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f);
+  float cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+  float cy = cosf(yaw * 0.5f), sy = sinf(yaw * 0.5f);
+  p_quat[0] = cr * cp * cy + sr * sp * sy;
+  p_quat[1] = sr * cp * cy - cr * sp * sy;
+  p_quat[2] = cr * sp * cy + sr * cp * sy;
+  p_quat[3] = cr * cp * sy - sr * sp * cy;
+}
+
+static void sampling_task(void *arg)
+{
+  uint32_t window_start = millis();
+  uint32_t window_count = 0;
+
+  while( g_sampling_running ){
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    if( !g_sampling_running )
+      break;
+
+    // only count samples the sensor actually produced
+    esp32_internal_bus_lock();
+    bool updated = M5.Imu.update() != 0;
+    m5::IMU_Class::imu_data_t data = M5.Imu.getImuData();
+    esp32_internal_bus_unlock();
+    if( !updated )
+      continue;
+
+    IMU_RECORD record;
+    record.timestamp = micros();
+    record.raw[0] = data.accel.x;
+    record.raw[1] = data.accel.y;
+    record.raw[2] = data.accel.z;
+    record.raw[3] = data.gyro.x;
+    record.raw[4] = data.gyro.y;
+    record.raw[5] = data.gyro.z;
+    if( g_fusion ){
+      g_filter.updateIMU(data.gyro.x, data.gyro.y, data.gyro.z, data.accel.x, data.accel.y, data.accel.z);
+      euler_to_quaternion(g_filter.getRollRadians(), g_filter.getPitchRadians(), g_filter.getYawRadians(), record.quat);
+    }else{
+      record.quat[0] = 1.0f;
+      record.quat[1] = record.quat[2] = record.quat[3] = 0.0f;
+    }
+    for( int i = 0 ; i < IMU_RECORD_QUAT_NUM ; i++ )
+      g_quat[i] = record.quat[i];
+
+    if( g_ring_head - g_ring_tail >= g_ring_capacity ){
+      g_dropped++;
+    }else{
+      g_ring[g_ring_head & (g_ring_capacity - 1)] = record;
+      __sync_synchronize();
+      g_ring_head++;
+    }
+
+    window_count++;
+    uint32_t now = millis();
+    if( now - window_start >= 1000 ){
+      g_sample_rate = window_count * 1000 / (now - window_start);
+      window_start = now;
+      window_count = 0;
+    }
+  }
+
+  g_sampling_task = NULL;
+  vTaskDelete(NULL);
+}
+
+static void stop_sampling(void)
+{
+  if( g_sampling_timer != NULL ){
+    esp_timer_stop(g_sampling_timer);
+    esp_timer_delete(g_sampling_timer);
+    g_sampling_timer = NULL;
+  }
+  if( g_sampling_task != NULL ){
+    g_sampling_running = false;
+    xTaskNotifyGive(g_sampling_task);
+    while( g_sampling_task != NULL )
+      delay(1);
+  }
+  if( g_ring != NULL ){
+    utils_mem_free(g_ring);
+    g_ring = NULL;
+  }
+  g_ring_capacity = 0;
+  g_ring_head = 0;
+  g_ring_tail = 0;
+  g_dropped = 0;
+  g_sample_rate = 0;
+}
 
 static JSValue esp32_imu_getAccel(JSContext *ctx, JSValueConst jsThis,
                                       int argc, JSValueConst *argv)
 {
-  JSValue obj = JS_NewObject(ctx);
   float ax, ay, az;
+  esp32_internal_bus_lock();
   M5.Imu.getAccel(&ax, &ay, &az);
-  JS_SetPropertyStr(ctx, obj, "x", JS_NewFloat64(ctx, ax));
-  JS_SetPropertyStr(ctx, obj, "y", JS_NewFloat64(ctx, ay));
-  JS_SetPropertyStr(ctx, obj, "z", JS_NewFloat64(ctx, az));
-  return obj;
+  esp32_internal_bus_unlock();
+  return create_xyz_object(ctx, JS_NewFloat64(ctx, ax), JS_NewFloat64(ctx, ay), JS_NewFloat64(ctx, az));
 }
 
 static JSValue esp32_imu_getGyro(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
-  JSValue obj = JS_NewObject(ctx);
   float gx, gy, gz;
+  esp32_internal_bus_lock();
   M5.Imu.getGyro(&gx, &gy, &gz);
-  JS_SetPropertyStr(ctx, obj, "x", JS_NewFloat64(ctx, gx));
-  JS_SetPropertyStr(ctx, obj, "y", JS_NewFloat64(ctx, gy));
-  JS_SetPropertyStr(ctx, obj, "z", JS_NewFloat64(ctx, gz));
-  return obj;
+  esp32_internal_bus_unlock();
+  return create_xyz_object(ctx, JS_NewFloat64(ctx, gx), JS_NewFloat64(ctx, gy), JS_NewFloat64(ctx, gz));
 }
 
 static JSValue esp32_imu_getTemp(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
   float t;
+  esp32_internal_bus_lock();
   M5.Imu.getTemp(&t);
+  esp32_internal_bus_unlock();
   return JS_NewFloat64(ctx, t);
 }
 
+static JSValue esp32_imu_startSampling(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  uint32_t rate = IMU_SAMPLING_DEFAULT_RATE;
+  uint32_t capacity = IMU_SAMPLING_DEFAULT_CAPACITY;
+  bool fusion = true;
+  if( argc >= 1 )
+    JS_ToUint32(ctx, &rate, argv[0]);
+  if( argc >= 2 ){
+    JSValue value;
+    value = JS_GetPropertyStr(ctx, argv[1], "capacity");
+    if( value != JS_UNDEFINED ){
+      JS_ToUint32(ctx, &capacity, value);
+      JS_FreeValue(ctx, value);
+    }
+    value = JS_GetPropertyStr(ctx, argv[1], "fusion");
+    if( value != JS_UNDEFINED ){
+      fusion = JS_ToBool(ctx, value);
+      JS_FreeValue(ctx, value);
+    }
+  }
+  if( rate == 0 || rate > IMU_SAMPLING_MAX_RATE )
+    return JS_EXCEPTION;
+  if( capacity < 2 || (capacity & (capacity - 1)) != 0 )
+    return JS_EXCEPTION;
+
+  stop_sampling();
+
+  g_ring = (IMU_RECORD*)utils_mem_alloc(sizeof(IMU_RECORD) * capacity);
+  if( g_ring == NULL )
+    return JS_EXCEPTION;
+  g_ring_capacity = capacity;
+  g_fusion = fusion;
+  g_filter = Madgwick();
+  g_filter.begin(rate);
+
+  g_sampling_running = true;
+  BaseType_t ret = xTaskCreatePinnedToCore(sampling_task, "imu_sampling", IMU_SAMPLING_TASK_STACK, NULL, IMU_SAMPLING_TASK_PRIORITY, &g_sampling_task, IMU_SAMPLING_TASK_CORE);
+  if( ret != pdPASS ){
+    g_sampling_running = false;
+    g_sampling_task = NULL;
+    stop_sampling();
+    return JS_EXCEPTION;
+  }
+
+  esp_timer_create_args_t timer_args = {};
+  timer_args.callback = sampling_timer_callback;
+  timer_args.name = "imu_sampling";
+  if( esp_timer_create(&timer_args, &g_sampling_timer) != ESP_OK ||
+      esp_timer_start_periodic(g_sampling_timer, 1000000 / rate) != ESP_OK ){
+    stop_sampling();
+    return JS_EXCEPTION;
+  }
+
+  return JS_NewBool(ctx, true);
+}
+
+static JSValue esp32_imu_stopSampling(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  stop_sampling();
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_imu_read(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  if( g_ring == NULL )
+    return JS_EXCEPTION;
+
+  uint32_t num = g_ring_head - g_ring_tail;
+  if( argc >= 1 ){
+    uint32_t batch;
+    JS_ToUint32(ctx, &batch, argv[0]);
+    if( batch < num )
+      num = batch;
+  }
+
+  float *p_raw = (float*)malloc(sizeof(float) * IMU_RECORD_RAW_NUM * (num > 0 ? num : 1));
+  float *p_quat = (float*)malloc(sizeof(float) * IMU_RECORD_QUAT_NUM * (num > 0 ? num : 1));
+  if( p_raw == NULL || p_quat == NULL ){
+    if( p_raw != NULL ) free(p_raw);
+    if( p_quat != NULL ) free(p_quat);
+    return JS_EXCEPTION;
+  }
+
+  uint32_t timestamp = 0;
+  for( uint32_t i = 0 ; i < num ; i++ ){
+    const IMU_RECORD *p_record = &g_ring[(g_ring_tail + i) & (g_ring_capacity - 1)];
+    if( i == 0 )
+      timestamp = p_record->timestamp;
+    memmove(&p_raw[i * IMU_RECORD_RAW_NUM], p_record->raw, sizeof(p_record->raw));
+    memmove(&p_quat[i * IMU_RECORD_QUAT_NUM], p_record->quat, sizeof(p_record->quat));
+  }
+  __sync_synchronize();
+  g_ring_tail += num;
+
+  JSValue raw_buffer = JS_NewArrayBuffer(ctx, (uint8_t*)p_raw, sizeof(float) * IMU_RECORD_RAW_NUM * num, my_mem_free, NULL, false);
+  if( JS_IsException(raw_buffer) ){
+    free(p_raw);
+    free(p_quat);
+    return JS_EXCEPTION;
+  }
+  JSValue quat_buffer = JS_NewArrayBuffer(ctx, (uint8_t*)p_quat, sizeof(float) * IMU_RECORD_QUAT_NUM * num, my_mem_free, NULL, false);
+  if( JS_IsException(quat_buffer) ){
+    JS_FreeValue(ctx, raw_buffer);
+    free(p_quat);
+    return JS_EXCEPTION;
+  }
+
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "data", create_TypedArray(ctx, BINDING_CTOR_FLOAT32ARRAY, raw_buffer));
+  JS_SetPropertyStr(ctx, obj, "quaternion", create_TypedArray(ctx, BINDING_CTOR_FLOAT32ARRAY, quat_buffer));
+  JS_FreeValue(ctx, raw_buffer);
+  JS_FreeValue(ctx, quat_buffer);
+  JS_SetPropertyStr(ctx, obj, "count", JS_NewUint32(ctx, num));
+  JS_SetPropertyStr(ctx, obj, "timestamp", JS_NewUint32(ctx, timestamp));
+
+  return obj;
+}
+
+static JSValue esp32_imu_getQuaternion(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  JSValue array = JS_NewArray(ctx);
+  for( int i = 0 ; i < IMU_RECORD_QUAT_NUM ; i++ )
+    JS_SetPropertyUint32(ctx, array, i, JS_NewFloat64(ctx, g_quat[i]));
+  return array;
+}
+
+static JSValue esp32_imu_getSamplingStatus(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "running", JS_NewBool(ctx, g_sampling_task != NULL));
+  JS_SetPropertyStr(ctx, obj, "rate", JS_NewUint32(ctx, g_sample_rate));
+  JS_SetPropertyStr(ctx, obj, "queued", JS_NewUint32(ctx, g_ring_head - g_ring_tail));
+  JS_SetPropertyStr(ctx, obj, "dropped", JS_NewUint32(ctx, g_dropped));
+  return obj;
+}
+
 static const JSCFunctionListEntry imu_funcs[] = {
     JSCFunctionListEntry{
         "getAccel", 0, JS_DEF_CFUNC, 0, {
@@ -51,6 +326,26 @@ static const JSCFunctionListEntry imu_funcs[] = {
         "getTemp", 0, JS_DEF_CFUNC, 0, {
           func : {0, JS_CFUNC_generic, esp32_imu_getTemp}
         }},
+    JSCFunctionListEntry{
+        "startSampling", 0, JS_DEF_CFUNC, 0, {
+          func : {2, JS_CFUNC_generic, esp32_imu_startSampling}
+        }},
+    JSCFunctionListEntry{
+        "stopSampling", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, esp32_imu_stopSampling}
+        }},
+    JSCFunctionListEntry{
+        "read", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic, esp32_imu_read}
+        }},
+    JSCFunctionListEntry{
+        "getQuaternion", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, esp32_imu_getQuaternion}
+        }},
+    JSCFunctionListEntry{
+        "getSamplingStatus", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, esp32_imu_getSamplingStatus}
+        }},
 };
 
 JSModuleDef *addModule_imu(JSContext *ctx, JSValue global)
@@ -70,17 +365,24 @@ JSModuleDef *addModule_imu(JSContext *ctx, JSValue global)
 }
 
 long initialize_imu(void){
+  esp32_internal_bus_lock();
   M5.Imu.begin();
+  esp32_internal_bus_unlock();
 
   return 0;
 }
 
+void endModule_imu(void)
+{
+  stop_sampling();
+}
+
 JsModuleEntry imu_module = {
   "Imu",
   initialize_imu,
   addModule_imu,
   NULL,
-  NULL
+  endModule_imu
 };
 
 #endif
@@ -5,8 +5,12 @@
 #include "module_type.h"
 #include "module_input.h"
 #include "quickjs_esp32.h"
+#include "module_utils.h"
+#include "module_esp32.h"
 
 #include "MyButton.h"
+#include <vector>
+#include <esp_timer.h>
 
 static MyButton *g_BtnX = NULL;
 static MyButton *g_BtnY = NULL;
@@ -138,8 +142,8 @@ static JSValue input_isTouched(JSContext *ctx, JSValueConst jsThis, int argc, JS
   if( M5.Touch.getCount() > 0 ){
     m5::touch_detail_t pos = M5.Touch.getDetail();
     JSValue obj = JS_NewObject(ctx);
-    JS_SetPropertyStr(ctx, obj, "x", JS_NewInt32(ctx, pos.x));
-    JS_SetPropertyStr(ctx, obj, "y", JS_NewInt32(ctx, pos.y));
+    binding_set_property(ctx, obj, BINDING_ATOM_X, JS_NewInt32(ctx, pos.x));
+    binding_set_property(ctx, obj, BINDING_ATOM_Y, JS_NewInt32(ctx, pos.y));
     if( argc > 0 ){
       JSValue value = JS_GetPropertyStr(ctx, argv[0], "length");
       if( value == JS_UNDEFINED ){
@@ -191,7 +195,7 @@ static JSValue input_isTouched(JSContext *ctx, JSValueConst jsThis, int argc, JS
           index++;
         }
       }
-      JS_SetPropertyStr(ctx, obj, "list", list);
+      binding_set_property(ctx, obj, BINDING_ATOM_LIST, list);
     }
     return obj;
   }else{
@@ -213,7 +217,7 @@ static JSValue input_openCustomButton(JSContext *ctx, JSValueConst jsThis, int a
       delete g_BtnX;
     g_BtnX = new MyButton(pin, invert, 10);
   }else if( btn == INPUT_BUTTON_Y ){
-    if( g_BtnX != NULL )
+    if( g_BtnY != NULL )
       delete g_BtnY;
     g_BtnY = new MyButton(pin, invert, 10);
   }else if( btn == INPUT_BUTTON_Z ){
@@ -232,7 +236,7 @@ static JSValue input_closeCustomButton(JSContext *ctx, JSValueConst jsThis, int
   uint32_t btn;
   JS_ToUint32(ctx, &btn, argv[0]);
 
-  if( btn == INPUT_BUTTON_Y ){
+  if( btn == INPUT_BUTTON_X ){
     if( g_BtnX != NULL ){
       delete g_BtnX;
       g_BtnX = NULL;
@@ -254,6 +258,444 @@ static JSValue input_closeCustomButton(JSContext *ctx, JSValueConst jsThis, int
   return JS_UNDEFINED;
 }
 
+#define TOUCH_MAX_POINTS      3
+#define TOUCH_MAX_EVENTS      64
+#define TOUCH_MAX_REGIONS     32
+
+#define TOUCH_DEFAULT_LONG_PRESS  500 // ms
+#define TOUCH_DEFAULT_DOUBLE_TAP  300 // ms
+#define TOUCH_DEFAULT_SLOP        10 // px, a tap may wander this far
+#define TOUCH_DEFAULT_SWIPE       40 // px
+#define TOUCH_DEFAULT_SWIPE_TIME  500 // ms
+#define TOUCH_DEFAULT_MOVE        2 // px between move events
+#define TOUCH_PINCH_STEP          0.05f
+
+#define TOUCH_SAMPLING_PERIOD     10 // ms
+#define TOUCH_TASK_STACK          4096
+#define TOUCH_TASK_PRIORITY       2
+
+typedef struct {
+  uint8_t type;
+  int8_t id;
+  int16_t x;
+  int16_t y;
+  int16_t dx;
+  int16_t dy;
+  float scale;
+  int16_t region;
+  uint32_t time;
+} TOUCH_EVENT;
+
+typedef struct {
+  bool active;
+  int8_t id;
+  uint32_t down_time;
+  int16_t down_x;
+  int16_t down_y;
+  int16_t x;
+  int16_t y;
+  int16_t event_x;
+  int16_t event_y;
+  bool moved;
+  bool long_fired;
+} TOUCH_POINT;
+
+typedef struct {
+  int16_t x;
+  int16_t y;
+  int16_t width;
+  int16_t height;
+} TOUCH_REGION;
+
+static bool g_touch_enabled = false;
+static TOUCH_POINT g_touch_points[TOUCH_MAX_POINTS];
+static std::vector<TOUCH_EVENT> g_touch_events;
+static std::vector<TOUCH_REGION> g_touch_regions;
+static uint32_t g_touch_dropped = 0;
+static bool g_last_tap_valid = false;
+static uint32_t g_last_tap_time = 0;
+static int16_t g_last_tap_x = 0;
+static int16_t g_last_tap_y = 0;
+static float g_pinch_base = 0.0f;
+static float g_pinch_last = 1.0f;
+
+static uint32_t g_touch_long_press = TOUCH_DEFAULT_LONG_PRESS;
+static uint32_t g_touch_double_tap = TOUCH_DEFAULT_DOUBLE_TAP;
+static uint32_t g_touch_slop = TOUCH_DEFAULT_SLOP;
+static uint32_t g_touch_swipe = TOUCH_DEFAULT_SWIPE;
+static uint32_t g_touch_swipe_time = TOUCH_DEFAULT_SWIPE_TIME;
+static uint32_t g_touch_move = TOUCH_DEFAULT_MOVE;
+
+static JSContext *g_touch_ctx = NULL;
+static JSValue g_touch_callback = JS_UNDEFINED;
+
+// the panel is sampled by a task, the loop only drains g_touch_events
+// g_touch_lock guards the points, the events and the regions
+static SemaphoreHandle_t g_touch_lock = NULL;
+static TaskHandle_t g_touch_task = NULL;
+static esp_timer_handle_t g_touch_timer = NULL;
+static volatile bool g_touch_running = false;
+
+static int16_t touch_hit_test(int16_t x, int16_t y)
+{
+  for( int i = 0 ; i < g_touch_regions.size() ; i++ ){
+    TOUCH_REGION *p_region = &g_touch_regions[i];
+    if( x >= p_region->x && x < (p_region->x + p_region->width) && y >= p_region->y && y < (p_region->y + p_region->height) )
+      return i;
+  }
+  return -1;
+}
+
+static void touch_push_event(uint8_t type, int8_t id, int16_t x, int16_t y, uint32_t time)
+{
+  if( g_touch_events.size() >= TOUCH_MAX_EVENTS ){
+    g_touch_events.erase(g_touch_events.begin());
+    g_touch_dropped++;
+  }
+  TOUCH_EVENT event;
+  event.type = type;
+  event.id = id;
+  event.x = x;
+  event.y = y;
+  event.dx = 0;
+  event.dy = 0;
+  event.scale = 1.0f;
+  event.region = touch_hit_test(x, y);
+  event.time = time;
+  g_touch_events.push_back(event);
+}
+
+static uint32_t touch_distance(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
+{
+  int32_t dx = x1 - x0;
+  int32_t dy = y1 - y0;
+  return (uint32_t)sqrtf((float)(dx * dx + dy * dy));
+}
+
+static void touch_release(TOUCH_POINT *p_point, uint32_t now)
+{
+  touch_push_event(TOUCH_EVENT_RELEASE, p_point->id, p_point->x, p_point->y, now);
+
+  if( !p_point->moved && !p_point->long_fired ){
+    // taps are reported where the finger went down
+    touch_push_event(TOUCH_EVENT_TAP, p_point->id, p_point->down_x, p_point->down_y, now);
+    if( g_last_tap_valid && now - g_last_tap_time <= g_touch_double_tap &&
+        touch_distance(g_last_tap_x, g_last_tap_y, p_point->down_x, p_point->down_y) <= g_touch_slop * 2 ){
+      touch_push_event(TOUCH_EVENT_DOUBLE_TAP, p_point->id, p_point->down_x, p_point->down_y, now);
+      g_last_tap_valid = false;
+    }else{
+      g_last_tap_valid = true;
+      g_last_tap_time = now;
+      g_last_tap_x = p_point->down_x;
+      g_last_tap_y = p_point->down_y;
+    }
+  }else if( p_point->moved && now - p_point->down_time <= g_touch_swipe_time &&
+            touch_distance(p_point->down_x, p_point->down_y, p_point->x, p_point->y) >= g_touch_swipe ){
+    touch_push_event(TOUCH_EVENT_SWIPE, p_point->id, p_point->down_x, p_point->down_y, now);
+    g_touch_events.back().dx = p_point->x - p_point->down_x;
+    g_touch_events.back().dy = p_point->y - p_point->down_y;
+  }
+
+  p_point->active = false;
+}
+
+static void touch_sample(const m5::touch_detail_t *p_details, uint8_t count, uint32_t now)
+{
+  bool seen[TOUCH_MAX_POINTS] = { false };
+
+  for( uint8_t i = 0 ; i < count ; i++ ){
+    const m5::touch_detail_t &detail = p_details[i];
+    int index = -1;
+    for( int j = 0 ; j < TOUCH_MAX_POINTS ; j++ ){
+      if( g_touch_points[j].active && g_touch_points[j].id == detail.id ){
+        index = j;
+        break;
+      }
+    }
+    if( index < 0 ){
+      for( int j = 0 ; j < TOUCH_MAX_POINTS ; j++ ){
+        if( !g_touch_points[j].active && !seen[j] ){
+          index = j;
+          break;
+        }
+      }
+      if( index < 0 )
+        continue;
+      TOUCH_POINT *p_point = &g_touch_points[index];
+      memset(p_point, 0, sizeof(TOUCH_POINT));
+      p_point->active = true;
+      p_point->id = detail.id;
+      p_point->down_time = now;
+      p_point->down_x = p_point->x = p_point->event_x = detail.x;
+      p_point->down_y = p_point->y = p_point->event_y = detail.y;
+      touch_push_event(TOUCH_EVENT_PRESS, p_point->id, detail.x, detail.y, now);
+    }
+    seen[index] = true;
+
+    TOUCH_POINT *p_point = &g_touch_points[index];
+    p_point->x = detail.x;
+    p_point->y = detail.y;
+    if( touch_distance(p_point->event_x, p_point->event_y, p_point->x, p_point->y) >= g_touch_move ){
+      touch_push_event(TOUCH_EVENT_MOVE, p_point->id, p_point->x, p_point->y, now);
+      g_touch_events.back().dx = p_point->x - p_point->event_x;
+      g_touch_events.back().dy = p_point->y - p_point->event_y;
+      p_point->event_x = p_point->x;
+      p_point->event_y = p_point->y;
+    }
+    if( !p_point->moved && touch_distance(p_point->down_x, p_point->down_y, p_point->x, p_point->y) > g_touch_slop )
+      p_point->moved = true;
+    if( !p_point->moved && !p_point->long_fired && now - p_point->down_time >= g_touch_long_press ){
+      touch_push_event(TOUCH_EVENT_LONG_PRESS, p_point->id, p_point->down_x, p_point->down_y, now);
+      p_point->long_fired = true;
+    }
+  }
+
+  for( int j = 0 ; j < TOUCH_MAX_POINTS ; j++ ){
+    if( g_touch_points[j].active && !seen[j] )
+      touch_release(&g_touch_points[j], now);
+  }
+
+  // pinch follows the distance between the first two fingers
+  TOUCH_POINT *p_first = NULL, *p_second = NULL;
+  for( int j = 0 ; j < TOUCH_MAX_POINTS ; j++ ){
+    if( !g_touch_points[j].active )
+      continue;
+    if( p_first == NULL ) p_first = &g_touch_points[j];
+    else if( p_second == NULL ) p_second = &g_touch_points[j];
+  }
+  if( p_second == NULL ){
+    g_pinch_base = 0.0f;
+    return;
+  }
+  float distance = (float)touch_distance(p_first->x, p_first->y, p_second->x, p_second->y);
+  if( g_pinch_base <= 0.0f ){
+    g_pinch_base = std::max(distance, 1.0f);
+    g_pinch_last = 1.0f;
+    return;
+  }
+  float scale = distance / g_pinch_base;
+  if( fabsf(scale - g_pinch_last) >= TOUCH_PINCH_STEP ){
+    touch_push_event(TOUCH_EVENT_PINCH, -1, (p_first->x + p_second->x) / 2, (p_first->y + p_second->y) / 2, now);
+    g_touch_events.back().scale = scale;
+    g_pinch_last = scale;
+  }
+}
+
+static void touch_reset(void)
+{
+  xSemaphoreTake(g_touch_lock, portMAX_DELAY);
+  memset(g_touch_points, 0, sizeof(g_touch_points));
+  g_touch_events.clear();
+  g_last_tap_valid = false;
+  g_pinch_base = 0.0f;
+  xSemaphoreGive(g_touch_lock);
+}
+
+static void touch_timer_callback(void *arg)
+{
+  TaskHandle_t task = g_touch_task;
+  if( task != NULL )
+    xTaskNotifyGive(task);
+}
+
+static void touch_task(void *arg)
+{
+  m5::touch_detail_t details[TOUCH_MAX_POINTS];
+
+  while( g_touch_running ){
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    if( !g_touch_running )
+      break;
+
+    // the panel shares the internal bus with the IMU and the RTC
+    esp32_internal_bus_lock();
+    uint32_t now = millis();
+    M5.Touch.update(now);
+    uint8_t count = std::min((uint8_t)M5.Touch.getCount(), (uint8_t)TOUCH_MAX_POINTS);
+    for( uint8_t i = 0 ; i < count ; i++ )
+      details[i] = M5.Touch.getDetail(i);
+    esp32_internal_bus_unlock();
+
+    xSemaphoreTake(g_touch_lock, portMAX_DELAY);
+    touch_sample(details, count, now);
+    xSemaphoreGive(g_touch_lock);
+  }
+
+  g_touch_task = NULL;
+  vTaskDelete(NULL);
+}
+
+static void touch_stop(void)
+{
+  if( g_touch_timer != NULL ){
+    esp_timer_stop(g_touch_timer);
+    esp_timer_delete(g_touch_timer);
+    g_touch_timer = NULL;
+  }
+  if( g_touch_task != NULL ){
+    g_touch_running = false;
+    xTaskNotifyGive(g_touch_task);
+    while( g_touch_task != NULL )
+      delay(1);
+  }
+  g_touch_enabled = false;
+}
+
+static bool touch_start(void)
+{
+  if( g_touch_task != NULL )
+    return true;
+
+  g_touch_running = true;
+  BaseType_t ret = xTaskCreate(touch_task, "touch_sampling", TOUCH_TASK_STACK, NULL, TOUCH_TASK_PRIORITY, &g_touch_task);
+  if( ret != pdPASS ){
+    g_touch_running = false;
+    g_touch_task = NULL;
+    return false;
+  }
+
+  esp_timer_create_args_t timer_args = {};
+  timer_args.callback = touch_timer_callback;
+  timer_args.name = "touch_sampling";
+  if( esp_timer_create(&timer_args, &g_touch_timer) != ESP_OK ||
+      esp_timer_start_periodic(g_touch_timer, TOUCH_SAMPLING_PERIOD * 1000) != ESP_OK ){
+    touch_stop();
+    return false;
+  }
+  g_touch_enabled = true;
+
+  return true;
+}
+
+static JSValue touch_events_to_array(JSContext *ctx)
+{
+  std::vector<TOUCH_EVENT> events;
+  xSemaphoreTake(g_touch_lock, portMAX_DELAY);
+  events.swap(g_touch_events);
+  xSemaphoreGive(g_touch_lock);
+
+  JSValue list = JS_NewArray(ctx);
+  for( int i = 0 ; i < events.size() ; i++ ){
+    TOUCH_EVENT *p_event = &events[i];
+    JSValue obj = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, obj, "type", JS_NewUint32(ctx, p_event->type));
+    JS_SetPropertyStr(ctx, obj, "id", JS_NewInt32(ctx, p_event->id));
+    binding_set_property(ctx, obj, BINDING_ATOM_X, JS_NewInt32(ctx, p_event->x));
+    binding_set_property(ctx, obj, BINDING_ATOM_Y, JS_NewInt32(ctx, p_event->y));
+    JS_SetPropertyStr(ctx, obj, "time", JS_NewUint32(ctx, p_event->time));
+    JS_SetPropertyStr(ctx, obj, "region", JS_NewInt32(ctx, p_event->region));
+    if( p_event->type == TOUCH_EVENT_MOVE || p_event->type == TOUCH_EVENT_SWIPE ){
+      JS_SetPropertyStr(ctx, obj, "dx", JS_NewInt32(ctx, p_event->dx));
+      JS_SetPropertyStr(ctx, obj, "dy", JS_NewInt32(ctx, p_event->dy));
+    }
+    if( p_event->type == TOUCH_EVENT_PINCH )
+      JS_SetPropertyStr(ctx, obj, "scale", JS_NewFloat64(ctx, p_event->scale));
+    JS_SetPropertyUint32(ctx, list, i, obj);
+  }
+  return list;
+}
+
+static void touch_read_option(JSContext *ctx, JSValueConst options, const char *name, uint32_t *p_value)
+{
+  JSValue value = JS_GetPropertyStr(ctx, options, name);
+  if( value != JS_UNDEFINED )
+    JS_ToUint32(ctx, p_value, value);
+  JS_FreeValue(ctx, value);
+}
+
+// setTouchCallback(func[, { longPress, doubleTap, slop, swipe, swipeTime, move }]), null stops the events
+static JSValue input_setTouchCallback(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  if( g_touch_callback != JS_UNDEFINED ){
+    JS_FreeValue(g_touch_ctx, g_touch_callback);
+    g_touch_callback = JS_UNDEFINED;
+  }
+  if( argc >= 2 ){
+    touch_read_option(ctx, argv[1], "longPress", &g_touch_long_press);
+    touch_read_option(ctx, argv[1], "doubleTap", &g_touch_double_tap);
+    touch_read_option(ctx, argv[1], "slop", &g_touch_slop);
+    touch_read_option(ctx, argv[1], "swipe", &g_touch_swipe);
+    touch_read_option(ctx, argv[1], "swipeTime", &g_touch_swipe_time);
+    touch_read_option(ctx, argv[1], "move", &g_touch_move);
+    if( g_touch_move < 1 )
+      g_touch_move = 1;
+  }
+
+  if( JS_IsFunction(ctx, argv[0]) ){
+    if( !touch_start() )
+      return JS_EXCEPTION;
+    g_touch_ctx = ctx;
+    g_touch_callback = JS_DupValue(ctx, argv[0]);
+  }else{
+    touch_stop();
+    touch_reset();
+  }
+
+  return JS_UNDEFINED;
+}
+
+// the first call starts the sampling for scripts that drain the queue themselves
+static JSValue input_getTouchEvents(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  if( !touch_start() )
+    return JS_EXCEPTION;
+  return touch_events_to_array(ctx);
+}
+
+static JSValue input_setTouchRegions(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  std::vector<TOUCH_REGION> regions;
+  if( argc < 1 || JS_IsNull(argv[0]) || JS_IsUndefined(argv[0]) ){
+    xSemaphoreTake(g_touch_lock, portMAX_DELAY);
+    g_touch_regions.clear();
+    xSemaphoreGive(g_touch_lock);
+    return JS_UNDEFINED;
+  }
+
+  uint32_t num_item;
+  JSValue value = JS_GetPropertyStr(ctx, argv[0], "length");
+  if( value == JS_UNDEFINED )
+    return JS_EXCEPTION;
+  JS_ToUint32(ctx, &num_item, value);
+  JS_FreeValue(ctx, value);
+  if( num_item > TOUCH_MAX_REGIONS )
+    return JS_EXCEPTION;
+
+  for( int i = 0 ; i < num_item ; i++ ){
+    JSValue item = JS_GetPropertyUint32(ctx, argv[0], i);
+    int32_t v[4] = { 0 };
+    const char *names[4] = { "x", "y", "width", "height" };
+    for( int j = 0 ; j < 4 ; j++ ){
+      JSValue val = JS_GetPropertyStr(ctx, item, names[j]);
+      JS_ToInt32(ctx, &v[j], val);
+      JS_FreeValue(ctx, val);
+    }
+    JS_FreeValue(ctx, item);
+    TOUCH_REGION region = { (int16_t)v[0], (int16_t)v[1], (int16_t)v[2], (int16_t)v[3] };
+    regions.push_back(region);
+  }
+  xSemaphoreTake(g_touch_lock, portMAX_DELAY);
+  g_touch_regions.swap(regions);
+  xSemaphoreGive(g_touch_lock);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue input_getTouchStats(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  JSValue obj = JS_NewObject(ctx);
+  xSemaphoreTake(g_touch_lock, portMAX_DELAY);
+  uint32_t queued = g_touch_events.size();
+  uint32_t dropped = g_touch_dropped;
+  uint32_t regions = g_touch_regions.size();
+  xSemaphoreGive(g_touch_lock);
+  JS_SetPropertyStr(ctx, obj, "enabled", JS_NewBool(ctx, g_touch_enabled));
+  JS_SetPropertyStr(ctx, obj, "queued", JS_NewUint32(ctx, queued));
+  JS_SetPropertyStr(ctx, obj, "dropped", JS_NewUint32(ctx, dropped));
+  JS_SetPropertyStr(ctx, obj, "regions", JS_NewUint32(ctx, regions));
+  return obj;
+}
+
 static const JSCFunctionListEntry input_funcs[] = {
     JSCFunctionListEntry{"isPressed", 0, JS_DEF_CFUNC, FUNC_TYPE_IS_PRESSED, {
                            func : {1, JS_CFUNC_generic_magic, {generic_magic : input_checkButtonState}}
@@ -288,6 +730,18 @@ static const JSCFunctionListEntry input_funcs[] = {
     JSCFunctionListEntry{"isTouched", 0, JS_DEF_CFUNC, 0, {
                           func : {1, JS_CFUNC_generic, input_isTouched}
                         }},
+    JSCFunctionListEntry{"setTouchCallback", 0, JS_DEF_CFUNC, 0, {
+                          func : {2, JS_CFUNC_generic, input_setTouchCallback}
+                        }},
+    JSCFunctionListEntry{"getTouchEvents", 0, JS_DEF_CFUNC, 0, {
+                          func : {0, JS_CFUNC_generic, input_getTouchEvents}
+                        }},
+    JSCFunctionListEntry{"setTouchRegions", 0, JS_DEF_CFUNC, 0, {
+                          func : {1, JS_CFUNC_generic, input_setTouchRegions}
+                        }},
+    JSCFunctionListEntry{"getTouchStats", 0, JS_DEF_CFUNC, 0, {
+                          func : {0, JS_CFUNC_generic, input_getTouchStats}
+                        }},
     JSCFunctionListEntry{
         "BUTTON_A", 0, JS_DEF_PROP_INT32, 0, {
           i32 : INPUT_BUTTON_A
@@ -316,6 +770,38 @@ static const JSCFunctionListEntry input_funcs[] = {
         "BUTTON_Z", 0, JS_DEF_PROP_INT32, 0, {
           i32 : INPUT_BUTTON_Z
         }},
+    JSCFunctionListEntry{
+        "TOUCH_PRESS", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : TOUCH_EVENT_PRESS
+        }},
+    JSCFunctionListEntry{
+        "TOUCH_RELEASE", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : TOUCH_EVENT_RELEASE
+        }},
+    JSCFunctionListEntry{
+        "TOUCH_MOVE", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : TOUCH_EVENT_MOVE
+        }},
+    JSCFunctionListEntry{
+        "TOUCH_TAP", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : TOUCH_EVENT_TAP
+        }},
+    JSCFunctionListEntry{
+        "TOUCH_DOUBLE_TAP", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : TOUCH_EVENT_DOUBLE_TAP
+        }},
+    JSCFunctionListEntry{
+        "TOUCH_LONG_PRESS", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : TOUCH_EVENT_LONG_PRESS
+        }},
+    JSCFunctionListEntry{
+        "TOUCH_SWIPE", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : TOUCH_EVENT_SWIPE
+        }},
+    JSCFunctionListEntry{
+        "TOUCH_PINCH", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : TOUCH_EVENT_PINCH
+        }},
 };
 
 JSModuleDef *addModule_input(JSContext *ctx, JSValue global)
@@ -349,6 +835,22 @@ void endModule_input(void)
     delete g_BtnZ;
     g_BtnZ = NULL;
   }
+
+  if( g_touch_callback != JS_UNDEFINED ){
+    JS_FreeValue(g_touch_ctx, g_touch_callback);
+    g_touch_callback = JS_UNDEFINED;
+  }
+  g_touch_ctx = NULL;
+  touch_stop();
+  touch_reset();
+  g_touch_regions.clear();
+  g_touch_dropped = 0;
+  g_touch_long_press = TOUCH_DEFAULT_LONG_PRESS;
+  g_touch_double_tap = TOUCH_DEFAULT_DOUBLE_TAP;
+  g_touch_slop = TOUCH_DEFAULT_SLOP;
+  g_touch_swipe = TOUCH_DEFAULT_SWIPE;
+  g_touch_swipe_time = TOUCH_DEFAULT_SWIPE_TIME;
+  g_touch_move = TOUCH_DEFAULT_MOVE;
 }
 
 void loopModule_input(void){
@@ -361,11 +863,33 @@ void loopModule_input(void){
   if( g_BtnZ != NULL ){
     g_BtnZ->read();
   }
+
+  if( !g_touch_enabled || g_touch_callback == JS_UNDEFINED )
+    return;
+  xSemaphoreTake(g_touch_lock, portMAX_DELAY);
+  bool queued = g_touch_events.size() > 0;
+  xSemaphoreGive(g_touch_lock);
+  if( !queued )
+    return;
+
+  // everything since the previous loop goes to the script in one call
+  JSValue list = touch_events_to_array(g_touch_ctx);
+  ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(g_touch_ctx);
+  JSValue ret = qjs->callJsFunc_with_arg(g_touch_ctx, g_touch_callback, g_touch_callback, 1, &list);
+  JS_FreeValue(g_touch_ctx, list);
+  JS_FreeValue(g_touch_ctx, ret);
+}
+
+long initialize_input(void)
+{
+  g_touch_lock = xSemaphoreCreateMutex();
+
+  return 0;
 }
 
 JsModuleEntry input_module = {
   "Input",
-  NULL,
+  initialize_input,
   addModule_input,
   loopModule_input,
   endModule_input
@@ -21,6 +21,15 @@
 #define FUNC_TYPE_WAS_RELEASE_FOR   6
 #define FUNC_TYPE_IS_TOUCHED        7
 
+#define TOUCH_EVENT_PRESS       0
+#define TOUCH_EVENT_RELEASE     1
+#define TOUCH_EVENT_MOVE        2
+#define TOUCH_EVENT_TAP         3
+#define TOUCH_EVENT_DOUBLE_TAP  4
+#define TOUCH_EVENT_LONG_PRESS  5
+#define TOUCH_EVENT_SWIPE       6
+#define TOUCH_EVENT_PINCH       7
+
 extern JsModuleEntry input_module;
 
 bool module_input_checkButtonState(uint8_t type, uint8_t value0, uint32_t value1);
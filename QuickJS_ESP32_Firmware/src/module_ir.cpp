@@ -4,19 +4,197 @@
 #ifdef _IR_ENABLE_
 
 #include "quickjs.h"
+#include "quickjs_esp32.h"
 #include "module_type.h"
 #include "module_utils.h"
+#include "lib_ircodec.h"
 
 #include <IRsend.h>
 #include <IRrecv.h>
 #include <IRutils.h>
+#include <LittleFS.h>
+#include <driver/rmt.h>
+#include <vector>
 
 #define IR_DEFAULT_HZ 38
+#define IR_CARRIER_MIN_KHZ  20 // consumer IR is 30..56kHz
+#define IR_CARRIER_MAX_KHZ  100
+
+#define IR_STORE_DIR          "/ir"
+#define IR_STORE_INDEX_FNAME  "/ir/index.bin"
+#define IR_STORE_NAME_LEN     24
+#define IR_STORE_MAX_DURATIONS  1024
+#define IR_RMT_CHANNEL        RMT_CHANNEL_1
+#define IR_RMT_CLK_DIV        80 // 1us per tick
+#define IR_RMT_MAX_DURATION   32767
+#define IR_RMT_TIMEOUT        1000
 
 static bool g_receiving = false;
 static IRsend *g_irsend = NULL;
 static IRrecv *g_irrecv = NULL;
 static decode_results results;
+static uint8_t g_send_pin = 0xff;
+
+// index entry, the compressed timings live in IR_STORE_DIR/<id>.bin
+typedef struct {
+  uint16_t id;
+  int16_t type; // decode_type_t at capture time, UNKNOWN when not decoded
+  uint16_t bits;
+  uint16_t size; // compressed bytes
+  uint64_t value;
+  char name[IR_STORE_NAME_LEN];
+} IR_STORE_ENTRY;
+static std::vector<IR_STORE_ENTRY> g_store_index;
+static bool g_store_loaded = false;
+
+// last capture, kept for store() without explicit timings
+static std::vector<uint16_t> g_last_raw;
+static int16_t g_last_type = UNKNOWN;
+static uint16_t g_last_bits = 0;
+static uint64_t g_last_value = 0;
+
+static bool g_rmt_installed = false;
+static bool g_rmt_busy = false;
+static uint8_t g_rmt_freq_khz = 0;
+static std::vector<rmt_item32_t> g_rmt_items;
+
+static JSContext *g_ctx = NULL;
+static JSValue g_recv_callback = JS_UNDEFINED;
+
+static void ir_rmt_release(void)
+{
+  if( !g_rmt_installed )
+    return;
+
+  rmt_wait_tx_done(IR_RMT_CHANNEL, pdMS_TO_TICKS(IR_RMT_TIMEOUT));
+  rmt_driver_uninstall(IR_RMT_CHANNEL);
+  g_rmt_installed = false;
+  g_rmt_items.clear();
+  // give the pin back to IRsend's bit-banging
+  if( g_irsend != NULL )
+    g_irsend->begin();
+  if( g_rmt_busy ){
+    g_rmt_busy = false;
+    if( g_receiving )
+      g_irrecv->enableIRIn();
+  }
+}
+
+static long ir_rmt_play(const uint16_t *p_durations, uint32_t num, uint8_t freq_khz)
+{
+  if( g_send_pin == 0xff )
+    return -1;
+  // the carrier divides by the frequency
+  if( freq_khz < IR_CARRIER_MIN_KHZ || freq_khz > IR_CARRIER_MAX_KHZ )
+    return -1;
+
+  if( g_rmt_installed && g_rmt_freq_khz != freq_khz )
+    ir_rmt_release();
+  if( g_rmt_installed ){
+    if( rmt_wait_tx_done(IR_RMT_CHANNEL, pdMS_TO_TICKS(IR_RMT_TIMEOUT)) != ESP_OK )
+      return -1;
+  }else{
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)g_send_pin, IR_RMT_CHANNEL);
+    config.clk_div = IR_RMT_CLK_DIV;
+    config.tx_config.carrier_en = true;
+    config.tx_config.carrier_freq_hz = freq_khz * 1000;
+    config.tx_config.carrier_duty_percent = 33;
+    config.tx_config.carrier_level = RMT_CARRIER_LEVEL_HIGH;
+    config.tx_config.idle_output_en = true;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+    if( rmt_config(&config) != ESP_OK || rmt_driver_install(config.channel, 0, 0) != ESP_OK )
+      return -1;
+    g_rmt_installed = true;
+    g_rmt_freq_khz = freq_khz;
+  }
+
+  // mark/space alternate, durations longer than one RMT half item are split
+  std::vector<rmt_item32_t> &items = g_rmt_items;
+  items.clear();
+  bool half = false;
+  for( uint32_t i = 0 ; i < num ; i++ ){
+    uint32_t level = (i & 1) ? 0 : 1;
+    uint32_t remain = p_durations[i];
+    while( remain > 0 ){
+      uint32_t duration = remain > IR_RMT_MAX_DURATION ? IR_RMT_MAX_DURATION : remain;
+      remain -= duration;
+      if( !half ){
+        rmt_item32_t item;
+        item.val = 0;
+        item.level0 = level;
+        item.duration0 = duration;
+        items.push_back(item);
+      }else{
+        items.back().level1 = level;
+        items.back().duration1 = duration;
+      }
+      half = !half;
+    }
+  }
+  if( half ){
+    items.back().level1 = 0;
+    items.back().duration1 = 0;
+  }else{
+    rmt_item32_t end;
+    end.val = 0;
+    items.push_back(end);
+  }
+
+  if( g_receiving )
+    g_irrecv->disableIRIn();
+  g_rmt_busy = true;
+  // returns right away, the items stay alive in g_rmt_items until the next play
+  if( rmt_write_items(IR_RMT_CHANNEL, items.data(), items.size(), false) != ESP_OK ){
+    ir_rmt_release();
+    return -1;
+  }
+
+  return 0;
+}
+
+static void ir_store_load(void)
+{
+  if( g_store_loaded )
+    return;
+
+  g_store_index.clear();
+  File fp = LittleFS.open(IR_STORE_INDEX_FNAME, FILE_READ);
+  if( fp ){
+    IR_STORE_ENTRY entry;
+    while( fp.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry) )
+      g_store_index.push_back(entry);
+    fp.close();
+  }
+  g_store_loaded = true;
+}
+
+static long ir_store_save_index(void)
+{
+  File fp = LittleFS.open(IR_STORE_INDEX_FNAME, FILE_WRITE);
+  if( !fp )
+    return -1;
+  size_t size = sizeof(IR_STORE_ENTRY) * g_store_index.size();
+  long ret = (size == 0) ? 0 : fp.write((uint8_t*)g_store_index.data(), size);
+  fp.close();
+  if( ret != size )
+    return -1;
+
+  return 0;
+}
+
+static int32_t ir_store_find(uint16_t id)
+{
+  for( uint32_t i = 0 ; i < g_store_index.size() ; i++ ){
+    if( g_store_index[i].id == id )
+      return i;
+  }
+  return -1;
+}
+
+static String ir_store_fname(uint16_t id)
+{
+  return String(IR_STORE_DIR) + "/" + String(id) + ".bin";
+}
 
 static JSValue esp32_ir_sendBegin(JSContext *ctx, JSValueConst jsThis, int argc,
                                JSValueConst *argv)
@@ -24,6 +202,7 @@ static JSValue esp32_ir_sendBegin(JSContext *ctx, JSValueConst jsThis, int argc,
   uint32_t pin;
   JS_ToUint32(ctx, &pin, argv[0]);
 
+  ir_rmt_release();
   if( g_irsend != NULL ){
     delete g_irsend;
     g_irsend = NULL;
@@ -31,6 +210,7 @@ static JSValue esp32_ir_sendBegin(JSContext *ctx, JSValueConst jsThis, int argc,
 
   g_irsend = new IRsend(pin);
   g_irsend->begin();
+  g_send_pin = pin;
 
   return JS_UNDEFINED;
 }
@@ -47,6 +227,7 @@ static JSValue esp32_ir_send(JSContext *ctx, JSValueConst jsThis, int argc,
   if( argc >= 2 )
     JS_ToUint32(ctx, &repeat, argv[1]);
 
+  ir_rmt_release();
   if( g_receiving )
     g_irrecv->disableIRIn();
   g_irsend->sendNEC(data, 32, repeat);
@@ -62,10 +243,37 @@ static JSValue esp32_ir_sendRaw(JSContext *ctx, JSValueConst jsThis, int argc,
   if( g_irsend == NULL )
     return JS_EXCEPTION;
 
+  ir_rmt_release();
+
+  if( JS_IsArray(ctx, argv[0]) ){
+    int32_t *p_array;
+    uint32_t length;
+    if( getNumberArray(ctx, argv[0], &p_array, &length) != 0 )
+      return JS_EXCEPTION;
+    uint16_t *p_buffer = (uint16_t*)malloc(sizeof(uint16_t) * (length > 0 ? length : 1));
+    if( p_buffer == NULL ){
+      free(p_array);
+      return JS_EXCEPTION;
+    }
+    for( uint32_t i = 0 ; i < length ; i++ )
+      p_buffer[i] = (uint16_t)p_array[i];
+    free(p_array);
+
+    if( g_receiving )
+      g_irrecv->disableIRIn();
+    g_irsend->sendRaw(p_buffer, length, IR_DEFAULT_HZ);
+    if( g_receiving )
+      g_irrecv->enableIRIn();
+
+    free(p_buffer);
+    return JS_UNDEFINED;
+  }
+
+  // Uint16Array: send directly from the backing store (byteOffset aware)
   uint16_t *p_buffer;
   uint8_t unit_size;
   uint32_t unit_num;
-  JSValue vbuffer = getTypedArrayBuffer(ctx, argv[0], (void**)&p_buffer, &unit_size, &unit_num);
+  JSValue vbuffer = getBinaryFromTypedArray(ctx, argv[0], (void**)&p_buffer, &unit_size, &unit_num);
   if( JS_IsNull(vbuffer) )
     return JS_EXCEPTION;
   if( unit_size != 2 ){
@@ -75,7 +283,8 @@ static JSValue esp32_ir_sendRaw(JSContext *ctx, JSValueConst jsThis, int argc,
 
   if( g_receiving )
     g_irrecv->disableIRIn();
-  g_irsend->sendRaw(p_buffer, unit_num, IR_DEFAULT_HZ);
+  // unit_num is in bytes
+  g_irsend->sendRaw(p_buffer, unit_num / 2, IR_DEFAULT_HZ);
   if( g_receiving )
     g_irrecv->enableIRIn();
 
@@ -181,6 +390,10 @@ static JSValue esp32_ir_checkRecvRaw(JSContext *ctx, JSValueConst jsThis, int ar
   if( g_irrecv->decode(&results) ){
     uint16_t * result = resultToRawArray(&results);
     uint16_t len = getCorrectedRawLength(&results);
+    g_last_raw.assign(result, result + len);
+    g_last_type = results.decode_type;
+    g_last_bits = results.bits;
+    g_last_value = results.value;
     JSValue array = JS_NewArray(ctx);
     for (uint16_t i = 0; i < len; i++)
       JS_SetPropertyUint32(ctx, array, i, JS_NewInt32(ctx, result[i]));
@@ -193,6 +406,225 @@ static JSValue esp32_ir_checkRecvRaw(JSContext *ctx, JSValueConst jsThis, int ar
   return JS_NULL;
 }
 
+static JSValue esp32_ir_setRecvCallback(JSContext *ctx, JSValueConst jsThis, int argc,
+                               JSValueConst *argv)
+{
+  if( g_recv_callback != JS_UNDEFINED )
+    JS_FreeValue(g_ctx, g_recv_callback);
+  g_recv_callback = JS_UNDEFINED;
+
+  if( argc >= 1 && JS_IsFunction(ctx, argv[0]) ){
+    g_ctx = ctx;
+    g_recv_callback = JS_DupValue(ctx, argv[0]);
+  }
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_ir_store(JSContext *ctx, JSValueConst jsThis, int argc,
+                               JSValueConst *argv)
+{
+  uint32_t id;
+  JS_ToUint32(ctx, &id, argv[0]);
+  if( id > 0xffff )
+    return JS_EXCEPTION;
+
+  IR_STORE_ENTRY entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.id = id;
+  uint8_t freq = IR_DEFAULT_HZ;
+  std::vector<uint16_t> raw;
+  JSValue value = JS_UNDEFINED;
+
+  // store(id, {raw, name, freq}): without raw the last capture is stored with its decode
+  JSValueConst options = (argc >= 2) ? argv[1] : JS_UNDEFINED;
+  JSValue vraw = (options != JS_UNDEFINED) ? JS_GetPropertyStr(ctx, options, "raw") : JS_UNDEFINED;
+  if( vraw != JS_UNDEFINED ){
+    if( JS_IsArray(ctx, vraw) ){
+      int32_t *p_array;
+      uint32_t length;
+      long ret = getNumberArray(ctx, vraw, &p_array, &length);
+      JS_FreeValue(ctx, vraw);
+      if( ret != 0 )
+        return JS_EXCEPTION;
+      for( uint32_t i = 0 ; i < length ; i++ ){
+        if( p_array[i] < 0 || p_array[i] > UINT16_MAX ){
+          free(p_array);
+          return JS_EXCEPTION;
+        }
+      }
+      raw.assign(p_array, p_array + length);
+      free(p_array);
+    }else{
+      uint16_t *p_buffer;
+      uint8_t unit_size;
+      uint32_t unit_num;
+      JSValue vbuffer = getBinaryFromTypedArray(ctx, vraw, (void**)&p_buffer, &unit_size, &unit_num);
+      JS_FreeValue(ctx, vraw);
+      if( JS_IsNull(vbuffer) )
+        return JS_EXCEPTION;
+      if( unit_size != 2 ){
+        JS_FreeValue(ctx, vbuffer);
+        return JS_EXCEPTION;
+      }
+      raw.assign(p_buffer, p_buffer + unit_num / 2);
+      JS_FreeValue(ctx, vbuffer);
+    }
+    entry.type = UNKNOWN;
+  }else{
+    raw = g_last_raw;
+    entry.type = g_last_type;
+    entry.bits = g_last_bits;
+    entry.value = g_last_value;
+  }
+  if( raw.size() == 0 || raw.size() > IR_STORE_MAX_DURATIONS )
+    return JS_EXCEPTION;
+  // a zero-length mark or space plays as its two neighbours merged, not as what was given
+  for( uint16_t duration : raw ){
+    if( duration == 0 )
+      return JS_EXCEPTION;
+  }
+
+  if( options != JS_UNDEFINED ){
+    value = JS_GetPropertyStr(ctx, options, "name");
+    if( value != JS_UNDEFINED ){
+      const char *p_name = JS_ToCString(ctx, value);
+      if( p_name != NULL ){
+        strncpy(entry.name, p_name, IR_STORE_NAME_LEN - 1);
+        JS_FreeCString(ctx, p_name);
+      }
+      JS_FreeValue(ctx, value);
+    }
+    value = JS_GetPropertyStr(ctx, options, "freq");
+    if( value != JS_UNDEFINED ){
+      uint32_t khz;
+      JS_ToUint32(ctx, &khz, value);
+      JS_FreeValue(ctx, value);
+      if( khz < IR_CARRIER_MIN_KHZ || khz > IR_CARRIER_MAX_KHZ )
+        return JS_EXCEPTION;
+      freq = khz;
+    }
+  }
+
+  uint32_t bound = ircodec_encode_bound(raw.size());
+  uint8_t *p_encoded = (uint8_t*)malloc(bound);
+  if( p_encoded == NULL )
+    return JS_EXCEPTION;
+  uint32_t size = ircodec_encode(raw.data(), raw.size(), freq, p_encoded, bound);
+  if( size == 0 ){
+    free(p_encoded);
+    return JS_EXCEPTION;
+  }
+
+  if( !LittleFS.exists(IR_STORE_DIR) )
+    LittleFS.mkdir(IR_STORE_DIR);
+  File fp = LittleFS.open(ir_store_fname(id), FILE_WRITE);
+  if( !fp ){
+    free(p_encoded);
+    return JS_EXCEPTION;
+  }
+  size_t written = fp.write(p_encoded, size);
+  fp.close();
+  free(p_encoded);
+  if( written != size )
+    return JS_EXCEPTION;
+
+  ir_store_load();
+  entry.size = size;
+  int32_t index = ir_store_find(id);
+  if( index >= 0 )
+    g_store_index[index] = entry;
+  else
+    g_store_index.push_back(entry);
+  if( ir_store_save_index() != 0 )
+    return JS_EXCEPTION;
+
+  return JS_NewUint32(ctx, size);
+}
+
+static JSValue esp32_ir_playStored(JSContext *ctx, JSValueConst jsThis, int argc,
+                               JSValueConst *argv)
+{
+  uint32_t id;
+  JS_ToUint32(ctx, &id, argv[0]);
+
+  ir_store_load();
+  int32_t index = ir_store_find(id);
+  if( index < 0 )
+    return JS_EXCEPTION;
+
+  File fp = LittleFS.open(ir_store_fname(id), FILE_READ);
+  if( !fp )
+    return JS_EXCEPTION;
+  uint32_t size = fp.size();
+  uint8_t *p_encoded = (uint8_t*)malloc(size > 0 ? size : 1);
+  if( p_encoded == NULL ){
+    fp.close();
+    return JS_EXCEPTION;
+  }
+  uint32_t read_size = fp.read(p_encoded, size);
+  fp.close();
+
+  uint32_t num = ircodec_decoded_length(p_encoded, read_size);
+  uint16_t *p_durations = (uint16_t*)malloc(sizeof(uint16_t) * (num > 0 ? num : 1));
+  uint8_t freq;
+  long ret = -1;
+  if( p_durations != NULL && read_size == size )
+    ret = ircodec_decode(p_encoded, read_size, p_durations, num, &num, &freq);
+  free(p_encoded);
+  if( ret == 0 )
+    ret = ir_rmt_play(p_durations, num, freq);
+  if( p_durations != NULL )
+    free(p_durations);
+  if( ret != 0 )
+    return JS_EXCEPTION;
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_ir_removeStored(JSContext *ctx, JSValueConst jsThis, int argc,
+                               JSValueConst *argv)
+{
+  uint32_t id;
+  JS_ToUint32(ctx, &id, argv[0]);
+
+  ir_store_load();
+  int32_t index = ir_store_find(id);
+  if( index < 0 )
+    return JS_NewBool(ctx, false);
+
+  LittleFS.remove(ir_store_fname(id));
+  g_store_index.erase(g_store_index.begin() + index);
+  if( ir_store_save_index() != 0 )
+    return JS_EXCEPTION;
+
+  return JS_NewBool(ctx, true);
+}
+
+static JSValue esp32_ir_getStoredList(JSContext *ctx, JSValueConst jsThis, int argc,
+                               JSValueConst *argv)
+{
+  ir_store_load();
+
+  JSValue array = JS_NewArray(ctx);
+  for( uint32_t i = 0 ; i < g_store_index.size() ; i++ ){
+    IR_STORE_ENTRY *p_entry = &g_store_index[i];
+    JSValue obj = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, obj, "id", JS_NewUint32(ctx, p_entry->id));
+    JS_SetPropertyStr(ctx, obj, "name", JS_NewString(ctx, p_entry->name));
+    JS_SetPropertyStr(ctx, obj, "size", JS_NewUint32(ctx, p_entry->size));
+    JS_SetPropertyStr(ctx, obj, "type", JS_NewInt32(ctx, p_entry->type));
+    if( p_entry->type != UNKNOWN ){
+      JS_SetPropertyStr(ctx, obj, "value", JS_NewUint32(ctx, (uint32_t)p_entry->value));
+      JS_SetPropertyStr(ctx, obj, "value_high", JS_NewUint32(ctx, p_entry->value >> 32));
+      JS_SetPropertyStr(ctx, obj, "bits", JS_NewUint32(ctx, p_entry->bits));
+    }
+    JS_SetPropertyUint32(ctx, array, i, obj);
+  }
+
+  return array;
+}
+
 static const JSCFunctionListEntry ir_funcs[] = {
     JSCFunctionListEntry{"sendBegin", 0, JS_DEF_CFUNC, 0, {
                            func : {1, JS_CFUNC_generic, esp32_ir_sendBegin}
@@ -221,6 +653,21 @@ static const JSCFunctionListEntry ir_funcs[] = {
     JSCFunctionListEntry{"checkRecvRaw", 0, JS_DEF_CFUNC, 0, {
                            func : {0, JS_CFUNC_generic, esp32_ir_checkRecvRaw}
                          }},
+    JSCFunctionListEntry{"setRecvCallback", 0, JS_DEF_CFUNC, 0, {
+                           func : {1, JS_CFUNC_generic, esp32_ir_setRecvCallback}
+                         }},
+    JSCFunctionListEntry{"store", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic, esp32_ir_store}
+                         }},
+    JSCFunctionListEntry{"playStored", 0, JS_DEF_CFUNC, 0, {
+                           func : {1, JS_CFUNC_generic, esp32_ir_playStored}
+                         }},
+    JSCFunctionListEntry{"removeStored", 0, JS_DEF_CFUNC, 0, {
+                           func : {1, JS_CFUNC_generic, esp32_ir_removeStored}
+                         }},
+    JSCFunctionListEntry{"getStoredList", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_ir_getStoredList}
+                         }},
     JSCFunctionListEntry{
         "TYPE_NEC", 0, JS_DEF_PROP_INT32, 0, {
           i32 : NEC
@@ -248,7 +695,55 @@ JSModuleDef *addModule_ir(JSContext *ctx, JSValue global)
   return mod;
 }
 
+void loopModule_ir(void)
+{
+  if( g_rmt_busy && rmt_wait_tx_done(IR_RMT_CHANNEL, 0) == ESP_OK ){
+    g_rmt_busy = false;
+    if( g_receiving )
+      g_irrecv->enableIRIn();
+  }
+
+  // with a callback set, decoding happens here instead of checkRecv polling from JS
+  if( g_irrecv == NULL || !g_receiving || g_rmt_busy || g_recv_callback == JS_UNDEFINED )
+    return;
+  if( !g_irrecv->decode(&results) )
+    return;
+
+  uint16_t *p_raw = resultToRawArray(&results);
+  uint16_t len = getCorrectedRawLength(&results);
+  g_last_raw.assign(p_raw, p_raw + len);
+  g_last_type = results.decode_type;
+  g_last_bits = results.bits;
+  g_last_value = results.value;
+  g_irrecv->resume();
+
+  JSValue obj = JS_NewObject(g_ctx);
+  JS_SetPropertyStr(g_ctx, obj, "type", JS_NewInt32(g_ctx, g_last_type));
+  JS_SetPropertyStr(g_ctx, obj, "value", JS_NewUint32(g_ctx, (uint32_t)g_last_value));
+  JS_SetPropertyStr(g_ctx, obj, "value_high", JS_NewUint32(g_ctx, g_last_value >> 32));
+  JS_SetPropertyStr(g_ctx, obj, "bits", JS_NewUint32(g_ctx, g_last_bits));
+  JSValue buffer = JS_NewArrayBufferCopy(g_ctx, (uint8_t*)p_raw, sizeof(uint16_t) * len);
+  JS_SetPropertyStr(g_ctx, obj, "raw", create_TypedArray(g_ctx, BINDING_CTOR_UINT16ARRAY, buffer));
+  JS_FreeValue(g_ctx, buffer);
+  delete[] p_raw;
+
+  ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(g_ctx);
+  JSValue ret = qjs->callJsFunc_with_arg(g_ctx, g_recv_callback, g_recv_callback, 1, &obj);
+  JS_FreeValue(g_ctx, obj);
+  JS_FreeValue(g_ctx, ret);
+}
+
 void endModule_ir(void){
+  ir_rmt_release();
+  if( g_recv_callback != JS_UNDEFINED ){
+    JS_FreeValue(g_ctx, g_recv_callback);
+    g_recv_callback = JS_UNDEFINED;
+  }
+  g_ctx = NULL;
+  g_last_raw.clear();
+  g_last_type = UNKNOWN;
+  g_store_loaded = false;
+  g_store_index.clear();
   if( g_irsend != NULL ){
     delete g_irsend;
     g_irsend = NULL;
@@ -258,13 +753,14 @@ void endModule_ir(void){
     g_irrecv = NULL;
   }
   g_receiving = false;
+  g_send_pin = 0xff;
 }
 
 JsModuleEntry ir_module = {
   "Ir",
   NULL,
   addModule_ir,
-  NULL,
+  loopModule_ir,
   endModule_ir
 };
 
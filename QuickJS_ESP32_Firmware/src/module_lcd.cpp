@@ -8,6 +8,10 @@
 #include "module_utils.h"
 #include "module_type.h"
 #include "module_esp32.h"
+#include "mem_utils.h"
+#include <HTTPClient.h>
+#include <vector>
+#include "lib_textcache.h"
 
 #ifdef _SD_ENABLE_
 #include "module_sd.h"
@@ -18,6 +22,238 @@ static LGFX_Sprite* sprites[NUM_OF_SPRITE];
 
 #define FONT_COLOR TFT_WHITE
 
+// Lcd.submit display list opcodes, followed by their fixed arguments
+#define LCD_OP_PIXEL            1 // x, y, color
+#define LCD_OP_LINE             2 // x0, y0, x1, y1, color
+#define LCD_OP_HLINE            3 // x, y, w, color
+#define LCD_OP_VLINE            4 // x, y, h, color
+#define LCD_OP_RECT             5 // x, y, w, h, color
+#define LCD_OP_FILL_RECT        6 // x, y, w, h, color
+#define LCD_OP_ROUND_RECT       7 // x, y, w, h, r, color
+#define LCD_OP_FILL_ROUND_RECT  8 // x, y, w, h, r, color
+#define LCD_OP_CIRCLE           9 // x, y, r, color
+#define LCD_OP_FILL_CIRCLE      10 // x, y, r, color
+#define LCD_OP_TRIANGLE         11 // x0, y0, x1, y1, x2, y2, color
+#define LCD_OP_FILL_TRIANGLE    12 // x0, y0, x1, y1, x2, y2, color
+#define LCD_OP_FILL_SCREEN      13 // color
+#define LCD_OP_TEXT             14 // string index, x, y
+#define LCD_OP_TEXT_COLOR       15 // fg, bg (-1: transparent)
+#define LCD_OP_TEXT_SIZE        16 // size
+#define LCD_OP_TEXT_DATUM       17 // datum
+#define LCD_OP_FONT             18 // size
+
+static const uint8_t lcd_op_args[] = {
+  0, 3, 5, 4, 4, 5, 5, 6, 6, 4, 4, 7, 7, 1, 3, 2, 1, 1, 1
+};
+
+#define LCD_MAX_DIRTY_RECT  8
+
+typedef struct {
+  int32_t x, y, w, h;
+} LCD_RECT;
+
+// off-screen canvas per display, draw calls go here while it exists
+typedef struct {
+  LGFX_Sprite *sprite;
+  LCD_RECT dirty[LCD_MAX_DIRTY_RECT];
+  uint8_t num_dirty;
+  uint32_t frames;
+  uint32_t time_last; // us
+  uint32_t time_max; // us
+  uint64_t time_total; // us
+  uint32_t bytes_last;
+  uint64_t bytes_total;
+  uint8_t rects_last;
+} LCD_CANVAS;
+
+static LCD_CANVAS g_canvas[2];
+
+static M5GFX& lcd_panel(int magic)
+{
+  if( magic == 1 )
+    return M5.Displays(g_external_display);
+  return M5.Display;
+}
+
+static LovyanGFX& lcd_target(int magic)
+{
+  if( g_canvas[magic].sprite != NULL )
+    return *g_canvas[magic].sprite;
+  return lcd_panel(magic);
+}
+
+static void lcd_damage(int magic, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+  LCD_CANVAS *p_canvas = &g_canvas[magic];
+  if( p_canvas->sprite == NULL )
+    return;
+
+  if( w < 0 ){ x += w + 1; w = -w; }
+  if( h < 0 ){ y += h + 1; h = -h; }
+  int32_t right = std::min(x + w, (int32_t)p_canvas->sprite->width());
+  int32_t bottom = std::min(y + h, (int32_t)p_canvas->sprite->height());
+  x = std::max(x, (int32_t)0);
+  y = std::max(y, (int32_t)0);
+  if( right <= x || bottom <= y )
+    return;
+
+  // merge into an overlapping rect, or into the one that grows least when the list is full
+  int best = -1;
+  int64_t best_growth = INT64_MAX;
+  for( int i = 0 ; i < p_canvas->num_dirty ; i++ ){
+    LCD_RECT *r = &p_canvas->dirty[i];
+    int32_t ux = std::min(r->x, x);
+    int32_t uy = std::min(r->y, y);
+    int32_t uw = std::max(r->x + r->w, right) - ux;
+    int32_t uh = std::max(r->y + r->h, bottom) - uy;
+    bool overlap = x <= r->x + r->w && r->x <= right && y <= r->y + r->h && r->y <= bottom;
+    int64_t growth = (int64_t)uw * uh - (int64_t)r->w * r->h;
+    if( overlap || (p_canvas->num_dirty >= LCD_MAX_DIRTY_RECT && growth < best_growth) ){
+      best = i;
+      best_growth = growth;
+      if( overlap )
+        break;
+    }
+  }
+  if( best < 0 ){
+    LCD_RECT *r = &p_canvas->dirty[p_canvas->num_dirty++];
+    r->x = x; r->y = y; r->w = right - x; r->h = bottom - y;
+    return;
+  }
+  LCD_RECT *r = &p_canvas->dirty[best];
+  int32_t ux = std::min(r->x, x);
+  int32_t uy = std::min(r->y, y);
+  r->w = std::max(r->x + r->w, right) - ux;
+  r->h = std::max(r->y + r->h, bottom) - uy;
+  r->x = ux;
+  r->y = uy;
+}
+
+static void lcd_damage_all(int magic)
+{
+  if( g_canvas[magic].sprite == NULL )
+    return;
+  g_canvas[magic].num_dirty = 0;
+  lcd_damage(magic, 0, 0, g_canvas[magic].sprite->width(), g_canvas[magic].sprite->height());
+}
+
+// conservative box around a string drawn at the datum point
+static void lcd_damage_text(int magic, const char *text, int32_t x, int32_t y)
+{
+  if( g_canvas[magic].sprite == NULL || text == NULL )
+    return;
+  LovyanGFX &gfx = lcd_target(magic);
+  int32_t w = gfx.textWidth(text);
+  int32_t h = gfx.fontHeight();
+  lcd_damage(magic, x - w, y - h, w * 2 + 1, h * 2 + 1);
+}
+
+// text printed at the cursor may wrap, take the whole rows it touched
+static void lcd_damage_rows(int magic, int32_t y_from)
+{
+  if( g_canvas[magic].sprite == NULL )
+    return;
+  LovyanGFX &gfx = lcd_target(magic);
+  int32_t y_to = gfx.getCursorY() + gfx.fontHeight();
+  lcd_damage(magic, 0, std::min(y_from, gfx.getCursorY()), gfx.width(), y_to - std::min(y_from, gfx.getCursorY()));
+}
+
+static void lcd_canvas_copy_state(LovyanGFX &dst, LovyanGFX &src)
+{
+  dst.setFont(src.getFont());
+  dst.setTextStyle(src.getTextStyle());
+  dst.setCursor(src.getCursorX(), src.getCursorY());
+}
+
+static bool lcd_canvas_create(int magic)
+{
+  M5GFX &panel = lcd_panel(magic);
+  LGFX_Sprite *sprite = new LGFX_Sprite(&panel);
+  sprite->setPsram(true);
+  sprite->setColorDepth(16);
+  if( sprite->createSprite(panel.width(), panel.height()) == NULL ){
+    delete sprite;
+    return false;
+  }
+  lcd_canvas_copy_state(*sprite, panel);
+
+  // the canvas starts cleared, the panel keeps its content until the first present
+  LCD_CANVAS *p_canvas = &g_canvas[magic];
+  memset(p_canvas, 0, sizeof(LCD_CANVAS));
+  p_canvas->sprite = sprite;
+
+  return true;
+}
+
+static void lcd_canvas_present(int magic)
+{
+  LCD_CANVAS *p_canvas = &g_canvas[magic];
+  if( p_canvas->sprite == NULL )
+    return;
+
+  uint32_t start = micros();
+  M5GFX &panel = lcd_panel(magic);
+  LGFX_Sprite *sprite = p_canvas->sprite;
+  uint32_t bytes = 0;
+  uint8_t bpp = (panel.getColorDepth() + 7) / 8;
+
+  // only the dirty regions go out, each as a clipped DMA push of the canvas
+  panel.startWrite();
+  for( int i = 0 ; i < p_canvas->num_dirty ; i++ ){
+    LCD_RECT *r = &p_canvas->dirty[i];
+    panel.setClipRect(r->x, r->y, r->w, r->h);
+    panel.pushImageDMA(0, 0, sprite->width(), sprite->height(), (lgfx::swap565_t*)sprite->getBuffer());
+    bytes += r->w * r->h * bpp;
+  }
+  panel.clearClipRect();
+  panel.endWrite();
+
+  uint32_t elapsed = micros() - start;
+  p_canvas->rects_last = p_canvas->num_dirty;
+  p_canvas->num_dirty = 0;
+  p_canvas->frames++;
+  p_canvas->time_last = elapsed;
+  p_canvas->time_total += elapsed;
+  if( elapsed > p_canvas->time_max )
+    p_canvas->time_max = elapsed;
+  p_canvas->bytes_last = bytes;
+  p_canvas->bytes_total += bytes;
+}
+
+static void lcd_canvas_delete(int magic)
+{
+  LCD_CANVAS *p_canvas = &g_canvas[magic];
+  if( p_canvas->sprite == NULL )
+    return;
+
+  lcd_canvas_present(magic);
+  lcd_canvas_copy_state(lcd_panel(magic), *p_canvas->sprite);
+  delete p_canvas->sprite;
+  p_canvas->sprite = NULL;
+}
+
+// the canvas follows the panel size after a rotation
+static void lcd_canvas_resize(int magic)
+{
+  LCD_CANVAS *p_canvas = &g_canvas[magic];
+  if( p_canvas->sprite == NULL )
+    return;
+
+  M5GFX &panel = lcd_panel(magic);
+  if( p_canvas->sprite->width() == panel.width() && p_canvas->sprite->height() == panel.height() )
+    return;
+
+  LCD_CANVAS backup = *p_canvas;
+  lcd_canvas_copy_state(panel, *p_canvas->sprite);
+  delete p_canvas->sprite;
+  p_canvas->sprite = NULL;
+  if( lcd_canvas_create(magic) ){
+    backup.sprite = p_canvas->sprite;
+    *p_canvas = backup;
+    lcd_damage_all(magic);
+  }
+}
+
 static JSValue esp32_lcd_clear(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
 {
   if( magic == 1 && g_external_display == -1 )
@@ -26,16 +262,11 @@ static JSValue esp32_lcd_clear(JSContext *ctx, JSValueConst jsThis, int argc, JS
   if( argc >= 1 ){
     int32_t color;
     JS_ToInt32(ctx, &color, argv[0]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).clear(color);
-    else
-      M5.Display.clear(color);
+    lcd_target(magic).clear(color);
   }else{
-    if( magic == 1 )
-      M5.Displays(g_external_display).clear();
-    else
-      M5.Display.clear();
+    lcd_target(magic).clear();
   }
+  lcd_damage_all(magic);
   return JS_UNDEFINED;
 }
 
@@ -46,10 +277,8 @@ static JSValue esp32_lcd_setRotation(JSContext *ctx, JSValueConst jsThis, int ar
 
   int32_t value;
   JS_ToInt32(ctx, &value, argv[0]);
-  if( magic == 1 )
-    M5.Displays(g_external_display).setRotation(value);
-  else
-    M5.Display.setRotation(value);
+  lcd_panel(magic).setRotation(value);
+  lcd_canvas_resize(magic);
   return JS_UNDEFINED;
 }
 
@@ -60,10 +289,7 @@ static JSValue esp32_lcd_setBrigthness(JSContext *ctx, JSValueConst jsThis, int
 
   uint32_t value;
   JS_ToUint32(ctx, &value, argv[0]);
-  if( magic == 1 )
-    M5.Displays(g_external_display).setBrightness(value);
-  else
-    M5.Display.setBrightness(value);
+  lcd_panel(magic).setBrightness(value);
   return JS_UNDEFINED;
 }
 
@@ -75,17 +301,11 @@ static JSValue esp32_lcd_setTextColor(JSContext *ctx, JSValueConst jsThis, int a
   uint32_t value0, value1;
   if( argc == 1 ){
     JS_ToUint32(ctx, &value0, argv[0]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).setTextColor(value0);
-    else
-      M5.Display.setTextColor(value0);
+    lcd_target(magic).setTextColor(value0);
   }else if( argc == 2 ){
     JS_ToUint32(ctx, &value0, argv[0]);
     JS_ToUint32(ctx, &value1, argv[1]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).setTextColor(value0, value1);
-    else
-      M5.Display.setTextColor(value0, value1);
+    lcd_target(magic).setTextColor(value0, value1);
   }
   return JS_UNDEFINED;
 }
@@ -98,17 +318,11 @@ static JSValue esp32_lcd_setTextSize(JSContext *ctx, JSValueConst jsThis, int ar
   double valueX, valueY;
   if( argc == 1 ){
     JS_ToFloat64(ctx, &valueX, argv[0]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).setTextSize(valueX);
-    else
-      M5.Display.setTextSize(valueX);
+    lcd_target(magic).setTextSize(valueX);
   }else if( argc == 2 ){
     JS_ToFloat64(ctx, &valueX, argv[0]);
     JS_ToFloat64(ctx, &valueY, argv[1]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).setTextSize(valueX, valueY);
-    else
-      M5.Display.setTextSize(valueX, valueY);
+    lcd_target(magic).setTextSize(valueX, valueY);
   }
   return JS_UNDEFINED;
 }
@@ -120,13 +334,576 @@ static JSValue esp32_lcd_setTextDatum(JSContext *ctx, JSValueConst jsThis, int a
 
   uint32_t value;
   JS_ToUint32(ctx, &value, argv[0]);
-  if( magic == 1 )
-    M5.Displays(g_external_display).setTextDatum(value);
-  else
-    M5.Display.setTextDatum(value);
+  lcd_target(magic).setTextDatum(value);
   return JS_UNDEFINED;
 }
 
+enum {
+  LCD_IMAGE_UNKNOWN,
+  LCD_IMAGE_BMP,
+  LCD_IMAGE_JPEG,
+  LCD_IMAGE_PNG,
+};
+
+#define LCD_IMAGE_TIMEOUT   10000
+
+static int lcd_image_type(const uint8_t *p_head)
+{
+  if( p_head[0] == 'B' && p_head[1] == 'M' )
+    return LCD_IMAGE_BMP;
+  if( p_head[0] == 0xff && p_head[1] == 0xd8 )
+    return LCD_IMAGE_JPEG;
+  if( p_head[0] == 0x89 && p_head[1] == 0x50 && p_head[2] == 0x4e && p_head[3] == 0x47 )
+    return LCD_IMAGE_PNG;
+  return LCD_IMAGE_UNKNOWN;
+}
+
+// width and height from the image header, without decoding
+static int lcd_image_size(const uint8_t *p_buffer, uint32_t size, int32_t *p_width, int32_t *p_height)
+{
+  if( size >= 26 && p_buffer[0] == 'B' && p_buffer[1] == 'M' ){
+    *p_width = (int32_t)(p_buffer[18] | (p_buffer[19] << 8) | (p_buffer[20] << 16) | (p_buffer[21] << 24));
+    *p_height = abs((int32_t)(p_buffer[22] | (p_buffer[23] << 8) | (p_buffer[24] << 16) | (p_buffer[25] << 24)));
+    return LCD_IMAGE_BMP;
+  }
+  if( size >= 24 && p_buffer[0] == 0x89 && p_buffer[1] == 0x50 && p_buffer[2] == 0x4e && p_buffer[3] == 0x47 ){
+    *p_width = (p_buffer[16] << 24) | (p_buffer[17] << 16) | (p_buffer[18] << 8) | p_buffer[19];
+    *p_height = (p_buffer[20] << 24) | (p_buffer[21] << 16) | (p_buffer[22] << 8) | p_buffer[23];
+    return LCD_IMAGE_PNG;
+  }
+  if( size >= 4 && p_buffer[0] == 0xff && p_buffer[1] == 0xd8 ){
+    uint32_t i = 2;
+    while( i + 9 < size ){
+      if( p_buffer[i] != 0xff )
+        break;
+      uint8_t marker = p_buffer[i + 1];
+      if( marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc ){
+        *p_height = (p_buffer[i + 5] << 8) | p_buffer[i + 6];
+        *p_width = (p_buffer[i + 7] << 8) | p_buffer[i + 8];
+        return LCD_IMAGE_JPEG;
+      }
+      i += 2 + ((p_buffer[i + 2] << 8) | p_buffer[i + 3]);
+    }
+  }
+  return LCD_IMAGE_UNKNOWN;
+}
+
+// feeds an HTTP or SD stream to the decoders as they ask for data, nothing is buffered here
+class LcdStreamWrapper : public lgfx::DataWrapper
+{
+  public:
+    LcdStreamWrapper(Stream *stream, int32_t length, uint32_t timeout)
+      : _stream(stream), _length(length), _deadline(millis() + timeout) {}
+
+    void setFile(File *file){
+      _file = file;
+      need_transaction = true; // the SD card may share the SPI bus with the panel
+    }
+    void setClient(WiFiClient *client){ _client = client; }
+
+    // the decoder is chosen from the first bytes, which are replayed afterwards
+    int peekType(void){
+      uint8_t head[sizeof(_head)];
+      int len = read(head, sizeof(head));
+      if( len < (int)sizeof(head) )
+        return LCD_IMAGE_UNKNOWN;
+      if( _file != NULL ){
+        seek(0);
+      }else{
+        memcpy(_head, head, sizeof(head));
+        _head_len = sizeof(head);
+        _pos = 0;
+      }
+      return lcd_image_type(head);
+    }
+
+    int read(uint8_t *buf, uint32_t len) override {
+      uint32_t done = 0;
+      while( done < len && _pos < _head_len )
+        buf[done++] = _head[_pos++];
+      while( done < len ){
+        if( _length >= 0 && _pos >= (uint32_t)_length )
+          break;
+        int available = _stream->available();
+        if( available > 0 ){
+          int ret = _stream->read(&buf[done], std::min((uint32_t)available, len - done));
+          if( ret > 0 ){
+            done += ret;
+            _pos += ret;
+            continue;
+          }
+        }else if( _file != NULL || (_client != NULL && !_client->connected()) ){
+          break;
+        }
+        if( (int32_t)(millis() - _deadline) >= 0 ){
+          timedout = true;
+          break;
+        }
+        delay(1);
+      }
+      return done;
+    }
+
+    void skip(int32_t offset) override {
+      if( offset < 0 || _file != NULL ){
+        seek(_pos + offset);
+        return;
+      }
+      uint8_t dummy[64];
+      while( offset > 0 ){
+        int ret = read(dummy, std::min((int32_t)sizeof(dummy), offset));
+        if( ret <= 0 )
+          break;
+        offset -= ret;
+      }
+    }
+
+    bool seek(uint32_t offset) override {
+      if( _file != NULL ){
+        if( !_file->seek(offset) )
+          return false;
+        _pos = offset;
+        return true;
+      }
+      if( offset < _pos ){
+        // only the replayed head can be revisited on a network stream
+        if( _pos > _head_len )
+          return false;
+        _pos = offset;
+        return true;
+      }
+      skip(offset - _pos);
+      return _pos == offset;
+    }
+
+    void close(void) override {}
+    int32_t tell(void) override { return _pos; }
+
+    bool timedout = false;
+
+  private:
+    Stream *_stream;
+    File *_file = NULL;
+    WiFiClient *_client = NULL;
+    int32_t _length;
+    uint32_t _deadline;
+    uint32_t _pos = 0;
+    uint8_t _head[4];
+    uint32_t _head_len = 0;
+};
+
+// drawImageUrl/drawImageFile options: { width, height, offsetX, offsetY, scale, scaleY, datum, timeout, cache }
+typedef struct {
+  int32_t x, y;
+  int32_t width, height;
+  int32_t offset_x, offset_y;
+  float scale_x, scale_y;
+  uint32_t datum;
+  uint32_t timeout;
+  bool cache;
+} LCD_IMAGE_OPTION;
+
+static void lcd_image_option_props(JSContext *ctx, JSValueConst obj, LCD_IMAGE_OPTION *p_option)
+{
+  JSValue value;
+  double f;
+  value = JS_GetPropertyStr(ctx, obj, "width");
+  if( value != JS_UNDEFINED )
+    JS_ToInt32(ctx, &p_option->width, value);
+  value = JS_GetPropertyStr(ctx, obj, "height");
+  if( value != JS_UNDEFINED )
+    JS_ToInt32(ctx, &p_option->height, value);
+  value = JS_GetPropertyStr(ctx, obj, "offsetX");
+  if( value != JS_UNDEFINED )
+    JS_ToInt32(ctx, &p_option->offset_x, value);
+  value = JS_GetPropertyStr(ctx, obj, "offsetY");
+  if( value != JS_UNDEFINED )
+    JS_ToInt32(ctx, &p_option->offset_y, value);
+  value = JS_GetPropertyStr(ctx, obj, "scale");
+  if( value != JS_UNDEFINED ){
+    JS_ToFloat64(ctx, &f, value);
+    p_option->scale_x = f;
+  }
+  value = JS_GetPropertyStr(ctx, obj, "scaleY");
+  if( value != JS_UNDEFINED ){
+    JS_ToFloat64(ctx, &f, value);
+    p_option->scale_y = f;
+  }
+  value = JS_GetPropertyStr(ctx, obj, "datum");
+  if( value != JS_UNDEFINED )
+    JS_ToUint32(ctx, &p_option->datum, value);
+  value = JS_GetPropertyStr(ctx, obj, "timeout");
+  if( value != JS_UNDEFINED )
+    JS_ToUint32(ctx, &p_option->timeout, value);
+  value = JS_GetPropertyStr(ctx, obj, "cache");
+  if( value != JS_UNDEFINED )
+    p_option->cache = JS_ToBool(ctx, value);
+}
+
+static void lcd_image_option(JSContext *ctx, int argc, JSValueConst *argv, LCD_IMAGE_OPTION *p_option)
+{
+  memset(p_option, 0, sizeof(LCD_IMAGE_OPTION));
+  p_option->scale_x = 1.0f;
+  p_option->timeout = LCD_IMAGE_TIMEOUT;
+  p_option->cache = true;
+  if( argc >= 2 )
+    JS_ToInt32(ctx, &p_option->x, argv[1]);
+  if( argc >= 3 )
+    JS_ToInt32(ctx, &p_option->y, argv[2]);
+  if( argc >= 4 )
+    lcd_image_option_props(ctx, argv[3], p_option);
+}
+
+static bool lcd_draw_image_stream(int magic, LcdStreamWrapper *p_wrapper, const LCD_IMAGE_OPTION *p_option)
+{
+  int type = p_wrapper->peekType();
+  if( type == LCD_IMAGE_UNKNOWN )
+    return false;
+
+  LovyanGFX &gfx = lcd_target(magic);
+  int32_t w = p_option->width > 0 ? p_option->width : gfx.width() - p_option->x;
+  int32_t h = p_option->height > 0 ? p_option->height : gfx.height() - p_option->y;
+  lcd_damage(magic, p_option->x, p_option->y, w, h);
+
+  lgfx::datum_t datum = (lgfx::datum_t)p_option->datum;
+  bool ret = false;
+  if( type == LCD_IMAGE_JPEG )
+    ret = gfx.drawJpg(p_wrapper, p_option->x, p_option->y, p_option->width, p_option->height, p_option->offset_x, p_option->offset_y, p_option->scale_x, p_option->scale_y, datum);
+  else if( type == LCD_IMAGE_PNG )
+    ret = gfx.drawPng(p_wrapper, p_option->x, p_option->y, p_option->width, p_option->height, p_option->offset_x, p_option->offset_y, p_option->scale_x, p_option->scale_y, datum);
+  else if( type == LCD_IMAGE_BMP )
+    ret = gfx.drawBmp(p_wrapper, p_option->x, p_option->y, p_option->width, p_option->height, p_option->offset_x, p_option->offset_y, p_option->scale_x, p_option->scale_y, datum);
+
+  return ret && !p_wrapper->timedout;
+}
+
+#define LCD_IMAGE_CACHE_MAX_AGE 60000 // ms before a URL entry is revalidated
+#define LCD_IMAGE_FETCH_MIN     (16 * 1024)
+
+// decoded RGB565 images keyed by source and drawing options, least recently used goes first
+typedef struct {
+  String key;
+  String etag;
+  String last_modified;
+  time_t mtime;
+  uint32_t validated;
+  uint32_t last_used;
+  uint16_t *p_pixels;
+  int32_t width;
+  int32_t height;
+  uint32_t size;
+} LCD_IMAGE_ENTRY;
+
+typedef enum {
+  LCD_FETCH_ERROR,
+  LCD_FETCH_OK,
+  LCD_FETCH_NOT_MODIFIED,
+} LCD_FETCH_RESULT;
+
+static std::vector<LCD_IMAGE_ENTRY*> g_image_cache;
+static uint32_t g_image_cache_budget = 0; // 0: disabled
+static uint32_t g_image_cache_max_age = LCD_IMAGE_CACHE_MAX_AGE;
+static uint32_t g_image_cache_used = 0;
+static uint32_t g_image_cache_tick = 0;
+static uint32_t g_image_cache_hits = 0;
+static uint32_t g_image_cache_misses = 0;
+static uint32_t g_image_cache_evictions = 0;
+static uint32_t g_image_cache_revalidations = 0;
+
+static void lcd_image_entry_free(LCD_IMAGE_ENTRY *p_entry)
+{
+  if( p_entry->p_pixels != NULL )
+    utils_mem_free(p_entry->p_pixels);
+  delete p_entry;
+}
+
+static void lcd_image_cache_remove(int index)
+{
+  LCD_IMAGE_ENTRY *p_entry = g_image_cache[index];
+  g_image_cache_used -= p_entry->size;
+  g_image_cache.erase(g_image_cache.begin() + index);
+  lcd_image_entry_free(p_entry);
+}
+
+static void lcd_image_cache_clear(void)
+{
+  while( g_image_cache.size() > 0 )
+    lcd_image_cache_remove(g_image_cache.size() - 1);
+}
+
+static void lcd_image_cache_trim(uint32_t budget)
+{
+  while( g_image_cache.size() > 0 && g_image_cache_used > budget ){
+    int oldest = 0;
+    for( int i = 1 ; i < g_image_cache.size() ; i++ ){
+      if( g_image_cache[i]->last_used < g_image_cache[oldest]->last_used )
+        oldest = i;
+    }
+    lcd_image_cache_remove(oldest);
+    g_image_cache_evictions++;
+  }
+}
+
+static int lcd_image_cache_find(const String &key)
+{
+  for( int i = 0 ; i < g_image_cache.size() ; i++ ){
+    if( g_image_cache[i]->key == key )
+      return i;
+  }
+  return -1;
+}
+
+static String lcd_image_cache_key(const char *source, const LCD_IMAGE_OPTION *p_option)
+{
+  char params[96];
+  snprintf(params, sizeof(params), "|%d,%d,%d,%d,%g,%g,%u", p_option->width, p_option->height,
+    p_option->offset_x, p_option->offset_y, p_option->scale_x, p_option->scale_y, p_option->datum);
+  return String(source) + params;
+}
+
+// whole body into PSRAM, conditional when the entry has validators
+static LCD_FETCH_RESULT lcd_image_fetch_url(const char *url, const LCD_IMAGE_OPTION *p_option, LCD_IMAGE_ENTRY *p_entry, bool known, uint8_t **pp_buffer, uint32_t *p_size)
+{
+  HTTPClient http;
+  const char *headers[] = { "ETag", "Last-Modified" };
+  http.useHTTP10(true);
+  http.setTimeout(std::min(p_option->timeout, (uint32_t)UINT16_MAX));
+  if( !http.begin(url) )
+    return LCD_FETCH_ERROR;
+  http.collectHeaders(headers, 2);
+  if( known && p_entry->etag.length() > 0 )
+    http.addHeader("If-None-Match", p_entry->etag);
+  if( known && p_entry->last_modified.length() > 0 )
+    http.addHeader("If-Modified-Since", p_entry->last_modified);
+
+  int status = http.GET();
+  if( status == HTTP_CODE_NOT_MODIFIED ){
+    http.end();
+    return LCD_FETCH_NOT_MODIFIED;
+  }
+  if( status != HTTP_CODE_OK ){
+    http.end();
+    return LCD_FETCH_ERROR;
+  }
+
+  WiFiClient *stream = http.getStreamPtr();
+  int32_t length = http.getSize();
+  uint32_t alloclen = length > 0 ? length : LCD_IMAGE_FETCH_MIN;
+  uint8_t *p_buffer = (uint8_t*)utils_mem_alloc(alloclen);
+  if( p_buffer == NULL ){
+    http.end();
+    return LCD_FETCH_ERROR;
+  }
+  LcdStreamWrapper wrapper(stream, length, p_option->timeout);
+  wrapper.setClient(stream);
+  uint32_t size = 0;
+  while( true ){
+    if( size == alloclen ){
+      if( length > 0 )
+        break;
+      uint8_t *p_new = (uint8_t*)utils_mem_alloc(alloclen * 2);
+      if( p_new == NULL ){
+        size = 0;
+        break;
+      }
+      memmove(p_new, p_buffer, size);
+      utils_mem_free(p_buffer);
+      p_buffer = p_new;
+      alloclen *= 2;
+    }
+    int ret = wrapper.read(&p_buffer[size], alloclen - size);
+    if( ret <= 0 )
+      break;
+    size += ret;
+  }
+  p_entry->etag = http.header("ETag");
+  p_entry->last_modified = http.header("Last-Modified");
+  http.end();
+  if( size == 0 || wrapper.timedout || (length > 0 && size != length) ){
+    utils_mem_free(p_buffer);
+    return LCD_FETCH_ERROR;
+  }
+
+  *pp_buffer = p_buffer;
+  *p_size = size;
+  return LCD_FETCH_OK;
+}
+
+#ifdef _SD_ENABLE_
+static LCD_FETCH_RESULT lcd_image_fetch_file(const char *fpath, LCD_IMAGE_ENTRY *p_entry, bool known, uint8_t **pp_buffer, uint32_t *p_size)
+{
+  File file = sd.open(fpath, FILE_READ);
+  if( !file )
+    return LCD_FETCH_ERROR;
+  time_t mtime = file.getLastWrite();
+  if( known && p_entry->mtime == mtime ){
+    file.close();
+    return LCD_FETCH_NOT_MODIFIED;
+  }
+
+  uint32_t size = file.size();
+  uint8_t *p_buffer = (uint8_t*)utils_mem_alloc(size);
+  if( p_buffer == NULL ){
+    file.close();
+    return LCD_FETCH_ERROR;
+  }
+  uint32_t read = file.read(p_buffer, size);
+  file.close();
+  if( size == 0 || read != size ){
+    utils_mem_free(p_buffer);
+    return LCD_FETCH_ERROR;
+  }
+  p_entry->mtime = mtime;
+
+  *pp_buffer = p_buffer;
+  *p_size = size;
+  return LCD_FETCH_OK;
+}
+#endif
+
+static bool lcd_image_decode(LCD_IMAGE_ENTRY *p_entry, const uint8_t *p_buffer, uint32_t size, const LCD_IMAGE_OPTION *p_option)
+{
+  int32_t image_width, image_height;
+  int type = lcd_image_size(p_buffer, size, &image_width, &image_height);
+  if( type == LCD_IMAGE_UNKNOWN )
+    return false;
+
+  float scale_y = p_option->scale_y > 0 ? p_option->scale_y : p_option->scale_x;
+  int32_t width = p_option->width > 0 ? p_option->width : ceil(image_width * p_option->scale_x);
+  int32_t height = p_option->height > 0 ? p_option->height : ceil(image_height * scale_y);
+  if( width <= 0 || height <= 0 )
+    return false;
+
+  uint32_t bytes = width * height * sizeof(uint16_t);
+  uint16_t *p_pixels = (uint16_t*)utils_mem_alloc(bytes);
+  if( p_pixels == NULL )
+    return false;
+  memset(p_pixels, 0, bytes);
+
+  LGFX_Sprite sprite;
+  sprite.setBuffer(p_pixels, width, height, lgfx::rgb565_2Byte);
+  lgfx::datum_t datum = (lgfx::datum_t)p_option->datum;
+  bool ret = false;
+  if( type == LCD_IMAGE_JPEG )
+    ret = sprite.drawJpg(p_buffer, size, 0, 0, width, height, p_option->offset_x, p_option->offset_y, p_option->scale_x, p_option->scale_y, datum);
+  else if( type == LCD_IMAGE_PNG )
+    ret = sprite.drawPng(p_buffer, size, 0, 0, width, height, p_option->offset_x, p_option->offset_y, p_option->scale_x, p_option->scale_y, datum);
+  else if( type == LCD_IMAGE_BMP )
+    ret = sprite.drawBmp(p_buffer, size, 0, 0, width, height, p_option->offset_x, p_option->offset_y, p_option->scale_x, p_option->scale_y, datum);
+  if( !ret ){
+    utils_mem_free(p_pixels);
+    return false;
+  }
+
+  p_entry->p_pixels = p_pixels;
+  p_entry->width = width;
+  p_entry->height = height;
+  p_entry->size = bytes;
+
+  return true;
+}
+
+// returns the entry, valid and decoded, or NULL. *p_temporary is set when it did not fit the budget
+static LCD_IMAGE_ENTRY *lcd_image_cache_load(const char *source, bool is_url, const LCD_IMAGE_OPTION *p_option, bool *p_temporary)
+{
+  String key = lcd_image_cache_key(source, p_option);
+  int index = lcd_image_cache_find(key);
+  LCD_IMAGE_ENTRY *p_entry = (index >= 0) ? g_image_cache[index] : NULL;
+  bool known = (p_entry != NULL);
+  *p_temporary = false;
+
+  uint32_t now = millis();
+  LCD_FETCH_RESULT result;
+  uint8_t *p_buffer = NULL;
+  uint32_t size;
+  if( !known ){
+    p_entry = new LCD_IMAGE_ENTRY();
+    p_entry->key = key;
+    p_entry->p_pixels = NULL;
+    p_entry->size = 0;
+  }
+  if( is_url ){
+    if( known && now - p_entry->validated < g_image_cache_max_age )
+      result = LCD_FETCH_NOT_MODIFIED;
+    else
+      result = lcd_image_fetch_url(source, p_option, p_entry, known, &p_buffer, &size);
+  }else{
+#ifdef _SD_ENABLE_
+    result = lcd_image_fetch_file(source, p_entry, known, &p_buffer, &size);
+#else
+    result = LCD_FETCH_ERROR;
+#endif
+  }
+
+  if( known && (result == LCD_FETCH_NOT_MODIFIED || result == LCD_FETCH_ERROR) ){
+    // a failed revalidation keeps serving the stale image
+    if( result == LCD_FETCH_NOT_MODIFIED && is_url && now - p_entry->validated >= g_image_cache_max_age ){
+      p_entry->validated = now;
+      g_image_cache_revalidations++;
+    }
+    p_entry->last_used = ++g_image_cache_tick;
+    g_image_cache_hits++;
+    return p_entry;
+  }
+  if( result != LCD_FETCH_OK ){
+    lcd_image_entry_free(p_entry);
+    return NULL;
+  }
+
+  g_image_cache_misses++;
+  if( known ){
+    // keep the old bitmap out of the way while the new one is decoded
+    g_image_cache.erase(g_image_cache.begin() + index);
+    g_image_cache_used -= p_entry->size;
+    utils_mem_free(p_entry->p_pixels);
+    p_entry->p_pixels = NULL;
+    p_entry->size = 0;
+  }
+  bool ret = lcd_image_decode(p_entry, p_buffer, size, p_option);
+  utils_mem_free(p_buffer);
+  if( !ret ){
+    lcd_image_entry_free(p_entry);
+    return NULL;
+  }
+  p_entry->validated = now;
+  p_entry->last_used = ++g_image_cache_tick;
+  if( p_entry->size > g_image_cache_budget ){
+    *p_temporary = true;
+    return p_entry;
+  }
+  lcd_image_cache_trim(g_image_cache_budget - p_entry->size);
+  g_image_cache.push_back(p_entry);
+  g_image_cache_used += p_entry->size;
+
+  return p_entry;
+}
+
+static void lcd_image_cache_blit(int magic, LCD_IMAGE_ENTRY *p_entry, const LCD_IMAGE_OPTION *p_option)
+{
+  LovyanGFX &gfx = lcd_target(magic);
+  gfx.startWrite();
+  gfx.pushImageDMA(p_option->x, p_option->y, p_entry->width, p_entry->height, (lgfx::swap565_t*)p_entry->p_pixels);
+  gfx.endWrite();
+  lcd_damage(magic, p_option->x, p_option->y, p_entry->width, p_entry->height);
+}
+
+// cache path of drawImageUrl/drawImageFile, -1 when the cache is not used
+static int lcd_image_cache_draw(int magic, const char *source, bool is_url, const LCD_IMAGE_OPTION *p_option)
+{
+  if( g_image_cache_budget == 0 || !p_option->cache )
+    return -1;
+
+  bool temporary;
+  LCD_IMAGE_ENTRY *p_entry = lcd_image_cache_load(source, is_url, p_option, &temporary);
+  if( p_entry == NULL )
+    return 0;
+  lcd_image_cache_blit(magic, p_entry, p_option);
+  if( temporary )
+    lcd_image_entry_free(p_entry);
+
+  return 1;
+}
+
 #ifdef _SD_ENABLE_
 static JSValue esp32_lcd_draw_image_file(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
 {
@@ -136,37 +913,24 @@ static JSValue esp32_lcd_draw_image_file(JSContext *ctx, JSValueConst jsThis, in
   const char *fpath = JS_ToCString(ctx, argv[0]);
   if( fpath == NULL )
     return JS_EXCEPTION;
-  File file = sd.open(fpath, FILE_READ);
-  if( !file ){
-    JS_FreeCString(ctx, fpath);
-    return JS_EXCEPTION;
-  }
-  uint8_t image_buffer[4];
-  int size = file.read(image_buffer, sizeof(image_buffer));
-  file.close();
-  if( size < sizeof(image_buffer) ){
+
+  LCD_IMAGE_OPTION option;
+  lcd_image_option(ctx, argc, argv, &option);
+  int cached = lcd_image_cache_draw(magic, fpath, false, &option);
+  if( cached >= 0 ){
     JS_FreeCString(ctx, fpath);
-    return JS_EXCEPTION;
+    return JS_NewBool(ctx, cached > 0);
   }
 
-  int32_t x = 0, y = 0;
-  if( argc >= 2 )
-  JS_ToInt32(ctx, &x, argv[1]);
-  if( argc >= 3 )
-  JS_ToInt32(ctx, &y, argv[2]);
-  bool ret = false;
-  if( image_buffer[0] == 0xff && image_buffer[1] == 0xd8 ){
-    if( magic == 1 )
-      ret = M5.Displays(g_external_display).drawJpgFile(sd, fpath, x, y);
-    else
-      ret = M5.Display.drawJpgFile(sd, fpath, x, y);
-  }else if (image_buffer[0] == 0x89 && image_buffer[1] == 0x50 && image_buffer[2] == 0x4e && image_buffer[3] == 0x47 ){
-    if( magic == 1 )
-      ret = M5.Displays(g_external_display).drawPngFile(sd, fpath, x, y);
-    else
-      ret = M5.Display.drawPngFile(sd, fpath, x, y);
-  }
+  File file = sd.open(fpath, FILE_READ);
   JS_FreeCString(ctx, fpath);
+  if( !file )
+    return JS_EXCEPTION;
+
+  LcdStreamWrapper wrapper(&file, file.size(), option.timeout);
+  wrapper.setFile(&file);
+  bool ret = lcd_draw_image_stream(magic, &wrapper, &option);
+  file.close();
 
   return JS_NewBool(ctx, ret);
 }
@@ -180,32 +944,35 @@ static JSValue esp32_lcd_draw_image_url(JSContext *ctx, JSValueConst jsThis, int
   const char *url = JS_ToCString(ctx, argv[0]);
   if( url == NULL )
     return JS_EXCEPTION;
-  
-  uint32_t size;
-  uint8_t *image_buffer = http_get_binary2(url, &size);
-  JS_FreeCString(ctx, url);
-  if( image_buffer == NULL )
-    return JS_EXCEPTION;
 
-  int32_t x = 0, y = 0;
-  if( argc >= 2 )
-    JS_ToInt32(ctx, &x, argv[1]);
-  if( argc >= 3 )
-    JS_ToInt32(ctx, &y, argv[2]);
+  LCD_IMAGE_OPTION option;
+  lcd_image_option(ctx, argc, argv, &option);
+  int cached = lcd_image_cache_draw(magic, url, true, &option);
+  if( cached >= 0 ){
+    JS_FreeCString(ctx, url);
+    return JS_NewBool(ctx, cached > 0);
+  }
 
-  bool ret = false;
-  if( image_buffer[0] == 0xff && image_buffer[1] == 0xd8 ){
-    if( magic == 1 )
-      ret = M5.Displays(g_external_display).drawJpg(image_buffer, size, x, y);
-    else
-      ret = M5.Display.drawJpg(image_buffer, size, x, y);
-  }else if (image_buffer[0] == 0x89 && image_buffer[1] == 0x50 && image_buffer[2] == 0x4e && image_buffer[3] == 0x47 ){
-    if( magic == 1 )
-      ret = M5.Displays(g_external_display).drawPng(image_buffer, size, x, y);
-    else
-      ret = M5.Display.drawPng(image_buffer, size, x, y);
+  HTTPClient http;
+  http.useHTTP10(true); // no chunked encoding, the body is read straight off the socket
+  http.setTimeout(std::min(option.timeout, (uint32_t)UINT16_MAX));
+  if( !http.begin(url) ){
+    JS_FreeCString(ctx, url);
+    return JS_EXCEPTION;
+  }
+  JS_FreeCString(ctx, url);
+  int status = http.GET();
+  if( status != HTTP_CODE_OK ){
+    http.end();
+    return JS_NewBool(ctx, false);
   }
 
+  WiFiClient *stream = http.getStreamPtr();
+  LcdStreamWrapper wrapper(stream, http.getSize(), option.timeout);
+  wrapper.setClient(stream);
+  bool ret = lcd_draw_image_stream(magic, &wrapper, &option);
+  http.end();
+
   return JS_NewBool(ctx, ret);
 }
 
@@ -232,16 +999,11 @@ static JSValue esp32_lcd_draw_image(JSContext *ctx, JSValueConst jsThis, int arg
     JS_ToInt32(ctx, &y, argv[2]);
 
   bool ret = false;
+  lcd_damage(magic, x, y, lcd_target(magic).width() - x, lcd_target(magic).height() - y);
   if( p_buffer[0] == 0xff && p_buffer[1] == 0xd8 ){
-    if( magic == 1 )
-      ret = M5.Displays(g_external_display).drawJpg(p_buffer, unit_num, x, y);
-    else
-      ret = M5.Display.drawJpg(p_buffer, unit_num, x, y);
+    ret = lcd_target(magic).drawJpg(p_buffer, unit_num, x, y);
   }else if (p_buffer[0] == 0x89 && p_buffer[1] == 0x50 && p_buffer[2] == 0x4e && p_buffer[3] == 0x47 ){
-    if( magic == 1 )
-      ret = M5.Displays(g_external_display).drawPng(p_buffer, unit_num, x, y);
-    else
-      ret = M5.Display.drawPng(p_buffer, unit_num, x, y);
+    ret = lcd_target(magic).drawPng(p_buffer, unit_num, x, y);
   }
   JS_FreeValue(ctx, vbuffer);
 
@@ -255,10 +1017,9 @@ static JSValue esp32_lcd_print(JSContext *ctx, JSValueConst jsThis, int argc, JS
 
   const char *text = JS_ToCString(ctx, argv[0]);
   long ret;
-  if( magic == 1 )
-    ret = M5.Displays(g_external_display).print(text);
-  else
-    ret = M5.Display.print(text);
+  int32_t cursor_y = lcd_target(magic).getCursorY();
+  ret = lcd_target(magic).print(text);
+  lcd_damage_rows(magic, cursor_y);
   JS_FreeCString(ctx, text);
   return JS_NewInt32(ctx, ret);
 }
@@ -270,18 +1031,258 @@ static JSValue esp32_lcd_println(JSContext *ctx, JSValueConst jsThis, int argc,
 
   const char *text = JS_ToCString(ctx, argv[0]);
   long ret;
-  if( magic == 1 )
-    ret = M5.Displays(g_external_display).println(text);
-  else
-    ret = M5.Display.println(text);
+  int32_t cursor_y = lcd_target(magic).getCursorY();
+  ret = lcd_target(magic).println(text);
+  lcd_damage_rows(magic, cursor_y);
   JS_FreeCString(ctx, text);
   return JS_NewInt32(ctx, ret);
 }
 
-static JSValue esp32_lcd_drawText(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+#define LCD_GLYPH_CACHE_DEFAULT (32 * 1024) // bytes of glyph masks when not given
+#define LCD_TEXT_RUN_MAX_LEN    128 // bytes of UTF-8, longer strings are drawn directly
+
+// 1bpp glyph mask at text size 1, keyed by font and codepoint
+typedef struct {
+  uint8_t *mask; // rows of (w + 7) / 8 bytes, msb first
+  uint16_t w;
+  uint16_t h;
+} LCD_GLYPH;
+
+// a whole string already rendered with its font, size and colors
+typedef struct {
+  LGFX_Sprite *sprite;
+  bool transparent;
+  uint32_t key_color; // rgb888, fills the background of a transparent run
+} LCD_TEXT_RUN;
+
+static void lcd_glyph_release(void *p_value)
 {
-  if( magic == 1 && g_external_display == -1 )
-    return JS_EXCEPTION;
+  LCD_GLYPH *p_glyph = (LCD_GLYPH*)p_value;
+  if( p_glyph->mask != NULL )
+    utils_mem_free(p_glyph->mask);
+  free(p_glyph);
+}
+
+static void lcd_text_run_release(void *p_value)
+{
+  LCD_TEXT_RUN *p_run = (LCD_TEXT_RUN*)p_value;
+  delete p_run->sprite;
+  free(p_run);
+}
+
+static TextCache<uint64_t> g_glyph_cache(lcd_glyph_release);
+static TextCache<std::string> g_text_run_cache(lcd_text_run_release);
+static LGFX_Sprite *g_glyph_scratch = NULL;
+
+static lgfx::rgb888_t lcd_rgb888(uint32_t color)
+{
+  return lgfx::rgb888_t((color >> 16) & 0xff, (color >> 8) & 0xff, color & 0xff);
+}
+
+static void lcd_text_cache_clear(void)
+{
+  g_text_run_cache.clear();
+  g_glyph_cache.clear();
+  if( g_glyph_scratch != NULL ){
+    delete g_glyph_scratch;
+    g_glyph_scratch = NULL;
+  }
+}
+
+static const LCD_GLYPH *lcd_glyph_get(const lgfx::IFont *font, const char *utf8, int len, uint32_t code)
+{
+  uint64_t key = textcache_glyph_key(font, code);
+  LCD_GLYPH *p_glyph = (LCD_GLYPH*)g_glyph_cache.find(key);
+  if( p_glyph != NULL )
+    return p_glyph;
+
+  char str[5];
+  memmove(str, utf8, len);
+  str[len] = '\0';
+
+  if( g_glyph_scratch == NULL ){
+    g_glyph_scratch = new LGFX_Sprite();
+    g_glyph_scratch->setColorDepth(16);
+  }
+  LGFX_Sprite *scratch = g_glyph_scratch;
+  scratch->setFont(font);
+  scratch->setTextSize(1);
+  int32_t w = scratch->textWidth(str);
+  int32_t h = scratch->fontHeight();
+  if( w < 0 || h <= 0 || w > 0xffff || h > 0xffff )
+    return NULL;
+
+  uint32_t size = 0;
+  uint8_t *mask = NULL;
+  if( w > 0 ){
+    if( scratch->width() < w || scratch->height() < h ){
+      int32_t sw = std::max(w, (int32_t)scratch->width());
+      int32_t sh = std::max(h, (int32_t)scratch->height());
+      scratch->deleteSprite();
+      if( scratch->createSprite(sw, sh) == NULL )
+        return NULL;
+      scratch->setFont(font);
+      scratch->setTextSize(1);
+    }
+    scratch->fillScreen(TFT_BLACK);
+    scratch->setTextColor(TFT_WHITE);
+    scratch->setTextDatum(lgfx::top_left);
+    scratch->drawString(str, 0, 0);
+
+    uint32_t stride = (w + 7) / 8;
+    size = stride * h;
+    mask = (uint8_t*)utils_mem_alloc(size);
+    if( mask == NULL )
+      return NULL;
+    memset(mask, 0, size);
+    for( int32_t y = 0 ; y < h ; y++ ){
+      for( int32_t x = 0 ; x < w ; x++ ){
+        if( scratch->readPixel(x, y) != 0 )
+          mask[y * stride + x / 8] |= 0x80 >> (x & 7);
+      }
+    }
+  }
+
+  p_glyph = (LCD_GLYPH*)malloc(sizeof(LCD_GLYPH));
+  if( p_glyph == NULL ){
+    if( mask != NULL )
+      utils_mem_free(mask);
+    return NULL;
+  }
+  p_glyph->mask = mask;
+  p_glyph->w = w;
+  p_glyph->h = h;
+  if( !g_glyph_cache.insert(key, p_glyph, size) ){
+    lcd_glyph_release(p_glyph);
+    return NULL;
+  }
+  return p_glyph;
+}
+
+// builds the run from cached glyph masks, false when a glyph is not available
+static bool lcd_text_run_compose(LGFX_Sprite *sprite, const lgfx::IFont *font, const char *text, int32_t sx, int32_t sy, uint32_t fore)
+{
+  lgfx::rgb888_t color = lcd_rgb888(fore);
+  int32_t pen = 0;
+  for( const char *p = text ; *p != '\0' ; ){
+    uint32_t code;
+    int len = textcache_utf8_next(p, &code);
+    if( len == 0 )
+      return false;
+    const LCD_GLYPH *p_glyph = lcd_glyph_get(font, p, len, code);
+    if( p_glyph == NULL )
+      return false;
+    p += len;
+
+    uint32_t stride = (p_glyph->w + 7) / 8;
+    for( int32_t y = 0 ; y < p_glyph->h ; y++ ){
+      const uint8_t *row = &p_glyph->mask[y * stride];
+      int32_t x = 0;
+      while( x < p_glyph->w ){
+        if( !(row[x / 8] & (0x80 >> (x & 7))) ){
+          x++;
+          continue;
+        }
+        int32_t start = x;
+        while( x < p_glyph->w && (row[x / 8] & (0x80 >> (x & 7))) )
+          x++;
+        sprite->fillRect(pen + start * sx, y * sy, (x - start) * sx, sy, color);
+      }
+    }
+    pen += p_glyph->w * sx;
+  }
+  return true;
+}
+
+static LCD_TEXT_RUN *lcd_text_run_get(LovyanGFX &gfx, const char *text)
+{
+  const lgfx::TextStyle &style = gfx.getTextStyle();
+  const lgfx::IFont *font = gfx.getFont();
+  bool transparent = (style.fore_rgb888 == style.back_rgb888);
+
+  std::string key = textcache_run_key(font, style.size_x, style.size_y, style.fore_rgb888, style.back_rgb888, transparent, text);
+  LCD_TEXT_RUN *p_run = (LCD_TEXT_RUN*)g_text_run_cache.find(key);
+  if( p_run != NULL )
+    return p_run;
+
+  int32_t w = gfx.textWidth(text);
+  int32_t h = gfx.fontHeight();
+  if( w <= 0 || h <= 0 )
+    return NULL;
+  uint32_t size = w * h * 2;
+  if( size > g_text_run_cache.budget() )
+    return NULL;
+
+  p_run = (LCD_TEXT_RUN*)malloc(sizeof(LCD_TEXT_RUN));
+  if( p_run == NULL )
+    return NULL;
+  p_run->transparent = transparent;
+  p_run->key_color = transparent ? (style.fore_rgb888 ^ 0xffffff) : style.back_rgb888;
+  p_run->sprite = new LGFX_Sprite();
+  p_run->sprite->setPsram(true);
+  p_run->sprite->setColorDepth(16);
+  if( p_run->sprite->createSprite(w, h) == NULL ){
+    lcd_text_run_release(p_run);
+    return NULL;
+  }
+  p_run->sprite->fillScreen(lcd_rgb888(p_run->key_color));
+
+  // integer sizes are composed from glyph masks, anything else is rasterized once here
+  int32_t sx = (int32_t)style.size_x;
+  int32_t sy = (int32_t)style.size_y;
+  bool composed = false;
+  if( g_glyph_cache.budget() > 0 && sx >= 1 && sy >= 1 && sx == style.size_x && sy == style.size_y )
+    composed = lcd_text_run_compose(p_run->sprite, font, text, sx, sy, style.fore_rgb888);
+  if( !composed ){
+    p_run->sprite->fillScreen(lcd_rgb888(p_run->key_color));
+    p_run->sprite->setFont(font);
+    p_run->sprite->setTextSize(style.size_x, style.size_y);
+    p_run->sprite->setTextDatum(lgfx::top_left);
+    if( transparent )
+      p_run->sprite->setTextColor(lcd_rgb888(style.fore_rgb888));
+    else
+      p_run->sprite->setTextColor(lcd_rgb888(style.fore_rgb888), lcd_rgb888(style.back_rgb888));
+    p_run->sprite->drawString(text, 0, 0);
+  }
+
+  if( !g_text_run_cache.insert(key, p_run, size) ){
+    lcd_text_run_release(p_run);
+    return NULL;
+  }
+  return p_run;
+}
+
+// drawString through the text run cache, same placement for the non-baseline datums
+static int32_t lcd_draw_string(LovyanGFX &gfx, const char *text, int32_t x, int32_t y)
+{
+  if( g_text_run_cache.budget() == 0 || text == NULL )
+    return gfx.drawString(text, x, y);
+  uint8_t datum = gfx.getTextDatum();
+  if( datum >= lgfx::baseline_left || !textcache_cacheable(text, LCD_TEXT_RUN_MAX_LEN) )
+    return gfx.drawString(text, x, y);
+
+  LCD_TEXT_RUN *p_run = lcd_text_run_get(gfx, text);
+  if( p_run == NULL )
+    return gfx.drawString(text, x, y);
+
+  int32_t w = p_run->sprite->width();
+  int32_t h = p_run->sprite->height();
+  if( (datum & 3) == 1 ) x -= w >> 1;
+  else if( (datum & 3) == 2 ) x -= w;
+  if( datum & 4 ) y -= h >> 1;
+  else if( datum & 8 ) y -= h;
+  if( p_run->transparent )
+    p_run->sprite->pushSprite(&gfx, x, y, lcd_rgb888(p_run->key_color));
+  else
+    p_run->sprite->pushSprite(&gfx, x, y);
+
+  return w;
+}
+
+static JSValue esp32_lcd_drawText(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return JS_EXCEPTION;
 
   const char *text = JS_ToCString(ctx, argv[0]);
   int32_t x, y;
@@ -289,10 +1290,8 @@ static JSValue esp32_lcd_drawText(JSContext *ctx, JSValueConst jsThis, int argc,
   JS_ToInt32(ctx, &y, argv[2]);
 
   long ret;
-  if( magic == 1 )
-    ret = M5.Displays(g_external_display).drawString(text, x, y);
-  else
-    ret = M5.Display.drawString(text, x, y);
+  ret = lcd_draw_string(lcd_target(magic), text, x, y);
+  lcd_damage_text(magic, text, x, y);
   JS_FreeCString(ctx, text);
 
   return JS_NewInt32(ctx, ret);
@@ -332,30 +1331,18 @@ static JSValue esp32_lcd_drawAlignedText(JSContext *ctx, JSValueConst jsThis, in
     }
     JS_FreeValue(ctx, item);
 
-    long ret;
-    if( magic == 1 ){
-      uint32_t backup_align = M5.Displays(g_external_display).getTextDatum();
-      float backup_textsizeX = M5.Displays(g_external_display).getTextSizeX();
-      float backup_textsizeY = M5.Displays(g_external_display).getTextSizeY();
-
-      M5.Displays(g_external_display).setTextDatum(align);
-      M5.Displays(g_external_display).setTextSize(scale);
-      ret = M5.Displays(g_external_display).drawString(text, base_x, base_y);
-
-      M5.Displays(g_external_display).setTextDatum(backup_align);
-      M5.Displays(g_external_display).setTextSize(backup_textsizeX, backup_textsizeY);
-    }else{
-      uint32_t backup_align = M5.Display.getTextDatum();
-      float backup_textsizeX = M5.Display.getTextSizeX();
-      float backup_textsizeY = M5.Display.getTextSizeY();
-
-      M5.Display.setTextDatum(align);
-      M5.Display.setTextSize(scale);
-      ret = M5.Display.drawString(text, base_x, base_y);
-
-      M5.Display.setTextDatum(backup_align);
-      M5.Display.setTextSize(backup_textsizeX, backup_textsizeY);
-    }
+    LovyanGFX &gfx = lcd_target(magic);
+    uint32_t backup_align = gfx.getTextDatum();
+    float backup_textsizeX = gfx.getTextSizeX();
+    float backup_textsizeY = gfx.getTextSizeY();
+
+    gfx.setTextDatum(align);
+    gfx.setTextSize(scale);
+    lcd_draw_string(gfx, text, base_x, base_y);
+    lcd_damage_text(magic, text, base_x, base_y);
+
+    gfx.setTextDatum(backup_align);
+    gfx.setTextSize(backup_textsizeX, backup_textsizeY);
     JS_FreeCString(ctx, text);
   }
   
@@ -364,7 +1351,7 @@ static JSValue esp32_lcd_drawAlignedText(JSContext *ctx, JSValueConst jsThis, in
 
 long module_lcd_setFont(uint16_t size, int magic)
 {
-  M5GFX &gfx = (magic == 1) ? M5.Displays(g_external_display) : M5.Display;
+  LovyanGFX &gfx = lcd_target(magic);
   switch (size){
 //    case 8 : gfx.setFont(&fonts::lgfxJapanGothic_8); break;
 //    case 12 : gfx.setFont(&fonts::lgfxJapanGothic_12); break;
@@ -408,6 +1395,14 @@ long module_lcd_setFont(uint16_t size, int magic)
   return 0;
 }
 
+LovyanGFX* module_lcd_getSurface(int magic)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return NULL;
+
+  return &lcd_target(magic);
+}
+
 static JSValue esp32_lcd_setFont(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
 {
   if( magic == 1 && g_external_display == -1 )
@@ -428,10 +1423,7 @@ static JSValue esp32_lcd_setCursor(JSContext *ctx, JSValueConst jsThis, int argc
   int32_t value1;
   JS_ToInt32(ctx, &value0, argv[0]);
   JS_ToInt32(ctx, &value1, argv[1]);
-  if( magic == 1 )
-    M5.Displays(g_external_display).setCursor(value0, value1);
-  else
-    M5.Display.setCursor(value0, value1);
+  lcd_target(magic).setCursor(value0, value1);
   return JS_UNDEFINED;
 }
 
@@ -441,13 +1433,8 @@ static JSValue esp32_lcd_getCursor(JSContext *ctx, JSValueConst jsThis, int argc
     return JS_EXCEPTION;
 
   JSValue obj = JS_NewObject(ctx);
-  if( magic == 1 ){
-    JS_SetPropertyStr(ctx, obj, "x", JS_NewInt32(ctx, M5.Displays(g_external_display).getCursorX()));
-    JS_SetPropertyStr(ctx, obj, "y", JS_NewInt32(ctx, M5.Displays(g_external_display).getCursorY()));
-  }else{
-    JS_SetPropertyStr(ctx, obj, "x", JS_NewInt32(ctx, M5.Display.getCursorX()));
-    JS_SetPropertyStr(ctx, obj, "y", JS_NewInt32(ctx, M5.Display.getCursorY()));
-  }
+  binding_set_property(ctx, obj, BINDING_ATOM_X, JS_NewInt32(ctx, lcd_target(magic).getCursorX()));
+  binding_set_property(ctx, obj, BINDING_ATOM_Y, JS_NewInt32(ctx, lcd_target(magic).getCursorY()));
   return obj;
 }
 
@@ -458,10 +1445,7 @@ static JSValue esp32_lcd_textWidth(JSContext *ctx, JSValueConst jsThis, int argc
 
   const char *text = JS_ToCString(ctx, argv[0]);
   int32_t width;
-  if( magic == 1 )
-    width = M5.Displays(g_external_display).textWidth(text);
-  else
-    width = M5.Display.textWidth(text);
+  width = lcd_target(magic).textWidth(text);
   JS_FreeCString(ctx, text);
   return JS_NewInt32(ctx, width);
 }
@@ -477,10 +1461,8 @@ static JSValue esp32_lcd_drawPixel(JSContext *ctx, JSValueConst jsThis, int argc
   JS_ToInt32(ctx, &value0, argv[0]);
   JS_ToInt32(ctx, &value1, argv[1]);
   JS_ToUint32(ctx, &value2, argv[2]);
-  if( magic == 1 )
-    M5.Displays(g_external_display).drawPixel(value0, value1, value2);
-  else
-    M5.Display.drawPixel(value0, value1, value2);
+  lcd_target(magic).drawPixel(value0, value1, value2);
+  lcd_damage(magic, value0, value1, 1, 1);
   return JS_UNDEFINED;
 }
 
@@ -500,16 +1482,11 @@ static JSValue esp32_lcd_drawLine(JSContext *ctx, JSValueConst jsThis, int argc,
   if(argc >= 5){
     uint32_t value4;
     JS_ToUint32(ctx, &value4, argv[4]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).drawLine(value0, value1, value2, value3, value4);
-    else
-      M5.Display.drawLine(value0, value1, value2, value3, value4);
+    lcd_target(magic).drawLine(value0, value1, value2, value3, value4);
   }else{
-    if( magic == 1 )
-      M5.Displays(g_external_display).drawLine(value0, value1, value2, value3);
-    else
-      M5.Display.drawLine(value0, value1, value2, value3);
+    lcd_target(magic).drawLine(value0, value1, value2, value3);
   }
+  lcd_damage(magic, std::min(value0, value2), std::min(value1, value3), abs(value2 - value0) + 1, abs(value3 - value1) + 1);
   return JS_UNDEFINED;
 }
 
@@ -527,16 +1504,11 @@ static JSValue esp32_lcd_drawCircle(JSContext *ctx, JSValueConst jsThis, int arg
   if(argc >= 4){
     uint32_t value3;
     JS_ToUint32(ctx, &value3, argv[3]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).drawCircle(value0, value1, value2, value3);
-    else
-      M5.Display.drawCircle(value0, value1, value2, value3);
+    lcd_target(magic).drawCircle(value0, value1, value2, value3);
   }else{
-    if( magic == 1 )
-      M5.Displays(g_external_display).drawCircle(value0, value1, value2);
-    else
-      M5.Display.drawCircle(value0, value1, value2);
+    lcd_target(magic).drawCircle(value0, value1, value2);
   }
+  lcd_damage(magic, value0 - value2, value1 - value2, value2 * 2 + 1, value2 * 2 + 1);
   return JS_UNDEFINED;
 }
 
@@ -554,16 +1526,11 @@ static JSValue esp32_lcd_fillCircle(JSContext *ctx, JSValueConst jsThis, int arg
   if(argc >= 4){
     uint32_t value3;
     JS_ToUint32(ctx, &value3, argv[3]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).fillCircle(value0, value1, value2, value3);
-    else
-      M5.Display.fillCircle(value0, value1, value2, value3);
+    lcd_target(magic).fillCircle(value0, value1, value2, value3);
   }else{
-    if( magic == 1 )
-      M5.Displays(g_external_display).fillCircle(value0, value1, value2);
-    else
-      M5.Display.fillCircle(value0, value1, value2);
+    lcd_target(magic).fillCircle(value0, value1, value2);
   }
+  lcd_damage(magic, value0 - value2, value1 - value2, value2 * 2 + 1, value2 * 2 + 1);
   return JS_UNDEFINED;
 }
 
@@ -583,16 +1550,11 @@ static JSValue esp32_lcd_drawRect(JSContext *ctx, JSValueConst jsThis, int argc,
   if(argc >= 5){
     uint32_t value4;
     JS_ToUint32(ctx, &value4, argv[4]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).drawRect(value0, value1, value2, value3, value4);
-    else
-      M5.Display.drawRect(value0, value1, value2, value3, value4);
+    lcd_target(magic).drawRect(value0, value1, value2, value3, value4);
   }else{
-    if( magic == 1 )
-      M5.Displays(g_external_display).drawRect(value0, value1, value2, value3);
-    else
-      M5.Display.drawRect(value0, value1, value2, value3);
+    lcd_target(magic).drawRect(value0, value1, value2, value3);
   }
+  lcd_damage(magic, value0, value1, value2, value3);
   return JS_UNDEFINED;
 }
 
@@ -612,16 +1574,11 @@ static JSValue esp32_lcd_fillRect(JSContext *ctx, JSValueConst jsThis, int argc,
   if(argc >= 5){
     uint32_t value4;
     JS_ToUint32(ctx, &value4, argv[4]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).fillRect(value0, value1, value2, value3, value4);
-    else
-      M5.Display.fillRect(value0, value1, value2, value3, value4);
+    lcd_target(magic).fillRect(value0, value1, value2, value3, value4);
   }else{
-    if( magic == 1 )
-      M5.Displays(g_external_display).fillRect(value0, value1, value2, value3);
-    else
-      M5.Display.fillRect(value0, value1, value2, value3);
+    lcd_target(magic).fillRect(value0, value1, value2, value3);
   }
+  lcd_damage(magic, value0, value1, value2, value3);
   return JS_UNDEFINED;
 }
 
@@ -643,16 +1600,11 @@ static JSValue esp32_lcd_drawRoundRect(JSContext *ctx, JSValueConst jsThis, int
   if(argc >= 6){
     uint32_t value5;
     JS_ToUint32(ctx, &value5, argv[5]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).drawRoundRect(value0, value1, value2, value3, value4, value5);
-    else
-      M5.Display.drawRoundRect(value0, value1, value2, value3, value4, value5);
+    lcd_target(magic).drawRoundRect(value0, value1, value2, value3, value4, value5);
   }else{
-    if( magic == 1 )
-      M5.Displays(g_external_display).drawRoundRect(value0, value1, value2, value3, value4);
-    else
-      M5.Display.drawRoundRect(value0, value1, value2, value3, value4);
+    lcd_target(magic).drawRoundRect(value0, value1, value2, value3, value4);
   }
+  lcd_damage(magic, value0, value1, value2, value3);
   return JS_UNDEFINED;
 }
 
@@ -674,16 +1626,11 @@ static JSValue esp32_lcd_fillRoundRect(JSContext *ctx, JSValueConst jsThis, int
   if(argc >= 6){
     uint32_t value5;
     JS_ToUint32(ctx, &value5, argv[5]);
-    if( magic == 1 )
-      M5.Displays(g_external_display).fillRoundRect(value0, value1, value2, value3, value4, value5);
-    else
-      M5.Display.fillRoundRect(value0, value1, value2, value3, value4, value5);
+    lcd_target(magic).fillRoundRect(value0, value1, value2, value3, value4, value5);
   }else{
-    if( magic == 1 )
-      M5.Displays(g_external_display).fillRoundRect(value0, value1, value2, value3, value4);
-    else
-      M5.Display.fillRoundRect(value0, value1, value2, value3, value4);
+    lcd_target(magic).fillRoundRect(value0, value1, value2, value3, value4);
   }
+  lcd_damage(magic, value0, value1, value2, value3);
   return JS_UNDEFINED;
 }
 
@@ -693,10 +1640,7 @@ static JSValue esp32_lcd_width(JSContext *ctx, JSValueConst jsThis, int argc, JS
     return JS_EXCEPTION;
     
   int32_t value;
-  if( magic == 1 )
-    value = M5.Displays(g_external_display).width();
-  else
-    value = M5.Display.width();
+  value = lcd_target(magic).width();
   return JS_NewInt32(ctx, value);
 }
 
@@ -706,10 +1650,7 @@ static JSValue esp32_lcd_height(JSContext *ctx, JSValueConst jsThis, int argc, J
     return JS_EXCEPTION;
 
   int32_t value;
-  if( magic == 1 )
-    value = M5.Displays(g_external_display).height();
-  else
-    value = M5.Display.height();
+  value = lcd_target(magic).height();
   return JS_NewInt32(ctx, value);
 }
 
@@ -719,10 +1660,7 @@ static JSValue esp32_lcd_fontHeight(JSContext *ctx, JSValueConst jsThis, int arg
     return JS_EXCEPTION;
 
   int32_t value;
-  if( magic == 1 )
-    value = M5.Displays(g_external_display).fontHeight();
-  else
-    value = M5.Display.fontHeight();
+  value = lcd_target(magic).fontHeight();
   return JS_NewInt32(ctx, value);
 }
 
@@ -732,10 +1670,7 @@ static JSValue esp32_lcd_getColorDepth(JSContext *ctx, JSValueConst jsThis, int
     return JS_EXCEPTION;
 
   int32_t value;
-  if( magic == 1 )
-    value = M5.Displays(g_external_display).getColorDepth();
-  else
-    value = M5.Display.getColorDepth();
+  value = lcd_target(magic).getColorDepth();
   return JS_NewInt32(ctx, value);
 }
 
@@ -746,10 +1681,8 @@ static JSValue esp32_lcd_fillScreen(JSContext *ctx, JSValueConst jsThis, int arg
 
   uint32_t value;
   JS_ToUint32(ctx, &value, argv[0]);
-  if( magic == 1 )
-    M5.Displays(g_external_display).fillScreen(value);
-  else
-    M5.Display.fillScreen(value);
+  lcd_target(magic).fillScreen(value);
+  lcd_damage_all(magic);
   return JS_UNDEFINED;
 }
 
@@ -771,14 +1704,8 @@ static JSValue esp32_lcd_transformPosition(JSContext *ctx, JSValueConst jsThis,
   JS_ToInt32(ctx, &x, argv[2]);
   JS_ToInt32(ctx, &y, argv[3]);
   
-  int32_t disp_width, disp_height;
-  if( magic == 1 ){
-    disp_width = M5.Displays(g_external_display).width();
-    disp_height = M5.Displays(g_external_display).height();
-  }else{
-    disp_width = M5.Display.width();
-    disp_height = M5.Display.height();
-  }
+  int32_t disp_width = lcd_target(magic).width();
+  int32_t disp_height = lcd_target(magic).height();
 
   float scale = std::min(disp_width / image_width, disp_height / image_height);
   float dw = image_width * scale;
@@ -786,150 +1713,1673 @@ static JSValue esp32_lcd_transformPosition(JSContext *ctx, JSValueConst jsThis,
   int32_t new_x = (disp_width - dw) / 2;
   int32_t new_y = (disp_height - dh) / 2;
 
-  JSValue obj = JS_NewObject(ctx);
-  JS_SetPropertyStr(ctx, obj, "x", JS_NewInt32(ctx, new_x));
-  JS_SetPropertyStr(ctx, obj, "y", JS_NewInt32(ctx, new_y));
+  JSValue obj = JS_NewObject(ctx);
+  binding_set_property(ctx, obj, BINDING_ATOM_X, JS_NewInt32(ctx, new_x));
+  binding_set_property(ctx, obj, BINDING_ATOM_Y, JS_NewInt32(ctx, new_y));
+
+  return obj;
+}
+
+static JSValue esp32_lcd_createSpriteFromBmp(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint8_t *p_buffer;
+  uint8_t unit_size;
+  uint32_t unit_num;
+  JSValue vbuffer = getBinaryFromTypedArray(ctx, argv[0], (void**)&p_buffer, &unit_size, &unit_num);
+  if( JS_IsNull(vbuffer) )
+    return JS_EXCEPTION;
+  if( unit_size != 1 ){
+    JS_FreeValue(ctx, vbuffer);
+    return JS_EXCEPTION;
+  }
+
+  for( int i = 0 ; i < NUM_OF_SPRITE ; i++ ){
+    if(sprites[i] == NULL ){
+      sprites[i] = new LGFX_Sprite(&M5.Display);
+      sprites[i]->createFromBmp(p_buffer, unit_num);
+      JS_FreeValue(ctx, vbuffer);
+      return JS_NewUint32(ctx, i);
+    }
+  }
+  JS_FreeValue(ctx, vbuffer);
+
+  return JS_EXCEPTION;
+}
+
+#ifdef _SD_ENABLE_
+static JSValue esp32_lcd_createSpriteFromBmpFile(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  const char *path = JS_ToCString(ctx, argv[0]);
+  if( path == NULL )
+    return JS_EXCEPTION;
+
+  for( int i = 0 ; i < NUM_OF_SPRITE ; i++ ){
+    if(sprites[i] == NULL ){
+      sprites[i] = new LGFX_Sprite(&M5.Display);
+      sprites[i]->createFromBmpFile(sd, path);
+      JS_FreeCString(ctx, path);
+      return JS_NewUint32(ctx, i);
+    }
+  }
+  JS_FreeCString(ctx, path);
+
+  return JS_EXCEPTION;
+}
+#endif
+
+static JSValue esp32_lcd_freeSprite(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t id;
+  JS_ToUint32(ctx, &id, argv[0]);
+
+  if( id >= NUM_OF_SPRITE )
+    return JS_EXCEPTION;
+
+  if( sprites[id] == NULL )
+    return JS_UNDEFINED;
+  
+  delete sprites[id];
+  sprites[id] = NULL;
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_lcd_setPivot(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t id;
+  JS_ToUint32(ctx, &id, argv[0]);
+
+  if( id >= NUM_OF_SPRITE )
+    return JS_EXCEPTION;
+
+  if( sprites[id] == NULL )
+    return JS_EXCEPTION;
+  
+  double x, y;
+  JS_ToFloat64(ctx, &x, argv[1]);
+  JS_ToFloat64(ctx, &y, argv[2]);
+
+  sprites[id]->setPivot(x, y);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_lcd_pushSprite(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t id;
+  JS_ToUint32(ctx, &id, argv[0]);
+  
+  if( id >= NUM_OF_SPRITE )
+    return JS_EXCEPTION;
+
+  if( sprites[id] == NULL )
+    return JS_EXCEPTION;
+  
+  int32_t x, y;
+  JS_ToInt32(ctx, &x, argv[1]);
+  JS_ToInt32(ctx, &y, argv[2]);
+
+  if( argc >= 4 ){
+    uint32_t transp;
+    JS_ToUint32(ctx, &transp, argv[3]);
+    sprites[id]->pushSprite(&lcd_target(0), x, y, transp);
+  }else{
+    sprites[id]->pushSprite(&lcd_target(0), x, y);
+  }
+  lcd_damage(0, x, y, sprites[id]->width(), sprites[id]->height());
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_lcd_pushRotateZoom(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t id;
+  JS_ToUint32(ctx, &id, argv[0]);
+  
+  if( id >= NUM_OF_SPRITE )
+    return JS_EXCEPTION;
+
+  if( sprites[id] == NULL )
+    return JS_EXCEPTION;
+  
+  double dst_x, dst_y, angle, zoom_x, zoom_y;
+  JS_ToFloat64(ctx, &dst_x, argv[1]);
+  JS_ToFloat64(ctx, &dst_y, argv[2]);
+  JS_ToFloat64(ctx, &angle, argv[3]);
+  JS_ToFloat64(ctx, &zoom_x, argv[4]);
+  JS_ToFloat64(ctx, &zoom_y, argv[5]);
+
+  if( argc >= 7 ){
+    uint32_t transp;
+    JS_ToUint32(ctx, &transp, argv[6]);
+    sprites[id]->pushRotateZoom(&lcd_target(0), dst_x, dst_y, angle, zoom_x, zoom_y, transp);
+  }else{
+    sprites[id]->pushRotateZoom(&lcd_target(0), dst_x, dst_y, angle, zoom_x, zoom_y);
+  }
+  // bounding circle of the rotated and zoomed sprite
+  int32_t radius = ceil(sqrt((double)sprites[id]->width() * sprites[id]->width() + (double)sprites[id]->height() * sprites[id]->height()) * std::max(fabs(zoom_x), fabs(zoom_y)));
+  lcd_damage(0, dst_x - radius, dst_y - radius, radius * 2 + 1, radius * 2 + 1);
+
+  return JS_UNDEFINED;
+}
+
+static void lcd_submit_damage(int magic, uint32_t op, const int32_t *a, const char **p_strings)
+{
+  if( g_canvas[magic].sprite == NULL )
+    return;
+
+  switch(op){
+    case LCD_OP_PIXEL: lcd_damage(magic, a[0], a[1], 1, 1); break;
+    case LCD_OP_LINE: lcd_damage(magic, std::min(a[0], a[2]), std::min(a[1], a[3]), abs(a[2] - a[0]) + 1, abs(a[3] - a[1]) + 1); break;
+    case LCD_OP_HLINE: lcd_damage(magic, a[0], a[1], a[2], 1); break;
+    case LCD_OP_VLINE: lcd_damage(magic, a[0], a[1], 1, a[2]); break;
+    case LCD_OP_RECT:
+    case LCD_OP_FILL_RECT:
+    case LCD_OP_ROUND_RECT:
+    case LCD_OP_FILL_ROUND_RECT:
+      lcd_damage(magic, a[0], a[1], a[2], a[3]);
+      break;
+    case LCD_OP_CIRCLE:
+    case LCD_OP_FILL_CIRCLE:
+      lcd_damage(magic, a[0] - a[2], a[1] - a[2], a[2] * 2 + 1, a[2] * 2 + 1);
+      break;
+    case LCD_OP_TRIANGLE:
+    case LCD_OP_FILL_TRIANGLE: {
+      int32_t left = std::min(std::min(a[0], a[2]), a[4]);
+      int32_t top = std::min(std::min(a[1], a[3]), a[5]);
+      lcd_damage(magic, left, top, std::max(std::max(a[0], a[2]), a[4]) - left + 1, std::max(std::max(a[1], a[3]), a[5]) - top + 1);
+      break;
+    }
+    case LCD_OP_FILL_SCREEN: lcd_damage_all(magic); break;
+    case LCD_OP_TEXT: lcd_damage_text(magic, p_strings[a[0]], a[1], a[2]); break;
+  }
+}
+
+static uint32_t g_submit_calls = 0;
+static uint32_t g_submit_ops = 0;
+static uint32_t g_submit_time_last = 0; // us, drawing only
+static uint32_t g_submit_time_max = 0; // us
+
+static long lcd_submit_execute(LovyanGFX &gfx, int magic, const int32_t *p_ops, uint32_t num_ops, const char **p_strings, uint32_t num_strings)
+{
+  // check the whole list first, nothing is drawn for a malformed one
+  long count = 0;
+  for( uint32_t i = 0 ; i < num_ops ; ){
+    uint32_t op = p_ops[i];
+    if( op == 0 || op >= sizeof(lcd_op_args) || i + 1 + lcd_op_args[op] > num_ops )
+      return -1;
+    if( op == LCD_OP_TEXT && (uint32_t)p_ops[i + 1] >= num_strings )
+      return -1;
+    i += 1 + lcd_op_args[op];
+    count++;
+  }
+
+  gfx.startWrite();
+  for( uint32_t i = 0 ; i < num_ops ; ){
+    const int32_t *a = &p_ops[i + 1];
+    uint32_t op = p_ops[i];
+    lcd_submit_damage(magic, op, a, p_strings);
+    switch(op){
+      case LCD_OP_PIXEL: gfx.drawPixel(a[0], a[1], (uint32_t)a[2]); break;
+      case LCD_OP_LINE: gfx.drawLine(a[0], a[1], a[2], a[3], (uint32_t)a[4]); break;
+      case LCD_OP_HLINE: gfx.drawFastHLine(a[0], a[1], a[2], (uint32_t)a[3]); break;
+      case LCD_OP_VLINE: gfx.drawFastVLine(a[0], a[1], a[2], (uint32_t)a[3]); break;
+      case LCD_OP_RECT: gfx.drawRect(a[0], a[1], a[2], a[3], (uint32_t)a[4]); break;
+      case LCD_OP_FILL_RECT: gfx.fillRect(a[0], a[1], a[2], a[3], (uint32_t)a[4]); break;
+      case LCD_OP_ROUND_RECT: gfx.drawRoundRect(a[0], a[1], a[2], a[3], a[4], (uint32_t)a[5]); break;
+      case LCD_OP_FILL_ROUND_RECT: gfx.fillRoundRect(a[0], a[1], a[2], a[3], a[4], (uint32_t)a[5]); break;
+      case LCD_OP_CIRCLE: gfx.drawCircle(a[0], a[1], a[2], (uint32_t)a[3]); break;
+      case LCD_OP_FILL_CIRCLE: gfx.fillCircle(a[0], a[1], a[2], (uint32_t)a[3]); break;
+      case LCD_OP_TRIANGLE: gfx.drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], (uint32_t)a[6]); break;
+      case LCD_OP_FILL_TRIANGLE: gfx.fillTriangle(a[0], a[1], a[2], a[3], a[4], a[5], (uint32_t)a[6]); break;
+      case LCD_OP_FILL_SCREEN: gfx.fillScreen((uint32_t)a[0]); break;
+      case LCD_OP_TEXT:
+        if( p_strings[a[0]] != NULL )
+          lcd_draw_string(gfx, p_strings[a[0]], a[1], a[2]);
+        break;
+      case LCD_OP_TEXT_COLOR:
+        if( a[1] < 0 )
+          gfx.setTextColor((uint32_t)a[0]);
+        else
+          gfx.setTextColor((uint32_t)a[0], (uint32_t)a[1]);
+        break;
+      case LCD_OP_TEXT_SIZE: gfx.setTextSize(a[0]); break;
+      case LCD_OP_TEXT_DATUM: gfx.setTextDatum(a[0]); break;
+      case LCD_OP_FONT: module_lcd_setFont(a[0], magic); break;
+    }
+    i += 1 + lcd_op_args[op];
+  }
+  gfx.endWrite();
+
+  return count;
+}
+
+static JSValue esp32_lcd_submit(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return JS_EXCEPTION;
+
+  int32_t *p_ops;
+  uint32_t num_ops;
+  int32_t *p_array = NULL;
+  JSValue vbuffer = JS_UNDEFINED;
+  if( JS_IsArray(ctx, argv[0]) ){
+    if( getNumberArray(ctx, argv[0], &p_array, &num_ops) != 0 )
+      return JS_EXCEPTION;
+    p_ops = p_array;
+  }else{
+    uint8_t unit_size;
+    vbuffer = getBinaryFromTypedArray(ctx, argv[0], (void**)&p_ops, &unit_size, &num_ops);
+    if( JS_IsNull(vbuffer) )
+      return JS_EXCEPTION;
+    if( unit_size != 4 ){
+      JS_FreeValue(ctx, vbuffer);
+      return JS_EXCEPTION;
+    }
+    // the length is reported in bytes
+    num_ops /= unit_size;
+  }
+
+  uint32_t num_strings = 0;
+  const char **p_strings = NULL;
+  if( argc >= 2 ){
+    JSValue value = JS_GetPropertyStr(ctx, argv[1], "length");
+    JS_ToUint32(ctx, &num_strings, value);
+    JS_FreeValue(ctx, value);
+    if( num_strings > 0 ){
+      p_strings = (const char**)calloc(num_strings, sizeof(const char*));
+      if( p_strings == NULL )
+        num_strings = 0;
+    }
+    for( uint32_t i = 0 ; i < num_strings ; i++ ){
+      JSValue item = JS_GetPropertyUint32(ctx, argv[1], i);
+      p_strings[i] = JS_ToCString(ctx, item);
+      JS_FreeValue(ctx, item);
+    }
+  }
+
+  uint32_t start = micros();
+  long ret = lcd_submit_execute(lcd_target(magic), magic, p_ops, num_ops, p_strings, num_strings);
+  if( ret >= 0 ){
+    g_submit_calls++;
+    g_submit_ops += ret;
+    g_submit_time_last = micros() - start;
+    if( g_submit_time_last > g_submit_time_max )
+      g_submit_time_max = g_submit_time_last;
+  }
+
+  for( uint32_t i = 0 ; i < num_strings ; i++ ){
+    if( p_strings[i] != NULL )
+      JS_FreeCString(ctx, p_strings[i]);
+  }
+  if( p_strings != NULL )
+    free(p_strings);
+  if( p_array != NULL )
+    free(p_array);
+  JS_FreeValue(ctx, vbuffer);
+
+  if( ret < 0 )
+    return JS_EXCEPTION;
+
+  return JS_NewInt32(ctx, ret);
+}
+
+static JSValue esp32_lcd_getSubmitStats(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "calls", JS_NewUint32(ctx, g_submit_calls));
+  JS_SetPropertyStr(ctx, obj, "ops", JS_NewUint32(ctx, g_submit_ops));
+  JS_SetPropertyStr(ctx, obj, "timeLast", JS_NewUint32(ctx, g_submit_time_last));
+  JS_SetPropertyStr(ctx, obj, "timeMax", JS_NewUint32(ctx, g_submit_time_max));
+  return obj;
+}
+
+#define LCD_SPRITE_POOL_MAX  (512 * 1024) // bytes of freed sprite pixels kept for reuse
+
+// Sprite objects, freed by the GC finalizer or explicitly with free()
+typedef struct {
+  LGFX_Sprite *sprite;
+  void *buffer;
+  uint32_t size;
+  int magic; // display pushed to by push()
+} LCD_SPRITE;
+
+typedef struct {
+  void *buffer;
+  uint32_t size;
+} LCD_SPRITE_BLOCK;
+
+static JSClassID g_sprite_class_id = 0;
+static std::vector<LCD_SPRITE_BLOCK> g_sprite_pool;
+static uint32_t g_sprite_pool_bytes = 0;
+static bool g_sprite_pool_closed = false; // between endModule and the next context
+static uint32_t g_sprite_count = 0;
+static uint32_t g_sprite_bytes = 0;
+
+static void *lcd_sprite_pool_alloc(uint32_t size, uint32_t *p_size)
+{
+  // reuse a pooled block that is not much larger than needed
+  for( auto it = g_sprite_pool.begin() ; it != g_sprite_pool.end() ; it++ ){
+    if( it->size >= size && it->size <= size * 2 ){
+      void *buffer = it->buffer;
+      *p_size = it->size;
+      g_sprite_pool_bytes -= it->size;
+      g_sprite_pool.erase(it);
+      memset(buffer, 0, *p_size);
+      return buffer;
+    }
+  }
+
+  void *buffer = utils_mem_alloc(size);
+  if( buffer == NULL )
+    return NULL;
+  memset(buffer, 0, size);
+  *p_size = size;
+  return buffer;
+}
+
+static void lcd_sprite_pool_free(void *buffer, uint32_t size)
+{
+  // finalizers run by JS_FreeRuntime() come after endModule, nothing would reuse the block
+  if( g_sprite_pool_closed ){
+    utils_mem_free(buffer);
+    return;
+  }
+  // the oldest blocks go first when the pool is full
+  while( g_sprite_pool.size() > 0 && g_sprite_pool_bytes + size > LCD_SPRITE_POOL_MAX ){
+    utils_mem_free(g_sprite_pool.front().buffer);
+    g_sprite_pool_bytes -= g_sprite_pool.front().size;
+    g_sprite_pool.erase(g_sprite_pool.begin());
+  }
+  if( size > LCD_SPRITE_POOL_MAX ){
+    utils_mem_free(buffer);
+    return;
+  }
+  LCD_SPRITE_BLOCK block = { buffer, size };
+  g_sprite_pool.push_back(block);
+  g_sprite_pool_bytes += size;
+}
+
+static void lcd_sprite_pool_clear(void)
+{
+  for( auto &block : g_sprite_pool )
+    utils_mem_free(block.buffer);
+  g_sprite_pool.clear();
+  g_sprite_pool_bytes = 0;
+}
+
+static void lcd_sprite_release(LCD_SPRITE *p_sprite)
+{
+  if( p_sprite->sprite != NULL ){
+    delete p_sprite->sprite;
+    p_sprite->sprite = NULL;
+  }
+  if( p_sprite->buffer != NULL ){
+    lcd_sprite_pool_free(p_sprite->buffer, p_sprite->size);
+    g_sprite_count--;
+    g_sprite_bytes -= p_sprite->size;
+    p_sprite->buffer = NULL;
+  }
+}
+
+static void lcd_sprite_finalizer(JSRuntime *rt, JSValue val)
+{
+  LCD_SPRITE *p_sprite = (LCD_SPRITE*)JS_GetOpaque(val, g_sprite_class_id);
+  if( p_sprite == NULL )
+    return;
+  lcd_sprite_release(p_sprite);
+  free(p_sprite);
+}
+
+static JSClassDef lcd_sprite_class = {
+  "Sprite",
+  lcd_sprite_finalizer,
+};
+
+static LGFX_Sprite *lcd_sprite_get(JSContext *ctx, JSValueConst obj)
+{
+  LCD_SPRITE *p_sprite = (LCD_SPRITE*)JS_GetOpaque2(ctx, obj, g_sprite_class_id);
+  if( p_sprite == NULL )
+    return NULL;
+  if( p_sprite->sprite == NULL ){
+    JS_ThrowReferenceError(ctx, "sprite already freed");
+    return NULL;
+  }
+  return p_sprite->sprite;
+}
+
+static JSValue lcd_sprite_new(JSContext *ctx, int magic, int32_t width, int32_t height, uint8_t depth)
+{
+  if( width <= 0 || height <= 0 )
+    return JS_EXCEPTION;
+  if( depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16 && depth != 24 )
+    return JS_EXCEPTION;
+
+  uint32_t line = ((uint32_t)width * depth + 7) / 8;
+  if( depth == 24 )
+    line = width * 3;
+  uint32_t size;
+  void *buffer = lcd_sprite_pool_alloc(line * height, &size);
+  if( buffer == NULL )
+    return JS_EXCEPTION;
+
+  LCD_SPRITE *p_sprite = (LCD_SPRITE*)malloc(sizeof(LCD_SPRITE));
+  if( p_sprite == NULL ){
+    lcd_sprite_pool_free(buffer, size);
+    return JS_EXCEPTION;
+  }
+  p_sprite->sprite = new LGFX_Sprite(&lcd_panel(magic));
+  p_sprite->sprite->setBuffer(buffer, width, height, (lgfx::color_depth_t)depth);
+  if( depth <= 8 )
+    p_sprite->sprite->createPalette();
+  p_sprite->buffer = buffer;
+  p_sprite->size = size;
+  p_sprite->magic = magic;
+  g_sprite_count++;
+  g_sprite_bytes += size;
+
+  JSValue obj = JS_NewObjectClass(ctx, g_sprite_class_id);
+  if( JS_IsException(obj) ){
+    lcd_sprite_release(p_sprite);
+    free(p_sprite);
+    return obj;
+  }
+  JS_SetOpaque(obj, p_sprite);
+
+  return obj;
+}
+
+static bool lcd_draw_image_buffer(LovyanGFX &gfx, int type, const uint8_t *p_buffer, uint32_t size, int32_t x, int32_t y)
+{
+  switch(type){
+    case LCD_IMAGE_BMP: return gfx.drawBmp(p_buffer, size, x, y);
+    case LCD_IMAGE_JPEG: return gfx.drawJpg(p_buffer, size, x, y);
+    case LCD_IMAGE_PNG: return gfx.drawPng(p_buffer, size, x, y);
+  }
+  return false;
+}
+
+static JSValue lcd_sprite_from_image(JSContext *ctx, int magic, const uint8_t *p_buffer, uint32_t size)
+{
+  int32_t width, height;
+  int type = lcd_image_size(p_buffer, size, &width, &height);
+  if( type == LCD_IMAGE_UNKNOWN )
+    return JS_EXCEPTION;
+
+  JSValue obj = lcd_sprite_new(ctx, magic, width, height, 16);
+  if( JS_IsException(obj) )
+    return obj;
+  LCD_SPRITE *p_sprite = (LCD_SPRITE*)JS_GetOpaque(obj, g_sprite_class_id);
+  if( !lcd_draw_image_buffer(*p_sprite->sprite, type, p_buffer, size, 0, 0) ){
+    JS_FreeValue(ctx, obj);
+    return JS_EXCEPTION;
+  }
+
+  return obj;
+}
+
+static JSValue esp32_lcd_createSprite(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return JS_EXCEPTION;
+
+  int32_t width, height;
+  uint32_t depth = 16;
+  JS_ToInt32(ctx, &width, argv[0]);
+  JS_ToInt32(ctx, &height, argv[1]);
+  if( argc >= 3 )
+    JS_ToUint32(ctx, &depth, argv[2]);
+
+  return lcd_sprite_new(ctx, magic, width, height, depth);
+}
+
+static JSValue esp32_lcd_createSpriteFromImage(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return JS_EXCEPTION;
+
+  uint8_t *p_buffer;
+  uint8_t unit_size;
+  uint32_t unit_num;
+  JSValue vbuffer = getBinaryFromTypedArray(ctx, argv[0], (void**)&p_buffer, &unit_size, &unit_num);
+  if( JS_IsNull(vbuffer) )
+    return JS_EXCEPTION;
+  if( unit_size != 1 ){
+    JS_FreeValue(ctx, vbuffer);
+    return JS_EXCEPTION;
+  }
+
+  JSValue obj = lcd_sprite_from_image(ctx, magic, p_buffer, unit_num);
+  JS_FreeValue(ctx, vbuffer);
+
+  return obj;
+}
+
+#ifdef _SD_ENABLE_
+static JSValue esp32_lcd_createSpriteFromImageFile(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return JS_EXCEPTION;
+
+  const char *fpath = JS_ToCString(ctx, argv[0]);
+  if( fpath == NULL )
+    return JS_EXCEPTION;
+  File file = sd.open(fpath, FILE_READ);
+  JS_FreeCString(ctx, fpath);
+  if( !file )
+    return JS_EXCEPTION;
+
+  uint32_t size = file.size();
+  uint8_t *p_buffer = (uint8_t*)utils_mem_alloc(size);
+  if( p_buffer == NULL ){
+    file.close();
+    return JS_EXCEPTION;
+  }
+  uint32_t read = file.read(p_buffer, size);
+  file.close();
+  if( read != size ){
+    utils_mem_free(p_buffer);
+    return JS_EXCEPTION;
+  }
+
+  JSValue obj = lcd_sprite_from_image(ctx, magic, p_buffer, size);
+  utils_mem_free(p_buffer);
+
+  return obj;
+}
+#endif
+
+static JSValue esp32_lcd_getSpriteStats(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "count", JS_NewUint32(ctx, g_sprite_count));
+  JS_SetPropertyStr(ctx, obj, "bytes", JS_NewUint32(ctx, g_sprite_bytes));
+  JS_SetPropertyStr(ctx, obj, "pooled", JS_NewUint32(ctx, g_sprite_pool_bytes));
+  JS_SetPropertyStr(ctx, obj, "pooledBlocks", JS_NewUint32(ctx, g_sprite_pool.size()));
+  return obj;
+}
+
+static JSValue lcd_sprite_free(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  LCD_SPRITE *p_sprite = (LCD_SPRITE*)JS_GetOpaque2(ctx, jsThis, g_sprite_class_id);
+  if( p_sprite == NULL )
+    return JS_EXCEPTION;
+  lcd_sprite_release(p_sprite);
+  return JS_UNDEFINED;
+}
+
+static JSValue lcd_sprite_size(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  LGFX_Sprite *sprite = lcd_sprite_get(ctx, jsThis);
+  if( sprite == NULL )
+    return JS_EXCEPTION;
+  if( magic == 0 )
+    return JS_NewInt32(ctx, sprite->width());
+  else if( magic == 1 )
+    return JS_NewInt32(ctx, sprite->height());
+  else
+    return JS_NewInt32(ctx, sprite->getColorDepth());
+}
+
+// drawing primitives, same arguments as the Lcd functions
+static JSValue lcd_sprite_draw(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  LGFX_Sprite *sprite = lcd_sprite_get(ctx, jsThis);
+  if( sprite == NULL )
+    return JS_EXCEPTION;
+
+  int32_t v[7] = { 0 };
+  for( int i = 0 ; i < argc && i < 7 ; i++ )
+    JS_ToInt32(ctx, &v[i], argv[i]);
+
+  switch(magic){
+    case LCD_OP_PIXEL: sprite->drawPixel(v[0], v[1], (uint32_t)v[2]); break;
+    case LCD_OP_LINE: sprite->drawLine(v[0], v[1], v[2], v[3], (uint32_t)v[4]); break;
+    case LCD_OP_RECT: sprite->drawRect(v[0], v[1], v[2], v[3], (uint32_t)v[4]); break;
+    case LCD_OP_FILL_RECT: sprite->fillRect(v[0], v[1], v[2], v[3], (uint32_t)v[4]); break;
+    case LCD_OP_ROUND_RECT: sprite->drawRoundRect(v[0], v[1], v[2], v[3], v[4], (uint32_t)v[5]); break;
+    case LCD_OP_FILL_ROUND_RECT: sprite->fillRoundRect(v[0], v[1], v[2], v[3], v[4], (uint32_t)v[5]); break;
+    case LCD_OP_CIRCLE: sprite->drawCircle(v[0], v[1], v[2], (uint32_t)v[3]); break;
+    case LCD_OP_FILL_CIRCLE: sprite->fillCircle(v[0], v[1], v[2], (uint32_t)v[3]); break;
+    case LCD_OP_TRIANGLE: sprite->drawTriangle(v[0], v[1], v[2], v[3], v[4], v[5], (uint32_t)v[6]); break;
+    case LCD_OP_FILL_TRIANGLE: sprite->fillTriangle(v[0], v[1], v[2], v[3], v[4], v[5], (uint32_t)v[6]); break;
+    case LCD_OP_FILL_SCREEN: sprite->fillScreen((uint32_t)v[0]); break;
+    case LCD_OP_TEXT_SIZE: sprite->setTextSize(v[0]); break;
+    case LCD_OP_TEXT_DATUM: sprite->setTextDatum(v[0]); break;
+    case LCD_OP_TEXT_COLOR:
+      if( argc >= 2 )
+        sprite->setTextColor((uint32_t)v[0], (uint32_t)v[1]);
+      else
+        sprite->setTextColor((uint32_t)v[0]);
+      break;
+  }
+
+  return JS_UNDEFINED;
+}
+
+static JSValue lcd_sprite_drawText(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  LGFX_Sprite *sprite = lcd_sprite_get(ctx, jsThis);
+  if( sprite == NULL )
+    return JS_EXCEPTION;
+
+  const char *text = JS_ToCString(ctx, argv[0]);
+  if( text == NULL )
+    return JS_EXCEPTION;
+  int32_t x, y;
+  JS_ToInt32(ctx, &x, argv[1]);
+  JS_ToInt32(ctx, &y, argv[2]);
+  long ret = sprite->drawString(text, x, y);
+  JS_FreeCString(ctx, text);
+
+  return JS_NewInt32(ctx, ret);
+}
+
+static JSValue lcd_sprite_drawImage(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  LGFX_Sprite *sprite = lcd_sprite_get(ctx, jsThis);
+  if( sprite == NULL )
+    return JS_EXCEPTION;
+
+  uint8_t *p_buffer;
+  uint8_t unit_size;
+  uint32_t unit_num;
+  JSValue vbuffer = getBinaryFromTypedArray(ctx, argv[0], (void**)&p_buffer, &unit_size, &unit_num);
+  if( JS_IsNull(vbuffer) )
+    return JS_EXCEPTION;
+  if( unit_size != 1 ){
+    JS_FreeValue(ctx, vbuffer);
+    return JS_EXCEPTION;
+  }
+
+  int32_t x = 0, y = 0;
+  if( argc >= 2 )
+    JS_ToInt32(ctx, &x, argv[1]);
+  if( argc >= 3 )
+    JS_ToInt32(ctx, &y, argv[2]);
+
+  int32_t width, height;
+  int type = lcd_image_size(p_buffer, unit_num, &width, &height);
+  bool ret = lcd_draw_image_buffer(*sprite, type, p_buffer, unit_num, x, y);
+  JS_FreeValue(ctx, vbuffer);
+
+  return JS_NewBool(ctx, ret);
+}
+
+static JSValue lcd_sprite_setPaletteColor(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  LGFX_Sprite *sprite = lcd_sprite_get(ctx, jsThis);
+  if( sprite == NULL )
+    return JS_EXCEPTION;
+
+  uint32_t index, color;
+  JS_ToUint32(ctx, &index, argv[0]);
+  JS_ToUint32(ctx, &color, argv[1]);
+  if( sprite->getColorDepth() > 8 || index >= (1u << sprite->getColorDepth()) )
+    return JS_EXCEPTION;
+  sprite->setPaletteColor(index, color);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue lcd_sprite_setPivot(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  LGFX_Sprite *sprite = lcd_sprite_get(ctx, jsThis);
+  if( sprite == NULL )
+    return JS_EXCEPTION;
+
+  double x, y;
+  JS_ToFloat64(ctx, &x, argv[0]);
+  JS_ToFloat64(ctx, &y, argv[1]);
+  sprite->setPivot(x, y);
+
+  return JS_UNDEFINED;
+}
+
+// push(x, y[, transp]) onto its display, pushTo(sprite, x, y[, transp]) onto another sprite
+static JSValue lcd_sprite_push(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  LCD_SPRITE *p_sprite = (LCD_SPRITE*)JS_GetOpaque2(ctx, jsThis, g_sprite_class_id);
+  LGFX_Sprite *sprite = lcd_sprite_get(ctx, jsThis);
+  if( sprite == NULL )
+    return JS_EXCEPTION;
+
+  LovyanGFX *dst;
+  int base = 0;
+  if( magic == 1 ){
+    dst = lcd_sprite_get(ctx, argv[0]);
+    if( dst == NULL )
+      return JS_EXCEPTION;
+    if( dst == sprite )
+      return JS_EXCEPTION;
+    base = 1;
+  }else{
+    if( p_sprite->magic == 1 && g_external_display == -1 )
+      return JS_EXCEPTION;
+    dst = &lcd_target(p_sprite->magic);
+  }
+
+  int32_t x, y;
+  JS_ToInt32(ctx, &x, argv[base]);
+  JS_ToInt32(ctx, &y, argv[base + 1]);
+  if( argc > base + 2 ){
+    uint32_t transp;
+    JS_ToUint32(ctx, &transp, argv[base + 2]);
+    sprite->pushSprite(dst, x, y, transp);
+  }else{
+    sprite->pushSprite(dst, x, y);
+  }
+  if( magic == 0 )
+    lcd_damage(p_sprite->magic, x, y, sprite->width(), sprite->height());
+
+  return JS_UNDEFINED;
+}
+
+// pushRotateZoom(x, y, angle, zoom_x, zoom_y[, transp]), pushRotateZoomTo(sprite, ...)
+static JSValue lcd_sprite_pushRotateZoom(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  LCD_SPRITE *p_sprite = (LCD_SPRITE*)JS_GetOpaque2(ctx, jsThis, g_sprite_class_id);
+  LGFX_Sprite *sprite = lcd_sprite_get(ctx, jsThis);
+  if( sprite == NULL )
+    return JS_EXCEPTION;
+
+  LovyanGFX *dst;
+  int base = 0;
+  if( magic == 1 ){
+    dst = lcd_sprite_get(ctx, argv[0]);
+    if( dst == NULL )
+      return JS_EXCEPTION;
+    if( dst == sprite )
+      return JS_EXCEPTION;
+    base = 1;
+  }else{
+    if( p_sprite->magic == 1 && g_external_display == -1 )
+      return JS_EXCEPTION;
+    dst = &lcd_target(p_sprite->magic);
+  }
+
+  double dst_x, dst_y, angle, zoom_x, zoom_y;
+  JS_ToFloat64(ctx, &dst_x, argv[base]);
+  JS_ToFloat64(ctx, &dst_y, argv[base + 1]);
+  JS_ToFloat64(ctx, &angle, argv[base + 2]);
+  JS_ToFloat64(ctx, &zoom_x, argv[base + 3]);
+  JS_ToFloat64(ctx, &zoom_y, argv[base + 4]);
+  if( argc > base + 5 ){
+    uint32_t transp;
+    JS_ToUint32(ctx, &transp, argv[base + 5]);
+    sprite->pushRotateZoom(dst, dst_x, dst_y, angle, zoom_x, zoom_y, transp);
+  }else{
+    sprite->pushRotateZoom(dst, dst_x, dst_y, angle, zoom_x, zoom_y);
+  }
+  if( magic == 0 ){
+    int32_t radius = ceil(sqrt((double)sprite->width() * sprite->width() + (double)sprite->height() * sprite->height()) * std::max(fabs(zoom_x), fabs(zoom_y)));
+    lcd_damage(p_sprite->magic, dst_x - radius, dst_y - radius, radius * 2 + 1, radius * 2 + 1);
+  }
+
+  return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry lcd_sprite_funcs[] = {
+    JSCFunctionListEntry{"free", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, lcd_sprite_free}
+                         }},
+    JSCFunctionListEntry{"width", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_size}}
+                         }},
+    JSCFunctionListEntry{"height", 0, JS_DEF_CFUNC, 1, {
+                           func : {0, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_size}}
+                         }},
+    JSCFunctionListEntry{"getColorDepth", 0, JS_DEF_CFUNC, 2, {
+                           func : {0, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_size}}
+                         }},
+    JSCFunctionListEntry{"drawPixel", 0, JS_DEF_CFUNC, LCD_OP_PIXEL, {
+                           func : {3, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"drawLine", 0, JS_DEF_CFUNC, LCD_OP_LINE, {
+                           func : {5, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"drawRect", 0, JS_DEF_CFUNC, LCD_OP_RECT, {
+                           func : {5, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"fillRect", 0, JS_DEF_CFUNC, LCD_OP_FILL_RECT, {
+                           func : {5, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"drawRoundRect", 0, JS_DEF_CFUNC, LCD_OP_ROUND_RECT, {
+                           func : {6, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"fillRoundRect", 0, JS_DEF_CFUNC, LCD_OP_FILL_ROUND_RECT, {
+                           func : {6, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"drawCircle", 0, JS_DEF_CFUNC, LCD_OP_CIRCLE, {
+                           func : {4, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"fillCircle", 0, JS_DEF_CFUNC, LCD_OP_FILL_CIRCLE, {
+                           func : {4, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"drawTriangle", 0, JS_DEF_CFUNC, LCD_OP_TRIANGLE, {
+                           func : {7, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"fillTriangle", 0, JS_DEF_CFUNC, LCD_OP_FILL_TRIANGLE, {
+                           func : {7, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"fillScreen", 0, JS_DEF_CFUNC, LCD_OP_FILL_SCREEN, {
+                           func : {1, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"setTextColor", 0, JS_DEF_CFUNC, LCD_OP_TEXT_COLOR, {
+                           func : {2, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"setTextSize", 0, JS_DEF_CFUNC, LCD_OP_TEXT_SIZE, {
+                           func : {1, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"setTextDatum", 0, JS_DEF_CFUNC, LCD_OP_TEXT_DATUM, {
+                           func : {1, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_draw}}
+                         }},
+    JSCFunctionListEntry{"drawText", 0, JS_DEF_CFUNC, 0, {
+                           func : {3, JS_CFUNC_generic, lcd_sprite_drawText}
+                         }},
+    JSCFunctionListEntry{"drawImage", 0, JS_DEF_CFUNC, 0, {
+                           func : {3, JS_CFUNC_generic, lcd_sprite_drawImage}
+                         }},
+    JSCFunctionListEntry{"setPaletteColor", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic, lcd_sprite_setPaletteColor}
+                         }},
+    JSCFunctionListEntry{"setPivot", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic, lcd_sprite_setPivot}
+                         }},
+    JSCFunctionListEntry{"push", 0, JS_DEF_CFUNC, 0, {
+                           func : {3, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_push}}
+                         }},
+    JSCFunctionListEntry{"pushTo", 0, JS_DEF_CFUNC, 1, {
+                           func : {4, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_push}}
+                         }},
+    JSCFunctionListEntry{"pushRotateZoom", 0, JS_DEF_CFUNC, 0, {
+                           func : {6, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_pushRotateZoom}}
+                         }},
+    JSCFunctionListEntry{"pushRotateZoomTo", 0, JS_DEF_CFUNC, 1, {
+                           func : {7, JS_CFUNC_generic_magic, {generic_magic : lcd_sprite_pushRotateZoom}}
+                         }},
+};
+
+static void lcd_sprite_class_init(JSContext *ctx)
+{
+  JSRuntime *rt = JS_GetRuntime(ctx);
+  JS_NewClassID(&g_sprite_class_id);
+  if( !JS_IsRegisteredClass(rt, g_sprite_class_id) )
+    JS_NewClass(rt, g_sprite_class_id, &lcd_sprite_class);
+
+  JSValue proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, proto, lcd_sprite_funcs, sizeof(lcd_sprite_funcs) / sizeof(JSCFunctionListEntry));
+  JS_SetClassProto(ctx, g_sprite_class_id, proto);
+}
+
+static JSValue esp32_lcd_setImageCache(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t budget;
+  JS_ToUint32(ctx, &budget, argv[0]);
+  if( argc >= 2 ){
+    JSValue value = JS_GetPropertyStr(ctx, argv[1], "maxAge");
+    if( value != JS_UNDEFINED )
+      JS_ToUint32(ctx, &g_image_cache_max_age, value);
+  }
+
+  g_image_cache_budget = budget;
+  lcd_image_cache_trim(budget);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_lcd_clearImageCache(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  lcd_image_cache_clear();
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_lcd_preloadImage(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  if( g_image_cache_budget == 0 )
+    return JS_EXCEPTION;
+
+  const char *source = JS_ToCString(ctx, argv[0]);
+  if( source == NULL )
+    return JS_EXCEPTION;
+
+  // same options as drawImageUrl/drawImageFile, so that the later draw hits
+  LCD_IMAGE_OPTION option;
+  lcd_image_option(ctx, 1, argv, &option);
+  if( argc >= 2 )
+    lcd_image_option_props(ctx, argv[1], &option);
+
+  bool is_url = strncmp(source, "http://", 7) == 0 || strncmp(source, "https://", 8) == 0;
+  bool temporary;
+  LCD_IMAGE_ENTRY *p_entry = lcd_image_cache_load(source, is_url, &option, &temporary);
+  JS_FreeCString(ctx, source);
+  if( p_entry == NULL )
+    return JS_NewBool(ctx, false);
+  if( temporary ){
+    lcd_image_entry_free(p_entry);
+    return JS_NewBool(ctx, false);
+  }
+
+  return JS_NewBool(ctx, true);
+}
+
+static JSValue esp32_lcd_getImageCacheStats(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "budget", JS_NewUint32(ctx, g_image_cache_budget));
+  JS_SetPropertyStr(ctx, obj, "used", JS_NewUint32(ctx, g_image_cache_used));
+  JS_SetPropertyStr(ctx, obj, "entries", JS_NewUint32(ctx, g_image_cache.size()));
+  JS_SetPropertyStr(ctx, obj, "hits", JS_NewUint32(ctx, g_image_cache_hits));
+  JS_SetPropertyStr(ctx, obj, "misses", JS_NewUint32(ctx, g_image_cache_misses));
+  JS_SetPropertyStr(ctx, obj, "evictions", JS_NewUint32(ctx, g_image_cache_evictions));
+  JS_SetPropertyStr(ctx, obj, "revalidations", JS_NewUint32(ctx, g_image_cache_revalidations));
+  return obj;
+}
+
+static JSValue esp32_lcd_setTextCache(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t budget;
+  JS_ToUint32(ctx, &budget, argv[0]);
+  uint32_t glyph_budget = (budget > 0) ? LCD_GLYPH_CACHE_DEFAULT : 0;
+  if( argc >= 2 )
+    JS_ToUint32(ctx, &glyph_budget, argv[1]);
+
+  g_text_run_cache.setBudget(budget);
+  g_glyph_cache.setBudget(glyph_budget);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_lcd_clearTextCache(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  lcd_text_cache_clear();
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_lcd_getTextCacheStats(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t lookups = g_text_run_cache.hits() + g_text_run_cache.misses();
+  uint32_t glyph_lookups = g_glyph_cache.hits() + g_glyph_cache.misses();
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "budget", JS_NewUint32(ctx, g_text_run_cache.budget()));
+  JS_SetPropertyStr(ctx, obj, "used", JS_NewUint32(ctx, g_text_run_cache.used()));
+  JS_SetPropertyStr(ctx, obj, "runs", JS_NewUint32(ctx, g_text_run_cache.count()));
+  JS_SetPropertyStr(ctx, obj, "hits", JS_NewUint32(ctx, g_text_run_cache.hits()));
+  JS_SetPropertyStr(ctx, obj, "misses", JS_NewUint32(ctx, g_text_run_cache.misses()));
+  JS_SetPropertyStr(ctx, obj, "hitRate", JS_NewFloat64(ctx, lookups > 0 ? (double)g_text_run_cache.hits() / lookups : 0.0));
+  JS_SetPropertyStr(ctx, obj, "glyphBudget", JS_NewUint32(ctx, g_glyph_cache.budget()));
+  JS_SetPropertyStr(ctx, obj, "glyphUsed", JS_NewUint32(ctx, g_glyph_cache.used()));
+  JS_SetPropertyStr(ctx, obj, "glyphs", JS_NewUint32(ctx, g_glyph_cache.count()));
+  JS_SetPropertyStr(ctx, obj, "glyphHits", JS_NewUint32(ctx, g_glyph_cache.hits()));
+  JS_SetPropertyStr(ctx, obj, "glyphMisses", JS_NewUint32(ctx, g_glyph_cache.misses()));
+  JS_SetPropertyStr(ctx, obj, "glyphHitRate", JS_NewFloat64(ctx, glyph_lookups > 0 ? (double)g_glyph_cache.hits() / glyph_lookups : 0.0));
+  JS_SetPropertyStr(ctx, obj, "evictions", JS_NewUint32(ctx, g_text_run_cache.evictions() + g_glyph_cache.evictions()));
+  return obj;
+}
+
+static JSValue esp32_lcd_beginCanvas(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return JS_EXCEPTION;
+
+  if( g_canvas[magic].sprite != NULL )
+    return JS_NewBool(ctx, true);
+
+  return JS_NewBool(ctx, lcd_canvas_create(magic));
+}
+
+static JSValue esp32_lcd_endCanvas(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return JS_EXCEPTION;
+
+  lcd_canvas_delete(magic);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_lcd_present(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return JS_EXCEPTION;
+
+  if( g_canvas[magic].sprite == NULL )
+    return JS_EXCEPTION;
+
+  if( argc >= 1 && JS_ToBool(ctx, argv[0]) )
+    lcd_damage_all(magic);
+  lcd_canvas_present(magic);
+
+  return JS_NewUint32(ctx, g_canvas[magic].bytes_last);
+}
+
+static JSValue esp32_lcd_markDirty(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return JS_EXCEPTION;
+
+  if( argc < 4 ){
+    lcd_damage_all(magic);
+  }else{
+    int32_t x, y, w, h;
+    JS_ToInt32(ctx, &x, argv[0]);
+    JS_ToInt32(ctx, &y, argv[1]);
+    JS_ToInt32(ctx, &w, argv[2]);
+    JS_ToInt32(ctx, &h, argv[3]);
+    lcd_damage(magic, x, y, w, h);
+  }
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_lcd_getCanvasStats(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return JS_EXCEPTION;
+
+  LCD_CANVAS *p_canvas = &g_canvas[magic];
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "enabled", JS_NewBool(ctx, p_canvas->sprite != NULL));
+  JS_SetPropertyStr(ctx, obj, "frames", JS_NewUint32(ctx, p_canvas->frames));
+  JS_SetPropertyStr(ctx, obj, "dirty", JS_NewUint32(ctx, p_canvas->num_dirty));
+  JS_SetPropertyStr(ctx, obj, "rectsLast", JS_NewUint32(ctx, p_canvas->rects_last));
+  JS_SetPropertyStr(ctx, obj, "timeLast", JS_NewUint32(ctx, p_canvas->time_last));
+  JS_SetPropertyStr(ctx, obj, "timeMax", JS_NewUint32(ctx, p_canvas->time_max));
+  JS_SetPropertyStr(ctx, obj, "timeAvg", JS_NewUint32(ctx, p_canvas->frames > 0 ? (uint32_t)(p_canvas->time_total / p_canvas->frames) : 0));
+  JS_SetPropertyStr(ctx, obj, "bytesLast", JS_NewUint32(ctx, p_canvas->bytes_last));
+  JS_SetPropertyStr(ctx, obj, "bytesTotal", JS_NewFloat64(ctx, (double)p_canvas->bytes_total));
+  return obj;
+}
+
+#define LCD_WIDGET_STRIP_CHART  0
+#define LCD_WIDGET_SPARKLINE    1
+#define LCD_WIDGET_BAR_GAUGE    2
+#define LCD_WIDGET_READOUT      3
+
+#define LCD_WIDGET_FPS          30
+#define LCD_WIDGET_MAX_FPS      60
+#define LCD_WIDGET_MAX_CAPACITY 2048
+#define LCD_WIDGET_TEXT_LEN     32
+
+// retained widget drawn by loopModule_lcd on the frame clock, samples live in a ring buffer
+typedef struct {
+  uint8_t type;
+  int magic;
+  int32_t x, y, w, h;
+  double min, max;
+  bool autoscale;
+  uint32_t color;
+  uint32_t background;
+  bool has_grid;
+  uint32_t grid;
+  int32_t grid_step;
+  bool vertical;
+  char format[16];
+  float text_size;
+  uint8_t datum;
+  float *ring;
+  uint16_t capacity;
+  uint16_t head;
+  uint16_t count;
+  uint16_t pending; // samples not yet on screen
+  bool redraw;
+  int32_t drawn; // bar gauge: filled length on screen
+  char text[LCD_WIDGET_TEXT_LEN]; // readout: text on screen
+} LCD_WIDGET;
+
+static JSClassID g_widget_class_id = 0;
+static std::vector<LCD_WIDGET*> g_widgets;
+static uint8_t g_widget_fps = LCD_WIDGET_FPS;
+static uint32_t g_widget_last = 0;
+static uint32_t g_widget_frames = 0;
+static uint32_t g_widget_time_last = 0; // us
+static uint32_t g_widget_time_max = 0; // us
+static uint32_t g_widget_samples = 0;
+
+static void lcd_widget_release(LCD_WIDGET *p_widget)
+{
+  for( auto it = g_widgets.begin() ; it != g_widgets.end() ; it++ ){
+    if( *it == p_widget ){
+      g_widgets.erase(it);
+      break;
+    }
+  }
+  if( p_widget->ring != NULL ){
+    free(p_widget->ring);
+    p_widget->ring = NULL;
+  }
+}
+
+static void lcd_widget_finalizer(JSRuntime *rt, JSValue val)
+{
+  LCD_WIDGET *p_widget = (LCD_WIDGET*)JS_GetOpaque(val, g_widget_class_id);
+  if( p_widget == NULL )
+    return;
+  lcd_widget_release(p_widget);
+  free(p_widget);
+}
+
+static JSClassDef lcd_widget_class = {
+  "Widget",
+  lcd_widget_finalizer,
+};
+
+static LCD_WIDGET *lcd_widget_get(JSContext *ctx, JSValueConst obj)
+{
+  LCD_WIDGET *p_widget = (LCD_WIDGET*)JS_GetOpaque2(ctx, obj, g_widget_class_id);
+  if( p_widget == NULL )
+    return NULL;
+  if( p_widget->ring == NULL ){
+    JS_ThrowReferenceError(ctx, "widget already freed");
+    return NULL;
+  }
+  return p_widget;
+}
+
+static void lcd_widget_push(LCD_WIDGET *p_widget, float value)
+{
+  p_widget->ring[p_widget->head] = value;
+  p_widget->head = (p_widget->head + 1) % p_widget->capacity;
+  if( p_widget->count < p_widget->capacity )
+    p_widget->count++;
+  if( p_widget->pending < p_widget->capacity )
+    p_widget->pending++;
+  g_widget_samples++;
+}
+
+// age 0 is the newest sample
+static float lcd_widget_at(LCD_WIDGET *p_widget, uint16_t age)
+{
+  return p_widget->ring[(p_widget->head + p_widget->capacity - 1 - age) % p_widget->capacity];
+}
+
+static void lcd_widget_range(LCD_WIDGET *p_widget, double *p_min, double *p_max)
+{
+  *p_min = p_widget->min;
+  *p_max = p_widget->max;
+  if( !p_widget->autoscale || p_widget->count == 0 )
+    return;
+  *p_min = *p_max = lcd_widget_at(p_widget, 0);
+  for( uint16_t i = 1 ; i < p_widget->count ; i++ ){
+    double value = lcd_widget_at(p_widget, i);
+    if( value < *p_min ) *p_min = value;
+    if( value > *p_max ) *p_max = value;
+  }
+}
+
+// 0..span, clamped to the range
+static int32_t lcd_widget_scale(double value, double min, double max, int32_t span)
+{
+  if( max <= min )
+    return 0;
+  double ratio = (value - min) / (max - min);
+  if( ratio < 0.0 ) ratio = 0.0;
+  if( ratio > 1.0 ) ratio = 1.0;
+  return (int32_t)lround(ratio * span);
+}
+
+static void lcd_widget_chart_column(LovyanGFX &gfx, LCD_WIDGET *p_widget, int32_t col, uint16_t age)
+{
+  int32_t cx = p_widget->x + col;
+  int32_t bottom = p_widget->y + p_widget->h - 1;
+  gfx.drawFastVLine(cx, p_widget->y, p_widget->h, p_widget->background);
+  if( p_widget->has_grid ){
+    for( int32_t gy = bottom ; gy >= p_widget->y ; gy -= p_widget->grid_step )
+      gfx.drawPixel(cx, gy, p_widget->grid);
+  }
+  if( age >= p_widget->count )
+    return;
+
+  int32_t y1 = bottom - lcd_widget_scale(lcd_widget_at(p_widget, age), p_widget->min, p_widget->max, p_widget->h - 1);
+  int32_t y0 = y1;
+  if( age + 1 < p_widget->count )
+    y0 = bottom - lcd_widget_scale(lcd_widget_at(p_widget, age + 1), p_widget->min, p_widget->max, p_widget->h - 1);
+  gfx.drawFastVLine(cx, std::min(y0, y1), abs(y1 - y0) + 1, p_widget->color);
+}
+
+static void lcd_widget_draw_chart(LovyanGFX &gfx, LCD_WIDGET *p_widget)
+{
+  int32_t n = p_widget->pending;
+  if( p_widget->redraw || n >= p_widget->w ){
+    for( int32_t col = 0 ; col < p_widget->w ; col++ )
+      lcd_widget_chart_column(gfx, p_widget, col, p_widget->w - 1 - col);
+    return;
+  }
+
+  // scroll what is already on screen and draw only the new columns
+  gfx.copyRect(p_widget->x, p_widget->y, p_widget->w - n, p_widget->h, p_widget->x + n, p_widget->y);
+  for( int32_t i = 0 ; i < n ; i++ )
+    lcd_widget_chart_column(gfx, p_widget, p_widget->w - n + i, n - 1 - i);
+}
+
+static void lcd_widget_draw_sparkline(LovyanGFX &gfx, LCD_WIDGET *p_widget)
+{
+  gfx.fillRect(p_widget->x, p_widget->y, p_widget->w, p_widget->h, p_widget->background);
+  if( p_widget->count == 0 )
+    return;
+
+  double min, max;
+  lcd_widget_range(p_widget, &min, &max);
+  int32_t bottom = p_widget->y + p_widget->h - 1;
+  int32_t span = std::max((int32_t)p_widget->capacity - 1, (int32_t)1);
+  int32_t px = 0, py = 0;
+  for( int32_t i = 0 ; i < p_widget->count ; i++ ){
+    // oldest sample on the left, newest at the right edge
+    int32_t slot = p_widget->capacity - p_widget->count + i;
+    int32_t x = p_widget->x + slot * (p_widget->w - 1) / span;
+    int32_t y = bottom - lcd_widget_scale(lcd_widget_at(p_widget, p_widget->count - 1 - i), min, max, p_widget->h - 1);
+    if( i == 0 )
+      gfx.drawPixel(x, y, p_widget->color);
+    else
+      gfx.drawLine(px, py, x, y, p_widget->color);
+    px = x;
+    py = y;
+  }
+}
+
+static void lcd_widget_draw_gauge(LovyanGFX &gfx, LCD_WIDGET *p_widget)
+{
+  int32_t length = p_widget->vertical ? p_widget->h : p_widget->w;
+  int32_t fill = 0;
+  if( p_widget->count > 0 ){
+    // the ring averages the latest samples
+    double sum = 0.0;
+    for( uint16_t i = 0 ; i < p_widget->count ; i++ )
+      sum += lcd_widget_at(p_widget, i);
+    fill = lcd_widget_scale(sum / p_widget->count, p_widget->min, p_widget->max, length);
+  }
+
+  int32_t from = p_widget->drawn;
+  if( p_widget->redraw ){
+    gfx.fillRect(p_widget->x, p_widget->y, p_widget->w, p_widget->h, p_widget->background);
+    from = 0;
+  }
+  if( fill == from ){
+    p_widget->drawn = fill;
+    return;
+  }
+
+  int32_t start = std::min(from, fill);
+  int32_t size = abs(fill - from);
+  uint32_t color = (fill > from) ? p_widget->color : p_widget->background;
+  if( p_widget->vertical )
+    gfx.fillRect(p_widget->x, p_widget->y + p_widget->h - start - size, p_widget->w, size, color);
+  else
+    gfx.fillRect(p_widget->x + start, p_widget->y, size, p_widget->h, color);
+  p_widget->drawn = fill;
+}
+
+static void lcd_widget_draw_readout(LovyanGFX &gfx, LCD_WIDGET *p_widget)
+{
+  char text[LCD_WIDGET_TEXT_LEN] = "";
+  if( p_widget->count > 0 )
+    snprintf(text, sizeof(text), p_widget->format, (double)lcd_widget_at(p_widget, 0));
+  if( !p_widget->redraw && strcmp(text, p_widget->text) == 0 )
+    return;
+  strcpy(p_widget->text, text);
+
+  int32_t x = p_widget->x;
+  if( (p_widget->datum & 3) == 1 ) x += p_widget->w / 2;
+  else if( (p_widget->datum & 3) == 2 ) x += p_widget->w - 1;
+  int32_t y = p_widget->y;
+  if( p_widget->datum & 4 ) y += p_widget->h / 2;
+  else if( p_widget->datum & 8 ) y += p_widget->h - 1;
+
+  // the current font is kept, the text style and clip area are restored afterwards
+  lgfx::TextStyle style = gfx.getTextStyle();
+  int32_t cx, cy, cw, ch;
+  gfx.getClipRect(&cx, &cy, &cw, &ch);
+  gfx.setClipRect(p_widget->x, p_widget->y, p_widget->w, p_widget->h);
+  gfx.fillRect(p_widget->x, p_widget->y, p_widget->w, p_widget->h, p_widget->background);
+  gfx.setTextColor(p_widget->color, p_widget->background);
+  gfx.setTextSize(p_widget->text_size);
+  gfx.setTextDatum(p_widget->datum);
+  gfx.drawString(text, x, y);
+  gfx.setClipRect(cx, cy, cw, ch);
+  gfx.setTextStyle(style);
+}
+
+static void lcd_widget_draw(LCD_WIDGET *p_widget)
+{
+  LovyanGFX &gfx = lcd_target(p_widget->magic);
+  gfx.startWrite();
+  switch(p_widget->type){
+    case LCD_WIDGET_STRIP_CHART: lcd_widget_draw_chart(gfx, p_widget); break;
+    case LCD_WIDGET_SPARKLINE: lcd_widget_draw_sparkline(gfx, p_widget); break;
+    case LCD_WIDGET_BAR_GAUGE: lcd_widget_draw_gauge(gfx, p_widget); break;
+    case LCD_WIDGET_READOUT: lcd_widget_draw_readout(gfx, p_widget); break;
+  }
+  gfx.endWrite();
+  lcd_damage(p_widget->magic, p_widget->x, p_widget->y, p_widget->w, p_widget->h);
+  p_widget->pending = 0;
+  p_widget->redraw = false;
+}
+
+// one float conversion and nothing else, the value is passed as a double
+static bool lcd_widget_format_valid(const char *format)
+{
+  int conversions = 0;
+  for( const char *p = format ; *p != '\0' ; p++ ){
+    if( *p != '%' )
+      continue;
+    p++;
+    if( *p == '%' )
+      continue;
+    while( *p != '\0' && strchr("-+ #0123456789.", *p) != NULL )
+      p++;
+    if( *p == '\0' || strchr("feEgG", *p) == NULL )
+      return false;
+    conversions++;
+  }
+  return conversions == 1;
+}
+
+static JSValue lcd_widget_new(JSContext *ctx, int magic, uint8_t type, int argc, JSValueConst *argv)
+{
+  if( magic == 1 && g_external_display == -1 )
+    return JS_EXCEPTION;
+
+  int32_t x, y, w, h;
+  JS_ToInt32(ctx, &x, argv[0]);
+  JS_ToInt32(ctx, &y, argv[1]);
+  JS_ToInt32(ctx, &w, argv[2]);
+  JS_ToInt32(ctx, &h, argv[3]);
+  if( w <= 0 || h <= 0 )
+    return JS_EXCEPTION;
+
+  LCD_WIDGET *p_widget = (LCD_WIDGET*)calloc(1, sizeof(LCD_WIDGET));
+  if( p_widget == NULL )
+    return JS_EXCEPTION;
+  p_widget->type = type;
+  p_widget->magic = magic;
+  p_widget->x = x;
+  p_widget->y = y;
+  p_widget->w = w;
+  p_widget->h = h;
+  p_widget->min = 0.0;
+  p_widget->max = 100.0;
+  p_widget->color = TFT_GREEN;
+  p_widget->background = TFT_BLACK;
+  p_widget->grid_step = std::max(h / 4, (int32_t)2);
+  strcpy(p_widget->format, "%.1f");
+  p_widget->text_size = 1.0;
+  p_widget->datum = lgfx::middle_center;
+  p_widget->redraw = true;
+
+  uint32_t capacity = (type == LCD_WIDGET_STRIP_CHART || type == LCD_WIDGET_SPARKLINE) ? w : 1;
+  bool has_min = false, has_max = false;
+  if( argc >= 5 ){
+    JSValue value;
+    value = JS_GetPropertyStr(ctx, argv[4], "min");
+    if( value != JS_UNDEFINED ){
+      JS_ToFloat64(ctx, &p_widget->min, value);
+      has_min = true;
+    }
+    JS_FreeValue(ctx, value);
+    value = JS_GetPropertyStr(ctx, argv[4], "max");
+    if( value != JS_UNDEFINED ){
+      JS_ToFloat64(ctx, &p_widget->max, value);
+      has_max = true;
+    }
+    JS_FreeValue(ctx, value);
+    value = JS_GetPropertyStr(ctx, argv[4], "color");
+    if( value != JS_UNDEFINED )
+      JS_ToUint32(ctx, &p_widget->color, value);
+    JS_FreeValue(ctx, value);
+    value = JS_GetPropertyStr(ctx, argv[4], "background");
+    if( value != JS_UNDEFINED )
+      JS_ToUint32(ctx, &p_widget->background, value);
+    JS_FreeValue(ctx, value);
+    value = JS_GetPropertyStr(ctx, argv[4], "grid");
+    if( value != JS_UNDEFINED ){
+      JS_ToUint32(ctx, &p_widget->grid, value);
+      p_widget->has_grid = true;
+    }
+    JS_FreeValue(ctx, value);
+    value = JS_GetPropertyStr(ctx, argv[4], "gridStep");
+    if( value != JS_UNDEFINED ){
+      JS_ToInt32(ctx, &p_widget->grid_step, value);
+      if( p_widget->grid_step < 2 )
+        p_widget->grid_step = 2;
+    }
+    JS_FreeValue(ctx, value);
+    value = JS_GetPropertyStr(ctx, argv[4], "vertical");
+    if( value != JS_UNDEFINED )
+      p_widget->vertical = JS_ToBool(ctx, value);
+    JS_FreeValue(ctx, value);
+    value = JS_GetPropertyStr(ctx, argv[4], "capacity");
+    if( value != JS_UNDEFINED && type == LCD_WIDGET_SPARKLINE )
+      JS_ToUint32(ctx, &capacity, value);
+    JS_FreeValue(ctx, value);
+    value = JS_GetPropertyStr(ctx, argv[4], "average");
+    if( value != JS_UNDEFINED && type == LCD_WIDGET_BAR_GAUGE )
+      JS_ToUint32(ctx, &capacity, value);
+    JS_FreeValue(ctx, value);
+    value = JS_GetPropertyStr(ctx, argv[4], "format");
+    if( value != JS_UNDEFINED ){
+      const char *format = JS_ToCString(ctx, value);
+      bool valid = format != NULL && strlen(format) < sizeof(p_widget->format) && lcd_widget_format_valid(format);
+      if( valid )
+        strcpy(p_widget->format, format);
+      if( format != NULL )
+        JS_FreeCString(ctx, format);
+      if( !valid ){
+        JS_FreeValue(ctx, value);
+        free(p_widget);
+        return JS_EXCEPTION;
+      }
+    }
+    JS_FreeValue(ctx, value);
+    value = JS_GetPropertyStr(ctx, argv[4], "textSize");
+    if( value != JS_UNDEFINED ){
+      double size;
+      JS_ToFloat64(ctx, &size, value);
+      p_widget->text_size = size;
+    }
+    JS_FreeValue(ctx, value);
+    value = JS_GetPropertyStr(ctx, argv[4], "datum");
+    if( value != JS_UNDEFINED ){
+      uint32_t datum;
+      JS_ToUint32(ctx, &datum, value);
+      p_widget->datum = datum;
+    }
+    JS_FreeValue(ctx, value);
+  }
+  // a sparkline without a range follows its samples
+  p_widget->autoscale = (type == LCD_WIDGET_SPARKLINE && !has_min && !has_max);
+  if( p_widget->max <= p_widget->min && !p_widget->autoscale ){
+    free(p_widget);
+    return JS_EXCEPTION;
+  }
+  if( capacity < 1 || capacity > LCD_WIDGET_MAX_CAPACITY ){
+    free(p_widget);
+    return JS_EXCEPTION;
+  }
+
+  p_widget->capacity = capacity;
+  p_widget->ring = (float*)malloc(sizeof(float) * capacity);
+  if( p_widget->ring == NULL ){
+    free(p_widget);
+    return JS_EXCEPTION;
+  }
+
+  JSValue obj = JS_NewObjectClass(ctx, g_widget_class_id);
+  if( JS_IsException(obj) ){
+    free(p_widget->ring);
+    free(p_widget);
+    return obj;
+  }
+  JS_SetOpaque(obj, p_widget);
+  g_widgets.push_back(p_widget);
 
   return obj;
 }
 
-static JSValue esp32_lcd_createSpriteFromBmp(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+static JSValue esp32_lcd_createStripChart(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
 {
-  uint8_t *p_buffer;
-  uint8_t unit_size;
-  uint32_t unit_num;
-  JSValue vbuffer = getBinaryFromTypedArray(ctx, argv[0], (void**)&p_buffer, &unit_size, &unit_num);
-  if( JS_IsNull(vbuffer) )
-    return JS_EXCEPTION;
-  if( unit_size != 1 ){
-    JS_FreeValue(ctx, vbuffer);
-    return JS_EXCEPTION;
-  }
+  return lcd_widget_new(ctx, magic, LCD_WIDGET_STRIP_CHART, argc, argv);
+}
 
-  for( int i = 0 ; i < NUM_OF_SPRITE ; i++ ){
-    if(sprites[i] == NULL ){
-      sprites[i] = new LGFX_Sprite(&M5.Display);
-      sprites[i]->createFromBmp(p_buffer, unit_num);
-      JS_FreeValue(ctx, vbuffer);
-      return JS_NewUint32(ctx, i);
-    }
-  }
-  JS_FreeValue(ctx, vbuffer);
+static JSValue esp32_lcd_createSparkline(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  return lcd_widget_new(ctx, magic, LCD_WIDGET_SPARKLINE, argc, argv);
+}
 
-  return JS_EXCEPTION;
+static JSValue esp32_lcd_createBarGauge(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  return lcd_widget_new(ctx, magic, LCD_WIDGET_BAR_GAUGE, argc, argv);
 }
 
-#ifdef _SD_ENABLE_
-static JSValue esp32_lcd_createSpriteFromBmpFile(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+static JSValue esp32_lcd_createReadout(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
 {
-  const char *path = JS_ToCString(ctx, argv[0]);
-  if( path == NULL )
+  return lcd_widget_new(ctx, magic, LCD_WIDGET_READOUT, argc, argv);
+}
+
+static JSValue esp32_lcd_setWidgetFps(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t fps;
+  JS_ToUint32(ctx, &fps, argv[0]);
+  if( fps < 1 || fps > LCD_WIDGET_MAX_FPS )
     return JS_EXCEPTION;
 
-  for( int i = 0 ; i < NUM_OF_SPRITE ; i++ ){
-    if(sprites[i] == NULL ){
-      sprites[i] = new LGFX_Sprite(&M5.Display);
-      sprites[i]->createFromBmpFile(sd, path);
-      JS_FreeCString(ctx, path);
-      return JS_NewUint32(ctx, i);
-    }
-  }
-  JS_FreeCString(ctx, path);
+  g_widget_fps = fps;
 
-  return JS_EXCEPTION;
+  return JS_UNDEFINED;
 }
-#endif
 
-static JSValue esp32_lcd_freeSprite(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+static JSValue esp32_lcd_getWidgetStats(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  uint32_t id;
-  JS_ToUint32(ctx, &id, argv[0]);
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "widgets", JS_NewUint32(ctx, g_widgets.size()));
+  JS_SetPropertyStr(ctx, obj, "fps", JS_NewUint32(ctx, g_widget_fps));
+  JS_SetPropertyStr(ctx, obj, "frames", JS_NewUint32(ctx, g_widget_frames));
+  JS_SetPropertyStr(ctx, obj, "samples", JS_NewUint32(ctx, g_widget_samples));
+  JS_SetPropertyStr(ctx, obj, "timeLast", JS_NewUint32(ctx, g_widget_time_last));
+  JS_SetPropertyStr(ctx, obj, "timeMax", JS_NewUint32(ctx, g_widget_time_max));
+  return obj;
+}
 
-  if( id >= NUM_OF_SPRITE )
+// push(value) or push([value, ...]), drawn on the next frame
+static JSValue lcd_widget_push_value(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  LCD_WIDGET *p_widget = lcd_widget_get(ctx, jsThis);
+  if( p_widget == NULL )
     return JS_EXCEPTION;
 
-  if( sprites[id] == NULL )
-    return JS_UNDEFINED;
-  
-  delete sprites[id];
-  sprites[id] = NULL;
+  if( JS_IsArray(ctx, argv[0]) ){
+    JSValue jv = JS_GetPropertyStr(ctx, argv[0], "length");
+    uint32_t length;
+    JS_ToUint32(ctx, &length, jv);
+    JS_FreeValue(ctx, jv);
+    for( uint32_t i = 0 ; i < length ; i++ ){
+      JSValue item = JS_GetPropertyUint32(ctx, argv[0], i);
+      double value;
+      JS_ToFloat64(ctx, &value, item);
+      JS_FreeValue(ctx, item);
+      lcd_widget_push(p_widget, value);
+    }
+  }else{
+    double value;
+    JS_ToFloat64(ctx, &value, argv[0]);
+    lcd_widget_push(p_widget, value);
+  }
+  if( p_widget->autoscale )
+    p_widget->redraw = true;
 
   return JS_UNDEFINED;
 }
 
-static JSValue esp32_lcd_setPivot(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+static JSValue lcd_widget_setRange(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  uint32_t id;
-  JS_ToUint32(ctx, &id, argv[0]);
-
-  if( id >= NUM_OF_SPRITE )
+  LCD_WIDGET *p_widget = lcd_widget_get(ctx, jsThis);
+  if( p_widget == NULL )
     return JS_EXCEPTION;
 
-  if( sprites[id] == NULL )
+  double min, max;
+  JS_ToFloat64(ctx, &min, argv[0]);
+  JS_ToFloat64(ctx, &max, argv[1]);
+  if( max <= min )
     return JS_EXCEPTION;
-  
-  double x, y;
-  JS_ToFloat64(ctx, &x, argv[1]);
-  JS_ToFloat64(ctx, &y, argv[2]);
-
-  sprites[id]->setPivot(x, y);
+  p_widget->min = min;
+  p_widget->max = max;
+  p_widget->autoscale = false;
+  p_widget->redraw = true;
 
   return JS_UNDEFINED;
 }
 
-static JSValue esp32_lcd_pushSprite(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+static JSValue lcd_widget_setColor(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  uint32_t id;
-  JS_ToUint32(ctx, &id, argv[0]);
-  
-  if( id >= NUM_OF_SPRITE )
+  LCD_WIDGET *p_widget = lcd_widget_get(ctx, jsThis);
+  if( p_widget == NULL )
     return JS_EXCEPTION;
 
-  if( sprites[id] == NULL )
+  JS_ToUint32(ctx, &p_widget->color, argv[0]);
+  if( argc >= 2 )
+    JS_ToUint32(ctx, &p_widget->background, argv[1]);
+  p_widget->redraw = true;
+
+  return JS_UNDEFINED;
+}
+
+// magic 0: clear the samples, 1: redraw on the next frame
+static JSValue lcd_widget_reset(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv, int magic)
+{
+  LCD_WIDGET *p_widget = lcd_widget_get(ctx, jsThis);
+  if( p_widget == NULL )
     return JS_EXCEPTION;
-  
-  int32_t x, y;
-  JS_ToInt32(ctx, &x, argv[1]);
-  JS_ToInt32(ctx, &y, argv[2]);
 
-  if( argc >= 4 ){
-    uint32_t transp;
-    JS_ToUint32(ctx, &transp, argv[3]);
-    sprites[id]->pushSprite(x, y, transp);
-  }else{
-    sprites[id]->pushSprite(x, y);
+  if( magic == 0 ){
+    p_widget->head = 0;
+    p_widget->count = 0;
+    p_widget->pending = 0;
   }
+  p_widget->redraw = true;
 
   return JS_UNDEFINED;
 }
 
-static JSValue esp32_lcd_pushRotateZoom(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+static JSValue lcd_widget_free(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  uint32_t id;
-  JS_ToUint32(ctx, &id, argv[0]);
-  
-  if( id >= NUM_OF_SPRITE )
+  LCD_WIDGET *p_widget = (LCD_WIDGET*)JS_GetOpaque2(ctx, jsThis, g_widget_class_id);
+  if( p_widget == NULL )
     return JS_EXCEPTION;
+  lcd_widget_release(p_widget);
+  return JS_UNDEFINED;
+}
 
-  if( sprites[id] == NULL )
-    return JS_EXCEPTION;
-  
-  double dst_x, dst_y, angle, zoom_x, zoom_y;
-  JS_ToFloat64(ctx, &dst_x, argv[1]);
-  JS_ToFloat64(ctx, &dst_y, argv[2]);
-  JS_ToFloat64(ctx, &angle, argv[3]);
-  JS_ToFloat64(ctx, &zoom_x, argv[4]);
-  JS_ToFloat64(ctx, &zoom_y, argv[5]);
+static const JSCFunctionListEntry lcd_widget_funcs[] = {
+    JSCFunctionListEntry{"push", 0, JS_DEF_CFUNC, 0, {
+                           func : {1, JS_CFUNC_generic, lcd_widget_push_value}
+                         }},
+    JSCFunctionListEntry{"setRange", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic, lcd_widget_setRange}
+                         }},
+    JSCFunctionListEntry{"setColor", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic, lcd_widget_setColor}
+                         }},
+    JSCFunctionListEntry{"clear", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic_magic, {generic_magic : lcd_widget_reset}}
+                         }},
+    JSCFunctionListEntry{"redraw", 0, JS_DEF_CFUNC, 1, {
+                           func : {0, JS_CFUNC_generic_magic, {generic_magic : lcd_widget_reset}}
+                         }},
+    JSCFunctionListEntry{"free", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, lcd_widget_free}
+                         }},
+};
 
-  if( argc >= 7 ){
-    uint32_t transp;
-    JS_ToUint32(ctx, &transp, argv[6]);
-    sprites[id]->pushRotateZoom(dst_x, dst_y, angle, zoom_x, zoom_y, transp);
-  }else{
-    sprites[id]->pushRotateZoom(dst_x, dst_y, angle, zoom_x, zoom_y);
-  }
+static void lcd_widget_class_init(JSContext *ctx)
+{
+  JSRuntime *rt = JS_GetRuntime(ctx);
+  JS_NewClassID(&g_widget_class_id);
+  if( !JS_IsRegisteredClass(rt, g_widget_class_id) )
+    JS_NewClass(rt, g_widget_class_id, &lcd_widget_class);
 
-  return JS_UNDEFINED;
+  JSValue proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, proto, lcd_widget_funcs, sizeof(lcd_widget_funcs) / sizeof(JSCFunctionListEntry));
+  JS_SetClassProto(ctx, g_widget_class_id, proto);
 }
 
 static const JSCFunctionListEntry lcd_funcs[] = {
@@ -1004,11 +3454,11 @@ static const JSCFunctionListEntry lcd_funcs[] = {
                          }},
 #ifdef _SD_ENABLE_
     JSCFunctionListEntry{"drawImageFile", 0, JS_DEF_CFUNC, 0, {
-                           func : {3, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_draw_image_file}}
+                           func : {4, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_draw_image_file}}
                          }},
 #endif
     JSCFunctionListEntry{"drawImageUrl", 0, JS_DEF_CFUNC, 0, {
-                           func : {3, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_draw_image_url}}
+                           func : {4, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_draw_image_url}}
                          }},
     JSCFunctionListEntry{"drawImage", 0, JS_DEF_CFUNC, 0, {
                            func : {3, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_draw_image}}
@@ -1048,6 +3498,152 @@ static const JSCFunctionListEntry lcd_funcs[] = {
     JSCFunctionListEntry{"pushRotateZoom", 0, JS_DEF_CFUNC, 0, {
                            func : {7, JS_CFUNC_generic, esp32_lcd_pushRotateZoom}
                          }},
+    JSCFunctionListEntry{"submit", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_submit}}
+                         }},
+    JSCFunctionListEntry{"getSubmitStats", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_lcd_getSubmitStats}
+                         }},
+    JSCFunctionListEntry{"createSprite", 0, JS_DEF_CFUNC, 0, {
+                           func : {3, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createSprite}}
+                         }},
+    JSCFunctionListEntry{"createSpriteFromImage", 0, JS_DEF_CFUNC, 0, {
+                           func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createSpriteFromImage}}
+                         }},
+#ifdef _SD_ENABLE_
+    JSCFunctionListEntry{"createSpriteFromImageFile", 0, JS_DEF_CFUNC, 0, {
+                           func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createSpriteFromImageFile}}
+                         }},
+#endif
+    JSCFunctionListEntry{"getSpriteStats", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_lcd_getSpriteStats}
+                         }},
+    JSCFunctionListEntry{"setImageCache", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic, esp32_lcd_setImageCache}
+                         }},
+    JSCFunctionListEntry{"setTextCache", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic, esp32_lcd_setTextCache}
+                         }},
+    JSCFunctionListEntry{"clearTextCache", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_lcd_clearTextCache}
+                         }},
+    JSCFunctionListEntry{"getTextCacheStats", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_lcd_getTextCacheStats}
+                         }},
+    JSCFunctionListEntry{"clearImageCache", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_lcd_clearImageCache}
+                         }},
+    JSCFunctionListEntry{"preloadImage", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic, esp32_lcd_preloadImage}
+                         }},
+    JSCFunctionListEntry{"getImageCacheStats", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_lcd_getImageCacheStats}
+                         }},
+    JSCFunctionListEntry{"beginCanvas", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_beginCanvas}}
+                         }},
+    JSCFunctionListEntry{"endCanvas", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_endCanvas}}
+                         }},
+    JSCFunctionListEntry{"present", 0, JS_DEF_CFUNC, 0, {
+                           func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_present}}
+                         }},
+    JSCFunctionListEntry{"markDirty", 0, JS_DEF_CFUNC, 0, {
+                           func : {4, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_markDirty}}
+                         }},
+    JSCFunctionListEntry{"getCanvasStats", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_getCanvasStats}}
+                         }},
+    JSCFunctionListEntry{"createStripChart", 0, JS_DEF_CFUNC, 0, {
+                           func : {5, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createStripChart}}
+                         }},
+    JSCFunctionListEntry{"createSparkline", 0, JS_DEF_CFUNC, 0, {
+                           func : {5, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createSparkline}}
+                         }},
+    JSCFunctionListEntry{"createBarGauge", 0, JS_DEF_CFUNC, 0, {
+                           func : {5, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createBarGauge}}
+                         }},
+    JSCFunctionListEntry{"createReadout", 0, JS_DEF_CFUNC, 0, {
+                           func : {5, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createReadout}}
+                         }},
+    JSCFunctionListEntry{"setWidgetFps", 0, JS_DEF_CFUNC, 0, {
+                           func : {1, JS_CFUNC_generic, esp32_lcd_setWidgetFps}
+                         }},
+    JSCFunctionListEntry{"getWidgetStats", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_lcd_getWidgetStats}
+                         }},
+    JSCFunctionListEntry{
+        "op_pixel", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_PIXEL
+        }},
+    JSCFunctionListEntry{
+        "op_line", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_LINE
+        }},
+    JSCFunctionListEntry{
+        "op_hline", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_HLINE
+        }},
+    JSCFunctionListEntry{
+        "op_vline", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_VLINE
+        }},
+    JSCFunctionListEntry{
+        "op_rect", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_RECT
+        }},
+    JSCFunctionListEntry{
+        "op_fill_rect", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FILL_RECT
+        }},
+    JSCFunctionListEntry{
+        "op_round_rect", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_ROUND_RECT
+        }},
+    JSCFunctionListEntry{
+        "op_fill_round_rect", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FILL_ROUND_RECT
+        }},
+    JSCFunctionListEntry{
+        "op_circle", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_CIRCLE
+        }},
+    JSCFunctionListEntry{
+        "op_fill_circle", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FILL_CIRCLE
+        }},
+    JSCFunctionListEntry{
+        "op_triangle", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_TRIANGLE
+        }},
+    JSCFunctionListEntry{
+        "op_fill_triangle", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FILL_TRIANGLE
+        }},
+    JSCFunctionListEntry{
+        "op_fill_screen", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FILL_SCREEN
+        }},
+    JSCFunctionListEntry{
+        "op_text", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_TEXT
+        }},
+    JSCFunctionListEntry{
+        "op_text_color", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_TEXT_COLOR
+        }},
+    JSCFunctionListEntry{
+        "op_text_size", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_TEXT_SIZE
+        }},
+    JSCFunctionListEntry{
+        "op_text_datum", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_TEXT_DATUM
+        }},
+    JSCFunctionListEntry{
+        "op_font", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FONT
+        }},
     JSCFunctionListEntry{
         "top_left", 0, JS_DEF_PROP_INT32, 0, {
           i32 : lgfx::top_left
@@ -1170,11 +3766,11 @@ static const JSCFunctionListEntry lcd_funcs2[] = {
                          }},
 #ifdef _SD_ENABLE_
     JSCFunctionListEntry{"drawImageFile", 0, JS_DEF_CFUNC, 1, {
-                           func : {3, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_draw_image_file}}
+                           func : {4, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_draw_image_file}}
                          }},
 #endif
     JSCFunctionListEntry{"drawImageUrl", 0, JS_DEF_CFUNC, 1, {
-                           func : {3, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_draw_image_url}}
+                           func : {4, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_draw_image_url}}
                          }},
     JSCFunctionListEntry{"drawImage", 0, JS_DEF_CFUNC, 1, {
                            func : {3, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_draw_image}}
@@ -1197,6 +3793,131 @@ static const JSCFunctionListEntry lcd_funcs2[] = {
     JSCFunctionListEntry{"displayType", 0, JS_DEF_CFUNC, 0, {
                            func : {0, JS_CFUNC_generic, esp32_lcd_displayType}
                          }},
+    JSCFunctionListEntry{"submit", 0, JS_DEF_CFUNC, 1, {
+                           func : {2, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_submit}}
+                         }},
+    JSCFunctionListEntry{"getSubmitStats", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_lcd_getSubmitStats}
+                         }},
+    JSCFunctionListEntry{"createSprite", 0, JS_DEF_CFUNC, 1, {
+                           func : {3, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createSprite}}
+                         }},
+    JSCFunctionListEntry{"createSpriteFromImage", 0, JS_DEF_CFUNC, 1, {
+                           func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createSpriteFromImage}}
+                         }},
+#ifdef _SD_ENABLE_
+    JSCFunctionListEntry{"createSpriteFromImageFile", 0, JS_DEF_CFUNC, 1, {
+                           func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createSpriteFromImageFile}}
+                         }},
+#endif
+    JSCFunctionListEntry{"getSpriteStats", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_lcd_getSpriteStats}
+                         }},
+    JSCFunctionListEntry{"beginCanvas", 0, JS_DEF_CFUNC, 1, {
+                           func : {0, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_beginCanvas}}
+                         }},
+    JSCFunctionListEntry{"endCanvas", 0, JS_DEF_CFUNC, 1, {
+                           func : {0, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_endCanvas}}
+                         }},
+    JSCFunctionListEntry{"present", 0, JS_DEF_CFUNC, 1, {
+                           func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_present}}
+                         }},
+    JSCFunctionListEntry{"markDirty", 0, JS_DEF_CFUNC, 1, {
+                           func : {4, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_markDirty}}
+                         }},
+    JSCFunctionListEntry{"getCanvasStats", 0, JS_DEF_CFUNC, 1, {
+                           func : {0, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_getCanvasStats}}
+                         }},
+    JSCFunctionListEntry{"createStripChart", 0, JS_DEF_CFUNC, 1, {
+                           func : {5, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createStripChart}}
+                         }},
+    JSCFunctionListEntry{"createSparkline", 0, JS_DEF_CFUNC, 1, {
+                           func : {5, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createSparkline}}
+                         }},
+    JSCFunctionListEntry{"createBarGauge", 0, JS_DEF_CFUNC, 1, {
+                           func : {5, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createBarGauge}}
+                         }},
+    JSCFunctionListEntry{"createReadout", 0, JS_DEF_CFUNC, 1, {
+                           func : {5, JS_CFUNC_generic_magic, {generic_magic : esp32_lcd_createReadout}}
+                         }},
+    JSCFunctionListEntry{"setWidgetFps", 0, JS_DEF_CFUNC, 0, {
+                           func : {1, JS_CFUNC_generic, esp32_lcd_setWidgetFps}
+                         }},
+    JSCFunctionListEntry{"getWidgetStats", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, esp32_lcd_getWidgetStats}
+                         }},
+    JSCFunctionListEntry{
+        "op_pixel", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_PIXEL
+        }},
+    JSCFunctionListEntry{
+        "op_line", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_LINE
+        }},
+    JSCFunctionListEntry{
+        "op_hline", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_HLINE
+        }},
+    JSCFunctionListEntry{
+        "op_vline", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_VLINE
+        }},
+    JSCFunctionListEntry{
+        "op_rect", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_RECT
+        }},
+    JSCFunctionListEntry{
+        "op_fill_rect", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FILL_RECT
+        }},
+    JSCFunctionListEntry{
+        "op_round_rect", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_ROUND_RECT
+        }},
+    JSCFunctionListEntry{
+        "op_fill_round_rect", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FILL_ROUND_RECT
+        }},
+    JSCFunctionListEntry{
+        "op_circle", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_CIRCLE
+        }},
+    JSCFunctionListEntry{
+        "op_fill_circle", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FILL_CIRCLE
+        }},
+    JSCFunctionListEntry{
+        "op_triangle", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_TRIANGLE
+        }},
+    JSCFunctionListEntry{
+        "op_fill_triangle", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FILL_TRIANGLE
+        }},
+    JSCFunctionListEntry{
+        "op_fill_screen", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FILL_SCREEN
+        }},
+    JSCFunctionListEntry{
+        "op_text", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_TEXT
+        }},
+    JSCFunctionListEntry{
+        "op_text_color", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_TEXT_COLOR
+        }},
+    JSCFunctionListEntry{
+        "op_text_size", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_TEXT_SIZE
+        }},
+    JSCFunctionListEntry{
+        "op_text_datum", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_TEXT_DATUM
+        }},
+    JSCFunctionListEntry{
+        "op_font", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : LCD_OP_FONT
+        }},
     JSCFunctionListEntry{
         "top_left", 0, JS_DEF_PROP_INT32, 0, {
           i32 : lgfx::top_left
@@ -1287,6 +4008,10 @@ JSModuleDef *addModule_lcd(JSContext *ctx, JSValue global)
 {
   JSModuleDef *mod;
 
+  lcd_sprite_class_init(ctx);
+  lcd_widget_class_init(ctx);
+  g_sprite_pool_closed = false;
+
   mod = JS_NewCModule(ctx, "Lcd", [](JSContext *ctx, JSModuleDef *m){
         return JS_SetModuleExportList(
                             ctx, m, lcd_funcs,
@@ -1333,8 +4058,66 @@ long initialize_lcd(void)
   return 0;
 }
 
+void loopModule_lcd(void)
+{
+  if( g_widgets.size() == 0 )
+    return;
+
+  uint32_t now = millis();
+  if( now - g_widget_last < 1000 / g_widget_fps )
+    return;
+  g_widget_last = now;
+
+  uint32_t start = micros();
+  bool drawn = false;
+  for( LCD_WIDGET *p_widget : g_widgets ){
+    if( !p_widget->redraw && p_widget->pending == 0 )
+      continue;
+    if( p_widget->magic == 1 && g_external_display == -1 )
+      continue;
+    lcd_widget_draw(p_widget);
+    drawn = true;
+  }
+  if( drawn ){
+    g_widget_frames++;
+    g_widget_time_last = micros() - start;
+    if( g_widget_time_last > g_widget_time_max )
+      g_widget_time_max = g_widget_time_last;
+  }
+}
+
 void endModule_lcd(void)
 {
+  // live Widget objects are finalized with the context, they only have to stop drawing
+  g_widgets.clear();
+  g_widget_fps = LCD_WIDGET_FPS;
+  g_widget_frames = 0;
+  g_widget_time_last = 0;
+  g_widget_time_max = 0;
+  g_widget_samples = 0;
+  g_submit_calls = 0;
+  g_submit_ops = 0;
+  g_submit_time_last = 0;
+  g_submit_time_max = 0;
+
+  lcd_canvas_delete(0);
+  lcd_canvas_delete(1);
+  // live Sprite objects are finalized with the context, their buffers are freed directly from then on
+  g_sprite_pool_closed = true;
+  lcd_sprite_pool_clear();
+  lcd_image_cache_clear();
+  g_image_cache_budget = 0;
+  g_image_cache_max_age = LCD_IMAGE_CACHE_MAX_AGE;
+  g_image_cache_hits = 0;
+  g_image_cache_misses = 0;
+  g_image_cache_evictions = 0;
+  g_image_cache_revalidations = 0;
+  lcd_text_cache_clear();
+  g_text_run_cache.setBudget(0);
+  g_glyph_cache.setBudget(0);
+  g_text_run_cache.resetStats();
+  g_glyph_cache.resetStats();
+
   for( int i = 0 ; i < NUM_OF_SPRITE ; i++ ){
     if( sprites[i] != NULL ){
       delete sprites[i];
@@ -1363,7 +4146,7 @@ JsModuleEntry lcd_module = {
   "Lcd",
   initialize_lcd,
   addModule_lcd,
-  NULL,
+  loopModule_lcd,
   endModule_lcd
 };
 
@@ -9,6 +9,7 @@
 extern JsModuleEntry lcd_module;
 
 long module_lcd_setFont(uint16_t size, int magic);
+LovyanGFX* module_lcd_getSurface(int magic);
 
 #endif
 
@@ -1,16 +1,355 @@
 #include <Arduino.h>
+#include "main_config.h"
 #include "quickjs.h"
 #include "module_pixels.h"
 #include "module_type.h"
+#include "module_utils.h"
 #include <Adafruit_NeoPixel.h>
+#include <driver/rmt.h>
+#include <esp_timer.h>
+#include <vector>
 
 #define DEFAULT_NUMPIXELS  25
 
+#define PIXELS_RMT_CHANNEL          RMT_CHANNEL_0
+#define PIXELS_RMT_CLK_DIV          2
+#define PIXELS_TX_TIMEOUT           100
+#define PIXELS_RESET_US             300 // low time that latches a WS2812 frame
+#define PIXELS_ENGINE_MAX_FPS       200
+#define PIXELS_ENGINE_DEFAULT_FPS   30
+#define PIXELS_ENGINE_TASK_STACK    4096
+#define PIXELS_ENGINE_TASK_PRIORITY 5
+
+typedef enum {
+  PIXELS_ANIM_NONE = 0,
+  PIXELS_ANIM_FADE,
+  PIXELS_ANIM_GRADIENT,
+  PIXELS_ANIM_PALETTE,
+  PIXELS_ANIM_TEXT,
+} PIXELS_ANIM_TYPE;
+
+typedef struct {
+  PIXELS_ANIM_TYPE type;
+  uint32_t start; // ms
+  uint32_t duration; // ms, fade
+  float speed; // palette: entries/s, text: columns/s
+  float spread; // palette: entries per pixel
+  std::vector<uint32_t> colors; // fade target per pixel, gradient/palette stops
+  std::vector<uint32_t> from; // fade source per pixel
+  // text
+  std::vector<uint8_t> bitmap; // column major, bit per row
+  uint16_t bitmap_width;
+  uint16_t width;
+  uint16_t height;
+  bool serpentine;
+  uint32_t color;
+  uint32_t background;
+} PIXELS_ANIMATION;
+
 static Adafruit_NeoPixel *pixels = NULL;
 static uint16_t num_colors = 0;
 static uint32_t *last_colors = NULL;
 static bool onoff = true;
 
+// Adafruit_NeoPixel keeps the frame buffer, the RMT channel transmits it
+static bool g_rmt_installed = false;
+static uint8_t *g_tx_buffer[2] = { NULL, NULL };
+static uint8_t g_tx_index = 0;
+static uint32_t g_t0h_ticks, g_t0l_ticks, g_t1h_ticks, g_t1l_ticks, g_reset_ticks;
+static SemaphoreHandle_t g_pixels_mutex = NULL;
+
+static PIXELS_ANIMATION g_animation;
+static TaskHandle_t g_engine_task = NULL;
+static esp_timer_handle_t g_engine_timer = NULL;
+static volatile bool g_engine_running = false;
+static uint32_t g_engine_fps = 0;
+static volatile bool g_frame_dirty = false;
+
+typedef struct {
+  uint32_t frames;
+  uint32_t dropped;
+  uint32_t fps; // achieved, last window
+  uint32_t jitter_avg; // us, last window
+  uint32_t jitter_max; // us, last window
+  uint32_t render_time; // us, last frame
+} PIXELS_FRAME_STATS;
+static PIXELS_FRAME_STATS g_frame_stats;
+
+static void IRAM_ATTR pixels_rmt_adapter(const void *src, rmt_item32_t *dest, size_t src_size,
+                                         size_t wanted_num, size_t *translated_size, size_t *item_num)
+{
+  if( src == NULL || dest == NULL ){
+    *translated_size = 0;
+    *item_num = 0;
+    return;
+  }
+  rmt_item32_t bit0, bit1;
+  bit0.level0 = 1; bit0.duration0 = g_t0h_ticks; bit0.level1 = 0; bit0.duration1 = g_t0l_ticks;
+  bit1.level0 = 1; bit1.duration0 = g_t1h_ticks; bit1.level1 = 0; bit1.duration1 = g_t1l_ticks;
+
+  size_t size = 0;
+  size_t num = 0;
+  const uint8_t *psrc = (const uint8_t *)src;
+  while( size < src_size && num + 8 <= wanted_num ){
+    // the last byte goes out together with the reset item
+    if( size == src_size - 1 && num + 8 + 1 > wanted_num )
+      break;
+    for( int i = 0 ; i < 8 ; i++ ){
+      dest->val = (*psrc & (0x80 >> i)) ? bit1.val : bit0.val;
+      dest++;
+    }
+    num += 8;
+    size++;
+    psrc++;
+  }
+  if( size > 0 && size == src_size ){
+    // hold the line low after the last bit, so rmt_wait_tx_done() covers the latch
+    dest->level0 = 0; dest->duration0 = g_reset_ticks / 2;
+    dest->level1 = 0; dest->duration1 = g_reset_ticks - g_reset_ticks / 2;
+    num++;
+  }
+  *translated_size = size;
+  *item_num = num;
+}
+
+static void pixels_rmt_end(void)
+{
+  if( g_rmt_installed ){
+    rmt_wait_tx_done(PIXELS_RMT_CHANNEL, pdMS_TO_TICKS(PIXELS_TX_TIMEOUT));
+    rmt_driver_uninstall(PIXELS_RMT_CHANNEL);
+    g_rmt_installed = false;
+  }
+  for( int i = 0 ; i < 2 ; i++ ){
+    if( g_tx_buffer[i] != NULL ){
+      free(g_tx_buffer[i]);
+      g_tx_buffer[i] = NULL;
+    }
+  }
+}
+
+static long pixels_rmt_begin(uint8_t pin, uint16_t num)
+{
+  g_tx_buffer[0] = (uint8_t*)malloc(num * 3);
+  g_tx_buffer[1] = (uint8_t*)malloc(num * 3);
+  if( g_tx_buffer[0] == NULL || g_tx_buffer[1] == NULL ){
+    pixels_rmt_end();
+    return -1;
+  }
+
+  rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, PIXELS_RMT_CHANNEL);
+  config.clk_div = PIXELS_RMT_CLK_DIV;
+  if( rmt_config(&config) != ESP_OK || rmt_driver_install(config.channel, 0, 0) != ESP_OK ){
+    pixels_rmt_end();
+    return -1;
+  }
+  g_rmt_installed = true;
+
+  // WS2812: T0H 0.4us, T0L 0.85us, T1H 0.8us, T1L 0.45us
+  uint32_t counter_clk_hz;
+  rmt_get_counter_clock(config.channel, &counter_clk_hz);
+  float ratio = (float)counter_clk_hz / 1e9;
+  g_t0h_ticks = (uint32_t)(ratio * 400);
+  g_t0l_ticks = (uint32_t)(ratio * 850);
+  g_t1h_ticks = (uint32_t)(ratio * 800);
+  g_t1l_ticks = (uint32_t)(ratio * 450);
+  g_reset_ticks = (uint32_t)(ratio * PIXELS_RESET_US * 1000);
+  rmt_translator_init(config.channel, pixels_rmt_adapter);
+
+  return 0;
+}
+
+// call with g_pixels_mutex held. Returns immediately, the RMT ISR feeds the strip.
+static bool pixels_transmit(void)
+{
+  if( !g_rmt_installed )
+    return false;
+
+  // the previous frame, including its reset time, has to be out before the next one starts
+  if( rmt_wait_tx_done(PIXELS_RMT_CHANNEL, pdMS_TO_TICKS(PIXELS_TX_TIMEOUT)) != ESP_OK )
+    return false;
+  g_tx_index ^= 1;
+  memmove(g_tx_buffer[g_tx_index], pixels->getPixels(), num_colors * 3);
+  rmt_write_sample(PIXELS_RMT_CHANNEL, g_tx_buffer[g_tx_index], num_colors * 3, false);
+
+  return true;
+}
+
+// call with g_pixels_mutex held
+static void pixels_show(void)
+{
+  // the engine picks the frame up on its next tick
+  if( g_engine_running ){
+    g_frame_dirty = true;
+    return;
+  }
+  pixels_transmit();
+}
+
+static void pixels_stop_animation(void)
+{
+  g_animation.type = PIXELS_ANIM_NONE;
+  g_animation.colors.clear();
+  g_animation.from.clear();
+  g_animation.bitmap.clear();
+}
+
+static uint32_t color_lerp(uint32_t c0, uint32_t c1, float t)
+{
+  uint8_t r = ((c0 >> 16) & 0xff) + (((int32_t)((c1 >> 16) & 0xff) - (int32_t)((c0 >> 16) & 0xff)) * t);
+  uint8_t g = ((c0 >> 8) & 0xff) + (((int32_t)((c1 >> 8) & 0xff) - (int32_t)((c0 >> 8) & 0xff)) * t);
+  uint8_t b = (c0 & 0xff) + (((int32_t)(c1 & 0xff) - (int32_t)(c0 & 0xff)) * t);
+  return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+}
+
+// call with g_pixels_mutex held, returns false when nothing changed
+static bool pixels_render(uint32_t now)
+{
+  PIXELS_ANIMATION *p_anim = &g_animation;
+  float elapsed = (now - p_anim->start) / 1000.0f;
+
+  switch( p_anim->type ){
+    case PIXELS_ANIM_FADE: {
+      float t = (p_anim->duration == 0) ? 1.0f : (float)(now - p_anim->start) / p_anim->duration;
+      if( t > 1.0f )
+        t = 1.0f;
+      for( uint16_t i = 0 ; i < num_colors ; i++ )
+        pixels->setPixelColor(i, color_lerp(p_anim->from[i], p_anim->colors[i], t));
+      if( t >= 1.0f )
+        pixels_stop_animation();
+      break;
+    }
+    case PIXELS_ANIM_GRADIENT: {
+      uint32_t num_stops = p_anim->colors.size();
+      for( uint16_t i = 0 ; i < num_colors ; i++ ){
+        float pos = (num_colors <= 1) ? 0.0f : (float)i * (num_stops - 1) / (num_colors - 1);
+        uint32_t index = (uint32_t)pos;
+        if( index >= num_stops - 1 )
+          pixels->setPixelColor(i, p_anim->colors[num_stops - 1]);
+        else
+          pixels->setPixelColor(i, color_lerp(p_anim->colors[index], p_anim->colors[index + 1], pos - index));
+      }
+      pixels_stop_animation(); // static, rendered once
+      break;
+    }
+    case PIXELS_ANIM_PALETTE: {
+      uint32_t num_entries = p_anim->colors.size();
+      for( uint16_t i = 0 ; i < num_colors ; i++ ){
+        float pos = fmodf(i * p_anim->spread + elapsed * p_anim->speed, (float)num_entries);
+        if( pos < 0 )
+          pos += num_entries;
+        uint32_t index = (uint32_t)pos;
+        pixels->setPixelColor(i, color_lerp(p_anim->colors[index % num_entries], p_anim->colors[(index + 1) % num_entries], pos - index));
+      }
+      break;
+    }
+    case PIXELS_ANIM_TEXT: {
+      // scrolls in from the right edge, out to the left, then repeats
+      uint32_t period = p_anim->bitmap_width + p_anim->width;
+      int32_t offset = (int32_t)(elapsed * p_anim->speed) % period;
+      for( uint16_t y = 0 ; y < p_anim->height ; y++ ){
+        for( uint16_t x = 0 ; x < p_anim->width ; x++ ){
+          int32_t column = (int32_t)x + offset - p_anim->width;
+          bool on = column >= 0 && column < p_anim->bitmap_width && (p_anim->bitmap[column] & (1 << y));
+          uint16_t px = (p_anim->serpentine && (y & 1)) ? (p_anim->width - 1 - x) : x;
+          uint32_t index = y * p_anim->width + px;
+          if( index < num_colors )
+            pixels->setPixelColor(index, on ? p_anim->color : p_anim->background);
+        }
+      }
+      break;
+    }
+    default:
+      return false;
+  }
+
+  return true;
+}
+
+static void engine_timer_callback(void *arg)
+{
+  TaskHandle_t task = g_engine_task;
+  if( task != NULL )
+    xTaskNotifyGive(task);
+}
+
+static void engine_task(void *arg)
+{
+  int64_t period = 1000000 / g_engine_fps;
+  int64_t last = 0;
+  uint32_t window_start = millis();
+  uint32_t window_frames = 0;
+  uint64_t window_jitter = 0;
+  uint32_t window_jitter_max = 0;
+
+  while( g_engine_running ){
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    if( !g_engine_running )
+      break;
+
+    int64_t tick = esp_timer_get_time();
+    if( last != 0 ){
+      uint32_t jitter = (uint32_t)llabs(tick - last - period);
+      window_jitter += jitter;
+      if( jitter > window_jitter_max )
+        window_jitter_max = jitter;
+    }
+    last = tick;
+
+    xSemaphoreTake(g_pixels_mutex, portMAX_DELAY);
+    if( pixels != NULL ){
+      bool changed = pixels_render(millis()) || g_frame_dirty;
+      if( changed ){
+        if( rmt_wait_tx_done(PIXELS_RMT_CHANNEL, 0) != ESP_OK ){
+          // the buffer already holds this frame, resend it on the next tick
+          g_frame_stats.dropped++;
+          g_frame_dirty = true;
+        }else{
+          g_frame_dirty = false;
+          pixels_transmit();
+        }
+      }
+    }
+    xSemaphoreGive(g_pixels_mutex);
+    g_frame_stats.render_time = (uint32_t)(esp_timer_get_time() - tick);
+    g_frame_stats.frames++;
+
+    window_frames++;
+    uint32_t now = millis();
+    if( now - window_start >= 1000 ){
+      g_frame_stats.fps = window_frames * 1000 / (now - window_start);
+      g_frame_stats.jitter_avg = (window_frames > 1) ? window_jitter / (window_frames - 1) : 0;
+      g_frame_stats.jitter_max = window_jitter_max;
+      window_start = now;
+      window_frames = 0;
+      window_jitter = 0;
+      window_jitter_max = 0;
+    }
+  }
+
+  g_engine_task = NULL;
+  vTaskDelete(NULL);
+}
+
+static void stop_engine(void)
+{
+  if( g_engine_timer != NULL ){
+    esp_timer_stop(g_engine_timer);
+    esp_timer_delete(g_engine_timer);
+    g_engine_timer = NULL;
+  }
+  if( g_engine_task != NULL ){
+    g_engine_running = false;
+    xTaskNotifyGive(g_engine_task);
+    while( g_engine_task != NULL )
+      delay(1);
+  }
+  g_engine_fps = 0;
+  g_frame_dirty = false;
+  memset(&g_frame_stats, 0, sizeof(g_frame_stats));
+}
+
+void endModule_pixels(void);
+
 static JSValue esp32_pixels_begin(JSContext *ctx, JSValueConst jsThis,
                                       int argc, JSValueConst *argv)
 {
@@ -20,14 +359,7 @@ static JSValue esp32_pixels_begin(JSContext *ctx, JSValueConst jsThis,
   if( argc >= 2 )
     JS_ToUint32(ctx, &num, argv[1]);
 
-  if( pixels != NULL ){
-    delete pixels;
-    pixels = NULL;
-  }
-  if( last_colors != NULL ){
-    free(last_colors);
-    last_colors = NULL;
-  }
+  endModule_pixels();
 
   last_colors = (uint32_t*)calloc(num, sizeof(uint32_t));
   if( last_colors == NULL )
@@ -35,6 +367,10 @@ static JSValue esp32_pixels_begin(JSContext *ctx, JSValueConst jsThis,
   num_colors = num;
   pixels = new Adafruit_NeoPixel(num_colors, pin, NEO_GRB + NEO_KHZ800);
   pixels->begin();
+  if( pixels_rmt_begin(pin, num_colors) != 0 ){
+    endModule_pixels();
+    return JS_EXCEPTION;
+  }
 
   return JS_UNDEFINED;
 }
@@ -46,8 +382,11 @@ static JSValue esp32_pixels_clear(JSContext *ctx, JSValueConst jsThis,
     return JS_EXCEPTION;
   }
   
+  xSemaphoreTake(g_pixels_mutex, portMAX_DELAY);
+  pixels_stop_animation();
   pixels->clear();
-  pixels->show();
+  pixels_show();
+  xSemaphoreGive(g_pixels_mutex);
 
   return JS_UNDEFINED;
 }
@@ -61,6 +400,8 @@ static JSValue esp32_pixels_setOnoff(JSContext *ctx, JSValueConst jsThis,
 
   onoff = JS_ToBool(ctx, argv[0]);
 
+  xSemaphoreTake(g_pixels_mutex, portMAX_DELAY);
+  pixels_stop_animation();
   if( onoff ){
     for( int i = 0 ; i < num_colors ; i++ )
       pixels->setPixelColor(i, last_colors[i]);
@@ -69,7 +410,8 @@ static JSValue esp32_pixels_setOnoff(JSContext *ctx, JSValueConst jsThis,
       last_colors[i] = pixels->getPixelColor(i);
     pixels->clear();
   }
-  pixels->show();
+  pixels_show();
+  xSemaphoreGive(g_pixels_mutex);
 
   return JS_UNDEFINED;
 }
@@ -92,8 +434,11 @@ static JSValue esp32_pixels_setPixelColor(JSContext *ctx, JSValueConst jsThis,
   JS_ToUint32(ctx, &color, argv[1]);
 
   onoff = true;
+  xSemaphoreTake(g_pixels_mutex, portMAX_DELAY);
+  pixels_stop_animation();
   pixels->setPixelColor(index, color);
-  pixels->show();
+  pixels_show();
+  xSemaphoreGive(g_pixels_mutex);
 
   return JS_UNDEFINED;
 }
@@ -108,11 +453,338 @@ static JSValue esp32_pixels_getPixelColor(JSContext *ctx, JSValueConst jsThis,
   uint32_t index;
   JS_ToUint32(ctx, &index, argv[0]);
 
+  xSemaphoreTake(g_pixels_mutex, portMAX_DELAY);
   uint32_t ret = pixels->getPixelColor(index);
+  xSemaphoreGive(g_pixels_mutex);
 
   return JS_NewUint32(ctx, ret);
 }
 
+static JSValue esp32_pixels_setPixels(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  if( pixels == NULL ){
+    return JS_EXCEPTION;
+  }
+
+  uint32_t start = 0;
+  if( argc >= 2 )
+    JS_ToUint32(ctx, &start, argv[1]);
+
+  // Uint8Array: r,g,b per pixel, Uint32Array: 0xRRGGBB per pixel
+  void *p_buffer;
+  uint8_t unit_size;
+  uint32_t unit_num;
+  JSValue vbuffer = getBinaryFromTypedArray(ctx, argv[0], &p_buffer, &unit_size, &unit_num);
+  if( JS_IsNull(vbuffer) )
+    return JS_EXCEPTION;
+
+  xSemaphoreTake(g_pixels_mutex, portMAX_DELAY);
+  pixels_stop_animation();
+  if( unit_size == 1 ){
+    const uint8_t *p_rgb = (const uint8_t*)p_buffer;
+    for( uint32_t i = 0 ; i < unit_num / 3 && start + i < num_colors ; i++ )
+      pixels->setPixelColor(start + i, p_rgb[i * 3], p_rgb[i * 3 + 1], p_rgb[i * 3 + 2]);
+  }else if( unit_size == 4 ){
+    const uint32_t *p_color = (const uint32_t*)p_buffer;
+    for( uint32_t i = 0 ; i < unit_num / 4 && start + i < num_colors ; i++ )
+      pixels->setPixelColor(start + i, p_color[i]);
+  }else{
+    xSemaphoreGive(g_pixels_mutex);
+    JS_FreeValue(ctx, vbuffer);
+    return JS_EXCEPTION;
+  }
+  JS_FreeValue(ctx, vbuffer);
+
+  onoff = true;
+  pixels_show();
+  xSemaphoreGive(g_pixels_mutex);
+
+  return JS_UNDEFINED;
+}
+
+static long get_color_list(JSContext *ctx, JSValue value, std::vector<uint32_t> *p_colors)
+{
+  p_colors->clear();
+  if( JS_IsNumber(value) ){
+    uint32_t color;
+    JS_ToUint32(ctx, &color, value);
+    p_colors->push_back(color);
+  }else if( JS_IsArray(ctx, value) ){
+    int32_t *p_array;
+    uint32_t num;
+    if( getNumberArray(ctx, value, &p_array, &num) != 0 )
+      return -1;
+    p_colors->assign(p_array, p_array + num);
+    free(p_array);
+  }else{
+    void *p_buffer;
+    uint8_t unit_size;
+    uint32_t unit_num;
+    JSValue vbuffer = getBinaryFromTypedArray(ctx, value, &p_buffer, &unit_size, &unit_num);
+    if( JS_IsNull(vbuffer) )
+      return -1;
+    if( unit_size != 4 ){
+      JS_FreeValue(ctx, vbuffer);
+      return -1;
+    }
+    p_colors->assign((uint32_t*)p_buffer, (uint32_t*)p_buffer + unit_num / 4);
+    JS_FreeValue(ctx, vbuffer);
+  }
+
+  return p_colors->size() > 0 ? 0 : -1;
+}
+
+static long start_engine(uint32_t fps)
+{
+  if( g_engine_task != NULL && g_engine_fps == fps )
+    return 0;
+  stop_engine();
+
+  g_engine_fps = fps;
+  g_engine_running = true;
+  BaseType_t ret = xTaskCreate(engine_task, "pixels_engine", PIXELS_ENGINE_TASK_STACK, NULL, PIXELS_ENGINE_TASK_PRIORITY, &g_engine_task);
+  if( ret != pdPASS ){
+    g_engine_running = false;
+    g_engine_task = NULL;
+    stop_engine();
+    return -1;
+  }
+
+  esp_timer_create_args_t timer_args = {};
+  timer_args.callback = engine_timer_callback;
+  timer_args.name = "pixels_engine";
+  if( esp_timer_create(&timer_args, &g_engine_timer) != ESP_OK ||
+      esp_timer_start_periodic(g_engine_timer, 1000000 / fps) != ESP_OK ){
+    stop_engine();
+    return -1;
+  }
+
+  return 0;
+}
+
+static JSValue esp32_pixels_setAll(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  if( pixels == NULL ){
+    return JS_EXCEPTION;
+  }
+
+  std::vector<uint32_t> colors;
+  if( get_color_list(ctx, argv[0], &colors) != 0 )
+    return JS_EXCEPTION;
+
+  xSemaphoreTake(g_pixels_mutex, portMAX_DELAY);
+  pixels_stop_animation();
+  if( colors.size() == 1 ){
+    pixels->fill(colors[0]);
+  }else{
+    for( uint16_t i = 0 ; i < num_colors && i < colors.size() ; i++ )
+      pixels->setPixelColor(i, colors[i]);
+  }
+  onoff = true;
+  pixels_show();
+  xSemaphoreGive(g_pixels_mutex);
+
+  return JS_UNDEFINED;
+}
+
+static long render_text(const char *p_text, PIXELS_ANIMATION *p_anim)
+{
+  M5Canvas canvas;
+  canvas.setColorDepth(1);
+  canvas.setFont(p_anim->height < 8 ? &fonts::TomThumb : &fonts::Font0);
+  int32_t width = canvas.textWidth(p_text);
+  if( width <= 0 )
+    return -1;
+  if( canvas.createSprite(width, p_anim->height) == NULL )
+    return -1;
+  canvas.fillScreen(0);
+  canvas.setTextColor(1);
+  canvas.drawString(p_text, 0, 0);
+
+  p_anim->bitmap.assign(width, 0);
+  p_anim->bitmap_width = width;
+  for( int32_t x = 0 ; x < width ; x++ ){
+    for( uint16_t y = 0 ; y < p_anim->height && y < 8 ; y++ ){
+      if( canvas.readPixel(x, y) != 0 )
+        p_anim->bitmap[x] |= 1 << y;
+    }
+  }
+  canvas.deleteSprite();
+
+  return 0;
+}
+
+static JSValue esp32_pixels_animate(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  if( pixels == NULL ){
+    return JS_EXCEPTION;
+  }
+
+  PIXELS_ANIMATION anim;
+  anim.type = PIXELS_ANIM_NONE;
+  anim.duration = 1000;
+  anim.speed = 1.0f;
+  anim.spread = 1.0f;
+  anim.bitmap_width = 0;
+  anim.width = num_colors;
+  anim.height = 1;
+  anim.serpentine = false;
+  anim.color = 0xffffff;
+  anim.background = 0x000000;
+
+  JSValue value = JS_GetPropertyStr(ctx, argv[0], "type");
+  const char *p_type = JS_ToCString(ctx, value);
+  JS_FreeValue(ctx, value);
+  if( p_type == NULL )
+    return JS_EXCEPTION;
+  if( strcmp(p_type, "fade") == 0 ) anim.type = PIXELS_ANIM_FADE;
+  else if( strcmp(p_type, "gradient") == 0 ) anim.type = PIXELS_ANIM_GRADIENT;
+  else if( strcmp(p_type, "palette") == 0 ) anim.type = PIXELS_ANIM_PALETTE;
+  else if( strcmp(p_type, "text") == 0 ) anim.type = PIXELS_ANIM_TEXT;
+  JS_FreeCString(ctx, p_type);
+  if( anim.type == PIXELS_ANIM_NONE )
+    return JS_EXCEPTION;
+
+  double number;
+  value = JS_GetPropertyStr(ctx, argv[0], "duration");
+  if( value != JS_UNDEFINED )
+    JS_ToUint32(ctx, &anim.duration, value);
+  value = JS_GetPropertyStr(ctx, argv[0], "speed");
+  if( value != JS_UNDEFINED ){
+    JS_ToFloat64(ctx, &number, value);
+    anim.speed = number;
+  }
+  value = JS_GetPropertyStr(ctx, argv[0], "spread");
+  if( value != JS_UNDEFINED ){
+    JS_ToFloat64(ctx, &number, value);
+    anim.spread = number;
+  }
+  value = JS_GetPropertyStr(ctx, argv[0], "color");
+  if( value != JS_UNDEFINED )
+    JS_ToUint32(ctx, &anim.color, value);
+  value = JS_GetPropertyStr(ctx, argv[0], "background");
+  if( value != JS_UNDEFINED )
+    JS_ToUint32(ctx, &anim.background, value);
+  uint32_t size;
+  value = JS_GetPropertyStr(ctx, argv[0], "width");
+  if( value != JS_UNDEFINED ){
+    JS_ToUint32(ctx, &size, value);
+    anim.width = size;
+  }
+  value = JS_GetPropertyStr(ctx, argv[0], "height");
+  if( value != JS_UNDEFINED ){
+    JS_ToUint32(ctx, &size, value);
+    anim.height = size;
+  }
+  value = JS_GetPropertyStr(ctx, argv[0], "serpentine");
+  if( value != JS_UNDEFINED )
+    anim.serpentine = JS_ToBool(ctx, value);
+
+  if( anim.type == PIXELS_ANIM_TEXT ){
+    if( anim.width == 0 || anim.height == 0 || anim.height > 8 )
+      return JS_EXCEPTION;
+    value = JS_GetPropertyStr(ctx, argv[0], "text");
+    const char *p_text = JS_ToCString(ctx, value);
+    JS_FreeValue(ctx, value);
+    if( p_text == NULL )
+      return JS_EXCEPTION;
+    long ret = render_text(p_text, &anim);
+    JS_FreeCString(ctx, p_text);
+    if( ret != 0 )
+      return JS_EXCEPTION;
+  }else{
+    const char *p_name = (anim.type == PIXELS_ANIM_FADE) ? "to" : "colors";
+    value = JS_GetPropertyStr(ctx, argv[0], p_name);
+    long ret = get_color_list(ctx, value, &anim.colors);
+    JS_FreeValue(ctx, value);
+    if( ret != 0 )
+      return JS_EXCEPTION;
+    if( anim.type == PIXELS_ANIM_FADE )
+      anim.colors.resize(num_colors, anim.colors.size() == 1 ? anim.colors[0] : anim.colors.back());
+  }
+
+  // the engine has to run for the animation to advance
+  if( g_engine_task == NULL && start_engine(PIXELS_ENGINE_DEFAULT_FPS) != 0 )
+    return JS_EXCEPTION;
+
+  xSemaphoreTake(g_pixels_mutex, portMAX_DELAY);
+  if( anim.type == PIXELS_ANIM_FADE ){
+    anim.from.resize(num_colors);
+    for( uint16_t i = 0 ; i < num_colors ; i++ )
+      anim.from[i] = pixels->getPixelColor(i);
+  }
+  anim.start = millis();
+  g_animation = anim;
+  onoff = true;
+  xSemaphoreGive(g_pixels_mutex);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_pixels_stopAnimation(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  if( g_pixels_mutex == NULL )
+    return JS_UNDEFINED;
+
+  xSemaphoreTake(g_pixels_mutex, portMAX_DELAY);
+  pixels_stop_animation();
+  xSemaphoreGive(g_pixels_mutex);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_pixels_isAnimating(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  return JS_NewBool(ctx, g_animation.type != PIXELS_ANIM_NONE);
+}
+
+static JSValue esp32_pixels_startEngine(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  if( pixels == NULL ){
+    return JS_EXCEPTION;
+  }
+
+  uint32_t fps = PIXELS_ENGINE_DEFAULT_FPS;
+  if( argc >= 1 )
+    JS_ToUint32(ctx, &fps, argv[0]);
+  if( fps == 0 || fps > PIXELS_ENGINE_MAX_FPS )
+    return JS_EXCEPTION;
+
+  if( start_engine(fps) != 0 )
+    return JS_EXCEPTION;
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_pixels_stopEngine(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  stop_engine();
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_pixels_getFrameStats(JSContext *ctx, JSValueConst jsThis,
+                                     int argc, JSValueConst *argv)
+{
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "running", JS_NewBool(ctx, g_engine_task != NULL));
+  JS_SetPropertyStr(ctx, obj, "targetFps", JS_NewUint32(ctx, g_engine_fps));
+  JS_SetPropertyStr(ctx, obj, "fps", JS_NewUint32(ctx, g_frame_stats.fps));
+  JS_SetPropertyStr(ctx, obj, "frames", JS_NewUint32(ctx, g_frame_stats.frames));
+  JS_SetPropertyStr(ctx, obj, "dropped", JS_NewUint32(ctx, g_frame_stats.dropped));
+  JS_SetPropertyStr(ctx, obj, "jitterAvg", JS_NewUint32(ctx, g_frame_stats.jitter_avg));
+  JS_SetPropertyStr(ctx, obj, "jitterMax", JS_NewUint32(ctx, g_frame_stats.jitter_max));
+  JS_SetPropertyStr(ctx, obj, "renderTime", JS_NewUint32(ctx, g_frame_stats.render_time));
+  return obj;
+}
+
 static const JSCFunctionListEntry pixels_funcs[] = {
     JSCFunctionListEntry{
         "begin", 0, JS_DEF_CFUNC, 0, {
@@ -138,6 +810,38 @@ static const JSCFunctionListEntry pixels_funcs[] = {
         "getPixelColor", 0, JS_DEF_CFUNC, 0, {
           func : {1, JS_CFUNC_generic, esp32_pixels_getPixelColor}
         }},
+    JSCFunctionListEntry{
+        "setPixels", 0, JS_DEF_CFUNC, 0, {
+          func : {2, JS_CFUNC_generic, esp32_pixels_setPixels}
+        }},
+    JSCFunctionListEntry{
+        "setAll", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic, esp32_pixels_setAll}
+        }},
+    JSCFunctionListEntry{
+        "animate", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic, esp32_pixels_animate}
+        }},
+    JSCFunctionListEntry{
+        "stopAnimation", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, esp32_pixels_stopAnimation}
+        }},
+    JSCFunctionListEntry{
+        "isAnimating", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, esp32_pixels_isAnimating}
+        }},
+    JSCFunctionListEntry{
+        "startEngine", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic, esp32_pixels_startEngine}
+        }},
+    JSCFunctionListEntry{
+        "stopEngine", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, esp32_pixels_stopEngine}
+        }},
+    JSCFunctionListEntry{
+        "getFrameStats", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, esp32_pixels_getFrameStats}
+        }},
 };
 
 JSModuleDef *addModule_pixels(JSContext *ctx, JSValue global)
@@ -159,6 +863,9 @@ JSModuleDef *addModule_pixels(JSContext *ctx, JSValue global)
 
 void endModule_pixels(void)
 {
+  stop_engine();
+  pixels_stop_animation();
+  pixels_rmt_end();
   if( pixels != NULL ){
     delete pixels;
     pixels = NULL;
@@ -169,9 +876,18 @@ void endModule_pixels(void)
   }
 }
 
+long initializeModule_pixels(void)
+{
+  g_pixels_mutex = xSemaphoreCreateMutex();
+  if( g_pixels_mutex == NULL )
+    return -1;
+
+  return 0;
+}
+
 JsModuleEntry pixels_module = {
   "Pixels",
-  NULL,
+  initializeModule_pixels,
   addModule_pixels,
   NULL,
   endModule_pixels
@@ -5,6 +5,7 @@
 
 #include "module_type.h"
 #include "quickjs.h"
+#include "module_esp32.h"
 
 static JSValue esp32_rtc_SetTime(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
@@ -16,7 +17,9 @@ static JSValue esp32_rtc_SetTime(JSContext *ctx, JSValueConst jsThis, int argc,
   def.hours = hours;
   def.minutes = minutes;
   def.seconds = seconds;
+  esp32_internal_bus_lock();
   M5.Rtc.setTime(&def);
+  esp32_internal_bus_unlock();
   return JS_UNDEFINED;
 }
 
@@ -32,14 +35,18 @@ static JSValue esp32_rtc_SetDate(JSContext *ctx, JSValueConst jsThis, int argc,
   def.month = month;
   def.date = date;
   def.weekDay = weekday;
+  esp32_internal_bus_lock();
   M5.Rtc.setDate(&def);
+  esp32_internal_bus_unlock();
   return JS_UNDEFINED;
 }
 
 static JSValue esp32_rtc_GetTime(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
   m5::rtc_time_t def;
+  esp32_internal_bus_lock();
   M5.Rtc.getTime(&def);
+  esp32_internal_bus_unlock();
   JSValue obj = JS_NewObject(ctx);
   JS_SetPropertyStr(ctx, obj, "Hours", JS_NewUint32(ctx, def.hours));
   JS_SetPropertyStr(ctx, obj, "Minutes", JS_NewUint32(ctx, def.minutes));
@@ -50,7 +57,9 @@ static JSValue esp32_rtc_GetTime(JSContext *ctx, JSValueConst jsThis, int argc,
 static JSValue esp32_rtc_GetDate(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
   m5::rtc_date_t def;
+  esp32_internal_bus_lock();
   M5.Rtc.getDate(&def);
+  esp32_internal_bus_unlock();
   JSValue obj = JS_NewObject(ctx);
   JS_SetPropertyStr(ctx, obj, "Year", JS_NewUint32(ctx, def.year));
   JS_SetPropertyStr(ctx, obj, "Month", JS_NewUint32(ctx, def.month));
@@ -98,8 +107,10 @@ JSModuleDef *addModule_rtc(JSContext *ctx, JSValue global)
 
 long initialize_rtc(void){
   time_t t = time(nullptr);
+  esp32_internal_bus_lock();
   if (M5.Rtc.isEnabled())
     M5.Rtc.setDateTime( gmtime( &t ) );
+  esp32_internal_bus_unlock();
 
 /*      
   struct tm timeInfo;
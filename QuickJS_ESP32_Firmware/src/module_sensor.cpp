@@ -0,0 +1,593 @@
+#include <Arduino.h>
+#include "main_config.h"
+
+#include "quickjs.h"
+#include "quickjs_esp32.h"
+#include "module_type.h"
+#include "module_sensor.h"
+#include <vector>
+
+#define SENSOR_MAX_SENSORS        12
+#define SENSOR_DEFAULT_HISTORY    16
+#define SENSOR_MAX_HISTORY        256
+#define SENSOR_MAX_EVENTS         32
+#define SENSOR_TASK_STACK         4096
+#define SENSOR_TASK_PRIORITY      2
+#define SENSOR_TASK_IDLE_WAIT     1000
+
+typedef struct {
+  bool registered;
+  char name[SENSOR_NAME_LEN];
+  uint8_t num_values;
+  const char * const *value_names;
+  SensorMeasureImpl measureImpl;
+
+  // subscription
+  bool subscribed;
+  uint32_t interval;
+  uint32_t next_due;
+  bool notify;
+  float threshold;
+
+  // cache
+  bool valid;
+  uint32_t timestamp;
+  float values[SENSOR_MAX_VALUES];
+  bool notified_valid;
+  float notified[SENSOR_MAX_VALUES];
+  float *p_history; // history_size * num_values
+  uint32_t *p_history_timestamp;
+  uint16_t history_size;
+  uint16_t history_head;
+  uint16_t history_count;
+
+  // stats
+  uint32_t count;
+  uint32_t errors;
+  uint32_t latency_last; // us
+  uint32_t latency_max; // us
+} SENSOR_ENTRY;
+static SENSOR_ENTRY g_sensors[SENSOR_MAX_SENSORS];
+
+typedef struct {
+  char name[SENSOR_NAME_LEN];
+  uint8_t index;
+  uint32_t timestamp;
+  float values[SENSOR_MAX_VALUES];
+} SENSOR_EVENT_INFO;
+static std::vector<SENSOR_EVENT_INFO> g_event_list;
+
+static SemaphoreHandle_t g_sensor_mutex = NULL;
+static TaskHandle_t g_sensor_task = NULL;
+static volatile bool g_sensor_running = false;
+static volatile int8_t g_sensor_measuring = -1;
+
+static JSContext *g_ctx = NULL;
+static JSValue g_callback_func = JS_UNDEFINED;
+
+static int8_t sensor_find(const char *name)
+{
+  for( int8_t i = 0 ; i < SENSOR_MAX_SENSORS ; i++ ){
+    if( g_sensors[i].registered && strcmp(g_sensors[i].name, name) == 0 )
+      return i;
+  }
+  return -1;
+}
+
+static void sensor_free_history(SENSOR_ENTRY *p_entry)
+{
+  if( p_entry->p_history != NULL ){
+    free(p_entry->p_history);
+    p_entry->p_history = NULL;
+  }
+  if( p_entry->p_history_timestamp != NULL ){
+    free(p_entry->p_history_timestamp);
+    p_entry->p_history_timestamp = NULL;
+  }
+  p_entry->history_size = 0;
+  p_entry->history_head = 0;
+  p_entry->history_count = 0;
+}
+
+static void sensor_reset_subscription(SENSOR_ENTRY *p_entry)
+{
+  sensor_free_history(p_entry);
+  p_entry->subscribed = false;
+  p_entry->notify = false;
+  p_entry->valid = false;
+  p_entry->notified_valid = false;
+  p_entry->count = 0;
+  p_entry->errors = 0;
+  p_entry->latency_last = 0;
+  p_entry->latency_max = 0;
+}
+
+// call with g_sensor_mutex held, returns with it held
+static void sensor_wait_measuring(int8_t index)
+{
+  while( g_sensor_measuring == index ){
+    xSemaphoreGive(g_sensor_mutex);
+    delay(1);
+    xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+  }
+}
+
+static void sensor_store(SENSOR_ENTRY *p_entry, const float *p_values, uint32_t timestamp)
+{
+  memmove(p_entry->values, p_values, sizeof(float) * p_entry->num_values);
+  p_entry->timestamp = timestamp;
+  p_entry->valid = true;
+
+  if( p_entry->history_size > 0 ){
+    memmove(&p_entry->p_history[p_entry->history_head * p_entry->num_values], p_values, sizeof(float) * p_entry->num_values);
+    p_entry->p_history_timestamp[p_entry->history_head] = timestamp;
+    p_entry->history_head = (p_entry->history_head + 1) % p_entry->history_size;
+    if( p_entry->history_count < p_entry->history_size )
+      p_entry->history_count++;
+  }
+
+  if( !p_entry->notify )
+    return;
+
+  bool changed = !p_entry->notified_valid;
+  for( uint8_t i = 0 ; !changed && i < p_entry->num_values ; i++ ){
+    if( fabsf(p_values[i] - p_entry->notified[i]) >= p_entry->threshold )
+      changed = true;
+  }
+  if( !changed )
+    return;
+
+  memmove(p_entry->notified, p_values, sizeof(float) * p_entry->num_values);
+  p_entry->notified_valid = true;
+
+  SENSOR_EVENT_INFO info;
+  strcpy(info.name, p_entry->name);
+  info.index = p_entry - g_sensors;
+  info.timestamp = timestamp;
+  memmove(info.values, p_values, sizeof(float) * p_entry->num_values);
+  if( g_event_list.size() >= SENSOR_MAX_EVENTS )
+    g_event_list.erase(g_event_list.begin());
+  g_event_list.push_back(info);
+}
+
+static void sensor_task(void *arg)
+{
+  float values[SENSOR_MAX_VALUES];
+
+  while( g_sensor_running ){
+    uint32_t now = millis();
+    int32_t wait = SENSOR_TASK_IDLE_WAIT;
+    int32_t most_late = 1;
+    int8_t index = -1;
+    SensorMeasureImpl measureImpl = NULL;
+
+    xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+    for( int8_t i = 0 ; i < SENSOR_MAX_SENSORS ; i++ ){
+      SENSOR_ENTRY *p_entry = &g_sensors[i];
+      if( !p_entry->registered || !p_entry->subscribed )
+        continue;
+      int32_t remain = (int32_t)(p_entry->next_due - now);
+      if( remain <= 0 ){
+        if( remain < most_late ){
+          most_late = remain;
+          index = i;
+        }
+      }else if( remain < wait ){
+        wait = remain;
+      }
+    }
+    if( index >= 0 ){
+      measureImpl = g_sensors[index].measureImpl;
+      g_sensor_measuring = index;
+    }
+    xSemaphoreGive(g_sensor_mutex);
+
+    if( index < 0 ){
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+      continue;
+    }
+
+    // the conversion wait happens here instead of inside the JS call
+    uint32_t start = micros();
+    bool ret = measureImpl(values);
+    uint32_t latency = micros() - start;
+
+    xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+    SENSOR_ENTRY *p_entry = &g_sensors[index];
+    if( p_entry->registered && p_entry->subscribed ){
+      p_entry->next_due += p_entry->interval;
+      if( (int32_t)(p_entry->next_due - millis()) < 0 )
+        p_entry->next_due = millis() + p_entry->interval; // skip slots missed on an overloaded bus
+      p_entry->count++;
+      p_entry->latency_last = latency;
+      if( latency > p_entry->latency_max )
+        p_entry->latency_max = latency;
+      if( ret )
+        sensor_store(p_entry, values, millis());
+      else
+        p_entry->errors++;
+    }
+    g_sensor_measuring = -1;
+    xSemaphoreGive(g_sensor_mutex);
+  }
+
+  g_sensor_task = NULL;
+  vTaskDelete(NULL);
+}
+
+static void sensor_stop_task(void)
+{
+  if( g_sensor_task == NULL )
+    return;
+
+  g_sensor_running = false;
+  xTaskNotifyGive(g_sensor_task);
+  while( g_sensor_task != NULL )
+    delay(1);
+}
+
+long sensor_register(const SENSOR_PROVIDER *p_provider)
+{
+  if( g_sensor_mutex == NULL || p_provider->num_values > SENSOR_MAX_VALUES || strlen(p_provider->name) >= SENSOR_NAME_LEN )
+    return -1;
+
+  xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+  int8_t index = sensor_find(p_provider->name);
+  if( index >= 0 ){
+    // re-begin: keep the subscription, swap the measurement
+    sensor_wait_measuring(index);
+  }else{
+    for( int8_t i = 0 ; i < SENSOR_MAX_SENSORS ; i++ ){
+      if( !g_sensors[i].registered ){
+        index = i;
+        break;
+      }
+    }
+    if( index < 0 ){
+      xSemaphoreGive(g_sensor_mutex);
+      return -1;
+    }
+    SENSOR_ENTRY *p_entry = &g_sensors[index];
+    memset(p_entry, 0, sizeof(SENSOR_ENTRY));
+    strcpy(p_entry->name, p_provider->name);
+    p_entry->registered = true;
+  }
+  SENSOR_ENTRY *p_entry = &g_sensors[index];
+  p_entry->num_values = p_provider->num_values;
+  p_entry->value_names = p_provider->value_names;
+  p_entry->measureImpl = p_provider->measureImpl;
+  p_entry->valid = false;
+  p_entry->notified_valid = false;
+  xSemaphoreGive(g_sensor_mutex);
+
+  return 0;
+}
+
+void sensor_unregister(const char *name)
+{
+  if( g_sensor_mutex == NULL )
+    return;
+
+  xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+  int8_t index = sensor_find(name);
+  if( index >= 0 ){
+    sensor_wait_measuring(index);
+    sensor_reset_subscription(&g_sensors[index]);
+    g_sensors[index].registered = false;
+  }
+  xSemaphoreGive(g_sensor_mutex);
+}
+
+static JSValue sensor_values_object(JSContext *ctx, const SENSOR_ENTRY *p_entry, const float *p_values)
+{
+  JSValue obj = JS_NewObject(ctx);
+  for( uint8_t i = 0 ; i < p_entry->num_values ; i++ )
+    JS_SetPropertyStr(ctx, obj, p_entry->value_names[i], JS_NewFloat64(ctx, p_values[i]));
+  return obj;
+}
+
+static int8_t sensor_get_index(JSContext *ctx, JSValueConst name)
+{
+  const char *p_name = JS_ToCString(ctx, name);
+  if( p_name == NULL )
+    return -1;
+  int8_t index = sensor_find(p_name);
+  JS_FreeCString(ctx, p_name);
+  return index;
+}
+
+static JSValue sensor_getList(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  JSValue array = JS_NewArray(ctx);
+  uint32_t num = 0;
+  xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+  for( int8_t i = 0 ; i < SENSOR_MAX_SENSORS ; i++ ){
+    SENSOR_ENTRY *p_entry = &g_sensors[i];
+    if( !p_entry->registered )
+      continue;
+    JSValue obj = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, obj, "name", JS_NewString(ctx, p_entry->name));
+    JSValue names = JS_NewArray(ctx);
+    for( uint8_t j = 0 ; j < p_entry->num_values ; j++ )
+      JS_SetPropertyUint32(ctx, names, j, JS_NewString(ctx, p_entry->value_names[j]));
+    JS_SetPropertyStr(ctx, obj, "values", names);
+    JS_SetPropertyStr(ctx, obj, "subscribed", JS_NewBool(ctx, p_entry->subscribed));
+    JS_SetPropertyUint32(ctx, array, num++, obj);
+  }
+  xSemaphoreGive(g_sensor_mutex);
+
+  return array;
+}
+
+static JSValue sensor_subscribe(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t interval;
+  JS_ToUint32(ctx, &interval, argv[1]);
+  if( interval == 0 )
+    return JS_EXCEPTION;
+
+  bool notify = false;
+  double threshold = 0.0;
+  uint32_t history = SENSOR_DEFAULT_HISTORY;
+  if( argc >= 3 ){
+    JSValue value = JS_GetPropertyStr(ctx, argv[2], "threshold");
+    if( value != JS_UNDEFINED ){
+      JS_ToFloat64(ctx, &threshold, value);
+      notify = true;
+    }
+    value = JS_GetPropertyStr(ctx, argv[2], "history");
+    if( value != JS_UNDEFINED ){
+      JS_ToUint32(ctx, &history, value);
+      if( history > SENSOR_MAX_HISTORY )
+        return JS_EXCEPTION;
+    }
+  }
+
+  if( g_sensor_task == NULL ){
+    g_sensor_running = true;
+    BaseType_t ret = xTaskCreate(sensor_task, "sensor_task", SENSOR_TASK_STACK, NULL, SENSOR_TASK_PRIORITY, &g_sensor_task);
+    if( ret != pdPASS ){
+      g_sensor_running = false;
+      g_sensor_task = NULL;
+      return JS_EXCEPTION;
+    }
+  }
+
+  xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+  int8_t index = sensor_get_index(ctx, argv[0]);
+  if( index < 0 ){
+    xSemaphoreGive(g_sensor_mutex);
+    return JS_EXCEPTION;
+  }
+  SENSOR_ENTRY *p_entry = &g_sensors[index];
+  if( p_entry->history_size != history ){
+    sensor_free_history(p_entry);
+    if( history > 0 ){
+      p_entry->p_history = (float*)malloc(sizeof(float) * p_entry->num_values * history);
+      p_entry->p_history_timestamp = (uint32_t*)malloc(sizeof(uint32_t) * history);
+      if( p_entry->p_history == NULL || p_entry->p_history_timestamp == NULL ){
+        sensor_free_history(p_entry);
+        xSemaphoreGive(g_sensor_mutex);
+        return JS_EXCEPTION;
+      }
+      p_entry->history_size = history;
+    }
+  }
+  p_entry->interval = interval;
+  p_entry->next_due = millis();
+  p_entry->notify = notify;
+  p_entry->threshold = threshold;
+  p_entry->notified_valid = false;
+  p_entry->subscribed = true;
+  xSemaphoreGive(g_sensor_mutex);
+
+  xTaskNotifyGive(g_sensor_task);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue sensor_unsubscribe(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+  int8_t index = sensor_get_index(ctx, argv[0]);
+  if( index >= 0 ){
+    sensor_wait_measuring(index);
+    sensor_reset_subscription(&g_sensors[index]);
+  }
+  xSemaphoreGive(g_sensor_mutex);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue sensor_get(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  JSValue obj = JS_NULL;
+  xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+  int8_t index = sensor_get_index(ctx, argv[0]);
+  if( index >= 0 && g_sensors[index].valid ){
+    SENSOR_ENTRY *p_entry = &g_sensors[index];
+    obj = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, obj, "value", sensor_values_object(ctx, p_entry, p_entry->values));
+    JS_SetPropertyStr(ctx, obj, "timestamp", JS_NewUint32(ctx, p_entry->timestamp));
+    JS_SetPropertyStr(ctx, obj, "age", JS_NewUint32(ctx, millis() - p_entry->timestamp));
+  }
+  xSemaphoreGive(g_sensor_mutex);
+
+  return obj;
+}
+
+static JSValue sensor_getHistory(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+  int8_t index = sensor_get_index(ctx, argv[0]);
+  if( index < 0 ){
+    xSemaphoreGive(g_sensor_mutex);
+    return JS_EXCEPTION;
+  }
+  SENSOR_ENTRY *p_entry = &g_sensors[index];
+  JSValue array = JS_NewArray(ctx);
+  // oldest first
+  uint16_t start = (p_entry->history_head + p_entry->history_size - p_entry->history_count) % std::max(p_entry->history_size, (uint16_t)1);
+  for( uint16_t i = 0 ; i < p_entry->history_count ; i++ ){
+    uint16_t pos = (start + i) % p_entry->history_size;
+    JSValue obj = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, obj, "value", sensor_values_object(ctx, p_entry, &p_entry->p_history[pos * p_entry->num_values]));
+    JS_SetPropertyStr(ctx, obj, "timestamp", JS_NewUint32(ctx, p_entry->p_history_timestamp[pos]));
+    JS_SetPropertyUint32(ctx, array, i, obj);
+  }
+  xSemaphoreGive(g_sensor_mutex);
+
+  return array;
+}
+
+static JSValue sensor_getStats(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+  int8_t index = sensor_get_index(ctx, argv[0]);
+  if( index < 0 ){
+    xSemaphoreGive(g_sensor_mutex);
+    return JS_EXCEPTION;
+  }
+  SENSOR_ENTRY *p_entry = &g_sensors[index];
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "subscribed", JS_NewBool(ctx, p_entry->subscribed));
+  JS_SetPropertyStr(ctx, obj, "interval", JS_NewUint32(ctx, p_entry->interval));
+  JS_SetPropertyStr(ctx, obj, "count", JS_NewUint32(ctx, p_entry->count));
+  JS_SetPropertyStr(ctx, obj, "errors", JS_NewUint32(ctx, p_entry->errors));
+  if( p_entry->valid )
+    JS_SetPropertyStr(ctx, obj, "age", JS_NewUint32(ctx, millis() - p_entry->timestamp));
+  JS_SetPropertyStr(ctx, obj, "latency", JS_NewFloat64(ctx, p_entry->latency_last / 1000.0));
+  JS_SetPropertyStr(ctx, obj, "latencyMax", JS_NewFloat64(ctx, p_entry->latency_max / 1000.0));
+  xSemaphoreGive(g_sensor_mutex);
+
+  return obj;
+}
+
+static JSValue sensor_setCallback(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  if( g_callback_func != JS_UNDEFINED )
+    JS_FreeValue(g_ctx, g_callback_func);
+  g_callback_func = JS_UNDEFINED;
+
+  if( argc >= 1 && JS_IsFunction(ctx, argv[0]) ){
+    g_ctx = ctx;
+    g_callback_func = JS_DupValue(ctx, argv[0]);
+  }
+
+  return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry sensor_funcs[] = {
+    JSCFunctionListEntry{
+        "getList", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic, sensor_getList}
+        }},
+    JSCFunctionListEntry{
+        "subscribe", 0, JS_DEF_CFUNC, 0, {
+          func : {3, JS_CFUNC_generic, sensor_subscribe}
+        }},
+    JSCFunctionListEntry{
+        "unsubscribe", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic, sensor_unsubscribe}
+        }},
+    JSCFunctionListEntry{
+        "get", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic, sensor_get}
+        }},
+    JSCFunctionListEntry{
+        "getHistory", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic, sensor_getHistory}
+        }},
+    JSCFunctionListEntry{
+        "getStats", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic, sensor_getStats}
+        }},
+    JSCFunctionListEntry{
+        "setCallback", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic, sensor_setCallback}
+        }},
+};
+
+JSModuleDef *addModule_sensor(JSContext *ctx, JSValue global)
+{
+  JSModuleDef *mod;
+  mod = JS_NewCModule(ctx, "Sensor", [](JSContext *ctx, JSModuleDef *m)
+                      { return JS_SetModuleExportList(
+                            ctx, m, sensor_funcs,
+                            sizeof(sensor_funcs) / sizeof(JSCFunctionListEntry)); });
+  if (mod){
+    JS_AddModuleExportList(
+        ctx, mod, sensor_funcs,
+        sizeof(sensor_funcs) / sizeof(JSCFunctionListEntry));
+  }
+
+  return mod;
+}
+
+void loopModule_sensor(void)
+{
+  if( g_ctx == NULL || g_callback_func == JS_UNDEFINED )
+    return;
+
+  while(true){
+    SENSOR_EVENT_INFO info;
+    JSValue objs[3];
+    xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+    if( g_event_list.size() == 0 ){
+      xSemaphoreGive(g_sensor_mutex);
+      break;
+    }
+    info = g_event_list.front();
+    g_event_list.erase(g_event_list.begin());
+    SENSOR_ENTRY *p_entry = &g_sensors[info.index];
+    if( !p_entry->registered || strcmp(p_entry->name, info.name) != 0 ){
+      xSemaphoreGive(g_sensor_mutex);
+      continue;
+    }
+    objs[0] = JS_NewString(g_ctx, info.name);
+    objs[1] = sensor_values_object(g_ctx, p_entry, info.values);
+    objs[2] = JS_NewUint32(g_ctx, info.timestamp);
+    xSemaphoreGive(g_sensor_mutex);
+
+    ESP32QuickJS *qjs = (ESP32QuickJS *)JS_GetContextOpaque(g_ctx);
+    JSValue ret = qjs->callJsFunc_with_arg(g_ctx, g_callback_func, g_callback_func, 3, objs);
+    JS_FreeValue(g_ctx, objs[0]);
+    JS_FreeValue(g_ctx, objs[1]);
+    JS_FreeValue(g_ctx, objs[2]);
+    JS_FreeValue(g_ctx, ret);
+  }
+}
+
+void endModule_sensor(void)
+{
+  sensor_stop_task();
+
+  xSemaphoreTake(g_sensor_mutex, portMAX_DELAY);
+  for( int8_t i = 0 ; i < SENSOR_MAX_SENSORS ; i++ )
+    sensor_reset_subscription(&g_sensors[i]);
+  g_event_list.clear();
+  xSemaphoreGive(g_sensor_mutex);
+
+  if( g_callback_func != JS_UNDEFINED ){
+    JS_FreeValue(g_ctx, g_callback_func);
+    g_callback_func = JS_UNDEFINED;
+  }
+  g_ctx = NULL;
+}
+
+long initializeModule_sensor(void)
+{
+  g_sensor_mutex = xSemaphoreCreateMutex();
+  if( g_sensor_mutex == NULL )
+    return -1;
+
+  return 0;
+}
+
+JsModuleEntry sensor_module = {
+  "Sensor",
+  initializeModule_sensor,
+  addModule_sensor,
+  loopModule_sensor,
+  endModule_sensor
+};
@@ -0,0 +1,27 @@
+#ifndef _MODULE_SENSOR_H_
+#define _MODULE_SENSOR_H_
+
+#include "module_type.h"
+
+#define SENSOR_MAX_VALUES       9
+#define SENSOR_NAME_LEN         16
+
+// runs on the sensor task, fills p_values[0 .. num_values-1]
+// the driver is also used by the synchronous JS getters, so both take the lock of the bus it sits on
+// (wire_bus_lock for I2C units, a driver lock for the analog ones)
+typedef bool (*SensorMeasureImpl)(float *p_values);
+
+typedef struct {
+  const char *name;
+  uint8_t num_values;
+  const char * const *value_names;
+  SensorMeasureImpl measureImpl;
+} SENSOR_PROVIDER;
+
+extern JsModuleEntry sensor_module;
+
+long sensor_register(const SENSOR_PROVIDER *p_provider);
+// waits for a measurement in progress, call before the sensor object is torn down
+void sensor_unregister(const char *name);
+
+#endif
@@ -46,7 +46,7 @@ static JSValue esp32_uart_write(JSContext *ctx, JSValueConst jsThis,
     uint8_t *p_buffer;
     uint32_t num;
     JSValue vbuffer = from_Uint8Array(ctx, argv[0], &p_buffer, &num);
-    if( JS_IsNull(vbuffer) ){
+    if( JS_IsException(vbuffer) ){
       return JS_EXCEPTION;
     }
 
@@ -63,20 +63,17 @@ static JSValue esp32_uart_read(JSContext *ctx, JSValueConst jsThis,
   if (argc > 0){
     uint32_t length;
     JS_ToUint32(ctx, &length, argv[0]);
-    uint8_t *p_buffer = (uint8_t*)malloc(length);
+    int available = Serial1.available();
+    if( available < 0 )
+      available = 0;
+    if( (uint32_t)available < length )
+      length = available;
+    uint8_t *p_buffer = (uint8_t*)malloc(length > 0 ? length : 1);
     if( p_buffer == NULL )
       return JS_EXCEPTION;
-    uint32_t i;
-    for (i = 0; i < length; i++){
-      int c = Serial1.read();
-      if( c < 0 )
-        break;
-      p_buffer[i] = (uint8_t)c;
-    }
+    size_t num = Serial1.read(p_buffer, length);
 
-    JSValue value = create_Uint8Array(ctx, p_buffer, i);
-    free(p_buffer);
-    return value;
+    return create_Uint8Array_nocopy(ctx, p_buffer, num, my_mem_free, NULL);
   }else{
     return JS_NewInt32(ctx, Serial1.read());
   }
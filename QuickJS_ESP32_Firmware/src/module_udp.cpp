@@ -80,16 +80,15 @@ static JSValue udp_checkRecv(JSContext *ctx, JSValueConst jsThis, int argc, JSVa
     return JS_EXCEPTION;
   }
 
-  JSValue value = create_Uint8Array(ctx, p_buffer, len);
-  free(p_buffer);
+  JSValue value = create_Uint8Array_nocopy(ctx, p_buffer, len, my_mem_free, NULL);
 
   String remoteIp = udp.remoteIP().toString();
   uint16_t port = udp.remotePort();
 
   JSValue obj = JS_NewObject(ctx);
-  JS_SetPropertyStr(ctx, obj, "payload", value);
-  JS_SetPropertyStr(ctx, obj, "remoteIp", JS_NewString(ctx, remoteIp.c_str()));
-  JS_SetPropertyStr(ctx, obj, "remotePort", JS_NewUint32(ctx, port));
+  binding_set_property(ctx, obj, BINDING_ATOM_PAYLOAD, value);
+  binding_set_property(ctx, obj, BINDING_ATOM_REMOTE_IP, JS_NewString(ctx, remoteIp.c_str()));
+  binding_set_property(ctx, obj, BINDING_ATOM_REMOTE_PORT, JS_NewUint32(ctx, port));
 
   return obj;
 }
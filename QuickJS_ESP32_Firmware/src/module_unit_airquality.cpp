@@ -6,46 +6,78 @@
 #include "quickjs.h"
 #include "module_unit_airquality.h"
 #include "AirQuality.h"
+#include "module_sensor.h"
 
 static AirQuality airquality;
 
+// airquality is shared by the sensor task and the synchronous getters
+static SemaphoreHandle_t g_airquality_lock = NULL;
+
+static const char * const airquality_value_names[] = { "slope" };
+
+static bool unit_airquality_measure(float *p_values)
+{
+  // also drives the warm-up state machine, so JS does not have to call update()
+  xSemaphoreTake(g_airquality_lock, portMAX_DELAY);
+  airquality.update();
+  bool ret = airquality.isReady();
+  if( ret )
+    p_values[0] = airquality.slope();
+  xSemaphoreGive(g_airquality_lock);
+  return ret;
+}
+
+static const SENSOR_PROVIDER airquality_provider = { "airquality", 1, airquality_value_names, unit_airquality_measure };
+
 static JSValue unit_airquality_begin(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
   uint32_t pin;
   JS_ToUint32(ctx, &pin, argv[0]);
 
+  sensor_unregister(airquality_provider.name);
   airquality.init(pin);
+  sensor_register(&airquality_provider);
 
   return JS_UNDEFINED;
 }
 
 static JSValue unit_airquality_isReady(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  xSemaphoreTake(g_airquality_lock, portMAX_DELAY);
   bool value = airquality.isReady();
+  xSemaphoreGive(g_airquality_lock);
   return JS_NewBool(ctx, value);
 }
 
 static JSValue unit_airquality_slope(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  xSemaphoreTake(g_airquality_lock, portMAX_DELAY);
   int value = airquality.slope();
+  xSemaphoreGive(g_airquality_lock);
   return JS_NewInt32(ctx, value);
 }
 
 static JSValue unit_airquality_update(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  xSemaphoreTake(g_airquality_lock, portMAX_DELAY);
   airquality.update();
+  xSemaphoreGive(g_airquality_lock);
   return JS_UNDEFINED;
 }
 
 static JSValue unit_airquality_end(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  xSemaphoreTake(g_airquality_lock, portMAX_DELAY);
   airquality.stopTimer();
+  xSemaphoreGive(g_airquality_lock);
   return JS_UNDEFINED;
 }
 
 static JSValue unit_airquality_reset(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  xSemaphoreTake(g_airquality_lock, portMAX_DELAY);
   airquality.resetAll();
+  xSemaphoreGive(g_airquality_lock);
   return JS_UNDEFINED;
 }
 
@@ -79,6 +111,10 @@ static const JSCFunctionListEntry unit_airquality_funcs[] = {
 JSModuleDef *addModule_unit_airquality(JSContext *ctx, JSValue global)
 {
   JSModuleDef *mod;
+
+  if( g_airquality_lock == NULL )
+    g_airquality_lock = xSemaphoreCreateMutex();
+
   mod = JS_NewCModule(ctx, "UnitAirquality", [](JSContext *ctx, JSModuleDef *m)
                       { return JS_SetModuleExportList(
                             ctx, m, unit_airquality_funcs,
@@ -94,7 +130,9 @@ JSModuleDef *addModule_unit_airquality(JSContext *ctx, JSValue global)
 
 void endModule_unit_airquality(void)
 {
+  xSemaphoreTake(g_airquality_lock, portMAX_DELAY);
   airquality.stopTimer();
+  xSemaphoreGive(g_airquality_lock);
 }
 
 JsModuleEntry unit_airquality_module = {
@@ -6,22 +6,46 @@
 #include "quickjs.h"
 #include "module_unit_angle8.h"
 #include "M5_ANGLE8.h"
+#include "module_sensor.h"
+#include "module_wire.h"
 
 static M5_ANGLE8 angle8;
 
+static const char * const angle8_value_names[] = { "ch0", "ch1", "ch2", "ch3", "ch4", "ch5", "ch6", "ch7", "switch" };
+
+static bool unit_angle8_measure(float *p_values)
+{
+  wire_bus_lock(&Wire);
+  for( uint8_t i = 0 ; i < 8 ; i++ )
+    p_values[i] = angle8.getAnalogInput(i, _12bit);
+  p_values[8] = angle8.getDigitalInput() ? 1 : 0;
+  wire_bus_unlock(&Wire);
+  return true;
+}
+
+static const SENSOR_PROVIDER angle8_provider = { "angle8", 9, angle8_value_names, unit_angle8_measure };
+
 static JSValue unit_angle8_begin(JSContext *ctx, JSValueConst jsThis,
                                       int argc, JSValueConst *argv)
 {
-  if( !angle8.begin(ANGLE8_I2C_ADDR) )
+  sensor_unregister(angle8_provider.name);
+  wire_bus_lock(&Wire);
+  bool ret = angle8.begin(ANGLE8_I2C_ADDR);
+  wire_bus_unlock(&Wire);
+  if( !ret )
     return JS_EXCEPTION;
 
+  sensor_register(&angle8_provider);
+
   return JS_UNDEFINED;
 }
 
 static JSValue unit_angle8_getDigitalInput(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   bool value = angle8.getDigitalInput();
+  wire_bus_unlock(&Wire);
 
   return JS_NewBool(ctx, value);
 }
@@ -32,7 +56,9 @@ static JSValue unit_angle8_getAnalogInput(JSContext *ctx, JSValueConst jsThis,
   uint32_t ch;
   JS_ToUint32(ctx, &ch, argv[0]);
 
+  wire_bus_lock(&Wire);
   uint16_t value = angle8.getAnalogInput((uint8_t)ch, _12bit);
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, value);
 }
@@ -45,7 +71,9 @@ static JSValue unit_angle8_setLEDColor(JSContext *ctx, JSValueConst jsThis,
   JS_ToUint32(ctx, &color, argv[1]);
   JS_ToUint32(ctx, &bright, argv[2]);
 
+  wire_bus_lock(&Wire);
   bool result = angle8.setLEDColor((uint8_t)ch, color, (uint8_t)bright);
+  wire_bus_unlock(&Wire);
 
   return JS_NewBool(ctx, result);
 }
@@ -72,6 +100,7 @@ static const JSCFunctionListEntry unit_angle8_funcs[] = {
 JSModuleDef *addModule_unit_angle8(JSContext *ctx, JSValue global)
 {
   JSModuleDef *mod;
+
   mod = JS_NewCModule(ctx, "UnitAngle8", [](JSContext *ctx, JSModuleDef *m)
                       { return JS_SetModuleExportList(
                             ctx, m, unit_angle8_funcs,
@@ -6,6 +6,7 @@
 #include <Wire.h>
 #include "quickjs.h"
 #include "module_unit_bytebutton.h"
+#include "module_wire.h"
 #include "unit_byte.hpp"
 
 static UnitByte unitbyte;
@@ -14,7 +15,10 @@ static const uint8_t buttonId = 0x47;
 static JSValue unit_bytebutton_begin(JSContext *ctx, JSValueConst jsThis,
                                       int argc, JSValueConst *argv)
 {
-  if( !unitbyte.begin(&Wire, buttonId) )
+  wire_bus_lock(&Wire);
+  bool ret = unitbyte.begin(&Wire, buttonId);
+  wire_bus_unlock(&Wire);
+  if( !ret )
     return JS_EXCEPTION;
 
   return JS_UNDEFINED;
@@ -23,7 +27,9 @@ static JSValue unit_bytebutton_begin(JSContext *ctx, JSValueConst jsThis,
 static JSValue unit_bytebutton_setFlashWriteBack(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   unitbyte.setFlashWriteBack();
+  wire_bus_unlock(&Wire);
 
   return JS_UNDEFINED;
 }
@@ -31,7 +37,9 @@ static JSValue unit_bytebutton_setFlashWriteBack(JSContext *ctx, JSValueConst js
 static JSValue unit_bytebutton_getSwitchStatus(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   uint8_t status = unitbyte.getSwitchStatus();
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, status);
 }
@@ -39,7 +47,9 @@ static JSValue unit_bytebutton_getSwitchStatus(JSContext *ctx, JSValueConst jsTh
 static JSValue unit_bytebutton_getLEDBrightness(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   uint8_t brightness = unitbyte.getLEDBrightness();
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, brightness);
 }
@@ -50,8 +60,10 @@ static JSValue unit_bytebutton_setLEDBrightness(JSContext *ctx, JSValueConst jsT
   uint32_t brightness;
   JS_ToUint32(ctx, &brightness, argv[0]);
 
+  wire_bus_lock(&Wire);
   for( int i = 0 ; i < 9 ; i++ )
     unitbyte.setLEDBrightness(i, (uint8_t)brightness);
+  wire_bus_unlock(&Wire);
 
   return JS_UNDEFINED;
 }
@@ -59,7 +71,9 @@ static JSValue unit_bytebutton_setLEDBrightness(JSContext *ctx, JSValueConst jsT
 static JSValue unit_bytebutton_getLEDShowMode(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   uint8_t mode = unitbyte.getLEDShowMode();
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, mode);
 }
@@ -71,7 +85,9 @@ static JSValue unit_bytebutton_setLEDShowMode(JSContext *ctx, JSValueConst jsThi
   JS_ToUint32(ctx, &mode, argv[0]);
 
   byte_led_t ledMode = (byte_led_t)mode;
+  wire_bus_lock(&Wire);
   unitbyte.setLEDShowMode(ledMode);
+  wire_bus_unlock(&Wire);
 
   return JS_UNDEFINED;
 }
@@ -84,8 +100,10 @@ static JSValue unit_bytebutton_setSwitchRGB(JSContext *ctx, JSValueConst jsThis,
   JS_ToUint32(ctx, &onColor, argv[1]);
   JS_ToUint32(ctx, &offColor, argv[2]);
 
+  wire_bus_lock(&Wire);
   unitbyte.setSwitchOnRGB888(num, onColor);
   unitbyte.setSwitchOffRGB888(num, offColor);
+  wire_bus_unlock(&Wire);
 
   return JS_UNDEFINED;
 }
@@ -96,8 +114,10 @@ static JSValue unit_bytebutton_getSwitchRGB(JSContext *ctx, JSValueConst jsThis,
   uint32_t num;
   JS_ToUint32(ctx, &num, argv[0]);
 
+  wire_bus_lock(&Wire);
   uint32_t onColor = unitbyte.getSwitchOnRGB888(num);
   uint32_t offColor = unitbyte.getSwitchOffRGB888(num);
+  wire_bus_unlock(&Wire);
 
   JSValue obj = JS_NewObject(ctx);
   JS_SetPropertyStr(ctx, obj, "onColor", JS_NewUint32(ctx, onColor));
@@ -113,7 +133,9 @@ static JSValue unit_bytebutton_setRGB(JSContext *ctx, JSValueConst jsThis,
   JS_ToUint32(ctx, &num, argv[0]);
   JS_ToUint32(ctx, &color, argv[1]);
 
+  wire_bus_lock(&Wire);
   unitbyte.setRGB888(num, color);
+  wire_bus_unlock(&Wire);
 
   return JS_UNDEFINED;
 }
@@ -124,7 +146,9 @@ static JSValue unit_bytebutton_getRGB(JSContext *ctx, JSValueConst jsThis,
   uint32_t num;
   JS_ToUint32(ctx, &num, argv[0]);
 
+  wire_bus_lock(&Wire);
   uint32_t color = unitbyte.getRGB888(num);
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, color);
 }
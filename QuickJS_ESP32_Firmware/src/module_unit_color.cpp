@@ -6,17 +6,44 @@
 #include "quickjs.h"
 #include "module_unit_color.h"
 #include "Adafruit_TCS34725.h"
+#include "module_sensor.h"
+#include "module_wire.h"
 
 static Adafruit_TCS34725 tcs = Adafruit_TCS34725(TCS34725_INTEGRATIONTIME_50MS, TCS34725_GAIN_4X);
 
+static const char * const color_value_names[] = { "red", "green", "blue", "clear" };
+
+static bool unit_color_measure(float *p_values)
+{
+  uint16_t clear, red, green, blue;
+  wire_bus_lock(&Wire);
+  tcs.getRawData(&red, &green, &blue, &clear);
+  wire_bus_unlock(&Wire);
+
+  p_values[0] = red;
+  p_values[1] = green;
+  p_values[2] = blue;
+  p_values[3] = clear;
+  return true;
+}
+
+static const SENSOR_PROVIDER color_provider = { "color", 4, color_value_names, unit_color_measure };
+
 static JSValue unit_color_begin(JSContext *ctx, JSValueConst jsThis,
                                       int argc, JSValueConst *argv)
 {
-  if( !tcs.begin() )
+  sensor_unregister(color_provider.name);
+  wire_bus_lock(&Wire);
+  bool ret = tcs.begin();
+  if( ret ){
+    tcs.setIntegrationTime(TCS34725_INTEGRATIONTIME_154MS);
+    tcs.setGain(TCS34725_GAIN_4X);
+  }
+  wire_bus_unlock(&Wire);
+  if( !ret )
     return JS_EXCEPTION;
 
-  tcs.setIntegrationTime(TCS34725_INTEGRATIONTIME_154MS);
-  tcs.setGain(TCS34725_GAIN_4X);
+  sensor_register(&color_provider);
 
   return JS_UNDEFINED;
 }
@@ -25,7 +52,9 @@ static JSValue unit_color_getRawData(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
   uint16_t clear, red, green, blue;
-  tcs.getRawData(&red, &green, &blue, &clear); 
+  wire_bus_lock(&Wire);
+  tcs.getRawData(&red, &green, &blue, &clear);
+  wire_bus_unlock(&Wire);
 
   JSValue obj = JS_NewObject(ctx);
   JS_SetPropertyStr(ctx, obj, "red", JS_NewUint32(ctx, red));
@@ -38,7 +67,9 @@ static JSValue unit_color_getRgb(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
   uint16_t clear, red, green, blue;
-  tcs.getRawData(&red, &green, &blue, &clear); 
+  wire_bus_lock(&Wire);
+  tcs.getRawData(&red, &green, &blue, &clear);
+  wire_bus_unlock(&Wire);
 
   uint32_t sum = clear;
   float r, g, b;
@@ -72,6 +103,7 @@ static const JSCFunctionListEntry unit_color_funcs[] = {
 JSModuleDef *addModule_unit_color(JSContext *ctx, JSValue global)
 {
   JSModuleDef *mod;
+
   mod = JS_NewCModule(ctx, "UnitColor", [](JSContext *ctx, JSModuleDef *m)
                       { return JS_SetModuleExportList(
                             ctx, m, unit_color_funcs,
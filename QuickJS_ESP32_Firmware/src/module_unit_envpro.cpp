@@ -6,25 +6,54 @@
 #include "quickjs.h"
 #include "module_unit_envpro.h"
 #include <Adafruit_BME680.h>
+#include "module_sensor.h"
+#include "module_wire.h"
 
 #define SEALEVELPRESSURE_HPA (1013.25)
 static Adafruit_BME680 *bme;
 
+static const char * const envpro_value_names[] = { "temperature", "humidity", "pressure", "gas", "altitude" };
+
+static bool unit_envpro_measure(float *p_values)
+{
+  wire_bus_lock(&Wire);
+  // endReading() waits out the remaining conversion time
+  bool ret = bme->beginReading() != 0 && bme->endReading();
+  if( ret ){
+    p_values[0] = bme->temperature;
+    p_values[1] = bme->humidity;
+    p_values[2] = bme->pressure / 100.0;
+    p_values[3] = bme->gas_resistance / 1000.0;
+    p_values[4] = bme->readAltitude(SEALEVELPRESSURE_HPA);
+  }
+  wire_bus_unlock(&Wire);
+  return ret;
+}
+
+static const SENSOR_PROVIDER envpro_provider = { "envpro", 5, envpro_value_names, unit_envpro_measure };
+
 static JSValue unit_envpro_begin(JSContext *ctx, JSValueConst jsThis,
                                       int argc, JSValueConst *argv)
 {
+  sensor_unregister(envpro_provider.name);
   if(bme != NULL )
     delete bme;
   bme = new Adafruit_BME680(&Wire);
 
-  if( !bme->begin() )
+  wire_bus_lock(&Wire);
+  bool ret = bme->begin();
+  if( ret ){
+    bme->setTemperatureOversampling(BME680_OS_8X);
+    bme->setHumidityOversampling(BME680_OS_2X);
+    bme->setPressureOversampling(BME680_OS_4X);
+    bme->setIIRFilterSize(BME680_FILTER_SIZE_3);
+    bme->setGasHeater(320, 150);
+  }
+  wire_bus_unlock(&Wire);
+  if( !ret )
     return JS_EXCEPTION;
 
-  bme->setTemperatureOversampling(BME680_OS_8X);
-  bme->setHumidityOversampling(BME680_OS_2X);
-  bme->setPressureOversampling(BME680_OS_4X);
-  bme->setIIRFilterSize(BME680_FILTER_SIZE_3);
-  bme->setGasHeater(320, 150);
+  sensor_register(&envpro_provider);
 
   return JS_UNDEFINED;
 }
@@ -32,26 +61,16 @@ static JSValue unit_envpro_begin(JSContext *ctx, JSValueConst jsThis,
 static JSValue unit_envpro_read(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
-  unsigned long endTime = bme->beginReading();
-  if (endTime == 0)
-    return JS_EXCEPTION;
-
-  delay(50);
-
-  if (!bme->endReading())
+  float values[5];
+  if( !unit_envpro_measure(values) )
     return JS_EXCEPTION;
 
   JSValue obj = JS_NewObject(ctx);
-  float temperature = bme->temperature;
-  JS_SetPropertyStr(ctx, obj, "temperature", JS_NewFloat64(ctx, temperature));
-  float humidity = bme->humidity;
-  JS_SetPropertyStr(ctx, obj, "humidity", JS_NewFloat64(ctx, humidity));
-  uint32_t pressure = bme->pressure;
-  JS_SetPropertyStr(ctx, obj, "pressure", JS_NewFloat64(ctx, pressure / 100.0));
-  uint32_t gas = bme->gas_resistance;
-  JS_SetPropertyStr(ctx, obj, "gas", JS_NewFloat64(ctx, gas / 1000.0));
-  float altitude = bme->readAltitude(SEALEVELPRESSURE_HPA);
-  JS_SetPropertyStr(ctx, obj, "altitude", JS_NewFloat64(ctx, altitude));
+  JS_SetPropertyStr(ctx, obj, "temperature", JS_NewFloat64(ctx, values[0]));
+  JS_SetPropertyStr(ctx, obj, "humidity", JS_NewFloat64(ctx, values[1]));
+  JS_SetPropertyStr(ctx, obj, "pressure", JS_NewFloat64(ctx, values[2]));
+  JS_SetPropertyStr(ctx, obj, "gas", JS_NewFloat64(ctx, values[3]));
+  JS_SetPropertyStr(ctx, obj, "altitude", JS_NewFloat64(ctx, values[4]));
 
   return obj;
 }
@@ -70,6 +89,7 @@ static const JSCFunctionListEntry unit_envpro_funcs[] = {
 JSModuleDef *addModule_unit_envpro(JSContext *ctx, JSValue global)
 {
   JSModuleDef *mod;
+
   mod = JS_NewCModule(ctx, "UnitEnvPro", [](JSContext *ctx, JSModuleDef *m)
                       { return JS_SetModuleExportList(
                             ctx, m, unit_envpro_funcs,
@@ -6,27 +6,50 @@
 #include "quickjs.h"
 #include "module_unit_gas.h"
 #include "Adafruit_SGP30.h"
+#include "module_sensor.h"
+#include "module_wire.h"
 
 static Adafruit_SGP30 sgp;
 
+static const char * const gas_value_names[] = { "TVOC", "eCO2" };
+
+static bool unit_gas_measure(float *p_values)
+{
+  wire_bus_lock(&Wire);
+  bool ret = sgp.IAQmeasure();
+  p_values[0] = sgp.TVOC;
+  p_values[1] = sgp.eCO2;
+  wire_bus_unlock(&Wire);
+  return ret;
+}
+
+static const SENSOR_PROVIDER gas_provider = { "gas", 2, gas_value_names, unit_gas_measure };
+
 static JSValue unit_gas_begin(JSContext *ctx, JSValueConst jsThis,
                                       int argc, JSValueConst *argv)
 {
-  if( !sgp.begin() )
+  sensor_unregister(gas_provider.name);
+  wire_bus_lock(&Wire);
+  bool ret = sgp.begin();
+  wire_bus_unlock(&Wire);
+  if( !ret )
     return JS_EXCEPTION;
 
+  sensor_register(&gas_provider);
+
   return JS_UNDEFINED;
 }
 
 static JSValue unit_gas_iaqMeature(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
-  if( !sgp.IAQmeasure() )
+  float values[2];
+  if( !unit_gas_measure(values) )
     return JS_EXCEPTION;
 
   JSValue obj = JS_NewObject(ctx);
-  JS_SetPropertyStr(ctx, obj, "TVOC", JS_NewUint32(ctx, sgp.TVOC));
-  JS_SetPropertyStr(ctx, obj, "eCO2", JS_NewUint32(ctx, sgp.eCO2));
+  JS_SetPropertyStr(ctx, obj, "TVOC", JS_NewUint32(ctx, (uint32_t)values[0]));
+  JS_SetPropertyStr(ctx, obj, "eCO2", JS_NewUint32(ctx, (uint32_t)values[1]));
   return obj;
 }
 
@@ -44,6 +67,7 @@ static const JSCFunctionListEntry unit_gas_funcs[] = {
 JSModuleDef *addModule_unit_gas(JSContext *ctx, JSValue global)
 {
   JSModuleDef *mod;
+
   mod = JS_NewCModule(ctx, "UnitGas", [](JSContext *ctx, JSModuleDef *m)
                       { return JS_SetModuleExportList(
                             ctx, m, unit_gas_funcs,
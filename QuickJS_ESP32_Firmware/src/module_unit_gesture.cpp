@@ -5,6 +5,7 @@
 
 #include "quickjs.h"
 #include "module_unit_gesture.h"
+#include "module_wire.h"
 #include <DFRobot_PAJ7620U2.h>
 
 static DFRobot_PAJ7620U2 sensor;
@@ -12,10 +13,14 @@ static DFRobot_PAJ7620U2 sensor;
 static JSValue unit_gesture_begin(JSContext *ctx, JSValueConst jsThis,
                                       int argc, JSValueConst *argv)
 {
-  if( sensor.begin() != ERR_OK )
+  wire_bus_lock(&Wire);
+  if( sensor.begin() != ERR_OK ){
+    wire_bus_unlock(&Wire);
     return JS_EXCEPTION;
+  }
 
   sensor.setGestureHighRate(true);
+  wire_bus_unlock(&Wire);
 
   return JS_UNDEFINED;
 }
@@ -24,7 +29,9 @@ static JSValue unit_gesture_setGestureHighRate(JSContext *ctx, JSValueConst jsTh
                                      int argc, JSValueConst *argv)
 {
   bool enable = JS_ToBool(ctx, argv[0]);
+  wire_bus_lock(&Wire);
   sensor.setGestureHighRate(enable); 
+  wire_bus_unlock(&Wire);
 
   return JS_UNDEFINED;
 }
@@ -32,7 +39,9 @@ static JSValue unit_gesture_setGestureHighRate(JSContext *ctx, JSValueConst jsTh
 static JSValue unit_gesture_getGesture(JSContext *ctx, JSValueConst jsThis,
                                      int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   DFRobot_PAJ7620U2::eGesture_t gesture = sensor.getGesture(); 
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, (uint32_t)gesture);
 }
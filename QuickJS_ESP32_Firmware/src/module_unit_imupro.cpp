@@ -5,6 +5,7 @@
 
 #include "quickjs.h"
 #include "module_unit_imupro.h"
+#include "module_wire.h"
 #include "M5_IMU_PRO.h"
 #include "MadgwickAHRS.h"
 
@@ -25,7 +26,9 @@ static JSValue unit_imupro_begin(JSContext *ctx, JSValueConst jsThis, int argc,
     uint32_t sampleFrequency = 20;
     JS_ToUint32(ctx, &sampleFrequency, argv[0]);
 
+    wire_bus_lock(&Wire);
     bool status = bmp.begin(BMP280_SENSOR_ADDR);
+    wire_bus_unlock(&Wire);
     if (!status) {
         Serial.println(
             F("Could not find a valid BMP280 sensor, check wiring or "
@@ -35,7 +38,9 @@ static JSValue unit_imupro_begin(JSContext *ctx, JSValueConst jsThis, int argc,
         return JS_EXCEPTION;
     }
 
+    wire_bus_lock(&Wire);
     int ret = bmi270.init(I2C_NUM_0, BIM270_SENSOR_ADDR);
+    wire_bus_unlock(&Wire);
     if( !ret ){
         Serial.println("bmi270 not found");
         return JS_EXCEPTION;
@@ -48,11 +53,15 @@ static JSValue unit_imupro_begin(JSContext *ctx, JSValueConst jsThis, int argc,
 
 static JSValue unit_imupro_readAcceleration(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-    if (!bmi270.accelerationAvailable())
+    wire_bus_lock(&Wire);
+    if (!bmi270.accelerationAvailable()){
+        wire_bus_unlock(&Wire);
         return JS_NULL;
+    }
 
     float ax, ay, az;
     int ret = bmi270.readAcceleration(ax, ay, az);
+    wire_bus_unlock(&Wire);
     if( !ret )
         return JS_EXCEPTION;
     
@@ -66,11 +75,15 @@ static JSValue unit_imupro_readAcceleration(JSContext *ctx, JSValueConst jsThis,
 
 static JSValue unit_imupro_readGyroscope(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-    if (!bmi270.gyroscopeAvailable())
+    wire_bus_lock(&Wire);
+    if (!bmi270.gyroscopeAvailable()){
+        wire_bus_unlock(&Wire);
         return JS_NULL;
+    }
 
     float gx, gy, gz;
     int ret = bmi270.readGyroscope(gx, gy, gz);
+    wire_bus_unlock(&Wire);
     if( !ret )
         return JS_EXCEPTION;
     
@@ -84,11 +97,15 @@ static JSValue unit_imupro_readGyroscope(JSContext *ctx, JSValueConst jsThis, in
 
 static JSValue unit_imupro_readMagneticField(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-    if (!bmi270.magneticFieldAvailable())
+    wire_bus_lock(&Wire);
+    if (!bmi270.magneticFieldAvailable()){
+        wire_bus_unlock(&Wire);
         return JS_NULL;
+    }
 
     int16_t mx, my, mz = 0;
     int ret = bmi270.readMagneticField(mx, my, mz);
+    wire_bus_unlock(&Wire);
     if( !ret )
         return JS_EXCEPTION;
     
@@ -102,16 +119,19 @@ static JSValue unit_imupro_readMagneticField(JSContext *ctx, JSValueConst jsThis
 
 static JSValue unit_imupro_updateFilter(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-    if (!bmi270.accelerationAvailable() || !bmi270.gyroscopeAvailable())
+    wire_bus_lock(&Wire);
+    if (!bmi270.accelerationAvailable() || !bmi270.gyroscopeAvailable()){
+        wire_bus_unlock(&Wire);
         return JS_NULL;
+    }
 
     float ax, ay, az;
     float gx, gy, gz;
     int ret;
     ret = bmi270.readAcceleration(ax, ay, az);
-    if( !ret )
-        return JS_EXCEPTION;
-    ret = bmi270.readGyroscope(gx, gy, gz);
+    if( ret )
+        ret = bmi270.readGyroscope(gx, gy, gz);
+    wire_bus_unlock(&Wire);
     if( !ret )
         return JS_EXCEPTION;
     filter.updateIMU(gx, gy, gz, ax, ay, az);
@@ -129,21 +149,27 @@ static JSValue unit_imupro_updateFilter(JSContext *ctx, JSValueConst jsThis, int
 
 static JSValue unit_imupro_readTemperature(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+    wire_bus_lock(&Wire);
     float temp = bmp.readTemperature();
+    wire_bus_unlock(&Wire);
 
     return JS_NewFloat64(ctx, temp);
 }
 
 static JSValue unit_imupro_readPressure(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+    wire_bus_lock(&Wire);
     float press = bmp.readPressure();
+    wire_bus_unlock(&Wire);
 
     return JS_NewFloat64(ctx, press);
 }
 
 static JSValue unit_imupro_readAltitude(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+    wire_bus_lock(&Wire);
     float alt = bmp.readAltitude(1013.25);
+    wire_bus_unlock(&Wire);
 
     return JS_NewFloat64(ctx, alt);
 }
@@ -5,6 +5,7 @@
 
 #include "quickjs.h"
 #include "module_unit_pbhub.h"
+#include "module_wire.h"
 #include "porthub.h"
 
 static PortHub porthub;
@@ -16,7 +17,9 @@ static uint8_t HUB_ADDR[6] = {HUB1_ADDR, HUB2_ADDR, HUB3_ADDR, HUB4_ADDR, HUB5_A
 static JSValue unit_pbhub_begin(JSContext *ctx, JSValueConst jsThis,
                                       int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   porthub.begin();
+  wire_bus_unlock(&Wire);
 
   return JS_UNDEFINED;
 }
@@ -29,7 +32,9 @@ static JSValue unit_pbhub_analogRead(JSContext *ctx, JSValueConst jsThis,
   if( reg >= sizeof(HUB_ADDR))
     return JS_EXCEPTION;
 
+  wire_bus_lock(&Wire);
   uint16_t value = porthub.hub_a_read_value(HUB_ADDR[reg]);
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, value);
 }
@@ -44,12 +49,15 @@ static JSValue unit_pbhub_digitalRead(JSContext *ctx, JSValueConst jsThis,
     return JS_EXCEPTION;
 
   uint8_t value;
+  if( port != PBHUB_PORT_A && port != PBHUB_PORT_B )
+    return JS_EXCEPTION;
+
+  wire_bus_lock(&Wire);
   if( port == PBHUB_PORT_A )
     value = porthub.hub_d_read_value_A(HUB_ADDR[reg]);
-  else if( port == PBHUB_PORT_B )
-    value = porthub.hub_d_read_value_B(HUB_ADDR[reg]);
   else
-    return JS_EXCEPTION;
+    value = porthub.hub_d_read_value_B(HUB_ADDR[reg]);
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, value);
 }
@@ -64,12 +72,15 @@ static JSValue unit_pbhub_analogWrite(JSContext *ctx, JSValueConst jsThis,
   if( reg >= sizeof(HUB_ADDR))
     return JS_EXCEPTION;
 
+  if( port != PBHUB_PORT_A && port != PBHUB_PORT_B )
+    return JS_EXCEPTION;
+
+  wire_bus_lock(&Wire);
   if( port == PBHUB_PORT_A )
     porthub.hub_a_wire_value_A(HUB_ADDR[reg], duty);
-  else if( port == PBHUB_PORT_B )
-    porthub.hub_a_wire_value_B(HUB_ADDR[reg], duty);
   else
-    return JS_EXCEPTION;
+    porthub.hub_a_wire_value_B(HUB_ADDR[reg], duty);
+  wire_bus_unlock(&Wire);
 
   return JS_UNDEFINED;
 }
@@ -84,12 +95,15 @@ static JSValue unit_pbhub_digitalWrite(JSContext *ctx, JSValueConst jsThis,
   if( reg >= sizeof(HUB_ADDR))
     return JS_EXCEPTION;
 
+  if( port != PBHUB_PORT_A && port != PBHUB_PORT_B )
+    return JS_EXCEPTION;
+
+  wire_bus_lock(&Wire);
   if( port == PBHUB_PORT_A )
     porthub.hub_d_wire_value_A(HUB_ADDR[reg], level);
-  else if( port == PBHUB_PORT_B )
-    porthub.hub_d_wire_value_B(HUB_ADDR[reg], level);
   else
-    return JS_EXCEPTION;
+    porthub.hub_d_wire_value_B(HUB_ADDR[reg], level);
+  wire_bus_unlock(&Wire);
 
   return JS_UNDEFINED;
 }
@@ -6,20 +6,25 @@
 #include <Wire.h>
 #include "quickjs.h"
 #include "module_unit_step16.h"
+#include "module_wire.h"
 #include "unit_step16.hpp"
 
 static UnitStep16 step16;
 
 static JSValue unit_step16_begin(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   bool ret = step16.begin();
+  wire_bus_unlock(&Wire);
 
   return JS_NewBool(ctx, ret);
 }
 
 static JSValue unit_step16_getValue(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   uint8_t value = step16.getValue();
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, value);
 }
@@ -29,14 +34,18 @@ static JSValue unit_step16_setLedConfig(JSContext *ctx, JSValueConst jsThis, int
   uint32_t config;
   JS_ToUint32(ctx, &config, argv[0]);
 
+  wire_bus_lock(&Wire);
   bool ret = step16.setLedConfig(config);
+  wire_bus_unlock(&Wire);
 
   return JS_NewBool(ctx, ret);
 }
 
 static JSValue unit_step16_getLedConfig(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   uint8_t config = step16.getLedConfig();
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, config);
 }
@@ -46,14 +55,18 @@ static JSValue unit_step16_setLedBrightness(JSContext *ctx, JSValueConst jsThis,
   uint32_t brightness;
   JS_ToUint32(ctx, &brightness, argv[0]);
 
+  wire_bus_lock(&Wire);
   bool ret = step16.setLedBrightness(brightness);
+  wire_bus_unlock(&Wire);
 
   return JS_NewBool(ctx, ret);
 }
 
 static JSValue unit_step16_getLedBrightness(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   uint8_t config = step16.getLedBrightness();
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, config);
 }
@@ -63,14 +76,18 @@ static JSValue unit_step16_setSwitchState(JSContext *ctx, JSValueConst jsThis, i
   uint32_t state;
   JS_ToUint32(ctx, &state, argv[0]);
 
+  wire_bus_lock(&Wire);
   bool ret = step16.setSwitchState(state);
+  wire_bus_unlock(&Wire);
 
   return JS_NewBool(ctx, ret);
 }
 
 static JSValue unit_step16_getSwitchState(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   uint8_t state = step16.getSwitchState();
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, state);
 }
@@ -80,14 +97,18 @@ static JSValue unit_step16_setRgbConfig(JSContext *ctx, JSValueConst jsThis, int
   uint32_t config;
   JS_ToUint32(ctx, &config, argv[0]);
 
+  wire_bus_lock(&Wire);
   bool ret = step16.setRgbConfig(config);
+  wire_bus_unlock(&Wire);
 
   return JS_NewBool(ctx, ret);
 }
 
 static JSValue unit_step16_getRgbConfig(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   uint8_t config = step16.getRgbConfig();
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, config);
 }
@@ -97,14 +118,18 @@ static JSValue unit_step16_setRgbBrightness(JSContext *ctx, JSValueConst jsThis,
   uint32_t brightness;
   JS_ToUint32(ctx, &brightness, argv[0]);
 
+  wire_bus_lock(&Wire);
   bool ret = step16.setRgbBrightness(brightness);
+  wire_bus_unlock(&Wire);
 
   return JS_NewBool(ctx, ret);
 }
 
 static JSValue unit_step16_getRgbBrightness(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   uint8_t config = step16.getRgbBrightness();
+  wire_bus_unlock(&Wire);
 
   return JS_NewUint32(ctx, config);
 }
@@ -116,7 +141,9 @@ static JSValue unit_step16_setRgb(JSContext *ctx, JSValueConst jsThis, int argc,
   JS_ToUint32(ctx, &g, argv[1]);
   JS_ToUint32(ctx, &b, argv[2]);
 
+  wire_bus_lock(&Wire);
   bool ret = step16.setRgb(r, g, b);
+  wire_bus_unlock(&Wire);
   if( !ret )
     return JS_EXCEPTION;
 
@@ -127,7 +154,9 @@ static JSValue unit_step16_getRgb(JSContext *ctx, JSValueConst jsThis, int argc,
 {
   uint8_t r, g, b;
 
+  wire_bus_lock(&Wire);
   uint8_t ret = step16.getRgb(&r, &g, &b);
+  wire_bus_unlock(&Wire);
   if( !ret )
     return JS_EXCEPTION;
 
@@ -143,14 +172,18 @@ static JSValue unit_step16_saveToFlash(JSContext *ctx, JSValueConst jsThis, int
   uint32_t save;
   JS_ToUint32(ctx, &save, argv[0]);
 
+  wire_bus_lock(&Wire);
   bool ret = step16.saveToFlash(save);
+  wire_bus_unlock(&Wire);
 
   return JS_NewBool(ctx, ret);
 }
 
 static JSValue unit_step16_setDefaultConfig(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  wire_bus_lock(&Wire);
   bool ret = step16.setDefaultConfig();
+  wire_bus_unlock(&Wire);
 
   return JS_NewBool(ctx, ret);
 }
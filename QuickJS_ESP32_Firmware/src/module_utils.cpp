@@ -1312,24 +1312,113 @@ JSValue createNumberArray(JSContext *ctx, int32_t *p_buffer, uint32_t unit_num)
   return list;
 }
 
+static JSContext *g_binding_ctx = NULL;
+static JSAtom g_binding_atoms[NUM_OF_BINDING_ATOM];
+static JSValue g_binding_ctors[NUM_OF_BINDING_CTOR];
+
+static const char *const g_binding_atom_names[NUM_OF_BINDING_ATOM] = {
+  "x", "y", "z", "list", "payload", "remoteIp", "remotePort"
+};
+static const char *const g_binding_ctor_names[NUM_OF_BINDING_CTOR] = {
+  "Uint8Array", "Uint16Array", "Uint32Array", "Float32Array"
+};
+
+void binding_cache_initialize(JSContext *ctx)
+{
+  if( g_binding_ctx != NULL )
+    binding_cache_free(g_binding_ctx);
+
+  JSValue global_obj = JS_GetGlobalObject(ctx);
+  for( int i = 0 ; i < NUM_OF_BINDING_CTOR ; i++ )
+    g_binding_ctors[i] = JS_GetPropertyStr(ctx, global_obj, g_binding_ctor_names[i]);
+  JS_FreeValue(ctx, global_obj);
+  for( int i = 0 ; i < NUM_OF_BINDING_ATOM ; i++ )
+    g_binding_atoms[i] = JS_NewAtom(ctx, g_binding_atom_names[i]);
+
+  g_binding_ctx = ctx;
+}
+
+void binding_cache_free(JSContext *ctx)
+{
+  if( g_binding_ctx != ctx )
+    return;
+
+  for( int i = 0 ; i < NUM_OF_BINDING_CTOR ; i++ ){
+    JS_FreeValue(ctx, g_binding_ctors[i]);
+    g_binding_ctors[i] = JS_UNDEFINED;
+  }
+  for( int i = 0 ; i < NUM_OF_BINDING_ATOM ; i++ ){
+    JS_FreeAtom(ctx, g_binding_atoms[i]);
+    g_binding_atoms[i] = JS_ATOM_NULL;
+  }
+
+  g_binding_ctx = NULL;
+}
+
+JSAtom binding_atom(BINDING_ATOM id)
+{
+  return g_binding_atoms[id];
+}
+
+void binding_set_property(JSContext *ctx, JSValue obj, BINDING_ATOM id, JSValue value)
+{
+  if( g_binding_ctx == ctx )
+    JS_DefinePropertyValue(ctx, obj, g_binding_atoms[id], value, JS_PROP_C_W_E);
+  else
+    JS_SetPropertyStr(ctx, obj, g_binding_atom_names[id], value);
+}
+
+JSValue create_TypedArray(JSContext *ctx, BINDING_CTOR type, JSValue array_buffer)
+{
+  JSValue args[1] = { array_buffer };
+  if( g_binding_ctx == ctx )
+    return JS_CallConstructor(ctx, g_binding_ctors[type], 1, args);
+
+  JSValue global_obj = JS_GetGlobalObject(ctx);
+  JSValue ctor = JS_GetPropertyStr(ctx, global_obj, g_binding_ctor_names[type]);
+  JSValue typed_array = JS_CallConstructor(ctx, ctor, 1, args);
+  JS_FreeValue(ctx, ctor);
+  JS_FreeValue(ctx, global_obj);
+
+  return typed_array;
+}
+
 JSValue create_Uint8Array(JSContext *ctx, const uint8_t *p_buffer, uint32_t len)
 {
     JSValue array_buffer = JS_NewArrayBufferCopy(ctx, p_buffer, len);
     if( array_buffer == JS_EXCEPTION )
       return JS_EXCEPTION;
 
-    JSValue global_obj = JS_GetGlobalObject(ctx);
-    JSValue ctor = JS_GetPropertyStr(ctx, global_obj, "Uint8Array");
-    JSValue args[1] = { array_buffer };
-    JSValue uint8_array = JS_CallConstructor(ctx, ctor, 1, args);
+    JSValue uint8_array = create_TypedArray(ctx, BINDING_CTOR_UINT8ARRAY, array_buffer);
+    JS_FreeValue(ctx, array_buffer);
 
-    JS_FreeValue(ctx, ctor);
-    JS_FreeValue(ctx, global_obj);
+    return uint8_array;
+}
+
+// p_buffer is owned by the returned array and released with free_func
+JSValue create_Uint8Array_nocopy(JSContext *ctx, uint8_t *p_buffer, uint32_t len, JSFreeArrayBufferDataFunc *free_func, void *opaque)
+{
+    JSValue array_buffer = JS_NewArrayBuffer(ctx, p_buffer, len, free_func, opaque, false);
+    if( array_buffer == JS_EXCEPTION ){
+      free_func(JS_GetRuntime(ctx), opaque, p_buffer);
+      return JS_EXCEPTION;
+    }
+
+    JSValue uint8_array = create_TypedArray(ctx, BINDING_CTOR_UINT8ARRAY, array_buffer);
     JS_FreeValue(ctx, array_buffer);
 
     return uint8_array;
 }
 
+JSValue create_xyz_object(JSContext *ctx, JSValue x, JSValue y, JSValue z)
+{
+  JSValue obj = JS_NewObject(ctx);
+  binding_set_property(ctx, obj, BINDING_ATOM_X, x);
+  binding_set_property(ctx, obj, BINDING_ATOM_Y, y);
+  binding_set_property(ctx, obj, BINDING_ATOM_Z, z);
+  return obj;
+}
+
 JSValue from_Uint8Array(JSContext *ctx, JSValue value, uint8_t** pp_buffer, uint32_t *p_num)
 {
   uint8_t unit_size;
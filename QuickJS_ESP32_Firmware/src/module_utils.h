@@ -28,4 +28,32 @@ JSValue from_Uint8Array(JSContext *ctx, JSValue value, uint8_t** pp_buffer, uint
 
 void my_mem_free(JSRuntime *rt, void *opaque, void *ptr);
 
+// per-context cache of atoms and constructors used by native modules
+typedef enum {
+  BINDING_ATOM_X = 0,
+  BINDING_ATOM_Y,
+  BINDING_ATOM_Z,
+  BINDING_ATOM_LIST,
+  BINDING_ATOM_PAYLOAD,
+  BINDING_ATOM_REMOTE_IP,
+  BINDING_ATOM_REMOTE_PORT,
+  NUM_OF_BINDING_ATOM
+} BINDING_ATOM;
+
+typedef enum {
+  BINDING_CTOR_UINT8ARRAY = 0,
+  BINDING_CTOR_UINT16ARRAY,
+  BINDING_CTOR_UINT32ARRAY,
+  BINDING_CTOR_FLOAT32ARRAY,
+  NUM_OF_BINDING_CTOR
+} BINDING_CTOR;
+
+void binding_cache_initialize(JSContext *ctx);
+void binding_cache_free(JSContext *ctx);
+JSAtom binding_atom(BINDING_ATOM id);
+void binding_set_property(JSContext *ctx, JSValue obj, BINDING_ATOM id, JSValue value);
+JSValue create_TypedArray(JSContext *ctx, BINDING_CTOR type, JSValue array_buffer);
+JSValue create_Uint8Array_nocopy(JSContext *ctx, uint8_t *p_buffer, uint32_t len, JSFreeArrayBufferDataFunc *free_func, void *opaque);
+JSValue create_xyz_object(JSContext *ctx, JSValue x, JSValue y, JSValue z);
+
 #endif
\ No newline at end of file
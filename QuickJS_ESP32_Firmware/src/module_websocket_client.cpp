@@ -12,62 +12,225 @@
 using namespace websockets;
 static WebsocketsClient wsc;
 
+#define WSCLIENT_DEFAULT_MAX_QUEUE  32
+#define WSCLIENT_CONNECT_TASK_STACK 8192
+#define WSCLIENT_HOST_MAX_LEN 128
+#define WSCLIENT_PATH_MAX_LEN 256
+
 typedef enum {
   WSCB_CONNECTED,
   WSCB_DISCONNECTED,
   WSCB_TEXT,
   WSCB_BINARY,
+  WSCB_PONG,
+  WSCB_ERROR,
 } WSCB_TYPE;
 
+typedef enum {
+  WSCLIENT_POLICY_DROP_OLDEST = 0,
+  WSCLIENT_POLICY_DROP_NEWEST,
+  WSCLIENT_POLICY_PAUSE,
+} WSCLIENT_POLICY;
+
+typedef enum {
+  WSCLIENT_STATE_DISCONNECTED = 0,
+  WSCLIENT_STATE_CONNECTING,
+  WSCLIENT_STATE_CONNECTED,
+} WSCLIENT_STATE;
+
 typedef struct {
   WSCB_TYPE type;
-  uint8_t *p_payload;
-  uint32_t length;
+  std::string *p_payload;
+  uint32_t value;
 } WSCLIENT_EVENT_INFO;
 static std::vector<WSCLIENT_EVENT_INFO> g_event_list;
+static SemaphoreHandle_t g_event_mutex = NULL;
 
 static JSContext *g_ctx = NULL;
 static JSValue g_callback_func = JS_UNDEFINED;
 
-void onMessageCallback(WebsocketsMessage message) {
-  WSCLIENT_EVENT_INFO info;
-  if( message.isText() ){
-    info.type = WSCB_TEXT;
-    info.p_payload = (uint8_t*)strdup(message.c_str());
-    if( info.p_payload == NULL )
-      return;
-    g_event_list.push_back(info);
-  }else if( message.isBinary() ){
-    const char* data = message.data().c_str();
-    size_t len = message.length();
-    info.p_payload = (uint8_t*)malloc(len);
-    if( info.p_payload == NULL )
+static volatile WSCLIENT_STATE g_state = WSCLIENT_STATE_DISCONNECTED;
+static TaskHandle_t g_connect_task = NULL;
+static char g_host[WSCLIENT_HOST_MAX_LEN] = "";
+static uint16_t g_port = 0;
+static char g_path[WSCLIENT_PATH_MAX_LEN] = "";
+
+static uint32_t g_max_queue = WSCLIENT_DEFAULT_MAX_QUEUE;
+static WSCLIENT_POLICY g_policy = WSCLIENT_POLICY_DROP_OLDEST;
+static uint32_t g_dropped = 0;
+
+static uint32_t g_ping_interval = 0;
+static uint32_t g_ping_timeout = 0;
+static uint32_t g_ping_sent = 0;
+static uint32_t g_ping_seq = 0;
+static bool g_ping_waiting = false;
+static uint32_t g_last_rtt = 0;
+
+static bool g_reconnect = false;
+static uint32_t g_reconnect_min = 1000;
+static uint32_t g_reconnect_max = 30000;
+static uint32_t g_reconnect_delay = 0;
+static uint32_t g_reconnect_at = 0;
+static uint32_t g_reconnect_count = 0;
+
+static uint32_t g_rx_bytes = 0;
+static uint32_t g_tx_bytes = 0;
+
+static void free_event_info(WSCLIENT_EVENT_INFO *p_info)
+{
+  if( p_info->p_payload != NULL ){
+    delete p_info->p_payload;
+    p_info->p_payload = NULL;
+  }
+}
+
+static void push_event(WSCB_TYPE type, std::string *p_payload, uint32_t value)
+{
+  WSCLIENT_EVENT_INFO info = { type, p_payload, value };
+
+  xSemaphoreTake(g_event_mutex, portMAX_DELAY);
+  if( (type == WSCB_TEXT || type == WSCB_BINARY) && g_event_list.size() >= g_max_queue ){
+    // PAUSE rarely gets here since poll() stops while the queue is full
+    if( g_policy == WSCLIENT_POLICY_DROP_NEWEST ){
+      g_dropped++;
+      xSemaphoreGive(g_event_mutex);
+      free_event_info(&info);
       return;
-    memmove(info.p_payload, data, len);
-    info.length = len;
-    g_event_list.push_back(info);
-  }else{
-    return;
+    }
+    auto it = std::find_if(g_event_list.begin(), g_event_list.end(), [](WSCLIENT_EVENT_INFO &ent){
+      return ent.type == WSCB_TEXT || ent.type == WSCB_BINARY;
+    });
+    if( it != g_event_list.end() ){
+      free_event_info(&(*it));
+      g_event_list.erase(it);
+      g_dropped++;
+    }
   }
+  g_event_list.push_back(info);
+  xSemaphoreGive(g_event_mutex);
+}
+
+static void clear_event_list(void)
+{
+  xSemaphoreTake(g_event_mutex, portMAX_DELAY);
+  for( auto &info : g_event_list )
+    free_event_info(&info);
+  g_event_list.clear();
+  xSemaphoreGive(g_event_mutex);
+}
+
+static uint32_t count_event_list(void)
+{
+  xSemaphoreTake(g_event_mutex, portMAX_DELAY);
+  uint32_t count = g_event_list.size();
+  xSemaphoreGive(g_event_mutex);
+  return count;
+}
+
+void onMessageCallback(WebsocketsMessage message) {
+  WSCB_TYPE type;
+  if( message.isText() )
+    type = WSCB_TEXT;
+  else if( message.isBinary() )
+    type = WSCB_BINARY;
+  else
+    return;
+
+  // message is our own copy, so take over its buffer instead of copying it
+  std::string *p_payload = new std::string();
+  p_payload->swap(const_cast<WSString&>(message.rawData()));
+  g_rx_bytes += p_payload->size();
+
+  push_event(type, p_payload, 0);
 }
 
 void onEventsCallback(WebsocketsEvent event, String data) {
-    WSCLIENT_EVENT_INFO info = {};
     if(event == WebsocketsEvent::ConnectionOpened) {
-      info.type = WSCB_CONNECTED;
-      info.p_payload = NULL;
-      g_event_list.push_back(info);
+      g_state = WSCLIENT_STATE_CONNECTED;
+      push_event(WSCB_CONNECTED, NULL, 0);
     } else if(event == WebsocketsEvent::ConnectionClosed) {
-      info.type = WSCB_DISCONNECTED;
-      info.p_payload = NULL;
-      g_event_list.push_back(info);
+      g_state = WSCLIENT_STATE_DISCONNECTED;
+      g_ping_waiting = false;
+      push_event(WSCB_DISCONNECTED, NULL, 0);
     } else if(event == WebsocketsEvent::GotPing) {
 //        Serial.println("Got a Ping!");
     } else if(event == WebsocketsEvent::GotPong) {
-//        Serial.println("Got a Pong!");
+      if( g_ping_waiting && strtoul(data.c_str(), NULL, 10) == g_ping_seq ){
+        g_ping_waiting = false;
+        g_last_rtt = millis() - g_ping_sent;
+        push_event(WSCB_PONG, NULL, g_last_rtt);
+      }
     }
 }
 
+static void wsclient_connect_task(void *arg)
+{
+  bool ret = wsc.connect(g_host, g_port, g_path);
+  if( ret ){
+    g_state = WSCLIENT_STATE_CONNECTED;
+    g_reconnect_delay = 0;
+  }else{
+    g_state = WSCLIENT_STATE_DISCONNECTED;
+    push_event(WSCB_ERROR, NULL, 0);
+  }
+
+  g_connect_task = NULL;
+  vTaskDelete(NULL);
+}
+
+static bool start_connect_task(void)
+{
+  if( g_connect_task != NULL )
+    return false;
+
+  g_state = WSCLIENT_STATE_CONNECTING;
+  BaseType_t ret = xTaskCreate(wsclient_connect_task, "wsclient_connect", WSCLIENT_CONNECT_TASK_STACK, NULL, 1, &g_connect_task);
+  if( ret != pdPASS ){
+    g_connect_task = NULL;
+    g_state = WSCLIENT_STATE_DISCONNECTED;
+    return false;
+  }
+
+  return true;
+}
+
+static void schedule_reconnect(void)
+{
+  if( g_reconnect_delay == 0 )
+    g_reconnect_delay = g_reconnect_min;
+  else
+    g_reconnect_delay = std::min(g_reconnect_delay * 2, g_reconnect_max);
+  g_reconnect_at = millis() + g_reconnect_delay;
+}
+
+static long set_target(JSContext *ctx, int argc, JSValueConst *argv)
+{
+  const char* p_host = JS_ToCString(ctx, argv[0]);
+  if( p_host == NULL )
+    return -1;
+  uint32_t port;
+  JS_ToUint32(ctx, &port, argv[1]);
+  const char* p_path = JS_ToCString(ctx, argv[2]);
+  if( p_path == NULL ){
+    JS_FreeCString(ctx, p_host);
+    return -1;
+  }
+
+  long ret = 0;
+  if( strlen(p_host) >= sizeof(g_host) || strlen(p_path) >= sizeof(g_path) ){
+    ret = -1;
+  }else{
+    strcpy(g_host, p_host);
+    strcpy(g_path, p_path);
+    g_port = port;
+  }
+
+  JS_FreeCString(ctx, p_host);
+  JS_FreeCString(ctx, p_path);
+
+  return ret;
+}
+
 static JSValue websocket_client_setCallback(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
   if( g_callback_func != JS_UNDEFINED )
@@ -81,53 +244,150 @@ static JSValue websocket_client_setCallback(JSContext *ctx, JSValueConst jsThis,
 
 static JSValue websocket_client_send(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  if( !wsc.available() )
+  if( g_state != WSCLIENT_STATE_CONNECTED || !wsc.available() )
     return JS_EXCEPTION;
 
-  const char* p_payload = JS_ToCString(ctx, argv[0]);
-  bool ret = wsc.send(p_payload);
-  JS_FreeCString(ctx, p_payload);
+  bool ret;
+  if( JS_IsString(argv[0]) ){
+    size_t len;
+    const char* p_payload = JS_ToCStringLen(ctx, &len, argv[0]);
+    if( p_payload == NULL )
+      return JS_EXCEPTION;
+    ret = wsc.send(p_payload, len);
+    JS_FreeCString(ctx, p_payload);
+    if( ret ) g_tx_bytes += len;
+  }else{
+    uint8_t *p_buffer;
+    uint8_t unit_size;
+    uint32_t unit_num;
+    JSValue vbuffer = getBinaryFromTypedArray(ctx, argv[0], (void**)&p_buffer, &unit_size, &unit_num);
+    if( JS_IsNull(vbuffer) )
+      return JS_EXCEPTION;
+    ret = wsc.sendBinary((const char*)p_buffer, unit_num);
+    JS_FreeValue(ctx, vbuffer);
+    if( ret ) g_tx_bytes += unit_num;
+  }
 
   return JS_NewBool(ctx, ret);
 }
 
 static JSValue websocket_client_connect(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
-  if( wsc.available() )
+  if( g_state != WSCLIENT_STATE_DISCONNECTED || wsc.available() )
     return JS_EXCEPTION;
 
-  const char* p_host = JS_ToCString(ctx, argv[0]);
-  uint32_t port;
-  JS_ToUint32(ctx, &port, argv[1]);
-  const char* p_path = JS_ToCString(ctx, argv[2]);
+  if( set_target(ctx, argc, argv) != 0 )
+    return JS_EXCEPTION;
 
-  bool ret = wsc.connect(p_host, port, p_path);
+  g_reconnect_delay = 0;
+  g_state = WSCLIENT_STATE_CONNECTING;
+  bool ret = wsc.connect(g_host, g_port, g_path);
+  g_state = ret ? WSCLIENT_STATE_CONNECTED : WSCLIENT_STATE_DISCONNECTED;
 
-  JS_FreeCString(ctx, p_host);
-  JS_FreeCString(ctx, p_path);
+  return JS_NewBool(ctx, ret);
+}
+
+static JSValue websocket_client_connectAsync(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  if( g_state != WSCLIENT_STATE_DISCONNECTED || wsc.available() )
+    return JS_EXCEPTION;
+
+  if( set_target(ctx, argc, argv) != 0 )
+    return JS_EXCEPTION;
+
+  g_reconnect_delay = 0;
+  bool ret = start_connect_task();
 
   return JS_NewBool(ctx, ret);
 }
 
 static JSValue websocket_client_disconnect(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  if( g_state == WSCLIENT_STATE_CONNECTING )
+    return JS_EXCEPTION;
+
+  // an explicit disconnect must not be undone by the reconnect logic
+  g_host[0] = '\0';
   wsc.close();
+  g_state = WSCLIENT_STATE_DISCONNECTED;
+  g_ping_waiting = false;
 
-  while(g_event_list.size() > 0){
-    WSCLIENT_EVENT_INFO info = g_event_list.front();
-    if( info.p_payload != NULL )
-      free(info.p_payload);
-    g_event_list.erase(g_event_list.begin());
-  }
+  clear_event_list();
 
   return JS_UNDEFINED;
 }
 
 static JSValue websocket_client_is_connected(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
 {
+  if( g_state != WSCLIENT_STATE_CONNECTED )
+    return JS_FALSE;
   return JS_NewBool(ctx, wsc.available());
 }
 
+static JSValue websocket_client_setQueuePolicy(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t max_queue;
+  JS_ToUint32(ctx, &max_queue, argv[0]);
+  if( max_queue < 1 )
+    return JS_EXCEPTION;
+
+  uint32_t policy = WSCLIENT_POLICY_DROP_OLDEST;
+  if( argc >= 2 )
+    JS_ToUint32(ctx, &policy, argv[1]);
+  if( policy > WSCLIENT_POLICY_PAUSE )
+    return JS_EXCEPTION;
+
+  g_max_queue = max_queue;
+  g_policy = (WSCLIENT_POLICY)policy;
+
+  return JS_UNDEFINED;
+}
+
+static JSValue websocket_client_setKeepalive(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  uint32_t interval;
+  JS_ToUint32(ctx, &interval, argv[0]);
+  uint32_t timeout = interval;
+  if( argc >= 2 )
+    JS_ToUint32(ctx, &timeout, argv[1]);
+
+  g_ping_interval = interval;
+  g_ping_timeout = timeout;
+  g_ping_sent = millis();
+  g_ping_waiting = false;
+
+  return JS_UNDEFINED;
+}
+
+static JSValue websocket_client_setReconnect(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  g_reconnect = JS_ToBool(ctx, argv[0]);
+  if( argc >= 2 )
+    JS_ToUint32(ctx, &g_reconnect_min, argv[1]);
+  if( argc >= 3 )
+    JS_ToUint32(ctx, &g_reconnect_max, argv[2]);
+  if( g_reconnect_min < 100 )
+    g_reconnect_min = 100;
+  if( g_reconnect_max < g_reconnect_min )
+    g_reconnect_max = g_reconnect_min;
+  g_reconnect_delay = 0;
+
+  return JS_UNDEFINED;
+}
+
+static JSValue websocket_client_getStatus(JSContext *ctx, JSValueConst jsThis, int argc, JSValueConst *argv)
+{
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "state", JS_NewUint32(ctx, g_state));
+  JS_SetPropertyStr(ctx, obj, "queued", JS_NewUint32(ctx, count_event_list()));
+  JS_SetPropertyStr(ctx, obj, "dropped", JS_NewUint32(ctx, g_dropped));
+  JS_SetPropertyStr(ctx, obj, "rtt", JS_NewUint32(ctx, g_last_rtt));
+  JS_SetPropertyStr(ctx, obj, "reconnects", JS_NewUint32(ctx, g_reconnect_count));
+  JS_SetPropertyStr(ctx, obj, "rxBytes", JS_NewUint32(ctx, g_rx_bytes));
+  JS_SetPropertyStr(ctx, obj, "txBytes", JS_NewUint32(ctx, g_tx_bytes));
+  return obj;
+}
+
 static const JSCFunctionListEntry websocket_client_funcs[] = {
     JSCFunctionListEntry{"setCallback", 0, JS_DEF_CFUNC, 0, {
                            func : {1, JS_CFUNC_generic, websocket_client_setCallback}
@@ -141,9 +401,36 @@ static const JSCFunctionListEntry websocket_client_funcs[] = {
     JSCFunctionListEntry{"connect", 0, JS_DEF_CFUNC, 0, {
                            func : {3, JS_CFUNC_generic, websocket_client_connect}
                          }},
+    JSCFunctionListEntry{"connectAsync", 0, JS_DEF_CFUNC, 0, {
+                           func : {3, JS_CFUNC_generic, websocket_client_connectAsync}
+                         }},
     JSCFunctionListEntry{"disconnect", 0, JS_DEF_CFUNC, 0, {
                            func : {0, JS_CFUNC_generic, websocket_client_disconnect}
                          }},
+    JSCFunctionListEntry{"setQueuePolicy", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic, websocket_client_setQueuePolicy}
+                         }},
+    JSCFunctionListEntry{"setKeepalive", 0, JS_DEF_CFUNC, 0, {
+                           func : {2, JS_CFUNC_generic, websocket_client_setKeepalive}
+                         }},
+    JSCFunctionListEntry{"setReconnect", 0, JS_DEF_CFUNC, 0, {
+                           func : {3, JS_CFUNC_generic, websocket_client_setReconnect}
+                         }},
+    JSCFunctionListEntry{"getStatus", 0, JS_DEF_CFUNC, 0, {
+                           func : {0, JS_CFUNC_generic, websocket_client_getStatus}
+                         }},
+    JSCFunctionListEntry{
+        "POLICY_DROP_OLDEST", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : WSCLIENT_POLICY_DROP_OLDEST
+        }},
+    JSCFunctionListEntry{
+        "POLICY_DROP_NEWEST", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : WSCLIENT_POLICY_DROP_NEWEST
+        }},
+    JSCFunctionListEntry{
+        "POLICY_PAUSE", 0, JS_DEF_PROP_INT32, 0, {
+          i32 : WSCLIENT_POLICY_PAUSE
+        }},
 };
 
 JSModuleDef *addModule_websocket_client(JSContext *ctx, JSValue global)
@@ -165,52 +452,119 @@ JSModuleDef *addModule_websocket_client(JSContext *ctx, JSValue global)
 
 long initialize_websocket_client(void)
 {
+  g_event_mutex = xSemaphoreCreateMutex();
+  if( g_event_mutex == NULL )
+    return -1;
+
   wsc.onMessage(onMessageCallback);
   wsc.onEvent(onEventsCallback);
-  
+
   return 0;
 }
 
 void endModule_websocket_client(void)
 {
+  // wait for a pending background connect to finish before touching the client
+  while( g_connect_task != NULL )
+    delay(10);
+
+  g_host[0] = '\0';
   wsc.close();
+  g_state = WSCLIENT_STATE_DISCONNECTED;
 
   if( g_callback_func != JS_UNDEFINED ){
     JS_FreeValue(g_ctx, g_callback_func);
     g_callback_func = JS_UNDEFINED;
   }
 
-  while(g_event_list.size() > 0){
-    WSCLIENT_EVENT_INFO info = g_event_list.front();
-    if( info.p_payload != NULL )
-      free(info.p_payload);
-    g_event_list.erase(g_event_list.begin());
-  }
+  clear_event_list();
+
+  g_max_queue = WSCLIENT_DEFAULT_MAX_QUEUE;
+  g_policy = WSCLIENT_POLICY_DROP_OLDEST;
+  g_dropped = 0;
+  g_ping_interval = 0;
+  g_ping_waiting = false;
+  g_last_rtt = 0;
+  g_reconnect = false;
+  g_reconnect_delay = 0;
+  g_reconnect_count = 0;
+  g_rx_bytes = 0;
+  g_tx_bytes = 0;
 
   g_ctx = NULL;
 }
 
+static void loopModule_websocket_client_keepalive(void)
+{
+  uint32_t now = millis();
+  if( g_ping_waiting ){
+    if( g_ping_timeout > 0 && now - g_ping_sent >= g_ping_timeout ){
+      Serial.println("WebsocketClient pong timeout");
+      g_ping_waiting = false;
+      wsc.close();
+    }
+  }else if( now - g_ping_sent >= g_ping_interval ){
+    g_ping_seq++;
+    g_ping_sent = now;
+    g_ping_waiting = wsc.ping(String(g_ping_seq));
+  }
+}
+
 void loopModule_websocket_client(void)
 {
-  wsc.poll();
+  if( g_state == WSCLIENT_STATE_CONNECTING )
+    return;
+
+  if( g_state == WSCLIENT_STATE_DISCONNECTED ){
+    if( g_reconnect && g_host[0] != '\0' ){
+      if( g_reconnect_delay == 0 ){
+        schedule_reconnect();
+      }else if( (int32_t)(millis() - g_reconnect_at) >= 0 ){
+        // back off first; a successful attempt resets the delay from the task
+        g_reconnect_count++;
+        schedule_reconnect();
+        start_connect_task();
+      }
+    }
+  }else{
+    if( g_policy != WSCLIENT_POLICY_PAUSE || count_event_list() < g_max_queue )
+      wsc.poll();
+    if( g_state == WSCLIENT_STATE_CONNECTED && g_ping_interval > 0 )
+      loopModule_websocket_client_keepalive();
+  }
 
   if( g_ctx != NULL && g_callback_func != JS_UNDEFINED ){
-    while(g_event_list.size() > 0){
-      WSCLIENT_EVENT_INFO info = g_event_list.front();
+    while(true){
+      WSCLIENT_EVENT_INFO info;
+      xSemaphoreTake(g_event_mutex, portMAX_DELAY);
+      if( g_event_list.size() == 0 ){
+        xSemaphoreGive(g_event_mutex);
+        break;
+      }
+      info = g_event_list.front();
+      g_event_list.erase(g_event_list.begin());
+      xSemaphoreGive(g_event_mutex);
+
       JSValue objs[2] = { JS_UNDEFINED, JS_UNDEFINED };
       if( info.type == WSCB_CONNECTED ){
         objs[0] = JS_NewString(g_ctx, "connected");
       }else if( info.type == WSCB_DISCONNECTED ){
         objs[0] = JS_NewString(g_ctx, "disconnected");
+      }else if( info.type == WSCB_ERROR ){
+        objs[0] = JS_NewString(g_ctx, "error");
+      }else if( info.type == WSCB_PONG ){
+        objs[0] = JS_NewString(g_ctx, "pong");
+        objs[1] = JS_NewUint32(g_ctx, info.value);
       }else if( info.type == WSCB_TEXT ){
         objs[0] = JS_NewString(g_ctx, "text");
-        objs[1] = JS_NewString(g_ctx, (char*)info.p_payload);
-        free(info.p_payload);
-        info.p_payload = NULL;
+        objs[1] = JS_NewStringLen(g_ctx, info.p_payload->data(), info.p_payload->size());
+        free_event_info(&info);
       }else if( info.type == WSCB_BINARY ){
+        // the ArrayBuffer borrows the received buffer and releases it on GC
+        std::string *p_payload = info.p_payload;
         objs[0] = JS_NewString(g_ctx, "binary");
-        objs[1] = JS_NewArrayBuffer(g_ctx, info.p_payload, info.length, my_mem_free, NULL, false);
-        free(info.p_payload);
+        objs[1] = JS_NewArrayBuffer(g_ctx, (uint8_t*)&(*p_payload)[0], p_payload->size(),
+                    [](JSRuntime *rt, void *opaque, void *ptr){ delete (std::string*)opaque; }, p_payload, false);
         info.p_payload = NULL;
       }
 
@@ -219,8 +573,6 @@ void loopModule_websocket_client(void)
       JS_FreeValue(g_ctx, objs[0]);
       JS_FreeValue(g_ctx, objs[1]);
       JS_FreeValue(g_ctx, ret);
-
-      g_event_list.erase(g_event_list.begin());
     }
   }
 }
@@ -233,4 +585,4 @@ JsModuleEntry websocket_client_module = {
   endModule_websocket_client
 };
 
-#endif
\ No newline at end of file
+#endif
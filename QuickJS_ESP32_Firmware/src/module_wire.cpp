@@ -4,6 +4,89 @@
 #include "module_wire.h"
 #include "module_type.h"
 #include "module_utils.h"
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#define WIRE_NUM_OF_BUS             2
+#define WIRE_QUEUE_LENGTH           16
+#define WIRE_TASK_STACK             4096
+#define WIRE_TASK_PRIORITY          3
+#define WIRE_ERROR_OTHER            4
+
+// one described transaction: [write] -> [repeated start] -> [read]
+typedef struct {
+  uint8_t address;
+  uint32_t clock; // 0: device/bus default
+  bool stop;
+  std::vector<uint8_t> write;
+  uint32_t read_len;
+  // result
+  uint8_t error;
+  uint8_t *p_read;
+  uint32_t read_num;
+} WIRE_TRANSACTION;
+
+typedef struct {
+  uint8_t bus;
+  std::vector<WIRE_TRANSACTION> transactions;
+  JSValue resolving_funcs[2];
+} WIRE_BATCH;
+
+typedef struct {
+  uint32_t transactions;
+  uint32_t errors;
+  uint32_t bytes;
+  uint64_t busy_us;
+  uint64_t last_busy_us;
+  uint32_t last_sampled;
+} WIRE_BUS_STATS;
+
+static QueueHandle_t g_wire_queue = NULL;
+static TaskHandle_t g_wire_task = NULL;
+static SemaphoreHandle_t g_wire_mutex = NULL;
+static std::vector<WIRE_BATCH*> g_wire_done;
+static volatile uint32_t g_wire_pending = 0;
+static std::map<uint16_t, uint32_t> g_wire_device_clock; // (bus << 8 | address) -> Hz
+static WIRE_BUS_STATS g_wire_stats[WIRE_NUM_OF_BUS];
+static SemaphoreHandle_t g_wire_bus_lock[WIRE_NUM_OF_BUS] = { NULL, NULL };
+static bool g_wire_js_held[WIRE_NUM_OF_BUS] = { false, false };
+static bool g_wire_js_nostop[WIRE_NUM_OF_BUS] = { false, false };
+
+void wire_bus_lock(TwoWire *wire)
+{
+  xSemaphoreTakeRecursive(g_wire_bus_lock[(wire == &Wire1) ? 1 : 0], portMAX_DELAY);
+}
+
+void wire_bus_unlock(TwoWire *wire)
+{
+  xSemaphoreGiveRecursive(g_wire_bus_lock[(wire == &Wire1) ? 1 : 0]);
+}
+
+// a direct Wire.* sequence from JS keeps the bus from beginTransmission/requestFrom
+// until it ends with a stop and the read bytes are drained, at the latest until the loop turn ends
+static void wire_js_hold(uint8_t bus)
+{
+  if( !g_wire_js_held[bus] ){
+    xSemaphoreTakeRecursive(g_wire_bus_lock[bus], portMAX_DELAY);
+    g_wire_js_held[bus] = true;
+  }
+}
+
+static void wire_js_release(uint8_t bus)
+{
+  g_wire_js_nostop[bus] = false;
+  if( g_wire_js_held[bus] ){
+    g_wire_js_held[bus] = false;
+    xSemaphoreGiveRecursive(g_wire_bus_lock[bus]);
+  }
+}
+
+static void wire_js_settle(TwoWire *wire, uint8_t bus)
+{
+  if( !g_wire_js_nostop[bus] && wire->available() == 0 )
+    wire_js_release(bus);
+}
 
 static JSValue esp32_wire_begin(JSContext *ctx, JSValueConst jsThis,
                                       int argc, JSValueConst *argv, int magic)
@@ -12,7 +95,6 @@ static JSValue esp32_wire_begin(JSContext *ctx, JSValueConst jsThis,
   if (magic == 0){
     wire = &Wire;
   }else if (magic == 1){
-    Wire1.end();
     wire = &Wire1;
   }else{
     return JS_EXCEPTION;
@@ -27,7 +109,11 @@ static JSValue esp32_wire_begin(JSContext *ctx, JSValueConst jsThis,
     JS_ToInt32(ctx, &scl, argv[1]);
   if( argc > 2)
     JS_ToUint32(ctx, &frequency, argv[2]);
+  wire_bus_lock(wire);
+  if( magic == 1 )
+    Wire1.end();
   bool ret = wire->begin(sda, scl, frequency);
+  wire_bus_unlock(wire);
 
   return JS_NewBool(ctx, ret);
 }
@@ -48,7 +134,9 @@ static JSValue esp32_wire_setClock(JSContext *ctx, JSValueConst jsThis,
   uint32_t frequency;
   JS_ToUint32(ctx, &frequency, argv[0]);
   
+  wire_bus_lock(wire);
   bool ret = wire->setClock(frequency);
+  wire_bus_unlock(wire);
 
   return JS_NewBool(ctx, ret);
 }
@@ -71,7 +159,11 @@ static JSValue esp32_wire_requestFrom(JSContext *ctx, JSValueConst jsThis,
   bool stop = true;
   if( argc >= 3 )
     stop = JS_ToBool(ctx, argv[2]);
-  return JS_NewUint32(ctx, wire->requestFrom((uint8_t)address, (uint8_t)count, (uint8_t)stop));
+  wire_js_hold(magic);
+  uint8_t num = wire->requestFrom((uint8_t)address, (uint8_t)count, (uint8_t)stop);
+  g_wire_js_nostop[magic] = !stop;
+  wire_js_settle(wire, magic);
+  return JS_NewUint32(ctx, num);
 }
 
 static JSValue esp32_wire_beginTransmission(JSContext *ctx, JSValueConst jsThis,
@@ -87,6 +179,7 @@ static JSValue esp32_wire_beginTransmission(JSContext *ctx, JSValueConst jsThis,
 
   uint32_t address;
   JS_ToUint32(ctx, &address, argv[0]);
+  wire_js_hold(magic);
   wire->beginTransmission((uint8_t)address);
   return JS_UNDEFINED;
 }
@@ -105,7 +198,11 @@ static JSValue esp32_wire_endTransmission(JSContext *ctx, JSValueConst jsThis,
   bool sendStop = true;
   if (argc > 0)
     sendStop = JS_ToBool(ctx, argv[0]);
-  return JS_NewUint32(ctx, wire->endTransmission(sendStop));
+  wire_js_hold(magic);
+  uint8_t ret = wire->endTransmission(sendStop);
+  g_wire_js_nostop[magic] = !sendStop;
+  wire_js_settle(wire, magic);
+  return JS_NewUint32(ctx, ret);
 }
 
 static JSValue esp32_wire_write(JSContext *ctx, JSValueConst jsThis,
@@ -119,11 +216,26 @@ static JSValue esp32_wire_write(JSContext *ctx, JSValueConst jsThis,
   else
     return JS_EXCEPTION;
 
+  wire_js_hold(magic);
   int tag = JS_VALUE_GET_TAG(argv[0]);
   if (tag == JS_TAG_INT){
     uint32_t value;
     JS_ToUint32(ctx, &value, argv[0]);
     return JS_NewInt32(ctx, wire->write((uint8_t)value));
+  }else if( !JS_IsArray(ctx, argv[0]) ){
+    // Uint8Array/ArrayBuffer: hand the backing store to the bus as is
+    uint8_t *p_buffer;
+    uint32_t length;
+    JSValue vbuffer = from_Uint8Array(ctx, argv[0], &p_buffer, &length);
+    if( JS_IsException(vbuffer) )
+      return JS_EXCEPTION;
+
+    size_t ret = wire->write(p_buffer, length);
+    JS_FreeValue(ctx, vbuffer);
+    if( ret != length )
+      return JS_EXCEPTION;
+
+    return JS_NewInt32(ctx, ret);
   }else{
     int32_t *p_buffer;
     uint32_t length;
@@ -176,12 +288,43 @@ static JSValue esp32_wire_read(JSContext *ctx, JSValueConst jsThis,
       int c = wire->read();
       JS_SetPropertyUint32(ctx, array, i, JS_NewInt32(ctx, c));
     }
+    wire_js_settle(wire, magic);
     return array;
   }else{
-    return JS_NewInt32(ctx, wire->read());
+    int c = wire->read();
+    wire_js_settle(wire, magic);
+    return JS_NewInt32(ctx, c);
   }
 }
 
+static JSValue esp32_wire_readBytes(JSContext *ctx, JSValueConst jsThis,
+                               int argc, JSValueConst *argv, int magic)
+{
+  TwoWire *wire;
+  if (magic == 0)
+    wire = &Wire;
+  else if (magic == 1)
+    wire = &Wire1;
+  else
+    return JS_EXCEPTION;
+
+  uint32_t length = wire->available();
+  if( argc > 0 ){
+    uint32_t value;
+    JS_ToUint32(ctx, &value, argv[0]);
+    if( value < length )
+      length = value;
+  }
+
+  uint8_t *p_buffer = (uint8_t*)malloc(length > 0 ? length : 1);
+  if( p_buffer == NULL )
+    return JS_EXCEPTION;
+  size_t ret = wire->readBytes(p_buffer, length);
+  wire_js_settle(wire, magic);
+
+  return create_Uint8Array_nocopy(ctx, p_buffer, ret, my_mem_free, NULL);
+}
+
 static JSValue esp32_wire_end(JSContext *ctx, JSValueConst jsThis,
   int argc, JSValueConst *argv, int magic)
 {
@@ -193,11 +336,325 @@ static JSValue esp32_wire_end(JSContext *ctx, JSValueConst jsThis,
   else
   return JS_EXCEPTION;
 
+  wire_bus_lock(wire);
   bool ret = wire->end();
+  wire_bus_unlock(wire);
 
   return JS_NewBool(ctx, ret);
 }
 
+static TwoWire *wire_get_bus(uint8_t bus)
+{
+  return (bus == 0) ? &Wire : &Wire1;
+}
+
+static uint8_t wire_execute(TwoWire *wire, WIRE_TRANSACTION *p_trans)
+{
+  if( p_trans->write.size() > 0 || p_trans->read_len == 0 ){
+    wire->beginTransmission(p_trans->address);
+    if( p_trans->write.size() > 0 && wire->write(p_trans->write.data(), p_trans->write.size()) != p_trans->write.size() ){
+      wire->endTransmission(true);
+      return 1; // data too long
+    }
+    uint8_t ret = wire->endTransmission(p_trans->read_len == 0 ? p_trans->stop : false);
+    if( ret != 0 )
+      return ret;
+  }
+
+  if( p_trans->read_len > 0 ){
+    p_trans->p_read = (uint8_t*)malloc(p_trans->read_len);
+    if( p_trans->p_read == NULL )
+      return WIRE_ERROR_OTHER;
+    size_t num = wire->requestFrom(p_trans->address, (size_t)p_trans->read_len, p_trans->stop);
+    p_trans->read_num = wire->readBytes(p_trans->p_read, num);
+    if( p_trans->read_num != p_trans->read_len )
+      return WIRE_ERROR_OTHER;
+  }
+
+  return 0;
+}
+
+static void wire_task(void *arg)
+{
+  WIRE_BATCH *p_batch;
+  while( xQueueReceive(g_wire_queue, &p_batch, portMAX_DELAY) == pdTRUE ){
+    if( p_batch == NULL )
+      break;
+
+    // the whole batch, clock changes included, runs under the bus lock so that direct
+    // Wire.* sequences and the unit/sensor drivers neither interleave with it nor see the device clock
+    TwoWire *wire = wire_get_bus(p_batch->bus);
+    wire_bus_lock(wire);
+    WIRE_BUS_STATS *p_stats = &g_wire_stats[p_batch->bus];
+    uint32_t default_clock = wire->getClock();
+    uint32_t current_clock = default_clock;
+    for( auto &trans : p_batch->transactions ){
+      uint32_t clock = trans.clock;
+      if( clock == 0 ){
+        xSemaphoreTake(g_wire_mutex, portMAX_DELAY);
+        auto it = g_wire_device_clock.find((p_batch->bus << 8) | trans.address);
+        clock = (it != g_wire_device_clock.end()) ? it->second : default_clock;
+        xSemaphoreGive(g_wire_mutex);
+      }
+      if( clock != current_clock ){
+        wire->setClock(clock);
+        current_clock = clock;
+      }
+
+      uint32_t start = micros();
+      trans.error = wire_execute(wire, &trans);
+      p_stats->busy_us += micros() - start;
+      p_stats->transactions++;
+      p_stats->bytes += trans.write.size() + trans.read_num;
+      if( trans.error != 0 )
+        p_stats->errors++;
+    }
+    if( current_clock != default_clock )
+      wire->setClock(default_clock);
+    wire_bus_unlock(wire);
+
+    xSemaphoreTake(g_wire_mutex, portMAX_DELAY);
+    g_wire_done.push_back(p_batch);
+    xSemaphoreGive(g_wire_mutex);
+  }
+
+  g_wire_task = NULL;
+  vTaskDelete(NULL);
+}
+
+static void wire_free_batch(JSContext *ctx, WIRE_BATCH *p_batch)
+{
+  for( auto &trans : p_batch->transactions ){
+    if( trans.p_read != NULL )
+      free(trans.p_read);
+  }
+  JS_FreeValue(ctx, p_batch->resolving_funcs[0]);
+  JS_FreeValue(ctx, p_batch->resolving_funcs[1]);
+  delete p_batch;
+}
+
+static JSValue esp32_wire_transact(JSContext *ctx, JSValueConst jsThis,
+                                int argc, JSValueConst *argv, int magic)
+{
+  if( magic >= WIRE_NUM_OF_BUS )
+    return JS_EXCEPTION;
+
+  if( g_wire_task == NULL ){
+    if( g_wire_queue == NULL )
+      g_wire_queue = xQueueCreate(WIRE_QUEUE_LENGTH, sizeof(WIRE_BATCH*));
+    if( g_wire_mutex == NULL )
+      g_wire_mutex = xSemaphoreCreateMutex();
+    if( g_wire_queue == NULL || g_wire_mutex == NULL )
+      return JS_EXCEPTION;
+    BaseType_t ret = xTaskCreate(wire_task, "wire_transact", WIRE_TASK_STACK, NULL, WIRE_TASK_PRIORITY, &g_wire_task);
+    if( ret != pdPASS ){
+      g_wire_task = NULL;
+      return JS_EXCEPTION;
+    }
+  }
+
+  JSValue jv = JS_GetPropertyStr(ctx, argv[0], "length");
+  uint32_t length;
+  JS_ToUint32(ctx, &length, jv);
+  JS_FreeValue(ctx, jv);
+  if( length == 0 )
+    return JS_EXCEPTION;
+
+  WIRE_BATCH *p_batch = new WIRE_BATCH();
+  p_batch->bus = magic;
+  p_batch->resolving_funcs[0] = JS_UNDEFINED;
+  p_batch->resolving_funcs[1] = JS_UNDEFINED;
+  for( uint32_t i = 0 ; i < length ; i++ ){
+    JSValue item = JS_GetPropertyUint32(ctx, argv[0], i);
+    WIRE_TRANSACTION trans = {};
+    trans.stop = true;
+    JSValue value;
+
+    value = JS_GetPropertyStr(ctx, item, "address");
+    if( value == JS_UNDEFINED ){
+      JS_FreeValue(ctx, item);
+      wire_free_batch(ctx, p_batch);
+      return JS_EXCEPTION;
+    }
+    uint32_t address;
+    JS_ToUint32(ctx, &address, value);
+    trans.address = address;
+
+    value = JS_GetPropertyStr(ctx, item, "register");
+    if( value != JS_UNDEFINED ){
+      uint32_t reg;
+      JS_ToUint32(ctx, &reg, value);
+      trans.write.push_back((uint8_t)reg);
+    }
+
+    value = JS_GetPropertyStr(ctx, item, "write");
+    if( value != JS_UNDEFINED ){
+      if( JS_IsArray(ctx, value) ){
+        int32_t *p_array;
+        uint32_t num;
+        if( getNumberArray(ctx, value, &p_array, &num) == 0 ){
+          for( uint32_t j = 0 ; j < num ; j++ )
+            trans.write.push_back((uint8_t)p_array[j]);
+          free(p_array);
+        }
+      }else{
+        uint8_t *p_buffer;
+        uint32_t num;
+        JSValue vbuffer = from_Uint8Array(ctx, value, &p_buffer, &num);
+        if( JS_IsException(vbuffer) ){
+          JS_FreeValue(ctx, value);
+          JS_FreeValue(ctx, item);
+          wire_free_batch(ctx, p_batch);
+          return JS_EXCEPTION;
+        }
+        trans.write.insert(trans.write.end(), p_buffer, p_buffer + num);
+        JS_FreeValue(ctx, vbuffer);
+      }
+      JS_FreeValue(ctx, value);
+    }
+
+    value = JS_GetPropertyStr(ctx, item, "read");
+    if( value != JS_UNDEFINED )
+      JS_ToUint32(ctx, &trans.read_len, value);
+
+    value = JS_GetPropertyStr(ctx, item, "clock");
+    if( value != JS_UNDEFINED )
+      JS_ToUint32(ctx, &trans.clock, value);
+
+    value = JS_GetPropertyStr(ctx, item, "stop");
+    if( value != JS_UNDEFINED )
+      trans.stop = JS_ToBool(ctx, value);
+
+    JS_FreeValue(ctx, item);
+    p_batch->transactions.push_back(trans);
+  }
+
+  JSValue promise = JS_NewPromiseCapability(ctx, p_batch->resolving_funcs);
+  if( JS_IsException(promise) ){
+    wire_free_batch(ctx, p_batch);
+    return JS_EXCEPTION;
+  }
+  if( xQueueSend(g_wire_queue, &p_batch, 0) != pdTRUE ){
+    wire_free_batch(ctx, p_batch);
+    JS_FreeValue(ctx, promise);
+    return JS_EXCEPTION;
+  }
+  g_wire_pending++;
+
+  return promise;
+}
+
+static JSValue esp32_wire_setDeviceClock(JSContext *ctx, JSValueConst jsThis,
+                                int argc, JSValueConst *argv, int magic)
+{
+  if( g_wire_mutex == NULL )
+    g_wire_mutex = xSemaphoreCreateMutex();
+  if( g_wire_mutex == NULL )
+    return JS_EXCEPTION;
+
+  uint32_t address, clock = 0;
+  JS_ToUint32(ctx, &address, argv[0]);
+  if( argc >= 2 )
+    JS_ToUint32(ctx, &clock, argv[1]);
+
+  xSemaphoreTake(g_wire_mutex, portMAX_DELAY);
+  if( clock == 0 )
+    g_wire_device_clock.erase((magic << 8) | (uint8_t)address);
+  else
+    g_wire_device_clock[(magic << 8) | (uint8_t)address] = clock;
+  xSemaphoreGive(g_wire_mutex);
+
+  return JS_UNDEFINED;
+}
+
+static JSValue esp32_wire_getStats(JSContext *ctx, JSValueConst jsThis,
+                                int argc, JSValueConst *argv, int magic)
+{
+  if( magic >= WIRE_NUM_OF_BUS )
+    return JS_EXCEPTION;
+
+  // utilization since the previous call
+  WIRE_BUS_STATS *p_stats = &g_wire_stats[magic];
+  uint32_t now = millis();
+  uint64_t busy_us = p_stats->busy_us;
+  uint32_t elapsed = now - p_stats->last_sampled;
+  uint32_t utilization = 0;
+  if( p_stats->last_sampled != 0 && elapsed > 0 )
+    utilization = (busy_us - p_stats->last_busy_us) / 10 / elapsed; // %
+  p_stats->last_busy_us = busy_us;
+  p_stats->last_sampled = now;
+
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "transactions", JS_NewUint32(ctx, p_stats->transactions));
+  JS_SetPropertyStr(ctx, obj, "errors", JS_NewUint32(ctx, p_stats->errors));
+  JS_SetPropertyStr(ctx, obj, "bytes", JS_NewUint32(ctx, p_stats->bytes));
+  JS_SetPropertyStr(ctx, obj, "busyTime", JS_NewFloat64(ctx, (double)busy_us / 1000.0));
+  JS_SetPropertyStr(ctx, obj, "utilization", JS_NewUint32(ctx, std::min(utilization, (uint32_t)100)));
+  JS_SetPropertyStr(ctx, obj, "pending", JS_NewUint32(ctx, g_wire_pending));
+  return obj;
+}
+
+void wire_transaction_loop(JSContext *ctx)
+{
+  for( uint8_t bus = 0 ; bus < WIRE_NUM_OF_BUS ; bus++ )
+    wire_js_release(bus);
+
+  if( g_wire_mutex == NULL || g_wire_pending == 0 )
+    return;
+
+  std::vector<WIRE_BATCH*> done;
+  xSemaphoreTake(g_wire_mutex, portMAX_DELAY);
+  done.swap(g_wire_done);
+  xSemaphoreGive(g_wire_mutex);
+
+  for( auto p_batch : done ){
+    JSValue results = JS_NewArray(ctx);
+    for( uint32_t i = 0 ; i < p_batch->transactions.size() ; i++ ){
+      WIRE_TRANSACTION *p_trans = &p_batch->transactions[i];
+      JSValue item = JS_NewObject(ctx);
+      JS_SetPropertyStr(ctx, item, "error", JS_NewUint32(ctx, p_trans->error));
+      if( p_trans->p_read != NULL ){
+        JS_SetPropertyStr(ctx, item, "data", create_Uint8Array_nocopy(ctx, p_trans->p_read, p_trans->read_num, my_mem_free, NULL));
+        p_trans->p_read = NULL;
+      }
+      JS_SetPropertyUint32(ctx, results, i, item);
+    }
+
+    JSValue ret = JS_Call(ctx, p_batch->resolving_funcs[0], JS_UNDEFINED, 1, &results);
+    JS_FreeValue(ctx, ret);
+    JS_FreeValue(ctx, results);
+    wire_free_batch(ctx, p_batch);
+    g_wire_pending--;
+  }
+}
+
+void wire_transaction_end(JSContext *ctx)
+{
+  // the task may be waiting for a bus the JS side still holds
+  for( uint8_t bus = 0 ; bus < WIRE_NUM_OF_BUS ; bus++ )
+    wire_js_release(bus);
+
+  if( g_wire_task != NULL ){
+    WIRE_BATCH *p_stop = NULL;
+    xQueueSendToFront(g_wire_queue, &p_stop, portMAX_DELAY);
+    while( g_wire_task != NULL )
+      delay(1);
+  }
+
+  // promises still pending belong to the context being torn down
+  WIRE_BATCH *p_batch;
+  while( g_wire_queue != NULL && xQueueReceive(g_wire_queue, &p_batch, 0) == pdTRUE ){
+    if( p_batch != NULL )
+      g_wire_done.push_back(p_batch);
+  }
+  for( auto p_batch : g_wire_done )
+    wire_free_batch(ctx, p_batch);
+  g_wire_done.clear();
+  g_wire_pending = 0;
+  g_wire_device_clock.clear();
+  memset(g_wire_stats, 0, sizeof(g_wire_stats));
+}
+
 static const JSCFunctionListEntry wire_funcs[] = {
     JSCFunctionListEntry{
         "begin", 0, JS_DEF_CFUNC, 0, {
@@ -231,6 +688,22 @@ static const JSCFunctionListEntry wire_funcs[] = {
         "read", 0, JS_DEF_CFUNC, 0, {
           func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_read}}
         }},
+    JSCFunctionListEntry{
+        "readBytes", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_readBytes}}
+        }},
+    JSCFunctionListEntry{
+        "transact", 0, JS_DEF_CFUNC, 0, {
+          func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_transact}}
+        }},
+    JSCFunctionListEntry{
+        "setDeviceClock", 0, JS_DEF_CFUNC, 0, {
+          func : {2, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_setDeviceClock}}
+        }},
+    JSCFunctionListEntry{
+        "getStats", 0, JS_DEF_CFUNC, 0, {
+          func : {0, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_getStats}}
+        }},
     JSCFunctionListEntry{
         "end", 0, JS_DEF_CFUNC, 0, {
           func : {0, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_end}}
@@ -266,12 +739,38 @@ static const JSCFunctionListEntry wire1_funcs[] = {
         "read", 0, JS_DEF_CFUNC, 1, {
           func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_read}}
         }},
+    JSCFunctionListEntry{
+        "readBytes", 0, JS_DEF_CFUNC, 1, {
+          func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_readBytes}}
+        }},
+    JSCFunctionListEntry{
+        "transact", 0, JS_DEF_CFUNC, 1, {
+          func : {1, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_transact}}
+        }},
+    JSCFunctionListEntry{
+        "setDeviceClock", 0, JS_DEF_CFUNC, 1, {
+          func : {2, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_setDeviceClock}}
+        }},
+    JSCFunctionListEntry{
+        "getStats", 0, JS_DEF_CFUNC, 1, {
+          func : {0, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_getStats}}
+        }},
     JSCFunctionListEntry{
         "end", 0, JS_DEF_CFUNC, 1, {
           func : {0, JS_CFUNC_generic_magic, {generic_magic : esp32_wire_end}}
         }},
 };
 
+long initialize_wire(void)
+{
+  for( int i = 0 ; i < WIRE_NUM_OF_BUS ; i++ ){
+    if( g_wire_bus_lock[i] == NULL )
+      g_wire_bus_lock[i] = xSemaphoreCreateRecursiveMutex();
+  }
+
+  return 0;
+}
+
 JSModuleDef *addModule_wire(JSContext *ctx, JSValue global)
 {
   JSModuleDef *mod;
@@ -309,7 +808,7 @@ JSModuleDef *addModule_wire1(JSContext *ctx, JSValue global)
 
 JsModuleEntry wire_module = {
   "Wire",
-  NULL,
+  initialize_wire,
   addModule_wire,
   NULL,
   NULL
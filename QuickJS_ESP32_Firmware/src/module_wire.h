@@ -1,9 +1,18 @@
 #ifndef _MODULE_WIRE_H_
 #define _MODULE_WIRE_H_
 
+#include <Wire.h>
 #include "module_type.h"
 
 extern JsModuleEntry wire_module;
 extern JsModuleEntry wire1_module;
 
+void wire_transaction_loop(JSContext *ctx);
+void wire_transaction_end(JSContext *ctx);
+
+// one recursive lock per TwoWire bus, held across a whole multi-step transaction
+// by every user: the transact task, direct Wire.* calls from JS and the unit/sensor drivers
+void wire_bus_lock(TwoWire *wire);
+void wire_bus_unlock(TwoWire *wire);
+
 #endif
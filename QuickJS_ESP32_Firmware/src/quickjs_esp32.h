@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <vector>
 #include "mem_utils.h"
+#include "lib_metrics.h"
 #include <esp_heap_caps.h>
 
 #ifdef ENABLE_WIFI
@@ -28,6 +29,7 @@
 #include "module_udp.h"
 #include "module_prefs.h"
 #include "module_http.h"
+#include "module_sensor.h"
 #ifdef _UART_ENABLE_
 #include "module_uart.h"
 #endif
@@ -139,6 +141,7 @@ static JsModuleEntry module_entries[] = {
   udp_module,
   prefs_module,
   http_module,
+  sensor_module,
 #ifdef _UART_ENABLE_
   uart_module,
 #endif
@@ -434,6 +437,7 @@ class JSTimer
     while (!timers.empty() && timers.back().timeout - now < eps) {
       empty = false;
       auto ent = timers.back();
+      metrics_record_timer_lag(now - ent.timeout);
 
       // NOTE: may update timers in this JS_Call().
       JSValue r = JS_Call(ctx, ent.func, ent.func, 0, nullptr);
@@ -457,11 +461,11 @@ class JSTimer
 static void *esp32_js_malloc(JSMallocState *s, size_t size) {
     if (s->malloc_size + size > s->malloc_limit)
         return NULL;
-    void *ptr = utils_mem_alloc(size);
+    void *ptr = js_mem_alloc(size);
     if (!ptr)
         return NULL;
     s->malloc_count++;
-    s->malloc_size += heap_caps_get_allocated_size(ptr);
+    s->malloc_size += js_mem_usable_size(ptr);
     return ptr;
 }
 
@@ -469,8 +473,8 @@ static void esp32_js_free(JSMallocState *s, void *ptr) {
     if (!ptr)
         return;
     s->malloc_count--;
-    s->malloc_size -= heap_caps_get_allocated_size(ptr);
-    utils_mem_free(ptr);
+    s->malloc_size -= js_mem_usable_size(ptr);
+    js_mem_free(ptr);
 }
 
 static void *esp32_js_realloc(JSMallocState *s, void *ptr, size_t size) {
@@ -479,31 +483,25 @@ static void *esp32_js_realloc(JSMallocState *s, void *ptr, size_t size) {
             return NULL;
         return esp32_js_malloc(s, size);
     }
-    size_t old_size = heap_caps_get_allocated_size(ptr);
+    size_t old_size = js_mem_usable_size(ptr);
     if (size == 0) {
         s->malloc_count--;
         s->malloc_size -= old_size;
-        utils_mem_free(ptr);
+        js_mem_free(ptr);
         return NULL;
     }
     if (s->malloc_size + size - old_size > s->malloc_limit)
         return NULL;
-    void *new_ptr = utils_mem_realloc(ptr, size);
+    void *new_ptr = js_mem_realloc(ptr, size);
     if (!new_ptr)
         return NULL;
-    s->malloc_size += heap_caps_get_allocated_size(new_ptr) - old_size;
+    s->malloc_size += js_mem_usable_size(new_ptr) - old_size;
     return new_ptr;
 }
 
 static size_t esp32_js_malloc_usable_size(const void *ptr) {
-#if defined(CONFIG_HEAP_POISONING_LIGHT) || defined(CONFIG_HEAP_POISONING_COMPREHENSIVE)
-    // heap_caps_get_allocated_size() includes the tail canary bytes when heap
-    // poisoning is enabled, which would cause QuickJS to write into the canary
-    // area and corrupt the heap. Return 0 to disable the slack optimization.
-    return 0;
-#else
-    return heap_caps_get_allocated_size((void *)ptr);
-#endif
+    // size kept in the block header, so this is safe with heap poisoning too
+    return js_mem_usable_size(ptr);
 }
 
 static const JSMallocFunctions esp32_malloc_funcs = {
@@ -573,8 +571,11 @@ class ESP32QuickJS {
     }
 
     timer.RemoveAll(ctx);
+    wire_transaction_end(ctx);
+    binding_cache_free(ctx);
     JS_FreeContext(ctx);
     JS_FreeRuntime(rt);
+    js_mem_release();
 
     rt = NULL;
   }
@@ -604,6 +605,8 @@ class ESP32QuickJS {
     if( !(g_fileloading == FILE_LOADING_NONE) )
       return false;
 
+    uint32_t start = micros();
+
     // async
     JSContext *c;
     int ret = JS_ExecutePendingJob(JS_GetRuntime(ctx), &c);
@@ -621,6 +624,7 @@ class ESP32QuickJS {
 #ifdef ENABLE_WIFI
         httpFetcher.loop(ctx);
 #endif
+    wire_transaction_loop(ctx);
 
     // loop()
     if( callLoopFn ){
@@ -649,10 +653,18 @@ class ESP32QuickJS {
       }
     }
 
+    metrics_record_loop_time(micros() - start);
+
     return true;
   }
 
-  void runGC() { JS_RunGC(rt); }
+  uint32_t runGC() {
+    uint32_t start = micros();
+    JS_RunGC(rt);
+    uint32_t elapsed = micros() - start;
+    metrics_record_gc(elapsed);
+    return elapsed;
+  }
 
   bool exec(const char *code) {
     g_fileloading = FILE_LOADING_NONE;
@@ -773,6 +785,7 @@ protected:
   virtual void setup(JSContext *ctx, JSValue global) {
     this->ctx = ctx;
     JS_SetContextOpaque(ctx, this);
+    binding_cache_initialize(ctx);
 
 //  setup console.log()
 //  JSValue console = JS_NewObject(ctx);
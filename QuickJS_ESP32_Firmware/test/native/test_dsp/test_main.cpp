@@ -0,0 +1,160 @@
+#include <unity.h>
+#include <math.h>
+#include "lib_dsp.h"
+
+#define FFT_SIZE  256
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static void test_decimator_block_average(void)
+{
+  DSP_DECIMATOR dec;
+  dsp_decimator_init(&dec, 4);
+
+  float out;
+  uint32_t outputs = 0;
+  const float expected[] = { 2.5f, 6.5f, 10.5f };
+  for( int i = 1 ; i <= 12 ; i++ ){
+    bool ready = dsp_decimator_push(&dec, (float)i, &out);
+    // one output per 4 inputs, on the 4th
+    TEST_ASSERT_EQUAL(i % 4 == 0, ready);
+    if( ready )
+      TEST_ASSERT_FLOAT_WITHIN(1e-6f, expected[outputs++], out);
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, outputs);
+}
+
+static void test_decimator_keeps_partial_sum(void)
+{
+  DSP_DECIMATOR dec;
+  dsp_decimator_init(&dec, 3);
+
+  float out;
+  TEST_ASSERT_FALSE(dsp_decimator_push(&dec, 3.0f, &out));
+  TEST_ASSERT_FALSE(dsp_decimator_push(&dec, 6.0f, &out));
+  TEST_ASSERT_TRUE(dsp_decimator_push(&dec, 9.0f, &out));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 6.0f, out);
+
+  // factor 0 is treated as 1, every input passes through
+  dsp_decimator_init(&dec, 0);
+  TEST_ASSERT_TRUE(dsp_decimator_push(&dec, -7.0f, &out));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, -7.0f, out);
+}
+
+static void test_stats_window(void)
+{
+  const float samples[] = { -3.0f, 1.0f, 2.0f, 4.0f };
+  DSP_STATS stats;
+  dsp_stats(samples, 4, &stats);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, stats.mean);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, -3.0f, stats.min);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 4.0f, stats.max);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, sqrtf(7.5f), stats.rms);
+
+  // only the first num samples count
+  dsp_stats(samples, 2, &stats);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, -1.0f, stats.mean);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, stats.max);
+
+  dsp_stats(samples, 0, &stats);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.0f, stats.rms);
+}
+
+static void test_stats_sine_rms(void)
+{
+  // whole periods of a sine: mean 0, rms A / sqrt(2)
+  float samples[FFT_SIZE];
+  for( int i = 0 ; i < FFT_SIZE ; i++ )
+    samples[i] = 3.0f * sinf(2.0f * (float)M_PI * 8 * i / FFT_SIZE);
+  DSP_STATS stats;
+  dsp_stats(samples, FFT_SIZE, &stats);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.0f, stats.mean);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 3.0f / sqrtf(2.0f), stats.rms);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 3.0f, stats.max);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, -3.0f, stats.min);
+}
+
+static void test_moving_rms(void)
+{
+  float squares[4];
+  DSP_MOVING_RMS rms;
+  dsp_moving_rms_init(&rms, squares, 4);
+
+  // fewer samples than the length: RMS of what has been pushed
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 3.0f, dsp_moving_rms_push(&rms, -3.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, sqrtf(12.5f), dsp_moving_rms_push(&rms, 4.0f));
+  dsp_moving_rms_push(&rms, 0.0f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, sqrtf(25.0f / 4), dsp_moving_rms_push(&rms, 0.0f));
+  // the window slides: -3 and then 4 fall out
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, sqrtf(20.0f / 4), dsp_moving_rms_push(&rms, 2.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, sqrtf(8.0f / 4), dsp_moving_rms_push(&rms, 2.0f));
+}
+
+static void test_moving_rms_long_run(void)
+{
+  // a sine over many laps settles on A / sqrt(2) without drifting
+  float squares[64];
+  DSP_MOVING_RMS rms;
+  dsp_moving_rms_init(&rms, squares, 64);
+  float value = 0.0f;
+  for( int i = 0 ; i < 100000 ; i++ )
+    value = dsp_moving_rms_push(&rms, 1000.0f + 2.0f * sinf(2.0f * (float)M_PI * i / 16));
+  float expected = sqrtf(1000.0f * 1000.0f + 2.0f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-2f, expected, value);
+}
+
+static void test_fft_magnitude_of_sine(void)
+{
+  // amplitude 2 on bin 16 over a DC offset of 1.5
+  float samples[FFT_SIZE];
+  for( int i = 0 ; i < FFT_SIZE ; i++ )
+    samples[i] = 1.5f + 2.0f * sinf(2.0f * (float)M_PI * 16 * i / FFT_SIZE);
+
+  float work[FFT_SIZE * 2];
+  float magnitude[FFT_SIZE / 2];
+  TEST_ASSERT_EQUAL_INT32(0, dsp_fft_magnitude(samples, FFT_SIZE, work, magnitude));
+
+  uint32_t peak = 0;
+  for( uint32_t i = 1 ; i < FFT_SIZE / 2 ; i++ ){
+    if( magnitude[i] > magnitude[peak] )
+      peak = i;
+  }
+  TEST_ASSERT_EQUAL_UINT32(16, peak);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 2.0f, magnitude[16]);
+  // the Hann window spreads half of the peak into each neighbour
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 1.0f, magnitude[15]);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 1.0f, magnitude[17]);
+  // DC is removed, far bins stay empty
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.0f, magnitude[0]);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, magnitude[40]);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, magnitude[100]);
+}
+
+static void test_fft_rejects_bad_size(void)
+{
+  float samples[12] = { 0 };
+  float work[24];
+  float magnitude[6];
+  TEST_ASSERT_EQUAL_INT32(-1, dsp_fft_magnitude(samples, 12, work, magnitude));
+  TEST_ASSERT_EQUAL_INT32(-1, dsp_fft_magnitude(samples, 1, work, magnitude));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_decimator_block_average);
+  RUN_TEST(test_decimator_keeps_partial_sum);
+  RUN_TEST(test_stats_window);
+  RUN_TEST(test_stats_sine_rms);
+  RUN_TEST(test_moving_rms);
+  RUN_TEST(test_moving_rms_long_run);
+  RUN_TEST(test_fft_magnitude_of_sine);
+  RUN_TEST(test_fft_rejects_bad_size);
+  return UNITY_END();
+}
@@ -0,0 +1,161 @@
+#include <unity.h>
+#include <stdlib.h>
+#include "lib_ircodec.h"
+
+#define NEC_HDR_MARK    9000
+#define NEC_HDR_SPACE   4500
+#define NEC_BIT_MARK    560
+#define NEC_ONE_SPACE   1690
+#define NEC_ZERO_SPACE  560
+
+static uint32_t g_seed;
+
+static uint16_t jitter(uint16_t value, uint32_t percent)
+{
+  // deterministic LCG, so a failure is reproducible
+  g_seed = g_seed * 1103515245 + 12345;
+  int32_t range = value * percent / 100;
+  int32_t delta = (int32_t)((g_seed >> 16) % (2 * range + 1)) - range;
+  return value + delta;
+}
+
+static uint32_t make_nec(uint16_t *p_durations, uint32_t data, uint32_t percent)
+{
+  uint32_t num = 0;
+  p_durations[num++] = jitter(NEC_HDR_MARK, percent);
+  p_durations[num++] = jitter(NEC_HDR_SPACE, percent);
+  for( int i = 0 ; i < 32 ; i++ ){
+    p_durations[num++] = jitter(NEC_BIT_MARK, percent);
+    p_durations[num++] = jitter((data & (1UL << i)) ? NEC_ONE_SPACE : NEC_ZERO_SPACE, percent);
+  }
+  p_durations[num++] = jitter(NEC_BIT_MARK, percent);
+  return num;
+}
+
+// the decoded value is the table entry the original was matched against
+static void assert_within_tolerance(const uint16_t *p_expected, const uint16_t *p_actual, uint32_t num)
+{
+  for( uint32_t i = 0 ; i < num ; i++ ){
+    uint32_t tolerance = p_actual[i] / IRCODEC_TOLERANCE;
+    if( tolerance < IRCODEC_TOLERANCE_MIN )
+      tolerance = IRCODEC_TOLERANCE_MIN;
+    TEST_ASSERT_UINT32_WITHIN(tolerance, p_expected[i], p_actual[i]);
+  }
+}
+
+void setUp(void)
+{
+  g_seed = 1;
+}
+
+void tearDown(void)
+{
+}
+
+static void test_nec_round_trip(void)
+{
+  uint16_t durations[67];
+  uint32_t num = make_nec(durations, 0x20DF10EF, 10);
+
+  uint8_t encoded[256];
+  uint32_t size = ircodec_encode(durations, num, 38, encoded, sizeof(encoded));
+  TEST_ASSERT_GREATER_THAN_UINT32(0, size);
+  // four clusters: header mark/space, bit mark, one space
+  TEST_ASSERT_EQUAL_UINT8(4, encoded[6]);
+  // one nibble per duration, no escapes
+  TEST_ASSERT_EQUAL_UINT32(IRCODEC_HEADER_SIZE + 4 * 2 + (num + 1) / 2, size);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(ircodec_encode_bound(num), size);
+  TEST_ASSERT_EQUAL_UINT32(num, ircodec_decoded_length(encoded, size));
+
+  uint16_t decoded[67];
+  uint32_t decoded_num = 0;
+  uint8_t freq = 0;
+  TEST_ASSERT_EQUAL_INT32(0, ircodec_decode(encoded, size, decoded, 67, &decoded_num, &freq));
+  TEST_ASSERT_EQUAL_UINT32(num, decoded_num);
+  TEST_ASSERT_EQUAL_UINT8(38, freq);
+  assert_within_tolerance(durations, decoded, num);
+}
+
+static void test_outliers(void)
+{
+  // a NEC frame, a repeat gap and a repeat code, plus the largest duration
+  uint16_t durations[80];
+  uint32_t num = make_nec(durations, 0x00FF00FF, 5);
+  durations[num++] = 40000;
+  durations[num++] = NEC_HDR_MARK;
+  durations[num++] = 2250;
+  durations[num++] = NEC_BIT_MARK;
+  durations[num++] = 65535;
+  durations[num++] = 1; // below IRCODEC_TOLERANCE_MIN of everything else
+
+  uint8_t encoded[256];
+  uint32_t size = ircodec_encode(durations, num, 38, encoded, sizeof(encoded));
+  TEST_ASSERT_GREATER_THAN_UINT32(0, size);
+
+  uint16_t decoded[80];
+  uint32_t decoded_num = 0;
+  TEST_ASSERT_EQUAL_INT32(0, ircodec_decode(encoded, size, decoded, 80, &decoded_num, NULL));
+  TEST_ASSERT_EQUAL_UINT32(num, decoded_num);
+  assert_within_tolerance(durations, decoded, num);
+  // single member clusters come back exactly
+  TEST_ASSERT_EQUAL_UINT16(40000, decoded[num - 6]);
+  TEST_ASSERT_EQUAL_UINT16(2250, decoded[num - 4]);
+  TEST_ASSERT_EQUAL_UINT16(65535, decoded[num - 2]);
+  TEST_ASSERT_EQUAL_UINT16(1, decoded[num - 1]);
+}
+
+static void test_more_clusters_than_table(void)
+{
+  // 20 durations 1.3x apart, further than the tolerance, so none shares a cluster
+  uint16_t durations[40];
+  uint32_t num = 0;
+  float value = 300;
+  for( int i = 0 ; i < 20 ; i++ ){
+    durations[num++] = (uint16_t)value;
+    value *= 1.3f;
+  }
+  // and each of them again, so escaped values repeat as well
+  for( int i = 0 ; i < 20 ; i++ )
+    durations[num++] = durations[i];
+
+  uint8_t encoded[256];
+  uint32_t size = ircodec_encode(durations, num, 40, encoded, sizeof(encoded));
+  TEST_ASSERT_GREATER_THAN_UINT32(0, size);
+  TEST_ASSERT_EQUAL_UINT8(IRCODEC_TABLE_MAX, encoded[6]);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(ircodec_encode_bound(num), size);
+
+  uint16_t decoded[40];
+  uint32_t decoded_num = 0;
+  TEST_ASSERT_EQUAL_INT32(0, ircodec_decode(encoded, size, decoded, 40, &decoded_num, NULL));
+  TEST_ASSERT_EQUAL_UINT32(num, decoded_num);
+  TEST_ASSERT_EQUAL_UINT16_ARRAY(durations, decoded, num);
+}
+
+static void test_short_buffers(void)
+{
+  uint16_t durations[67];
+  uint32_t num = make_nec(durations, 0x12345678, 10);
+
+  uint8_t encoded[256];
+  TEST_ASSERT_EQUAL_UINT32(0, ircodec_encode(durations, num, 38, encoded, 20));
+  uint32_t size = ircodec_encode(durations, num, 38, encoded, sizeof(encoded));
+
+  uint16_t decoded[67];
+  uint32_t decoded_num = 0;
+  // truncated input, too small output, broken magic
+  TEST_ASSERT_EQUAL_INT32(-1, ircodec_decode(encoded, size - 1, decoded, 67, &decoded_num, NULL));
+  TEST_ASSERT_EQUAL_INT32(-1, ircodec_decode(encoded, size, decoded, num - 1, &decoded_num, NULL));
+  encoded[0] = 'X';
+  TEST_ASSERT_EQUAL_UINT32(0, ircodec_decoded_length(encoded, size));
+  TEST_ASSERT_EQUAL_INT32(-1, ircodec_decode(encoded, size, decoded, 67, &decoded_num, NULL));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_nec_round_trip);
+  RUN_TEST(test_outliers);
+  RUN_TEST(test_more_clusters_than_table);
+  RUN_TEST(test_short_buffers);
+  return UNITY_END();
+}
@@ -0,0 +1,236 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "lib_jsmem.h"
+
+#define TRACE_LIVE_MAX    4096
+#define TRACE_NUM_OPS     200000
+
+typedef enum {
+  TRACE_ALLOC,
+  TRACE_REALLOC,
+  TRACE_FREE,
+} TRACE_OP_TYPE;
+
+typedef struct {
+  TRACE_OP_TYPE type;
+  uint32_t slot;
+  uint32_t size;
+} TRACE_OP;
+
+static uint32_t g_seed;
+
+static uint32_t next_random(void)
+{
+  g_seed = g_seed * 1103515245 + 12345;
+  return g_seed >> 8;
+}
+
+// synthetic: sizes and lifetimes come from the LCG above, not from a recorded QuickJS run, and
+// no GC pass is part of it; the mix is roughly a runtime's: mostly objects, shapes and short strings
+static uint32_t trace_size(void)
+{
+  uint32_t r = next_random() % 100;
+  if( r < 45 ) return 8 + next_random() % 25; // 8..32
+  if( r < 75 ) return 33 + next_random() % 32; // 33..64
+  if( r < 95 ) return 65 + next_random() % 448; // 65..512
+  return 513 + next_random() % 8192;
+}
+
+static std::vector<TRACE_OP> make_trace(uint32_t num)
+{
+  std::vector<TRACE_OP> trace;
+  std::vector<bool> live(TRACE_LIVE_MAX, false);
+  for( uint32_t i = 0 ; i < num ; i++ ){
+    uint32_t slot = next_random() % TRACE_LIVE_MAX;
+    TRACE_OP op;
+    op.slot = slot;
+    op.size = trace_size();
+    if( !live[slot] ){
+      op.type = TRACE_ALLOC;
+      live[slot] = true;
+    }else if( next_random() % 4 == 0 ){
+      op.type = TRACE_REALLOC;
+    }else{
+      op.type = TRACE_FREE;
+      live[slot] = false;
+    }
+    trace.push_back(op);
+  }
+  for( uint32_t slot = 0 ; slot < TRACE_LIVE_MAX ; slot++ ){
+    if( live[slot] )
+      trace.push_back(TRACE_OP{ TRACE_FREE, slot, 0 });
+  }
+  return trace;
+}
+
+static void fill(void *p, uint32_t size, uint32_t slot)
+{
+  memset(p, (uint8_t)(slot * 31 + 7), size);
+}
+
+static bool check(const void *p, uint32_t size, uint32_t slot)
+{
+  const uint8_t *p_byte = (const uint8_t*)p;
+  for( uint32_t i = 0 ; i < size ; i++ ){
+    if( p_byte[i] != (uint8_t)(slot * 31 + 7) )
+      return false;
+  }
+  return true;
+}
+
+void setUp(void)
+{
+  g_seed = 1;
+}
+
+void tearDown(void)
+{
+  js_mem_release();
+}
+
+static void test_alignment_and_usable_size(void)
+{
+  void *p_blocks[200];
+  for( uint32_t size = 1 ; size <= 200 ; size++ ){
+    void *p = js_mem_alloc(size);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL_UINT32(0, (uintptr_t)p % JS_MEM_ALIGN);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(size, js_mem_usable_size(p));
+    p_blocks[size - 1] = p;
+  }
+
+  JS_MEM_INFO info;
+  js_mem_get_info(&info);
+  TEST_ASSERT_EQUAL_UINT32(JS_MEM_SLAB_MAX_SIZE, info.slab_used);
+
+  for( uint32_t i = 0 ; i < 200 ; i++ )
+    js_mem_free(p_blocks[i]);
+  js_mem_get_info(&info);
+  TEST_ASSERT_EQUAL_UINT32(0, info.slab_used);
+  TEST_ASSERT_NULL(js_mem_alloc(0));
+}
+
+static void test_realloc_keeps_contents(void)
+{
+  // slab to a larger class, slab to large, large to large, then shrink
+  const uint32_t sizes[] = { 12, 40, 60, 300, 5000, 100, 20 };
+  uint32_t size = 10;
+  uint8_t *p = (uint8_t*)js_mem_alloc(size);
+  fill(p, size, 1);
+  for( uint32_t i = 0 ; i < sizeof(sizes) / sizeof(sizes[0]) ; i++ ){
+    p = (uint8_t*)js_mem_realloc(p, sizes[i]);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL_UINT32(0, (uintptr_t)p % JS_MEM_ALIGN);
+    uint32_t kept = size < sizes[i] ? size : sizes[i];
+    TEST_ASSERT_TRUE(check(p, kept, 1));
+    size = sizes[i];
+    fill(p, size, 1);
+  }
+  TEST_ASSERT_NULL(js_mem_realloc(p, 0));
+}
+
+static void test_pool_cap_falls_back(void)
+{
+  std::vector<void*> blocks;
+  JS_MEM_INFO info;
+  do{
+    void *p = js_mem_alloc(16);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL_UINT32(0, (uintptr_t)p % JS_MEM_ALIGN);
+    blocks.push_back(p);
+    js_mem_get_info(&info);
+  }while( info.slab_fallback < 10 );
+
+  TEST_ASSERT_EQUAL_UINT32(JS_MEM_SLAB_MAX_BYTES / JS_MEM_SLAB_CHUNK_SIZE, info.slab_chunks);
+  TEST_ASSERT_EQUAL_UINT32(10, info.large_count);
+  for( void *p : blocks )
+    js_mem_free(p);
+  js_mem_get_info(&info);
+  TEST_ASSERT_EQUAL_UINT32(0, info.slab_used);
+  TEST_ASSERT_EQUAL_UINT32(0, info.large_count);
+}
+
+static void test_trace_replay(void)
+{
+  std::vector<TRACE_OP> trace = make_trace(TRACE_NUM_OPS);
+  std::vector<void*> blocks(TRACE_LIVE_MAX, NULL);
+  std::vector<uint32_t> sizes(TRACE_LIVE_MAX, 0);
+  for( const TRACE_OP &op : trace ){
+    switch( op.type ){
+      case TRACE_ALLOC:
+        blocks[op.slot] = js_mem_alloc(op.size);
+        TEST_ASSERT_NOT_NULL(blocks[op.slot]);
+        sizes[op.slot] = op.size;
+        fill(blocks[op.slot], op.size, op.slot);
+        break;
+      case TRACE_REALLOC: {
+        uint32_t kept = sizes[op.slot] < op.size ? sizes[op.slot] : op.size;
+        blocks[op.slot] = js_mem_realloc(blocks[op.slot], op.size);
+        TEST_ASSERT_NOT_NULL(blocks[op.slot]);
+        TEST_ASSERT_TRUE(check(blocks[op.slot], kept, op.slot));
+        sizes[op.slot] = op.size;
+        fill(blocks[op.slot], op.size, op.slot);
+        break;
+      }
+      case TRACE_FREE:
+        TEST_ASSERT_TRUE(check(blocks[op.slot], sizes[op.slot], op.slot));
+        js_mem_free(blocks[op.slot]);
+        blocks[op.slot] = NULL;
+        break;
+    }
+    if( blocks[op.slot] != NULL )
+      TEST_ASSERT_EQUAL_UINT32(0, (uintptr_t)blocks[op.slot] % JS_MEM_ALIGN);
+  }
+
+  JS_MEM_INFO info;
+  js_mem_get_info(&info);
+  TEST_ASSERT_EQUAL_UINT32(0, info.slab_used);
+  TEST_ASSERT_EQUAL_UINT32(0, info.large_count);
+}
+
+// the same trace through js_mem_* and through malloc, only reported
+static void test_trace_benchmark(void)
+{
+  std::vector<TRACE_OP> trace = make_trace(TRACE_NUM_OPS);
+  std::vector<void*> blocks(TRACE_LIVE_MAX, NULL);
+
+  auto start = std::chrono::steady_clock::now();
+  for( const TRACE_OP &op : trace ){
+    switch( op.type ){
+      case TRACE_ALLOC: blocks[op.slot] = js_mem_alloc(op.size); break;
+      case TRACE_REALLOC: blocks[op.slot] = js_mem_realloc(blocks[op.slot], op.size); break;
+      case TRACE_FREE: js_mem_free(blocks[op.slot]); break;
+    }
+  }
+  auto middle = std::chrono::steady_clock::now();
+  for( const TRACE_OP &op : trace ){
+    switch( op.type ){
+      case TRACE_ALLOC: blocks[op.slot] = malloc(op.size); break;
+      case TRACE_REALLOC: blocks[op.slot] = realloc(blocks[op.slot], op.size); break;
+      case TRACE_FREE: free(blocks[op.slot]); break;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  double js_mem_ns = std::chrono::duration<double, std::nano>(middle - start).count() / trace.size();
+  double malloc_ns = std::chrono::duration<double, std::nano>(end - middle).count() / trace.size();
+  char message[128];
+  snprintf(message, sizeof(message), "%u ops, js_mem %.1f ns/op, malloc %.1f ns/op",
+           (unsigned int)trace.size(), js_mem_ns, malloc_ns);
+  TEST_MESSAGE(message);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_alignment_and_usable_size);
+  RUN_TEST(test_realloc_keeps_contents);
+  RUN_TEST(test_pool_cap_falls_back);
+  RUN_TEST(test_trace_replay);
+  RUN_TEST(test_trace_benchmark);
+  return UNITY_END();
+}
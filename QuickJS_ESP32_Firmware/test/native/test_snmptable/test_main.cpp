@@ -0,0 +1,335 @@
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include "lib_snmptable.h"
+
+#define TABLE_BASE    ".1.3.6.1.4.1.8072.9999.10"
+#define PRIVATE_BASE  ".1.3.6.1.4.1.8072.9999"
+
+// snmpget -v2c -c public <host> .1.3.6.1.2.1.1.3.0
+static const uint8_t g_get_sysuptime[] = {
+  0x30, 0x26, 0x02, 0x01, 0x01, 0x04, 0x06, 'p', 'u', 'b', 'l', 'i', 'c',
+  0xa0, 0x19, 0x02, 0x01, 0x01, 0x02, 0x01, 0x00, 0x02, 0x01, 0x00,
+  0x30, 0x0e, 0x30, 0x0c, 0x06, 0x08, 0x2b, 0x06, 0x01, 0x02, 0x01, 0x01, 0x03, 0x00, 0x05, 0x00
+};
+
+static SNMP_TABLE g_tables[2];
+
+static std::vector<uint32_t> oid_of(const char *p_str)
+{
+  std::vector<uint32_t> oid;
+  TEST_ASSERT_TRUE(snmp_oid_parse(p_str, oid));
+  return oid;
+}
+
+static std::vector<uint32_t> cell_oid(unsigned int column, unsigned int row)
+{
+  std::vector<uint32_t> oid = oid_of(TABLE_BASE);
+  oid.push_back(1);
+  oid.push_back(column);
+  oid.push_back(row);
+  return oid;
+}
+
+static SNMP_VARBIND varbind_of(const std::vector<uint32_t> &oid, std::vector<uint8_t> value)
+{
+  SNMP_VARBIND varbind;
+  varbind.oid = oid;
+  varbind.value = value;
+  return varbind;
+}
+
+static SNMP_MESSAGE message_of(uint8_t pdu_type, int32_t version, int32_t status, int32_t index)
+{
+  SNMP_MESSAGE message;
+  message.version = version;
+  message.community = "public";
+  message.pdu_type = pdu_type;
+  message.request_id = 0x1234;
+  message.error_status = status;
+  message.error_index = index;
+  return message;
+}
+
+static const std::vector<uint8_t> END_OF_MIB = { 0x82, 0x00 };
+static const std::vector<uint8_t> INTEGER_7 = { 0x02, 0x01, 0x07 };
+
+void setUp(void)
+{
+  // columns: name(string), value(number), updated(timestamp); rows: 3
+  SNMP_TABLE *p_table = &g_tables[0];
+  p_table->used = true;
+  snmp_oid_parse(TABLE_BASE, p_table->oid_base);
+  p_table->num_columns = 3;
+  p_table->types[0] = SNMP_COLUMN_STRING;
+  p_table->types[1] = SNMP_COLUMN_NUMBER;
+  p_table->types[2] = SNMP_COLUMN_TIMESTAMP;
+  p_table->num_rows = 3;
+  p_table->cells.assign(9, SNMP_TABLE_CELL{ 0, "" });
+  for( unsigned int row = 0 ; row < 3 ; row++ ){
+    p_table->cells[row * 3 + 0].str = std::string("row") + std::to_string(row + 1);
+    p_table->cells[row * 3 + 1].number = (row == 2) ? -200 : (int)(row + 1) * 100;
+    p_table->cells[row * 3 + 2].number = 3000000000U;
+  }
+  g_tables[1].used = false;
+}
+
+void tearDown(void)
+{
+}
+
+static void test_oid_parse_compare(void)
+{
+  std::vector<uint32_t> oid;
+  TEST_ASSERT_TRUE(snmp_oid_parse(".1.3.6.1.2.1.1.3.0", oid));
+  TEST_ASSERT_EQUAL(9, oid.size());
+  TEST_ASSERT_EQUAL(3, oid[7]);
+  TEST_ASSERT_TRUE(snmp_oid_parse("1.3.6", oid));
+  TEST_ASSERT_FALSE(snmp_oid_parse(".1.3..6", oid));
+  TEST_ASSERT_FALSE(snmp_oid_parse(".1.3.6.", oid));
+  TEST_ASSERT_FALSE(snmp_oid_parse(".1.3.x", oid));
+  TEST_ASSERT_FALSE(snmp_oid_parse(".1", oid));
+
+  TEST_ASSERT_TRUE(snmp_oid_compare(oid_of(".1.3.6"), oid_of(".1.3.6.1")) < 0);
+  TEST_ASSERT_TRUE(snmp_oid_compare(oid_of(".1.3.7"), oid_of(".1.3.6.1")) > 0);
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(oid_of(".1.3.6.1"), oid_of("1.3.6.1")));
+}
+
+static void test_message_round_trip(void)
+{
+  SNMP_MESSAGE message;
+  TEST_ASSERT_TRUE(snmp_message_decode(g_get_sysuptime, sizeof(g_get_sysuptime), &message));
+  TEST_ASSERT_EQUAL(1, message.version);
+  TEST_ASSERT_EQUAL_STRING("public", message.community.c_str());
+  TEST_ASSERT_EQUAL_HEX8(SNMP_PDU_GET, message.pdu_type);
+  TEST_ASSERT_EQUAL(1, message.request_id);
+  TEST_ASSERT_EQUAL(1, message.varbinds.size());
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(oid_of(SNMP_TABLE_PLACEHOLDER_OID), message.varbinds[0].oid));
+
+  std::vector<uint8_t> encoded;
+  snmp_message_encode(&message, encoded);
+  TEST_ASSERT_EQUAL(sizeof(g_get_sysuptime), encoded.size());
+  TEST_ASSERT_EQUAL_MEMORY(g_get_sysuptime, encoded.data(), encoded.size());
+
+  // truncated input never reads past the end
+  for( size_t length = 0 ; length < sizeof(g_get_sysuptime) ; length++ )
+    TEST_ASSERT_FALSE(snmp_message_decode(g_get_sysuptime, length, &message));
+}
+
+static void test_table_find_next(void)
+{
+  unsigned int column, row;
+  TEST_ASSERT_TRUE(snmp_table_find(&g_tables[0], cell_oid(2, 3), &column, &row));
+  TEST_ASSERT_EQUAL(2, column);
+  TEST_ASSERT_EQUAL(3, row);
+  TEST_ASSERT_FALSE(snmp_table_find(&g_tables[0], cell_oid(4, 1), &column, &row));
+  TEST_ASSERT_FALSE(snmp_table_find(&g_tables[0], cell_oid(1, 4), &column, &row));
+  TEST_ASSERT_FALSE(snmp_table_find(&g_tables[0], cell_oid(1, 0), &column, &row));
+
+  // walking from before the table visits every cell column by column, then leaves
+  std::vector<uint32_t> oid = oid_of(PRIVATE_BASE ".3.2");
+  unsigned int visited = 0;
+  while( snmp_table_next(&g_tables[0], oid, &column, &row) ){
+    TEST_ASSERT_EQUAL(visited / 3 + 1, column);
+    TEST_ASSERT_EQUAL(visited % 3 + 1, row);
+    std::vector<uint32_t> next = cell_oid(column, row);
+    TEST_ASSERT_TRUE(snmp_oid_compare(oid, next) < 0);
+    oid = next;
+    visited++;
+  }
+  TEST_ASSERT_EQUAL(9, visited);
+
+  // partial and in-between OIDs
+  TEST_ASSERT_TRUE(snmp_table_next(&g_tables[0], oid_of(TABLE_BASE), &column, &row));
+  TEST_ASSERT_EQUAL(1, column);
+  TEST_ASSERT_EQUAL(1, row);
+  TEST_ASSERT_TRUE(snmp_table_next(&g_tables[0], oid_of(TABLE_BASE ".1.2"), &column, &row));
+  TEST_ASSERT_EQUAL(2, column);
+  TEST_ASSERT_EQUAL(1, row);
+  TEST_ASSERT_TRUE(snmp_table_next(&g_tables[0], oid_of(TABLE_BASE ".1.2.1.5"), &column, &row));
+  TEST_ASSERT_EQUAL(2, column);
+  TEST_ASSERT_EQUAL(2, row);
+  TEST_ASSERT_TRUE(snmp_table_next(&g_tables[0], oid_of(TABLE_BASE ".1.1.9"), &column, &row));
+  TEST_ASSERT_EQUAL(2, column);
+  TEST_ASSERT_EQUAL(1, row);
+  TEST_ASSERT_FALSE(snmp_table_next(&g_tables[0], oid_of(TABLE_BASE ".1.4"), &column, &row));
+  TEST_ASSERT_FALSE(snmp_table_next(&g_tables[0], oid_of(TABLE_BASE ".2"), &column, &row));
+  TEST_ASSERT_FALSE(snmp_table_next(&g_tables[0], oid_of(PRIVATE_BASE ".11"), &column, &row));
+}
+
+static void test_large_table_walk(void)
+{
+  // far beyond what per-cell agent handlers allowed
+  SNMP_TABLE *p_table = &g_tables[1];
+  p_table->used = true;
+  snmp_oid_parse(PRIVATE_BASE ".20", p_table->oid_base);
+  p_table->num_columns = SNMP_TABLE_MAX_COLUMNS;
+  memset(p_table->types, SNMP_COLUMN_NUMBER, sizeof(p_table->types));
+  p_table->num_rows = 256;
+  p_table->cells.assign(SNMP_TABLE_MAX_COLUMNS * 256, SNMP_TABLE_CELL{ 1, "" });
+
+  std::vector<uint32_t> oid = p_table->oid_base;
+  unsigned int column, row, visited = 0;
+  while( snmp_table_next(p_table, oid, &column, &row) ){
+    oid = p_table->oid_base;
+    oid.push_back(1);
+    oid.push_back(column);
+    oid.push_back(row);
+    visited++;
+  }
+  TEST_ASSERT_EQUAL(SNMP_TABLE_MAX_COLUMNS * 256, visited);
+}
+
+static void test_get_rewrite_merge(void)
+{
+  SNMP_MESSAGE original = message_of(SNMP_PDU_GET, 1, 0, 0);
+  original.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".1.0"), { 0x05, 0x00 }));
+  original.varbinds.push_back(varbind_of(cell_oid(1, 2), { 0x05, 0x00 }));
+  original.varbinds.push_back(varbind_of(cell_oid(2, 3), { 0x05, 0x00 }));
+  original.varbinds.push_back(varbind_of(cell_oid(3, 1), { 0x05, 0x00 }));
+
+  SNMP_MESSAGE request = original;
+  TEST_ASSERT_TRUE(snmp_tables_rewrite_request(g_tables, 2, &request));
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(original.varbinds[0].oid, request.varbinds[0].oid));
+  for( int i = 1 ; i < 4 ; i++ )
+    TEST_ASSERT_EQUAL(0, snmp_oid_compare(oid_of(SNMP_TABLE_PLACEHOLDER_OID), request.varbinds[i].oid));
+
+  // what the agent answers to the rewritten request
+  SNMP_MESSAGE response = message_of(SNMP_PDU_RESPONSE, 1, 0, 0);
+  response.varbinds.push_back(varbind_of(request.varbinds[0].oid, INTEGER_7));
+  for( int i = 1 ; i < 4 ; i++ )
+    response.varbinds.push_back(varbind_of(request.varbinds[i].oid, { 0x43, 0x01, 0x10 }));
+
+  TEST_ASSERT_TRUE(snmp_tables_merge_response(g_tables, 2, &original, &response, 1400));
+  TEST_ASSERT_EQUAL_MEMORY(INTEGER_7.data(), response.varbinds[0].value.data(), 3);
+  const uint8_t string_row2[] = { 0x04, 0x04, 'r', 'o', 'w', '2' };
+  TEST_ASSERT_EQUAL(sizeof(string_row2), response.varbinds[1].value.size());
+  TEST_ASSERT_EQUAL_MEMORY(string_row2, response.varbinds[1].value.data(), sizeof(string_row2));
+  const uint8_t integer_minus200[] = { 0x02, 0x02, 0xff, 0x38 };
+  TEST_ASSERT_EQUAL(sizeof(integer_minus200), response.varbinds[2].value.size());
+  TEST_ASSERT_EQUAL_MEMORY(integer_minus200, response.varbinds[2].value.data(), sizeof(integer_minus200));
+  // 3000000000 / 10 = 300000000 = 0x11e1a300
+  const uint8_t timeticks[] = { 0x43, 0x04, 0x11, 0xe1, 0xa3, 0x00 };
+  TEST_ASSERT_EQUAL(sizeof(timeticks), response.varbinds[3].value.size());
+  TEST_ASSERT_EQUAL_MEMORY(timeticks, response.varbinds[3].value.data(), sizeof(timeticks));
+  for( int i = 1 ; i < 4 ; i++ )
+    TEST_ASSERT_EQUAL(0, snmp_oid_compare(original.varbinds[i].oid, response.varbinds[i].oid));
+
+  // the merged message still decodes
+  std::vector<uint8_t> encoded;
+  snmp_message_encode(&response, encoded);
+  SNMP_MESSAGE decoded;
+  TEST_ASSERT_TRUE(snmp_message_decode(encoded.data(), encoded.size(), &decoded));
+  TEST_ASSERT_EQUAL(4, decoded.varbinds.size());
+  TEST_ASSERT_EQUAL(0x1234, decoded.request_id);
+
+  // requests without cells are left to the agent alone
+  SNMP_MESSAGE plain = message_of(SNMP_PDU_GET, 1, 0, 0);
+  plain.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".1.0"), { 0x05, 0x00 }));
+  TEST_ASSERT_FALSE(snmp_tables_rewrite_request(g_tables, 2, &plain));
+}
+
+static void test_getnext_merge(void)
+{
+  SNMP_MESSAGE request = message_of(SNMP_PDU_GETNEXT, 1, 0, 0);
+  request.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".3.2"), { 0x05, 0x00 }));
+  request.varbinds.push_back(varbind_of(cell_oid(1, 3), { 0x05, 0x00 }));
+  request.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".1.0"), { 0x05, 0x00 }));
+  request.varbinds.push_back(varbind_of(cell_oid(3, 3), { 0x05, 0x00 }));
+  TEST_ASSERT_TRUE(snmp_tables_rewrite_request(g_tables, 2, &request));
+
+  // the agent knows nothing after .3.2, skips the table from inside it, and has .1.1 after .1.0
+  SNMP_MESSAGE response = message_of(SNMP_PDU_RESPONSE, 1, 0, 0);
+  response.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".3.2"), END_OF_MIB));
+  response.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".3.2"), END_OF_MIB));
+  response.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".1.1"), INTEGER_7));
+  response.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".3.2"), END_OF_MIB));
+
+  TEST_ASSERT_TRUE(snmp_tables_merge_response(g_tables, 2, &request, &response, 1400));
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(cell_oid(1, 1), response.varbinds[0].oid));
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(cell_oid(2, 1), response.varbinds[1].oid));
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(oid_of(PRIVATE_BASE ".1.1"), response.varbinds[2].oid));
+  TEST_ASSERT_EQUAL_HEX8(0x82, response.varbinds[3].value[0]);
+}
+
+static void test_getnext_v1_end_of_agent(void)
+{
+  SNMP_MESSAGE request = message_of(SNMP_PDU_GETNEXT, 0, 0, 0);
+  request.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".3.2"), { 0x05, 0x00 }));
+
+  SNMP_MESSAGE response = message_of(SNMP_PDU_RESPONSE, 0, 2, 1);
+  response.varbinds = request.varbinds;
+  TEST_ASSERT_TRUE(snmp_tables_merge_response(g_tables, 2, &request, &response, 1400));
+  TEST_ASSERT_EQUAL(0, response.error_status);
+  TEST_ASSERT_EQUAL(0, response.error_index);
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(cell_oid(1, 1), response.varbinds[0].oid));
+
+  // past the table the agent's error stands
+  request.varbinds[0].oid = cell_oid(3, 3);
+  response = message_of(SNMP_PDU_RESPONSE, 0, 2, 1);
+  response.varbinds = request.varbinds;
+  TEST_ASSERT_FALSE(snmp_tables_merge_response(g_tables, 2, &request, &response, 1400));
+  TEST_ASSERT_EQUAL(2, response.error_status);
+}
+
+static void test_getbulk_merge(void)
+{
+  // non-repeaters 1, max-repetitions 6
+  SNMP_MESSAGE request = message_of(SNMP_PDU_GETBULK, 1, 1, 6);
+  request.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".1.0"), { 0x05, 0x00 }));
+  request.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".3.1"), { 0x05, 0x00 }));
+  request.varbinds.push_back(varbind_of(cell_oid(2, 2), { 0x05, 0x00 }));
+  TEST_ASSERT_TRUE(snmp_tables_rewrite_request(g_tables, 2, &request));
+
+  SNMP_MESSAGE response = message_of(SNMP_PDU_RESPONSE, 1, 0, 0);
+  response.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".1.1"), INTEGER_7));
+  for( int r = 0 ; r < 6 ; r++ ){
+    if( r == 0 )
+      response.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".3.2"), INTEGER_7));
+    else
+      response.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".3.2"), END_OF_MIB));
+    response.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".3.2"), END_OF_MIB));
+  }
+
+  TEST_ASSERT_TRUE(snmp_tables_merge_response(g_tables, 2, &request, &response, 1400));
+  TEST_ASSERT_EQUAL(1 + 2 * 6, response.varbinds.size());
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(oid_of(PRIVATE_BASE ".1.1"), response.varbinds[0].oid));
+  // first repeater: the agent's .3.2, then the table from its start
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(oid_of(PRIVATE_BASE ".3.2"), response.varbinds[1].oid));
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(cell_oid(1, 1), response.varbinds[3].oid));
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(cell_oid(1, 2), response.varbinds[5].oid));
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(cell_oid(2, 2), response.varbinds[11].oid));
+  // second repeater: the rest of the table, then the end of the MIB
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(cell_oid(2, 3), response.varbinds[2].oid));
+  TEST_ASSERT_EQUAL(0, snmp_oid_compare(cell_oid(3, 3), response.varbinds[8].oid));
+  TEST_ASSERT_EQUAL_HEX8(0x82, response.varbinds[10].value[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x82, response.varbinds[12].value[0]);
+
+  // a small size limit drops whole repetitions
+  SNMP_MESSAGE limited = message_of(SNMP_PDU_RESPONSE, 1, 0, 0);
+  limited.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".1.1"), INTEGER_7));
+  for( int r = 0 ; r < 6 ; r++ ){
+    limited.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".3.2"), END_OF_MIB));
+    limited.varbinds.push_back(varbind_of(oid_of(PRIVATE_BASE ".3.2"), END_OF_MIB));
+  }
+  TEST_ASSERT_TRUE(snmp_tables_merge_response(g_tables, 2, &request, &limited, 150));
+  std::vector<uint8_t> encoded;
+  snmp_message_encode(&limited, encoded);
+  TEST_ASSERT_TRUE(encoded.size() <= 150);
+  TEST_ASSERT_EQUAL(0, (limited.varbinds.size() - 1) % 2);
+  TEST_ASSERT_TRUE(limited.varbinds.size() < 1 + 2 * 6);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_oid_parse_compare);
+  RUN_TEST(test_message_round_trip);
+  RUN_TEST(test_table_find_next);
+  RUN_TEST(test_large_table_walk);
+  RUN_TEST(test_get_rewrite_merge);
+  RUN_TEST(test_getnext_merge);
+  RUN_TEST(test_getnext_v1_end_of_agent);
+  RUN_TEST(test_getbulk_merge);
+  return UNITY_END();
+}
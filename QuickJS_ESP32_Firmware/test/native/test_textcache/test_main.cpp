@@ -0,0 +1,228 @@
+#include <unity.h>
+#include <string.h>
+#include <vector>
+#include "lib_textcache.h"
+
+#define GLYPH_MASK_SIZE   32 // 16x16 at 1bpp
+#define GLYPH_BUDGET      (32 * 1024)
+
+// the strings a Japanese dashboard redraws every frame
+static const char *g_strings[] = {
+  "温度 23.5℃",
+  "湿度 45%",
+  "気圧 1013hPa",
+  "東京都千代田区",
+  "こんにちは、世界",
+  "ｶﾀｶﾅ半角テスト",
+  "電池残量 87%",
+  "接続中…",
+};
+#define NUM_OF_STRINGS  (sizeof(g_strings) / sizeof(g_strings[0]))
+
+static uint32_t g_released;
+
+static void count_release(void *p_value)
+{
+  g_released++;
+  delete (uint32_t*)p_value;
+}
+
+void setUp(void)
+{
+  g_released = 0;
+}
+
+void tearDown(void)
+{
+}
+
+static void test_utf8_decode(void)
+{
+  uint32_t code;
+  TEST_ASSERT_EQUAL_INT(1, textcache_utf8_next("A", &code));
+  TEST_ASSERT_EQUAL_UINT32('A', code);
+  TEST_ASSERT_EQUAL_INT(3, textcache_utf8_next("温", &code));
+  TEST_ASSERT_EQUAL_UINT32(0x6e29, code);
+  TEST_ASSERT_EQUAL_INT(3, textcache_utf8_next("℃", &code));
+  TEST_ASSERT_EQUAL_UINT32(0x2103, code);
+  TEST_ASSERT_EQUAL_INT(3, textcache_utf8_next("ｶ", &code));
+  TEST_ASSERT_EQUAL_UINT32(0xff76, code);
+  TEST_ASSERT_EQUAL_INT(4, textcache_utf8_next("\xf0\x9f\x98\x80", &code));
+  TEST_ASSERT_EQUAL_UINT32(0x1f600, code);
+  // truncated sequence and a bare continuation byte
+  TEST_ASSERT_EQUAL_INT(0, textcache_utf8_next("\xe6\xb8", &code));
+  TEST_ASSERT_EQUAL_INT(0, textcache_utf8_next("\x80", &code));
+}
+
+static void test_cacheable(void)
+{
+  TEST_ASSERT_TRUE(textcache_cacheable("東京都千代田区", 128));
+  TEST_ASSERT_FALSE(textcache_cacheable("", 128));
+  TEST_ASSERT_FALSE(textcache_cacheable("line\nbreak", 128));
+  // the limit is in bytes, 3 per kanji
+  TEST_ASSERT_TRUE(textcache_cacheable("温度湿度", 12));
+  TEST_ASSERT_FALSE(textcache_cacheable("温度湿度", 11));
+}
+
+static void test_run_key(void)
+{
+  static int font_a, font_b;
+  std::string key = textcache_run_key(&font_a, 1, 1, 0xffffff, 0x000000, false, "温度");
+  TEST_ASSERT_TRUE(key == textcache_run_key(&font_a, 1, 1, 0xffffff, 0x000000, false, "温度"));
+  TEST_ASSERT_FALSE(key == textcache_run_key(&font_b, 1, 1, 0xffffff, 0x000000, false, "温度"));
+  TEST_ASSERT_FALSE(key == textcache_run_key(&font_a, 2, 1, 0xffffff, 0x000000, false, "温度"));
+  TEST_ASSERT_FALSE(key == textcache_run_key(&font_a, 1, 1.5f, 0xffffff, 0x000000, false, "温度"));
+  TEST_ASSERT_FALSE(key == textcache_run_key(&font_a, 1, 1, 0xff0000, 0x000000, false, "温度"));
+  TEST_ASSERT_FALSE(key == textcache_run_key(&font_a, 1, 1, 0xffffff, 0x0000ff, false, "温度"));
+  TEST_ASSERT_FALSE(key == textcache_run_key(&font_a, 1, 1, 0xffffff, 0x000000, false, "湿度"));
+  // transparent runs share a key whatever the background
+  TEST_ASSERT_FALSE(key == textcache_run_key(&font_a, 1, 1, 0xffffff, 0x000000, true, "温度"));
+  TEST_ASSERT_TRUE(textcache_run_key(&font_a, 1, 1, 0xffffff, 0x123456, true, "温度") ==
+                   textcache_run_key(&font_a, 1, 1, 0xffffff, 0x654321, true, "温度"));
+
+  TEST_ASSERT_TRUE(textcache_glyph_key(&font_a, 0x6e29) != textcache_glyph_key(&font_b, 0x6e29));
+  TEST_ASSERT_TRUE(textcache_glyph_key(&font_a, 0x6e29) != textcache_glyph_key(&font_a, 0x6e7f));
+}
+
+static void test_lru_eviction(void)
+{
+  TextCache<std::string> cache(count_release);
+  cache.setBudget(300);
+  TEST_ASSERT_TRUE(cache.insert("a", new uint32_t(1), 100));
+  TEST_ASSERT_TRUE(cache.insert("b", new uint32_t(2), 100));
+  TEST_ASSERT_TRUE(cache.insert("c", new uint32_t(3), 100));
+  TEST_ASSERT_EQUAL_UINT32(300, cache.used());
+
+  // touching "a" makes "b" the oldest
+  TEST_ASSERT_NOT_NULL(cache.find("a"));
+  TEST_ASSERT_TRUE(cache.insert("d", new uint32_t(4), 100));
+  TEST_ASSERT_NULL(cache.find("b"));
+  TEST_ASSERT_NOT_NULL(cache.find("a"));
+  TEST_ASSERT_NOT_NULL(cache.find("c"));
+  TEST_ASSERT_EQUAL_UINT32(1, g_released);
+  TEST_ASSERT_EQUAL_UINT32(1, cache.evictions());
+  TEST_ASSERT_EQUAL_UINT32(3, cache.hits());
+  TEST_ASSERT_EQUAL_UINT32(1, cache.misses());
+
+  // a value over the whole budget stays with the caller
+  uint32_t *p_large = new uint32_t(5);
+  TEST_ASSERT_FALSE(cache.insert("e", p_large, 301));
+  delete p_large;
+  TEST_ASSERT_EQUAL_UINT32(3, cache.count());
+
+  // one that needs two slots evicts the two oldest: "d" then "a"
+  TEST_ASSERT_TRUE(cache.insert("f", new uint32_t(6), 200));
+  TEST_ASSERT_EQUAL_UINT32(2, cache.count());
+  TEST_ASSERT_EQUAL_UINT32(300, cache.used());
+  TEST_ASSERT_NOT_NULL(cache.find("c"));
+  TEST_ASSERT_NULL(cache.find("d"));
+
+  cache.setBudget(150);
+  TEST_ASSERT_EQUAL_UINT32(1, cache.count());
+  TEST_ASSERT_EQUAL_UINT32(100, cache.used());
+  cache.clear();
+  TEST_ASSERT_EQUAL_UINT32(0, cache.count());
+  TEST_ASSERT_EQUAL_UINT32(0, cache.used());
+  TEST_ASSERT_EQUAL_UINT32(5, g_released);
+}
+
+static void test_zero_size_entries(void)
+{
+  // glyphs like a space have no mask
+  TextCache<uint64_t> cache(count_release);
+  uint32_t value = 0;
+  // nothing is kept while the cache is off
+  TEST_ASSERT_FALSE(cache.insert(1, &value, 0));
+  TEST_ASSERT_EQUAL_UINT32(0, cache.count());
+  cache.setBudget(64);
+  TEST_ASSERT_TRUE(cache.insert(2, new uint32_t(0), 0));
+  TEST_ASSERT_TRUE(cache.insert(3, new uint32_t(0), 0));
+  // a key that is already there is not replaced
+  TEST_ASSERT_FALSE(cache.insert(3, &value, 0));
+  TEST_ASSERT_EQUAL_UINT32(2, cache.count());
+  TEST_ASSERT_EQUAL_UINT32(0, cache.used());
+  cache.setBudget(0);
+  TEST_ASSERT_EQUAL_UINT32(0, cache.count());
+  TEST_ASSERT_EQUAL_UINT32(2, g_released);
+}
+
+// what lcd_text_run_get/lcd_glyph_get do for every drawText, without the pixels
+static void draw_strings(TextCache<std::string> *p_runs, TextCache<uint64_t> *p_glyphs, const void *font, uint32_t fore)
+{
+  for( uint32_t i = 0 ; i < NUM_OF_STRINGS ; i++ ){
+    std::string key = textcache_run_key(font, 1, 1, fore, 0, false, g_strings[i]);
+    if( p_runs->find(key) != NULL )
+      continue;
+    uint32_t width = 0;
+    for( const char *p = g_strings[i] ; *p != '\0' ; ){
+      uint32_t code;
+      int len = textcache_utf8_next(p, &code);
+      TEST_ASSERT_GREATER_THAN(0, len);
+      p += len;
+      uint64_t glyph_key = textcache_glyph_key(font, code);
+      if( p_glyphs->find(glyph_key) == NULL )
+        TEST_ASSERT_TRUE(p_glyphs->insert(glyph_key, new uint32_t(code), GLYPH_MASK_SIZE));
+      width += 16;
+    }
+    TEST_ASSERT_TRUE(p_runs->insert(key, new uint32_t(i), width * 16 * 2));
+  }
+}
+
+static void test_japanese_string_set(void)
+{
+  TextCache<std::string> runs(count_release);
+  TextCache<uint64_t> glyphs(count_release);
+  runs.setBudget(64 * 1024);
+  glyphs.setBudget(GLYPH_BUDGET);
+  static int font;
+
+  // unique codepoints of the set
+  std::vector<uint32_t> codes;
+  for( uint32_t i = 0 ; i < NUM_OF_STRINGS ; i++ ){
+    for( const char *p = g_strings[i] ; *p != '\0' ; ){
+      uint32_t code;
+      p += textcache_utf8_next(p, &code);
+      bool found = false;
+      for( uint32_t c : codes )
+        found = found || (c == code);
+      if( !found )
+        codes.push_back(code);
+    }
+  }
+
+  // the first frame renders everything, the next 59 only hit
+  for( int frame = 0 ; frame < 60 ; frame++ )
+    draw_strings(&runs, &glyphs, &font, 0xffffff);
+  TEST_ASSERT_EQUAL_UINT32(NUM_OF_STRINGS, runs.count());
+  TEST_ASSERT_EQUAL_UINT32(NUM_OF_STRINGS, runs.misses());
+  TEST_ASSERT_EQUAL_UINT32(NUM_OF_STRINGS * 59, runs.hits());
+  TEST_ASSERT_EQUAL_UINT32(codes.size(), glyphs.count());
+  TEST_ASSERT_EQUAL_UINT32(codes.size(), glyphs.misses());
+  TEST_ASSERT_EQUAL_UINT32(0, runs.evictions());
+
+  // a color change builds new runs from the glyphs already cached
+  uint32_t glyph_misses = glyphs.misses();
+  draw_strings(&runs, &glyphs, &font, 0xff0000);
+  TEST_ASSERT_EQUAL_UINT32(glyph_misses, glyphs.misses());
+  TEST_ASSERT_EQUAL_UINT32(NUM_OF_STRINGS * 2, runs.count());
+
+  // a run budget for a quarter of them keeps evicting but stays within it
+  runs.setBudget(runs.used() / 4);
+  for( int frame = 0 ; frame < 10 ; frame++ )
+    draw_strings(&runs, &glyphs, &font, 0xffffff);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(runs.budget(), runs.used());
+  TEST_ASSERT_GREATER_THAN_UINT32(0, runs.evictions());
+  TEST_ASSERT_EQUAL_UINT32(glyph_misses, glyphs.misses());
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_utf8_decode);
+  RUN_TEST(test_cacheable);
+  RUN_TEST(test_run_key);
+  RUN_TEST(test_lru_eviction);
+  RUN_TEST(test_zero_size_entries);
+  RUN_TEST(test_japanese_string_set);
+  return UNITY_END();
+}